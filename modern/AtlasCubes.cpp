@@ -0,0 +1,553 @@
+/*
+ * @author Jacob William
+ * @desc This program draws a grid of cubes that each have their own texture.
+ *       By default the textures go into a material table, bindless handles
+ *       when the driver has them and one packed array texture otherwise, and
+ *       the whole grid is one instanced draw. Run with -array to force the
+ *       array texture, or -binds to bind every texture separately and draw
+ *       cube by cube instead.
+ *
+ */
+
+#include <iostream> 		// C++ I/O library
+#include <cstdlib>
+#include <vector>
+#include <GL/glew.h>		// Glew header
+#include <GL/freeglut.h>	// freeglut header
+
+// Importing glm headers
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// SOIL2 library import
+#include "SOIL2/SOIL2.h"
+
+#include "common/MaterialTable.h"
+
+// Use the standard name spaces
+using namespace std;
+
+// Global title name given to the window
+#define WINDOW_TITLE "Jacob William"
+
+// Vertex and  Fragment Shader
+#ifndef GLSL
+#define GLSL(Version, Source) "#version " #Version "\n" #Source
+#endif
+
+// Shader body without a version line, the material table adds its own
+#ifndef GLSL_BODY
+#define GLSL_BODY(Source) #Source
+#endif
+
+// Declaration of variables
+GLuint VAO, VBO, instanceVBO;
+GLint materialProgram, bindProgram, WindowWidth = 800, WindowHeight = 600;
+
+// One texture per cube for the -binds path
+vector<GLuint> textures;
+
+// Bindless handles or packed array texture for the one draw path
+UMaterialTable materials;
+
+// Cubes along each side of the grid, 10 gives 1,000 distinct textures
+int gridSize = 10;
+int cubeCount;
+
+// Bind every texture on its own
+bool bindPerCube = false;
+
+// Skip bindless even when the driver has it
+bool forceArray = false;
+
+// The -binds path draws cube i as instance i. Without GL 4.2 base instances
+// the index goes through a uniform and the shader places the cube itself
+bool baseInstance = true;
+
+// Frame timing and bind counting for the stats line
+int lastStatsTime = 0, framesSinceStats = 0;
+long bindsSinceStats = 0;
+
+/*
+ * Prototypes to init functions before implementation
+ */
+void UResizeWindow(int, int);
+void URenderGraphics(void);
+void UCloseWindow(void);
+void UCreateShader(void);
+void UCreateBuffers(void);
+void UGenerateTexture(void);
+
+
+/*
+ * Vertex shader source code, model and atlas region are per instance
+ */
+const GLchar* VertexShader = GLSL(330,
+		layout (location = 0) in vec3 position;
+		layout (location = 2) in vec2 textureCoordinates;
+		layout (location = 3) in mat4 model;
+		layout (location = 7) in vec4 region;
+		layout (location = 8) in float layer;
+
+		out vec2 mobileTextureCoordinate;
+		flat out float mobileLayer;
+
+		uniform mat4 view;
+		uniform mat4 projection;
+		void main() {
+			gl_Position = projection * view * model * vec4(position, 1.0f);
+			mobileTextureCoordinate = region.xy + vec2(textureCoordinates.x, 1.0f - textureCoordinates.y) * region.zw;
+			mobileLayer = layer;
+		}
+);
+
+/*
+ * Vertex shader for -binds without base instances, instanceOffset is the cube
+ * and the grid position is worked out the same way UCreateBuffers does
+ */
+const GLchar* OffsetVertexShader = GLSL(330,
+		layout (location = 0) in vec3 position;
+		layout (location = 2) in vec2 textureCoordinates;
+
+		out vec2 mobileTextureCoordinate;
+		flat out float mobileLayer;
+
+		uniform mat4 view;
+		uniform mat4 projection;
+		uniform int instanceOffset;
+		uniform int gridSize;
+		void main() {
+			int i = instanceOffset + gl_InstanceID;
+			ivec3 cell = ivec3(i % gridSize, (i / gridSize) % gridSize, i / (gridSize * gridSize));
+			vec3 translation = vec3(cell - ivec3(gridSize / 2)) * 2.0f;
+			gl_Position = projection * view * vec4(position + translation, 1.0f);
+			mobileTextureCoordinate = vec2(textureCoordinates.x, 1.0f - textureCoordinates.y);
+			mobileLayer = 0.0f;
+		}
+);
+
+/*
+ * Fragment Shader sampling the material table, mobileLayer is the material
+ */
+const GLchar* MaterialFragmentShader = GLSL_BODY(
+
+	in vec2 mobileTextureCoordinate;
+	flat in float mobileLayer;
+
+	out vec4 gpuTexture;
+
+	void main() {
+		gpuTexture = USampleMaterial(mobileLayer, mobileTextureCoordinate);
+	}
+);
+
+/*
+ * Fragment Shader sampling a single bound texture
+ */
+const GLchar* BindFragmentShader = GLSL(330,
+
+	in vec2 mobileTextureCoordinate;
+	flat in float mobileLayer;
+
+	out vec4 gpuTexture;
+
+	uniform sampler2D uTexture;
+	void main() {
+		gpuTexture = texture(uTexture, mobileTextureCoordinate);
+	}
+);
+
+// Main function
+int main(int argc, char * argv[]) {
+
+	// Initializes the OpenGL program properties
+	// Init freeglut
+	glutInit(&argc, argv);
+
+	for (int i = 1; i < argc; ++i) {
+		if (string(argv[i]) == "-binds") {
+			bindPerCube = true;
+		}
+		else if (string(argv[i]) == "-array") {
+			forceArray = true;
+		}
+		else {
+			char* end;
+			long size = strtol(argv[i], &end, 10);
+			if (end == argv[i] || *end != '\0' || size <= 0 || size > 1000) {
+				cout << "Grid size needs to be between 1 and 1000, not " << argv[i] << endl;
+				return -1;
+			}
+			gridSize = (int)size;
+		}
+	}
+	cubeCount = gridSize * gridSize * gridSize;
+
+	// Creates memory buffer for the window
+	glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA);
+
+	// Init the window with the given width*Height
+	glutInitWindowSize(WindowWidth, WindowHeight);
+
+	// Creates the window with the title
+	glutCreateWindow(WINDOW_TITLE);
+
+	// Sets the proper window size
+	glutReshapeFunc(UResizeWindow);
+
+	// Sets the result/status when initiatite
+	glewExperimental = GL_TRUE;
+	// Checks if there's an error
+	if (GLEW_OK !=  glewInit()) {
+		cout << "Failed to init GLEW" << endl;
+		return  -1;
+	}
+
+	baseInstance = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+
+	// Generates textures, needed before the buffers for the atlas regions
+	// and before the shaders, which depend on the material table mode
+	UGenerateTexture();
+
+	// Calls the function to create shader
+	UCreateShader();
+
+	// Calls the function to create the cube and the instance data
+	UCreateBuffers();
+
+	// Sets the background color to clear
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+	// Renders graphics in the window
+	glutDisplayFunc(URenderGraphics);
+
+	// Frees the GL objects while the context still exists, GLUT exits
+	// from inside the loop
+	glutCloseFunc(UCloseWindow);
+
+	// Starts the OpenGL loop in the background
+	glutMainLoop();
+
+	// Termination of the program due to a successful exit
+	return 0;
+}
+
+/*
+ * @desc This function resize the program's GUI window
+ * @parameters height, width
+ * @return void
+ */
+void UResizeWindow(int width, int height) {
+	WindowWidth = width;
+	WindowHeight = height;
+	glViewport(0, 0, width, height);
+}
+
+/*
+ * @desc Frees every buffer and texture before the window goes away
+ * @returns void
+ */
+void UCloseWindow(void) {
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &instanceVBO);
+	materials.Destroy();
+	glDeleteTextures((GLsizei)textures.size(), textures.data());
+	glDeleteProgram(materialProgram);
+	glDeleteProgram(bindProgram);
+}
+
+/*
+ * @desc This function handles the rendering of graphics
+ * @returns void
+ */
+void URenderGraphics(void) {
+
+	// Enables z axis
+	glEnable(GL_DEPTH_TEST);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	int now = glutGet(GLUT_ELAPSED_TIME);
+	GLint program = bindPerCube ? bindProgram : materialProgram;
+	glUseProgram(program);
+
+	// Camera orbits the grid
+	float angle = now * 0.0002f;
+	float distance = gridSize * 2.5f;
+	glm::mat4 view;
+	view = glm::lookAt(glm::vec3(distance * sin(angle), distance * 0.5f, distance * cos(angle)),
+			glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	// Projection
+	glm::mat4 projection;
+	projection = glm::perspective(glm::radians(45.0f), (GLfloat)WindowWidth / (GLfloat)WindowHeight, 0.1f, 500.0f);
+
+	// Set values returned from each variable to its corresponding variable
+	GLint viewLocation = glGetUniformLocation(program, "view");
+	GLint proLocation = glGetUniformLocation(program, "projection");
+
+	glUniformMatrix4fv(viewLocation, 1, GL_FALSE, glm::value_ptr(view));
+	glUniformMatrix4fv(proLocation, 1, GL_FALSE, glm::value_ptr(projection));
+
+	glBindVertexArray(VAO);
+
+	if (bindPerCube) {
+		// One bind and one draw per cube
+		GLint offsetLocation = glGetUniformLocation(program, "instanceOffset");
+		glUniform1i(glGetUniformLocation(program, "gridSize"), gridSize);
+		for (int i = 0; i < cubeCount; ++i) {
+			glBindTexture(GL_TEXTURE_2D, textures[i]);
+			if (baseInstance) {
+				glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 36, 1, i);
+			}
+			else {
+				glUniform1i(offsetLocation, i);
+				glDrawArraysInstanced(GL_TRIANGLES, 0, 36, 1);
+			}
+		}
+		bindsSinceStats += cubeCount;
+	}
+	else {
+		// Every cube in one draw
+		materials.Bind(program);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 36, cubeCount);
+		bindsSinceStats += 1;
+	}
+
+	// Deactivator
+	glBindVertexArray(0);
+
+	// Frame time and binds every five seconds
+	++framesSinceStats;
+	if (now - lastStatsTime >= 5000) {
+		cout << cubeCount << " textures, " << (bindPerCube ? "per cube binds" : materials.ModeName()) << ": "
+			<< (now - lastStatsTime) / (float)framesSinceStats << " ms/frame, "
+			<< bindsSinceStats / framesSinceStats << " binds/frame" << endl;
+		lastStatsTime = now;
+		framesSinceStats = 0;
+		bindsSinceStats = 0;
+	}
+
+	// Flags to the main loop
+	glutPostRedisplay();
+
+	// Buffer flipper
+	glutSwapBuffers();
+}
+
+/*
+ * @desc Compiles and links one vertex and fragment shader pair
+ * @returns program name
+ */
+GLint UCreateProgram(const GLchar* vertexSource, const GLchar* fragmentSource) {
+
+	// Vertex shader
+	GLint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShaderId, 1, &vertexSource, NULL);
+	glCompileShader(vertexShaderId);
+
+
+	// Fragment shader
+	GLint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShaderId, 1, &fragmentSource, NULL);
+	glCompileShader(fragmentShaderId);
+
+	// Create shader program
+	GLint program = glCreateProgram();
+	glAttachShader(program, vertexShaderId);
+	glAttachShader(program, fragmentShaderId);
+	glLinkProgram(program);
+
+
+	// Delete the instances once the program is created and linked
+	glDeleteShader(vertexShaderId);
+	glDeleteShader(fragmentShaderId);
+
+	return program;
+}
+
+void UCreateShader(void) {
+	string materialSource = materials.BuildShader(MaterialFragmentShader);
+	materialProgram = UCreateProgram(VertexShader, materialSource.c_str());
+	bindProgram = UCreateProgram(baseInstance ? VertexShader : OffsetVertexShader, BindFragmentShader);
+}
+
+/*
+ * @desc this function creates the cube, the model matrices and the atlas regions
+ * @returns void
+ */
+void UCreateBuffers() {
+	GLfloat verts[] = {
+            -0.5f, -0.5f, -0.5f, 0.0f, 0.0f,
+             0.5f, -0.5f, -0.5f, 1.0f, 0.0f,
+             0.5f,  0.5f, -0.5f, 1.0f, 1.0f,
+             0.5f,  0.5f, -0.5f, 1.0f, 1.0f,
+            -0.5f,  0.5f, -0.5f, 0.0f, 1.0f,
+            -0.5f, -0.5f, -0.5f, 0.0f, 0.0f,
+
+            -0.5f, -0.5f,  0.5f, 0.0f, 0.0f,
+             0.5f, -0.5f,  0.5f, 1.0f, 0.0f,
+             0.5f,  0.5f,  0.5f, 1.0f, 1.0f,
+             0.5f,  0.5f,  0.5f, 1.0f, 1.0f,
+            -0.5f,  0.5f,  0.5f, 0.0f, 1.0f,
+            -0.5f, -0.5f,  0.5f, 0.0f, 0.0f,
+
+            -0.5f,  0.5f,  0.5f, 1.0f, 0.0f,
+            -0.5f,  0.5f, -0.5f, 1.0f, 1.0f,
+            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+            -0.5f, -0.5f,  0.5f, 0.0f, 0.0f,
+            -0.5f,  0.5f,  0.5f, 1.0f, 0.0f,
+
+             0.5f,  0.5f,  0.5f, 1.0f, 0.0f,
+             0.5f,  0.5f, -0.5f, 1.0f, 1.0f,
+             0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+             0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+             0.5f, -0.5f,  0.5f, 0.0f, 0.0f,
+             0.5f,  0.5f,  0.5f, 1.0f, 0.0f,
+
+            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+             0.5f, -0.5f, -0.5f, 1.0f, 1.0f,
+             0.5f, -0.5f,  0.5f, 1.0f, 0.0f,
+             0.5f, -0.5f,  0.5f, 1.0f, 0.0f,
+            -0.5f, -0.5f,  0.5f, 0.0f, 0.0f,
+            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+
+            -0.5f,  0.5f, -0.5f, 0.0f, 1.0f,
+             0.5f,  0.5f, -0.5f, 1.0f, 1.0f,
+             0.5f,  0.5f,  0.5f, 1.0f, 0.0f,
+             0.5f,  0.5f,  0.5f, 1.0f, 0.0f,
+            -0.5f,  0.5f,  0.5f, 0.0f, 0.0f,
+            -0.5f,  0.5f, -0.5f, 0.0f, 1.0f,
+	};
+
+	// Per cube: model matrix, atlas region and layer
+	const int InstanceFloats = 16 + 4 + 1;
+	vector<GLfloat> instances(cubeCount * InstanceFloats);
+
+	for (int i = 0; i < cubeCount; ++i) {
+		int x = i % gridSize, y = (i / gridSize) % gridSize, z = i / (gridSize * gridSize);
+
+		glm::mat4 model;
+		model = glm::translate(model, glm::vec3((x - gridSize / 2) * 2.0f, (y - gridSize / 2) * 2.0f, (z - gridSize / 2) * 2.0f));
+		memcpy(&instances[i * InstanceFloats], glm::value_ptr(model), 16 * sizeof(GLfloat));
+
+		// Remap into the material table, the -binds path samples each texture whole
+		GLfloat* region = &instances[i * InstanceFloats + 16];
+		if (bindPerCube) {
+			region[0] = 0.0f;
+			region[1] = 0.0f;
+			region[2] = 1.0f;
+			region[3] = 1.0f;
+			region[4] = 0.0f;
+		}
+		else {
+			const UPackedRegion& packed = materials.Region(i);
+			region[0] = packed.uvOffset[0];
+			region[1] = packed.uvOffset[1];
+			region[2] = packed.uvScale[0];
+			region[3] = packed.uvScale[1];
+			region[4] = packed.layer;
+		}
+	}
+
+	// Generate buffer IDs
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &instanceVBO);
+
+	// Activates the vertex object before binding any VBOs
+	glBindVertexArray(VAO);
+
+	// Activates the VBO in relation to the vertices
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
+
+	// Set attrs for pointer 0
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
+	glEnableVertexAttribArray(0);
+
+	// set attrs pointer 2
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(2);
+
+	// Instance attributes: model in pointers 3 to 6, region in 7, layer in 8
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(GLfloat), instances.data(), GL_STATIC_DRAW);
+	for (GLuint column = 0; column < 4; ++column) {
+		glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, InstanceFloats * sizeof(GLfloat), (GLvoid*)(column * 4 * sizeof(GLfloat)));
+		glEnableVertexAttribArray(3 + column);
+		glVertexAttribDivisor(3 + column, 1);
+	}
+	glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, InstanceFloats * sizeof(GLfloat), (GLvoid*)(16 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(7);
+	glVertexAttribDivisor(7, 1);
+	glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, InstanceFloats * sizeof(GLfloat), (GLvoid*)(20 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(8);
+	glVertexAttribDivisor(8, 1);
+
+	// Deactivate the VAO
+	glBindVertexArray(0);
+}
+
+/*
+ * @desc Creates one image per cube, the first is snhu.JPG when it can be
+ *       loaded and the rest are checkerboards of different sizes and colors.
+ *       They are either packed into the array texture or uploaded one by one.
+ * @returns void
+ */
+void UGenerateTexture() {
+
+	vector<UImage> images(cubeCount);
+
+	for (int i = 0; i < cubeCount; ++i) {
+		UImage& image = images[i];
+
+		if (i == 0) {
+			// Texture file loader
+			unsigned char* pixels = SOIL_load_image("snhu.JPG", &image.width, &image.height, 0, SOIL_LOAD_RGBA);
+			if (pixels != NULL) {
+				image.pixels.assign(pixels, pixels + image.width * image.height * 4);
+				SOIL_free_image_data(pixels);
+				continue;
+			}
+		}
+
+		image.width = 32 + (i * 37) % 97;
+		image.height = 32 + (i * 53) % 97;
+		image.pixels.resize(image.width * image.height * 4);
+
+		unsigned char red = (unsigned char)(i * 67), green = (unsigned char)(i * 131), blue = (unsigned char)(i * 199);
+		int cell = 4 + i % 12;
+		for (int y = 0; y < image.height; ++y) {
+			for (int x = 0; x < image.width; ++x) {
+				bool dark = ((x / cell) + (y / cell)) % 2 == 0;
+				unsigned char* pixel = &image.pixels[(y * image.width + x) * 4];
+				pixel[0] = dark ? red / 2 : red;
+				pixel[1] = dark ? green / 2 : green;
+				pixel[2] = dark ? blue / 2 : blue;
+				pixel[3] = 255;
+			}
+		}
+	}
+
+	if (bindPerCube) {
+		textures.resize(cubeCount);
+		glGenTextures(cubeCount, textures.data());
+		for (int i = 0; i < cubeCount; ++i) {
+			glBindTexture(GL_TEXTURE_2D, textures[i]);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, images[i].width, images[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, images[i].pixels.data());
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	else {
+		materials.Create(images, !forceArray);
+		cout << cubeCount << " materials as " << materials.ModeName();
+		if (materials.Mode() == UMaterialArray) {
+			cout << ", " << materials.LayerCount() << " layers";
+		}
+		cout << endl;
+	}
+}
@@ -0,0 +1,974 @@
+/*
+ * @author Jacob William
+ * @desc This program draws a field of spinning cubes with instancing. The
+ *       transform update, culling, sorting and instance writing run on the
+ *       job system, only the upload and draw calls stay on the GL thread.
+ *       With -lights the cubes are lit by that many moving point lights
+ *       through clustered forward shading, -brute loops over every light.
+ *       -prepass lays depth down with a position only stream first so the
+ *       shading pass runs once per pixel, -unsorted drops the front to back
+ *       order; fragment counts per pass are printed with the stats.
+ *       -bloom renders into HDR targets planned by the render graph and adds
+ *       a half resolution bloom before presenting.
+ *       -particles runs a fountain of that many particles in the middle of
+ *       the field, simulated and drawn by the GPU without per particle CPU
+ *       work; it needs GL 4.3.
+ *       -watch writes the shaders and the cube mesh into a directory, unless
+ *       they are already there, and reloads them whenever they are saved.
+ *
+ */
+
+#include <iostream> 		// C++ I/O library
+#include <cctype>
+#include <cstdlib>
+#include <random>
+#include <GL/glew.h>		// Glew header
+#include <GL/freeglut.h>	// freeglut header
+
+// Importing glm headers
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "common/AssetDatabase.h"
+#include "common/ClusteredLighting.h"
+#include "common/DemoMeshes.h"
+#include "common/FrameCapture.h"
+#include "common/FrameScene.h"
+#include "common/ParticleSystem.h"
+#include "common/RenderGraph.h"
+#include "common/RenderPass.h"
+#include "common/Resources.h"
+
+// Use the standard name spaces
+using namespace std;
+
+// Global title name given to the window
+#define WINDOW_TITLE "Jacob William"
+
+// Vertex and  Fragment Shader
+#ifndef GLSL
+#define GLSL(Version, Source) "#version " #Version "\n" #Source
+#endif
+
+// Declaration of variables
+GLuint instanceVBO, depthVertexArray, depthPositionBuffer, fullscreenVertexArray;
+GLint WindowWidth = 800, WindowHeight = 600;
+
+// Long-lived resources and the per frame arenas
+UResourcePools pools;
+UMesh* cube;
+UProgram* shader;
+UProgram* depthShader;
+UProgram* brightShader;
+UProgram* blurShader;
+UProgram* compositeShader;
+UFrameArenas arenas;
+
+// Number of cubes, can be overridden by a numeric argument
+size_t objectCount = 100000;
+
+// Batches start part way into the instance buffer. Without GL 4.2 base
+// instances the matrix attributes are pointed at each batch instead
+bool baseInstance = true;
+
+// Draw every cube on its own through command lists recorded by the workers
+bool recordCommands = false;
+
+// Depth pre-pass before shading and front to back order within a mesh
+bool depthPrePass = false, frontToBack = true;
+URenderPasses passes;
+
+// Bloom post-processing through the render graph, rebuilt when the window resizes
+bool bloom = false, graphDirty = true;
+URenderGraph graph;
+
+// Records the window to a Y4M file or PNG sequence when -capture is given
+string capturePath;
+UFrameCapture capture;
+
+// Point lights, their resting positions and the cluster lists built from them
+size_t lightCount = 0;
+bool bruteForceLights = false;
+vector<UPointLight> lights, restingLights;
+UClusteredLights clusters;
+
+// GPU particle fountain and the camera its pass draws with
+size_t particleCount = 0;
+UParticleSystem particles;
+glm::mat4 frameView, frameProjection;
+
+// Shaders and the cube reloaded from this directory when -watch is given
+string watchDirectory;
+UAssetDatabase assets;
+
+// Elapsed time of the last frame and of the last stats print in milliseconds
+int lastFrameTime = 0, lastStatsTime = 0, framesSinceStats = 0;
+
+// Scene, per frame output and the workers building it
+USceneObjects scene;
+UFrameData frame;
+UJobSystem* jobs;
+
+/*
+ * Prototypes to init functions before implementation
+ */
+void UResizeWindow(int, int);
+void URenderGraphics(void);
+void UCreateShader(void);
+void UCreateBuffers(void);
+void UCreatePasses(void);
+void UDrawDepth(void);
+void UDrawShaded(void);
+void UBuildGraph(void);
+void UDrawFullscreen(GLuint, GLuint, GLuint);
+GLuint UCompileProgram(const GLchar*, const GLchar*);
+void UCreateLights(void);
+void UMoveLights(int);
+void UCreateParticles(void);
+void UUploadCube(const vector<GLfloat>&);
+void UInstanceAttributes(GLuint);
+void UDrawInstances(const UDrawBatch&);
+void UWatchAssets(void);
+void UDrawParticles(void);
+void UCloseWindow(void);
+
+
+/*
+ * Vertex shader source code, the model matrix comes from the instance buffer
+ */
+const GLchar* VertexShader = GLSL(330,
+		layout (location = 0) in vec3 position;
+		layout (location = 1) in vec3 color;
+		layout (location = 3) in mat4 model;
+
+		out vec3 mobileColor;
+		invariant gl_Position;
+
+		uniform mat4 view;
+		uniform mat4 projection;
+		void main() {
+			gl_Position = projection * view * model * vec4(position, 1.0f);
+			mobileColor = color;
+		}
+);
+
+/*
+ * Fragment Shader
+ */
+
+const GLchar* FragmentShader = GLSL(330,
+	in vec3 mobileColor;
+	out vec4 gpuColor;
+	void main() {
+		gpuColor = vec4(mobileColor, 1.0);
+	}
+);
+
+/*
+ * Lit vertex shader, hands view space position and normal to the fragment
+ */
+const GLchar* LitVertexShader = GLSL(330,
+		layout (location = 0) in vec3 position;
+		layout (location = 1) in vec3 color;
+		layout (location = 2) in vec3 normal;
+		layout (location = 3) in mat4 model;
+
+		out vec3 mobileColor;
+		out vec3 viewPosition;
+		out vec3 viewNormal;
+		invariant gl_Position;
+
+		uniform mat4 view;
+		uniform mat4 projection;
+		void main() {
+			mat4 modelView = view * model;
+			gl_Position = projection * view * model * vec4(position, 1.0f);
+			viewPosition = (modelView * vec4(position, 1.0f)).xyz;
+			viewNormal = mat3(modelView) * normal;
+			mobileColor = color;
+		}
+);
+
+/*
+ * Lit fragment shader, compiled after ClusteredLightingShader
+ */
+const GLchar* LitFragmentShader = GLSL_PART(
+	in vec3 mobileColor;
+	in vec3 viewPosition;
+	in vec3 viewNormal;
+	out vec4 gpuColor;
+	void main() {
+		vec3 lit = mobileColor * 0.05 + UShadeClustered(viewPosition, viewNormal, mobileColor, 32.0);
+		gpuColor = vec4(lit, 1.0);
+	}
+);
+
+/*
+ * Depth pre-pass shaders, the position has to come out bit for bit the same
+ * as in the shading pass for GL_EQUAL to pass
+ */
+const GLchar* DepthVertexShader = GLSL(330,
+		layout (location = 0) in vec3 position;
+		layout (location = 3) in mat4 model;
+		invariant gl_Position;
+
+		uniform mat4 view;
+		uniform mat4 projection;
+		void main() {
+			gl_Position = projection * view * model * vec4(position, 1.0f);
+		}
+);
+
+const GLchar* DepthFragmentShader = GLSL(330,
+	void main() {
+	}
+);
+
+/*
+ * Post-processing shaders, one triangle covering the target
+ */
+const GLchar* FullscreenVertexShader = GLSL(330,
+		out vec2 uv;
+		void main() {
+			uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+			gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+		}
+);
+
+// Keeps what is brighter than the threshold, scaled down so it fades in
+const GLchar* BrightFragmentShader = GLSL(330,
+	in vec2 uv;
+	out vec4 gpuColor;
+	uniform sampler2D source;
+	void main() {
+		vec3 color = texture(source, uv).rgb;
+		float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
+		gpuColor = vec4(color * (max(luminance - 0.9, 0.0) / max(luminance, 0.0001)), 1.0);
+	}
+);
+
+// Nine tap gaussian along direction, one texel per step
+const GLchar* BlurFragmentShader = GLSL(330,
+	in vec2 uv;
+	out vec4 gpuColor;
+	uniform sampler2D source;
+	uniform vec2 direction;
+	void main() {
+		float weights[5] = float[](0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);
+		vec3 color = texture(source, uv).rgb * weights[0];
+		for (int i = 1; i < 5; ++i) {
+			color += texture(source, uv + direction * float(i)).rgb * weights[i];
+			color += texture(source, uv - direction * float(i)).rgb * weights[i];
+		}
+		gpuColor = vec4(color, 1.0);
+	}
+);
+
+const GLchar* CompositeFragmentShader = GLSL(330,
+	in vec2 uv;
+	out vec4 gpuColor;
+	uniform sampler2D source;
+	uniform sampler2D bloom;
+	void main() {
+		gpuColor = vec4(texture(source, uv).rgb + texture(bloom, uv).rgb * 0.8, 1.0);
+	}
+);
+// Main function
+int main(int argc, char * argv[]) {
+
+	// Initializes the OpenGL program properties
+	// Init freeglut
+	glutInit(&argc, argv);
+
+	for (int i = 1; i < argc; ++i) {
+		if (string(argv[i]) == "-commands") {
+			recordCommands = true;
+		}
+		else if (string(argv[i]) == "-capture" && i + 1 < argc) {
+			capturePath = argv[++i];
+		}
+		else if (string(argv[i]) == "-lights" && i + 1 < argc) {
+			lightCount = min((size_t)atol(argv[++i]), ClusterMaxLights);
+		}
+		else if (string(argv[i]) == "-brute") {
+			bruteForceLights = true;
+		}
+		else if (string(argv[i]) == "-prepass") {
+			depthPrePass = true;
+		}
+		else if (string(argv[i]) == "-unsorted") {
+			frontToBack = false;
+		}
+		else if (string(argv[i]) == "-bloom") {
+			bloom = true;
+		}
+		else if (string(argv[i]) == "-particles" && i + 1 < argc) {
+			particleCount = (size_t)atol(argv[++i]);
+		}
+		else if (string(argv[i]) == "-watch" && i + 1 < argc) {
+			watchDirectory = argv[++i];
+		}
+		else {
+			char* end;
+			unsigned long count = strtoul(argv[i], &end, 10);
+			if (!isdigit((unsigned char)argv[i][0]) || *end != '\0' || count == 0) {
+				cout << "Unknown argument " << argv[i] << endl;
+				return -1;
+			}
+			objectCount = (size_t)count;
+		}
+	}
+
+	// Creates memory buffer for the window
+	glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA);
+
+	// Init the window with the given width*Height
+	glutInitWindowSize(WindowWidth, WindowHeight);
+
+	// Creates the window with the title
+	glutCreateWindow(WINDOW_TITLE);
+
+	// Sets the proper window size
+	glutReshapeFunc(UResizeWindow);
+
+	// Sets the result/status when initiatite
+	glewExperimental = GL_TRUE;
+	// Checks if there's an error
+	if (GLEW_OK !=  glewInit()) {
+		cout << "Failed to init GLEW" << endl;
+		return  -1;
+	}
+
+	baseInstance = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+	if (!baseInstance && recordCommands) {
+		cout << "-commands needs GL 4.2 base instances, drawing batches instead" << endl;
+		recordCommands = false;
+	}
+
+	// Workers for the CPU side of the frame
+	jobs = new UJobSystem();
+	cout << "Job threads: " << jobs->ThreadCount() << endl;
+
+	UScatterObjects(scene, objectCount, 50.0f, 1, 42);
+
+	// Calls the function to create shader
+	UCreateShader();
+
+	// Calls the function to create the cube and instance buffers
+	UCreateBuffers();
+
+	if (particleCount > 0) {
+		UCreateParticles();
+	}
+
+	if (!watchDirectory.empty()) {
+		UWatchAssets();
+	}
+
+	UCreatePasses();
+	cout << (depthPrePass ? "depth pre-pass, " : "single pass, ") << (frontToBack ? "front to back" : "scene order") << endl;
+
+	if (lightCount > 0) {
+		UCreateLights();
+		cout << lightCount << " point lights, " << (bruteForceLights ? "every light per fragment" : "clustered") << endl;
+	}
+
+	glUseProgram(shader->program);
+	// Sets the background color to clear
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+	if (!capturePath.empty()) {
+		if (!capture.Open(capturePath, WindowWidth, WindowHeight, 60)) {
+			cout << "Failed to open " << capturePath << endl;
+			return -1;
+		}
+		cout << "Capturing to " << capturePath << endl;
+	}
+
+	// Renders graphics in the window
+	glutDisplayFunc(URenderGraphics);
+
+	// Finishes the capture and frees the GL objects while the context still
+	// exists, GLUT exits from inside the loop
+	glutCloseFunc(UCloseWindow);
+
+	// Starts the OpenGL loop in the background
+	glutMainLoop();
+
+	// Termination of the program due to a successful exit
+	return 0;
+}
+
+/*
+ * @desc This function handles the rendering of graphics
+ * @returns void
+ */
+void URenderGraphics(void) {
+
+	// Reloaded assets are swapped in before anything draws
+	if (!watchDirectory.empty()) {
+		assets.Update(cout);
+	}
+
+	// Enables z axis
+	glEnable(GL_DEPTH_TEST);
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	int now = glutGet(GLUT_ELAPSED_TIME);
+	float deltaTime = (now - lastFrameTime) / 1000.0f;
+	lastFrameTime = now;
+
+	// Camera slowly orbits the field
+	float angle = now * 0.0001f;
+	glm::vec3 cameraPosition = glm::vec3(60.0f * sin(angle), 10.0f, 60.0f * cos(angle));
+
+	glm::mat4 view;
+	view = glm::lookAt(cameraPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	glm::mat4 projection;
+	projection = glm::perspective(glm::radians(45.0f), (GLfloat)WindowWidth / (GLfloat)WindowHeight, 0.1f, 200.0f);
+
+	// CPU stages on the job system
+	glm::mat4 viewProjection = projection * view;
+	UBuildFrame(*jobs, scene, glm::value_ptr(viewProjection), glm::value_ptr(cameraPosition), deltaTime, arenas.Current(), frame, frontToBack);
+
+	// Set values returned from each variable to its corresponding variable, in both programs
+	GLuint programs[] = { shader->program, depthShader->program };
+	for (int p = 0; p < 2; ++p) {
+		glUseProgram(programs[p]);
+		glUniformMatrix4fv(glGetUniformLocation(programs[p], "view"), 1, GL_FALSE, glm::value_ptr(view));
+		glUniformMatrix4fv(glGetUniformLocation(programs[p], "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+	}
+	glUseProgram(shader->program);
+	frameView = view;
+	frameProjection = projection;
+
+	// Light lists for this view, built while nothing else runs on the workers
+	if (lightCount > 0) {
+		UMoveLights(now);
+		clusters.Update(*jobs, lights, glm::value_ptr(view), glm::radians(45.0f), (GLfloat)WindowWidth / (GLfloat)WindowHeight, 0.1f, 200.0f);
+		clusters.Bind(shader->program, 0, WindowWidth, WindowHeight, bruteForceLights);
+	}
+
+	// Orphan the instance buffer and upload this frame's sorted matrices
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, frame.visibleCount * 16 * sizeof(GLfloat), frame.instances, GL_STREAM_DRAW);
+
+	// Particles step on the GPU, a long first frame or a stall is capped
+	if (particleCount > 0) {
+		particles.Simulate(min(deltaTime, 0.1f));
+	}
+
+	if (bloom) {
+		if (graphDirty) {
+			UBuildGraph();
+		}
+		graph.Execute();
+	}
+	else {
+		passes.Execute();
+	}
+
+	// Allocator counters every five seconds
+	++framesSinceStats;
+	if (now - lastStatsTime >= 5000) {
+		cout << "frame: " << (now - lastStatsTime) / (float)framesSinceStats << " ms, visible " << frame.visibleCount << endl;
+		UPrintAllocationStats(cout, "frame arena", arenas.Current().Stats());
+		pools.PrintStats(cout);
+		if (lightCount > 0) {
+			clusters.PrintStats(cout);
+		}
+		passes.PrintStatistics(cout);
+		passes.ResetStatistics();
+		if (particleCount > 0) {
+			particles.PrintStats(cout);
+			particles.ResetStats();
+		}
+		UCaptureStats stats = capture.Stats();
+		if (capture.IsOpen() && stats.frames > 0) {
+			cout << "capture: " << stats.frames << " frames, " << stats.captureMilliseconds / stats.frames << " ms/frame on the GL thread, "
+				<< stats.waitMilliseconds / stats.frames << " ms/frame waiting for the encoder" << endl;
+		}
+		lastStatsTime = now;
+		framesSinceStats = 0;
+	}
+
+	// Queues the back buffer before it is swapped away
+	capture.Capture();
+
+	// Flags to the main loop
+	glutPostRedisplay();
+	glutSwapBuffers();
+	if (!watchDirectory.empty()) {
+		assets.Presented(cout);
+	}
+
+	// This frame's arrays stay alive for one more frame, the older arena is recycled
+	arenas.Flip();
+}
+
+/*
+ * @desc Writes the frames still in flight and frees everything before the
+ *       window goes away
+ * @returns void
+ */
+void UCloseWindow(void) {
+	capture.Close();
+	assets.Close();
+
+	// Deconstructors
+	glDeleteVertexArrays(1, &cube->vertexArray);
+	glDeleteBuffers(1, &cube->vertexBuffer);
+	glDeleteBuffers(1, &instanceVBO);
+	glDeleteVertexArrays(1, &depthVertexArray);
+	glDeleteBuffers(1, &depthPositionBuffer);
+	glDeleteProgram(shader->program);
+	glDeleteProgram(depthShader->program);
+	glDeleteProgram(brightShader->program);
+	glDeleteProgram(blurShader->program);
+	glDeleteProgram(compositeShader->program);
+	glDeleteVertexArrays(1, &fullscreenVertexArray);
+	graph.Destroy();
+	passes.Destroy();
+	clusters.Destroy();
+	particles.Destroy();
+	pools.meshes.Destroy(cube);
+	pools.programs.Destroy(shader);
+	pools.programs.Destroy(depthShader);
+	pools.programs.Destroy(brightShader);
+	pools.programs.Destroy(blurShader);
+	pools.programs.Destroy(compositeShader);
+	delete jobs;
+	jobs = NULL;
+}
+
+void UCreateShader(void) {
+
+	// Vertex shader
+	GLint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShaderId, 1, lightCount > 0 ? &LitVertexShader : &VertexShader, NULL);
+	glCompileShader(vertexShaderId);
+
+
+	// Fragment shader, the lit one is the lighting part followed by its own main
+	GLint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+	const GLchar* litSources[] = { "#version 330\n", ClusteredLightingShader, LitFragmentShader };
+	if (lightCount > 0) {
+		glShaderSource(fragmentShaderId, 3, litSources, NULL);
+	}
+	else {
+		glShaderSource(fragmentShaderId, 1, &FragmentShader, NULL);
+	}
+	glCompileShader(fragmentShaderId);
+
+	// Shader program
+	// Create shader program
+	shader = pools.programs.Create();
+	shader->program = glCreateProgram();
+	glAttachShader(shader->program, vertexShaderId);
+	glAttachShader(shader->program, fragmentShaderId);
+	glLinkProgram(shader->program);
+
+
+	// Delete the instances once the program is created and linked
+	glDeleteShader(vertexShaderId);
+	glDeleteShader(fragmentShaderId);
+
+	// Depth only program of the pre-pass and the post-processing programs
+	depthShader = pools.programs.Create();
+	depthShader->program = UCompileProgram(DepthVertexShader, DepthFragmentShader);
+	brightShader = pools.programs.Create();
+	brightShader->program = UCompileProgram(FullscreenVertexShader, BrightFragmentShader);
+	blurShader = pools.programs.Create();
+	blurShader->program = UCompileProgram(FullscreenVertexShader, BlurFragmentShader);
+	compositeShader = pools.programs.Create();
+	compositeShader->program = UCompileProgram(FullscreenVertexShader, CompositeFragmentShader);
+}
+
+/*
+ * @desc Compiles and links a vertex and fragment shader pair
+ * @returns the program
+ */
+GLuint UCompileProgram(const GLchar* vertexSource, const GLchar* fragmentSource) {
+	GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShaderId, 1, &vertexSource, NULL);
+	glCompileShader(vertexShaderId);
+	GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShaderId, 1, &fragmentSource, NULL);
+	glCompileShader(fragmentShaderId);
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShaderId);
+	glAttachShader(program, fragmentShaderId);
+	glLinkProgram(program);
+	glDeleteShader(vertexShaderId);
+	glDeleteShader(fragmentShaderId);
+	return program;
+}
+
+
+/*
+ * @desc This function resize the program's GUI window
+ * @parameters height, width
+ * @return void
+ */
+void UResizeWindow(int width, int height) {
+	// The capture buffers and the Y4M header keep the size it started with
+	if (capture.IsOpen() && (width != capture.Width() || height != capture.Height())) {
+		glutReshapeWindow(capture.Width(), capture.Height());
+		return;
+	}
+
+	WindowWidth = width;
+	WindowHeight = height;
+	glViewport(0, 0, width, height);
+	graphDirty = true;
+}
+
+
+
+/*
+ * @desc this function creates the cube and the per instance matrix buffer
+ * @returns void
+ */
+void UCreateBuffers(void) {
+
+	// Generate buffer IDs
+	cube = pools.meshes.Create();
+	glGenVertexArrays(1, &cube->vertexArray);
+	glGenBuffers(1, &cube->vertexBuffer);
+	glGenBuffers(1, &instanceVBO);
+	glGenBuffers(1, &depthPositionBuffer);
+
+	// Cube positions, flat normals and face colors
+	UUploadCube(UAddFlatNormals(ColorCubeVertices, DemoMeshVertexCount, 6));
+
+	// Activates the vertex object before binding any VBOs
+	glBindVertexArray(cube->vertexArray);
+
+	// Activates the VBO in relation to the vertices
+	glBindBuffer(GL_ARRAY_BUFFER, cube->vertexBuffer);
+
+	// Set attrs for pointer 0
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)0);
+	glEnableVertexAttribArray(0);
+
+	// set attrs pointer 1
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(1);
+
+	// Normals on pointer 2, only read by the lit shader
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(2);
+
+	// Model matrix takes pointers 3 to 6, one column each, advancing once per instance
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	UInstanceAttributes(0);
+
+	// Pre-pass stream: tightly packed positions and the same instance matrices
+	glGenVertexArrays(1, &depthVertexArray);
+	glBindVertexArray(depthVertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, depthPositionBuffer);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
+	glEnableVertexAttribArray(0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	UInstanceAttributes(0);
+
+	// Full screen triangles need a vertex array bound but read no attributes
+	glGenVertexArrays(1, &fullscreenVertexArray);
+
+	// Deactivate the VAO
+	glBindVertexArray(0);
+}
+
+/*
+ * @desc Fills the cube's buffers from a position, normal, color triangle
+ *       list: the shaded stream and the position only pre-pass stream. The
+ *       vertex arrays keep pointing at the same buffers, so a reloaded mesh
+ *       needs nothing else
+ * @returns void
+ */
+void UUploadCube(const vector<GLfloat>& vertices) {
+	vector<GLfloat> positions;
+	for (size_t v = 0; v < vertices.size(); v += 9) {
+		positions.insert(positions.end(), vertices.begin() + v, vertices.begin() + v + 3);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, cube->vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, depthPositionBuffer);
+	glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(GLfloat), positions.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	cube->vertexCount = (GLsizei)(vertices.size() / 9);
+}
+
+/*
+ * @desc Hands the built-in shaders and cube to watchDirectory for editing
+ *       and watches them. The fragment shader of the cubes is whichever
+ *       variant -lights picked
+ * @returns void
+ */
+void UWatchAssets(void) {
+	string directory = watchDirectory + "/";
+	string cubeName = lightCount > 0 ? "cube_lit" : "cube";
+	bool exported = UExportShader(directory + cubeName + ".vert", { lightCount > 0 ? LitVertexShader : VertexShader });
+	if (lightCount > 0) {
+		exported = UExportShader(directory + cubeName + ".frag", { "#version 330\n", ClusteredLightingShader, LitFragmentShader }) && exported;
+	}
+	else {
+		exported = UExportShader(directory + cubeName + ".frag", { FragmentShader }) && exported;
+	}
+	exported = UExportShader(directory + "depth.vert", { DepthVertexShader }) && exported;
+	exported = UExportShader(directory + "depth.frag", { DepthFragmentShader }) && exported;
+	exported = UExportShader(directory + "fullscreen.vert", { FullscreenVertexShader }) && exported;
+	exported = UExportShader(directory + "bright.frag", { BrightFragmentShader }) && exported;
+	exported = UExportShader(directory + "blur.frag", { BlurFragmentShader }) && exported;
+	exported = UExportShader(directory + "composite.frag", { CompositeFragmentShader }) && exported;
+	exported = UExportObj(directory + "cube.obj", ColorCubeVertices, DemoMeshVertexCount) && exported;
+	if (!exported) {
+		cout << "Failed to write the assets to " << watchDirectory << endl;
+	}
+
+	assets.WatchProgram(&shader->program, directory + cubeName + ".vert", directory + cubeName + ".frag");
+	assets.WatchProgram(&depthShader->program, directory + "depth.vert", directory + "depth.frag");
+	assets.WatchProgram(&brightShader->program, directory + "fullscreen.vert", directory + "bright.frag");
+	assets.WatchProgram(&blurShader->program, directory + "fullscreen.vert", directory + "blur.frag");
+	assets.WatchProgram(&compositeShader->program, directory + "fullscreen.vert", directory + "composite.frag");
+	assets.WatchMesh(directory + "cube.obj", ULoadObj, UUploadCube);
+	if (!assets.Start(true)) {
+		cout << "inotify is not available, -watch is off" << endl;
+		watchDirectory.clear();
+		return;
+	}
+	cout << "Watching " << watchDirectory << " for shader and mesh changes" << endl;
+}
+
+/*
+ * @desc Depth pre-pass then GL_EQUAL shading, or one plain pass. Fragment
+ *       statistics are always collected, they cost a few queries a frame
+ * @returns void
+ */
+void UCreatePasses(void) {
+	if (depthPrePass) {
+		passes.Add("depth", DepthPrePassState, UDrawDepth);
+		passes.Add("shading", EqualShadingPassState, UDrawShaded);
+	}
+	else {
+		passes.Add("opaque", OpaquePassState, UDrawShaded);
+	}
+	if (particleCount > 0) {
+		passes.Add("particles", BlendedPassState, UDrawParticles);
+	}
+	passes.EnableStatistics();
+}
+
+/*
+ * @desc Every batch through the position only stream and empty fragment shader
+ * @returns void
+ */
+void UDrawDepth(void) {
+	glUseProgram(depthShader->program);
+	glBindVertexArray(depthVertexArray);
+	for (size_t b = 0; b < frame.batches.size(); ++b) {
+		UDrawInstances(frame.batches[b]);
+	}
+	glBindVertexArray(0);
+}
+
+/*
+ * @desc Draws the visible cubes with the color or lit program
+ * @returns void
+ */
+void UDrawShaded(void) {
+	glUseProgram(shader->program);
+	if (recordCommands) {
+		// One draw per cube, recorded in parallel and replayed here in order
+		URecordObjectCommands(*jobs, frame, shader->program, cube->vertexArray, cube->vertexCount);
+		UReplayCommands(frame.commandLists.data(), frame.commandLists.size());
+	}
+	else {
+		glBindVertexArray(cube->vertexArray);
+		for (size_t b = 0; b < frame.batches.size(); ++b) {
+			UDrawInstances(frame.batches[b]);
+		}
+	}
+	glBindVertexArray(0);
+}
+
+/*
+ * @desc Model matrix on pointers 3 to 6 of the bound vertex array, one
+ *       column each from the bound buffer, advancing once per instance and
+ *       starting at firstInstance
+ * @returns void
+ */
+void UInstanceAttributes(GLuint firstInstance) {
+	for (GLuint column = 0; column < 4; ++column) {
+		GLsizeiptr offset = ((GLsizeiptr)firstInstance * 16 + column * 4) * sizeof(GLfloat);
+		glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(GLfloat), (GLvoid*)offset);
+		glEnableVertexAttribArray(3 + column);
+		glVertexAttribDivisor(3 + column, 1);
+	}
+}
+
+/*
+ * @desc Draws one batch of cubes with the bound vertex array, moving its
+ *       matrix attributes to the batch when there is no base instance
+ * @returns void
+ */
+void UDrawInstances(const UDrawBatch& batch) {
+	if (baseInstance) {
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, cube->vertexCount, batch.instanceCount, batch.firstInstance);
+		return;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	UInstanceAttributes(batch.firstInstance);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, cube->vertexCount, batch.instanceCount);
+}
+
+/*
+ * @desc Scatters the point lights through the cube field with random
+ *       colors and creates the cluster buffers
+ * @returns void
+ */
+void UCreateLights(void) {
+	mt19937 random(7);
+	uniform_real_distribution<float> position(-50.0f, 50.0f), radius(3.0f, 8.0f), unit(0.0f, 1.0f);
+
+	restingLights.resize(lightCount);
+	for (size_t i = 0; i < lightCount; ++i) {
+		UPointLight& light = restingLights[i];
+		light.position[0] = position(random);
+		light.position[1] = position(random);
+		light.position[2] = position(random);
+		light.radius = radius(random);
+
+		// Saturated colors, one channel always full
+		int full = (int)(unit(random) * 3.0f) % 3;
+		for (int c = 0; c < 3; ++c) {
+			light.color[c] = c == full ? 1.0f : unit(random);
+		}
+		light.intensity = 4.0f + 8.0f * unit(random);
+	}
+	lights = restingLights;
+
+	clusters.Create();
+}
+
+/*
+ * @desc Each light circles its resting position at its own pace
+ * @returns void
+ */
+void UMoveLights(int now) {
+	float time = now * 0.001f;
+	for (size_t i = 0; i < lightCount; ++i) {
+		float phase = time * (0.5f + (i % 7) * 0.1f) + i;
+		lights[i].position[0] = restingLights[i].position[0] + 2.0f * sin(phase);
+		lights[i].position[2] = restingLights[i].position[2] + 2.0f * cos(phase);
+	}
+}
+
+/*
+ * @desc Fountain in the middle of the field. Emission keeps the buffer
+ *       about full, a particle lives three quarters of the lifetime on average
+ * @returns void
+ */
+void UCreateParticles(void) {
+	UParticleSettings settings;
+	settings.capacity = (GLuint)particleCount;
+	settings.lifetime = 4.0f;
+	settings.emitRate = particleCount / (0.75f * settings.lifetime);
+	settings.origin[0] = settings.origin[1] = settings.origin[2] = 0.0f;
+	settings.speed = 25.0f;
+	settings.spread = 0.35f;
+	settings.gravity = 9.8f;
+	settings.size = 0.15f;
+	if (!particles.Create(settings)) {
+		cout << "Particles need GL 4.3 compute shaders, -particles is off" << endl;
+		particleCount = 0;
+		return;
+	}
+	cout << particleCount << " particles" << endl;
+}
+
+/*
+ * @desc Billboards of the live particles, their count never leaves the GPU
+ * @returns void
+ */
+void UDrawParticles(void) {
+	particles.Draw(glm::value_ptr(frameView), glm::value_ptr(frameProjection));
+}
+
+/*
+ * @desc Declares the bloom frame for the current window size: the scene
+ *       passes into HDR color and depth, bright parts at half size, two
+ *       blur passes and the composite onto the back buffer. The bright and
+ *       final bloom targets end up sharing one texture
+ * @returns void
+ */
+void UBuildGraph(void) {
+	graph.Destroy();
+	graph.SetBackBufferSize(WindowWidth, WindowHeight);
+
+	int halfWidth = max(WindowWidth / 2, 1), halfHeight = max(WindowHeight / 2, 1);
+	UGraphResource sceneColor = graph.CreateTarget("scene color", WindowWidth, WindowHeight, GL_RGBA16F);
+	UGraphResource sceneDepth = graph.CreateTarget("scene depth", WindowWidth, WindowHeight, GL_DEPTH_COMPONENT24);
+	UGraphResource bright = graph.CreateTarget("bright", halfWidth, halfHeight, GL_RGBA16F);
+	UGraphResource blurred = graph.CreateTarget("blurred", halfWidth, halfHeight, GL_RGBA16F);
+	UGraphResource bloomColor = graph.CreateTarget("bloom", halfWidth, halfHeight, GL_RGBA16F);
+
+	graph.AddPass("scene", {}, { sceneColor, sceneDepth }, [](const URenderGraph&) {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		passes.Execute();
+	});
+	graph.AddPass("bright", { sceneColor }, { bright }, [=](const URenderGraph& frameGraph) {
+		UDrawFullscreen(brightShader->program, frameGraph.Texture(sceneColor), 0);
+	});
+	graph.AddPass("blur x", { bright }, { blurred }, [=](const URenderGraph& frameGraph) {
+		glUseProgram(blurShader->program);
+		glUniform2f(glGetUniformLocation(blurShader->program, "direction"), 1.0f / halfWidth, 0.0f);
+		UDrawFullscreen(blurShader->program, frameGraph.Texture(bright), 0);
+	});
+	graph.AddPass("blur y", { blurred }, { bloomColor }, [=](const URenderGraph& frameGraph) {
+		glUseProgram(blurShader->program);
+		glUniform2f(glGetUniformLocation(blurShader->program, "direction"), 0.0f, 1.0f / halfHeight);
+		UDrawFullscreen(blurShader->program, frameGraph.Texture(blurred), 0);
+	});
+	graph.AddPass("composite", { sceneColor, bloomColor }, { GraphBackBuffer }, [=](const URenderGraph& frameGraph) {
+		UDrawFullscreen(compositeShader->program, frameGraph.Texture(sceneColor), frameGraph.Texture(bloomColor));
+	});
+
+	if (!graph.Compile()) {
+		cout << "Render graph did not compile, bloom is off" << endl;
+		bloom = false;
+	}
+	else {
+		graph.PrintPlan(cout);
+	}
+	graphDirty = false;
+}
+
+/*
+ * @desc Draws one triangle over the bound target with program, source on
+ *       unit 0 and an optional bloom texture on unit 1
+ * @returns void
+ */
+void UDrawFullscreen(GLuint program, GLuint source, GLuint bloomTexture) {
+	glUseProgram(program);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, source);
+	glUniform1i(glGetUniformLocation(program, "source"), 0);
+	if (bloomTexture != 0) {
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, bloomTexture);
+		glUniform1i(glGetUniformLocation(program, "bloom"), 1);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	glDisable(GL_DEPTH_TEST);
+	glBindVertexArray(fullscreenVertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+}
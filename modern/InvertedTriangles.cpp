@@ -6,6 +6,8 @@
 #include <GL/glew.h>		// Glew header
 #include <GL/freeglut.h>	// freeglut header
 
+#include "common/DemoMeshes.h"
+
 // Use the standard name spaces
 using namespace std;
 
@@ -166,27 +168,11 @@ void UCreateVBO(void) {
 
 	// Init the vertices of the two triangles
 	// BOTH TRIANGLES WILL BE SHARING THE SECOND INDEX
-	GLfloat verts[] = {
-			// First triangle
-			-1.0f, 1.0f,
-			1.0f, 0.0f, 0.0f, 1.0f,
-
-			// Shared Index
-			-0.5f, 0.0f,
-			0.0f, 1.0f, 0.0f, 1.0f,
-
-			-1.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, 1.0f,
-
-			// Second triangle
-			0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, 1.0f,
-			0.0f, -1.0f,
-			0.0f, 0.0f, 1.0f, 1.0f
-	};
+	// Vertices come from common/DemoMeshes.h
+	const GLfloat* verts = InvertedTrianglesVertices;
 
 	// Retrieves the size of the above vertices
-	float numOfVerticies = sizeof(verts);
+	float numOfVerticies = sizeof(InvertedTrianglesVertices);
 
 	// Holds the object of buffer
 	GLuint myBufferID;
@@ -221,8 +207,8 @@ void UCreateVBO(void) {
 	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, colorStride, (char*)(sizeof(float) * 2));
 
 
-	GLushort indicies[] = {0, 1, 2, 3, 4,1};
-	float numIndicies = sizeof(indicies);
+	const GLushort* indicies = InvertedTrianglesIndices;
+	float numIndicies = sizeof(InvertedTrianglesIndices);
 	GLuint indexBufferID;
 	// This function creates 1 buffer in accordance to the reference address of the buffer object
 	glGenBuffers(1, &indexBufferID);
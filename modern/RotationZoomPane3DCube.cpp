@@ -5,6 +5,8 @@
  */
 
 #include <iostream> 		// C++ I/O library
+#include <chrono>
+#include <cstdlib>
 #include <GL/glew.h>		// Glew header
 #include <GL/freeglut.h>	// freeglut header
 
@@ -13,6 +15,14 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "common/Camera.h"
+#include "common/DemoMeshes.h"
+#include "common/FixedTimestep.h"
+#include "common/FrameTimes.h"
+#include "common/InputRecorder.h"
+#include "common/RenderThread.h"
+#include "common/ShadowCascades.h"
+
 // Use the standard name spaces
 using namespace std;
 
@@ -28,36 +38,108 @@ using namespace std;
 GLuint VAO, VBO;
 GLint shaderProgram, WindowWidth = 800, WindowHeight = 600;
 
-// Camera movement speed FPS
+// Model scale and the camera's depth range, the shadow cascades split it
+const GLfloat ModelScale = 2.0f, NearPlane = 0.1f, FarPlane = 100.0f;
+
+// -shadows lights the model from a directional light, casting onto a floor
+// just under it through cascaded shadow maps
+bool shadows = false;
+GLint litProgram, shadowProgram;
+GLuint groundVAO, groundVBO;
+UShadowCascades shadowCascades;
+const int ShadowMapSize = 2048;
+glm::vec3 towardsLight = glm::normalize(glm::vec3(0.4f, 1.0f, 0.3f));
+
+// Bounding radius of the model after scaling, and the floor height under it
+GLfloat casterRadius = 0.0f, groundHeight = 0.0f;
+
+// Zoom speed, fraction of the camera distance per millisecond
 GLfloat cameraSpeed = 0.0005f;
 
 // Locks the cursor at center of screen
 GLfloat lastMouseX = 400, lastMouseY = 300;
 
-// Mouse offset, pitch and yaw
-GLfloat mouseXOffset, mouseYOffset, yaw = 0.0f, pitch = 0.0f;
+// Mouse offset
+GLfloat mouseXOffset, mouseYOffset;
 
 // Sensetivity of mouse
 GLfloat sensitivity = 0.005f;
 
 bool mouseDetected = false;
 
-// GLM global vectors
-glm::vec3 cameraPosition = glm::vec3(0.0f, 0.0f, 0.0f);
-glm::vec3 cameraUpY = glm::vec3(0.0f, 1.0f, 0.0f);
-glm::vec3 cameraForwardZ = glm::vec3(0.0f, 0.0f, -1.0f);
-glm::vec3 front;
+// Camera orbiting the model 10 units out, and where it was one step ago
+UCamera camera, previousCamera;
 GLint currentKey;
 
+// Mouse input logged with -record and fed back with -replay
+UInputRecorder inputRecorder;
+UInputReplay inputReplay;
+
+// Replay speed, 0 steps the log by one 60 Hz frame per rendered frame
+double replaySpeed = 1.0, replayTime = 0.0;
+bool replayStarted = false, headless = false;
+
+// Frame to frame times while replaying
+UFrameTimes frameTimes;
+chrono::steady_clock::time_point lastFrame;
+
+// The camera is simulated at a fixed rate, -hz overrides it. Mouse input
+// collects between steps and rendering blends the last two camera positions
+UFixedTimestep simulation(1000.0 / 60.0);
+GLfloat rotateInputX = 0.0f, rotateInputY = 0.0f;
+int zoomDirection = 0;
+
+// Time spent in each stage, printed every five seconds
+UFrameTimes updateTimes, renderTimes;
+chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+int lastStatsTime = 0;
+
+/*
+ * Everything the render stage needs for one frame, copied by value so
+ * the render thread never reads the window thread's globals
+ */
+struct UFrameSnapshot {
+	UCamera camera;
+	GLint width, height;
+	chrono::steady_clock::time_point inputTime;	// newest input this frame shows
+	bool newInput;
+};
+
+// -threaded draws on a render thread, the window thread only pumps events
+// and runs the simulation
+bool threaded = false;
+URenderThread<UFrameSnapshot> renderThread;
+
+// Newest mouse event not yet in a snapshot, window thread only
+chrono::steady_clock::time_point lastInputTime;
+bool inputPending = false;
+
+// Render stage figures, only touched by the thread that presents
+UFrameTimes latencyTimes;
+chrono::steady_clock::time_point drawStart, lastRenderStats = chrono::steady_clock::now();
+size_t framesPresented = 0;
+
 /*
  * Prototypes to init functions before implementation
  */
 void UResizeWindow(int, int);
 void URenderGraphics(void);
+void UCreateGLObjects(void);
 void UCreateShader(void);
+GLint UCompileProgram(GLsizei vertexCount, const GLchar** vertexSources, GLsizei fragmentCount, const GLchar** fragmentSources);
+void URenderShadows(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection);
 void UCreateBuffers(void);
+void UVertexLayout(void);
 void UMouseMove(int x, int y);
 void IsAlt(int button, int state, int x, int y);
+int UModifiers(void);
+void UReplayInput(void);
+void UCloseWindow(void);
+void USimulate(double stepMilliseconds);
+UFrameSnapshot UUpdate(void);
+void UDrawFrame(const UFrameSnapshot& snapshot);
+void UPresented(const UFrameSnapshot& snapshot);
+void UPublishFrame(void);
 
 
 /*
@@ -90,13 +172,122 @@ const GLchar* FragmentShader = GLSL(330,
 		gpuColor = vec4(mobileColor, 1.0);
 	}
 );
+
+/*
+ * Vertex shader of -shadows, also passes the world position and view depth
+ * the cascade lookup needs
+ */
+const GLchar* LitVertexShader = GLSL(330,
+		layout (location = 0) in vec3 position;
+		layout (location = 1) in vec3 color;
+		layout (location = 2) in vec3 normal;
+
+		out vec3 mobileColor;
+		out vec3 worldPosition;
+		out vec3 worldNormal;
+		out float viewDepth;
+
+		uniform mat4 model;
+		uniform mat4 view;
+		uniform mat4 projection;
+		void main() {
+			vec4 world = model * vec4(position, 1.0f);
+			vec4 eye = view * world;
+			gl_Position = projection * eye;
+			mobileColor = color;
+			worldPosition = world.xyz;
+			worldNormal = mat3(model) * normal;
+			viewDepth = -eye.z;
+		}
+);
+
+/*
+ * Fragment shader of -shadows, compiled after ShadowCascadesShader. The
+ * chair has no thickness so both sides of a face are lit
+ */
+const GLchar* LitFragmentShader = GLSL_PART(
+	in vec3 mobileColor;
+	in vec3 worldPosition;
+	in vec3 worldNormal;
+	in float viewDepth;
+	out vec4 gpuColor;
+	uniform vec3 uTowardsLight;
+	void main() {
+		vec3 normal = normalize(gl_FrontFacing ? worldNormal : -worldNormal);
+		float diffuse = max(dot(normal, uTowardsLight), 0.0);
+		float lit = diffuse * UShadowFactor(worldPosition, viewDepth);
+		gpuColor = vec4(mobileColor * (0.3 + 0.7 * lit), 1.0);
+	}
+);
+
+/*
+ * Shadow casters, depth only
+ */
+const GLchar* ShadowVertexShader = GLSL(330,
+		layout (location = 0) in vec3 position;
+		uniform mat4 model;
+		uniform mat4 lightViewProjection;
+		void main() {
+			gl_Position = lightViewProjection * model * vec4(position, 1.0f);
+		}
+);
+
+const GLchar* ShadowFragmentShader = GLSL(330,
+	void main() {
+	}
+);
 // Main function
 int main(int argc, char * argv[]) {
 
 	// Initializes the OpenGL program properties
+	// Xlib has to know about threads before GLUT opens the display
+	UInitRenderThreading();
+
 	// Init freeglut
 	glutInit(&argc, argv);
 
+	string recordPath, replayPath;
+	for (int i = 1; i < argc; ++i) {
+		string argument = argv[i];
+		if (argument == "-record" && i + 1 < argc) {
+			recordPath = argv[++i];
+		}
+		else if (argument == "-replay" && i + 1 < argc) {
+			replayPath = argv[++i];
+		}
+		else if (argument == "-speed" && i + 1 < argc) {
+			replaySpeed = atof(argv[++i]);
+		}
+		else if (argument == "-headless") {
+			headless = true;
+		}
+		else if (argument == "-hz" && i + 1 < argc) {
+			double hz = atof(argv[++i]);
+			if (!(hz > 0.0)) {
+				cout << "-hz needs a rate above 0, not " << argv[i] << endl;
+				return -1;
+			}
+			simulation.SetStep(1000.0 / hz);
+		}
+		else if (argument == "-threaded") {
+			threaded = true;
+		}
+		else if (argument == "-shadows") {
+			shadows = true;
+		}
+	}
+
+	// A replay runs in the window size it was recorded in
+	if (!replayPath.empty()) {
+		if (!inputReplay.Open(replayPath)) {
+			cout << "Failed to load input log " << replayPath << endl;
+			return -1;
+		}
+		WindowWidth = inputReplay.WindowWidth();
+		WindowHeight = inputReplay.WindowHeight();
+		cout << "Replaying " << inputReplay.EventCount() << " events, " << inputReplay.Duration() / 1000.0 << " s recorded" << endl;
+	}
+
 	// Creates memory buffer for the window
 	glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA);
 
@@ -118,15 +309,14 @@ int main(int argc, char * argv[]) {
 	}
 
 
-	// Calls the function to create shader
-	UCreateShader();
+	// 45 degree field of view over the depth range the cascades split
+	camera.SetPerspective(glm::radians(45.0f), (GLfloat)WindowWidth / (GLfloat)WindowHeight, NearPlane, FarPlane);
 
-	// Calls the function to draw the two triangles for this assigment
-	UCreateBuffers();
-
-	glUseProgram(shaderProgram);
-	// Sets the background color to clear
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	// Starts above the model looking down, so the floor and its shadow show
+	if (shadows) {
+		camera.SetAngles(0.0f, 0.6f);
+	}
+	previousCamera = camera;
 
 	// Renders graphics in the window
 	glutDisplayFunc(URenderGraphics);
@@ -135,6 +325,34 @@ int main(int argc, char * argv[]) {
 
 	glutMotionFunc(UMouseMove);
 
+	// Closes the input log before the window goes away
+	glutCloseFunc(UCloseWindow);
+
+	if (!recordPath.empty() && !inputRecorder.Open(recordPath, WindowWidth, WindowHeight, glutGet(GLUT_ELAPSED_TIME))) {
+		cout << "Failed to create input log " << recordPath << endl;
+		return -1;
+	}
+
+	// Without a visible window GLUT stops calling the display function
+	if (headless) {
+		glutHideWindow();
+		glutIdleFunc(URenderGraphics);
+	}
+
+	// The window thread keeps GLUT and its context, the render thread draws
+	// with a second one sharing its objects and makes the rest itself
+	if (threaded && !renderThread.Start(UCreateGLObjects, UDrawFrame, UPresented)) {
+		cout << "Failed to create a shared context, drawing on the window thread" << endl;
+		threaded = false;
+	}
+	if (threaded) {
+		glutDisplayFunc(UPublishFrame);
+		glutIdleFunc(UPublishFrame);
+	}
+	else {
+		UCreateGLObjects();
+	}
+
 	// Starts the OpenGL loop in the background
 	glutMainLoop();
 
@@ -142,24 +360,63 @@ int main(int argc, char * argv[]) {
 	// Deconstructors
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
+	if (shadows) {
+		shadowCascades.Destroy();
+		glDeleteVertexArrays(1, &groundVAO);
+		glDeleteBuffers(1, &groundVBO);
+	}
 
 	// Termination of the program due to a successful exit
 	return 0;
 }
 
 /*
- * @desc This function handles the rendering of graphics
- * @returns void
+ * @desc Update stage: replayed input, the fixed simulation steps up to now
+ *       and the snapshot the render stage draws. Window thread only
+ * @returns the frame snapshot
  */
-void URenderGraphics(void) {
+UFrameSnapshot UUpdate(void) {
 
-	// Enables z axis
-	glEnable(GL_DEPTH_TEST);
+	// Recorded input due by this frame goes through the same handlers
+	if (inputReplay.IsOpen()) {
+		UReplayInput();
+	}
 
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	// Whole steps up to now, on the replay clock when replaying so a speed
+	// 0 replay simulates the same steps every run
+	chrono::steady_clock::time_point updateStart = chrono::steady_clock::now();
+	double simulationTime = inputReplay.IsOpen() ? replayTime : chrono::duration<double, milli>(updateStart - startTime).count();
+	int steps = simulation.Advance(simulationTime);
+	for (int i = 0; i < steps; ++i) {
+		USimulate(simulation.Step());
+	}
 
-	glBindVertexArray(VAO);
-	cameraForwardZ = front;
+	// The camera between the last two steps
+	UFrameSnapshot snapshot;
+	snapshot.camera.Blend(previousCamera, camera, (GLfloat)simulation.Alpha());
+	snapshot.width = WindowWidth;
+	snapshot.height = WindowHeight;
+	snapshot.inputTime = lastInputTime;
+	snapshot.newInput = inputPending;
+	inputPending = false;
+	updateTimes.Add(chrono::duration<double, milli>(chrono::steady_clock::now() - updateStart).count());
+
+	int now = glutGet(GLUT_ELAPSED_TIME);
+	if (now - lastStatsTime >= 5000) {
+		cout << "simulation: " << 1000.0 / simulation.Step() << " Hz" << endl;
+		updateTimes.Print(cout, "update");
+		updateTimes.Clear();
+		lastStatsTime = now;
+	}
+	return snapshot;
+}
+
+/*
+ * @desc Render stage, GL calls only, on whichever thread owns the context
+ * @returns void
+ */
+void UDrawFrame(const UFrameSnapshot& snapshot) {
+	drawStart = chrono::steady_clock::now();
 
 	// Model
 	glm::mat4 model;
@@ -167,60 +424,196 @@ void URenderGraphics(void) {
 	// Model modification using glm
 	model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
 	model = glm::rotate(model, 45.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(2.0f, 2.0f, 2.0f));
+	model = glm::scale(model, glm::vec3(ModelScale, ModelScale, ModelScale));
 
-	// Camera view
-	glm::mat4 view;
-	// Camera initial position
-	view = glm::lookAt(cameraForwardZ, cameraPosition, cameraUpY);
+	// Camera view and projection
+	glm::mat4 view = glm::make_mat4(snapshot.camera.View());
+	glm::mat4 projection = glm::make_mat4(snapshot.camera.Projection());
 
-	// Projection
-	glm::mat4 projection;
-	projection = glm::perspective(45.0f, (GLfloat)WindowWidth / (GLfloat)WindowHeight, 0.1f, 100.0f);
+	// Shadow maps first, they leave their own framebuffer and viewport bound
+	if (shadows) {
+		URenderShadows(model, view, projection);
+	}
+
+	glViewport(0, 0, snapshot.width, snapshot.height);
+
+	// Enables z axis
+	glEnable(GL_DEPTH_TEST);
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	GLint program = shadows ? litProgram : shaderProgram;
+	glUseProgram(program);
+	glBindVertexArray(VAO);
 
 	// Set values returned from each variable to its corresponding variable
-	GLint modelLocation = glGetUniformLocation(shaderProgram, "model");
-	GLint viewLocation = glGetUniformLocation(shaderProgram, "view");
-	GLint proLocation = glGetUniformLocation(shaderProgram, "projection");
+	GLint modelLocation = glGetUniformLocation(program, "model");
+	GLint viewLocation = glGetUniformLocation(program, "view");
+	GLint proLocation = glGetUniformLocation(program, "projection");
 
 	// Specify the model, view, and location values in relation to the matrix
 	glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(model));
 	glUniformMatrix4fv(viewLocation, 1, GL_FALSE, glm::value_ptr(view));
 	glUniformMatrix4fv(proLocation, 1, GL_FALSE, glm::value_ptr(projection));
 
+	if (shadows) {
+		shadowCascades.Bind(program, 1);
+		glUniform3fv(glGetUniformLocation(program, "uTowardsLight"), 1, glm::value_ptr(towardsLight));
+	}
 
-	// Flags to the main loop
-	glutPostRedisplay();
 	glDrawArrays(GL_TRIANGLES, 0, 36);
 
+	// The floor receives the shadow, it sits in world space
+	if (shadows) {
+		glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4()));
+		glBindVertexArray(groundVAO);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+	}
+
+	glBindVertexArray(0);
+}
+
+/*
+ * @desc Fits the cascades to this frame's camera and redraws the ones whose
+ *       light box moved. Nothing in the scene moves, so a still camera
+ *       redraws none
+ * @returns void
+ */
+void URenderShadows(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) {
+	const GLfloat casters[4] = { 0.0f, 0.0f, 0.0f, casterRadius };
+	shadowCascades.Update(glm::value_ptr(view), glm::value_ptr(projection), NearPlane, FarPlane,
+		glm::value_ptr(towardsLight), casters, 1);
+
+	glUseProgram(shadowProgram);
+	glBindVertexArray(VAO);
+	GLint lightLocation = glGetUniformLocation(shadowProgram, "lightViewProjection");
+	glUniformMatrix4fv(glGetUniformLocation(shadowProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+	shadowCascades.Render([lightLocation](const float* lightViewProjection) {
+		glUniformMatrix4fv(lightLocation, 1, GL_FALSE, lightViewProjection);
+		glDrawArrays(GL_TRIANGLES, 0, 36);
+	});
 	glBindVertexArray(0);
+}
+
+/*
+ * @desc Runs once the frame is swapped: render time, input to present
+ *       latency of frames showing new input, and frames per second
+ * @returns void
+ */
+void UPresented(const UFrameSnapshot& snapshot) {
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	renderTimes.Add(chrono::duration<double, milli>(now - drawStart).count());
+	if (snapshot.newInput) {
+		latencyTimes.Add(chrono::duration<double, milli>(now - snapshot.inputTime).count());
+	}
+	++framesPresented;
+
+	double sinceStats = chrono::duration<double, milli>(now - lastRenderStats).count();
+	if (sinceStats >= 5000.0) {
+		cout << (threaded ? "render thread: " : "render: ") << framesPresented * 1000.0 / sinceStats << " frames/s" << endl;
+		renderTimes.Print(cout, "render");
+		latencyTimes.Print(cout, "input to present");
+		if (shadows) {
+			shadowCascades.PrintStats(cout);
+			shadowCascades.ResetStats();
+		}
+		renderTimes.Clear();
+		latencyTimes.Clear();
+		framesPresented = 0;
+		lastRenderStats = now;
+	}
+}
+
+/*
+ * @desc This function handles the rendering of graphics, both stages on the
+ *       GLUT thread
+ * @returns void
+ */
+void URenderGraphics(void) {
+	UFrameSnapshot snapshot = UUpdate();
+	UDrawFrame(snapshot);
+
+	// Flags to the main loop
+	glutPostRedisplay();
 	glutSwapBuffers();
+	UPresented(snapshot);
 }
+
+/*
+ * @desc Window thread side of -threaded: builds a snapshot whenever the
+ *       render thread has room for one
+ * @returns void
+ */
+void UPublishFrame(void) {
+	if (renderThread.Pending() >= RenderQueueDepth) {
+		this_thread::sleep_for(chrono::microseconds(200));
+		return;
+	}
+	renderThread.Submit(UUpdate());
+}
+
+/*
+ * @desc Programs, buffers, vertex arrays and shadow maps, on the thread
+ *       whose context draws with them
+ * @returns void
+ */
+void UCreateGLObjects(void) {
+	// Calls the function to create shader
+	UCreateShader();
+
+	// Calls the function to draw the two triangles for this assigment
+	UCreateBuffers();
+
+	if (shadows) {
+		shadowCascades.Create(ShadowMapSize);
+	}
+
+	glUseProgram(shaderProgram);
+	// Sets the background color to clear
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
 void UCreateShader(void) {
 
+	shaderProgram = UCompileProgram(1, &VertexShader, 1, &FragmentShader);
+
+	if (shadows) {
+		const GLchar* litSources[] = { "#version 330\n", ShadowCascadesShader, LitFragmentShader };
+		litProgram = UCompileProgram(1, &LitVertexShader, 3, litSources);
+		shadowProgram = UCompileProgram(1, &ShadowVertexShader, 1, &ShadowFragmentShader);
+	}
+}
+
+/*
+ * @desc Compiles and links one program, each shader may come in parts
+ * @returns the program
+ */
+GLint UCompileProgram(GLsizei vertexCount, const GLchar** vertexSources, GLsizei fragmentCount, const GLchar** fragmentSources) {
+
 	// Vertex shader
 	GLint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShaderId, 1, &VertexShader, NULL);
+	glShaderSource(vertexShaderId, vertexCount, vertexSources, NULL);
 	glCompileShader(vertexShaderId);
 
 
 	// Fragment shader
 	GLint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShaderId, 1, &FragmentShader, NULL);
+	glShaderSource(fragmentShaderId, fragmentCount, fragmentSources, NULL);
 	glCompileShader(fragmentShaderId);
 
 	// Shader program
 	// Create shader program
-	shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShaderId);
-	glAttachShader(shaderProgram, fragmentShaderId);
-	glLinkProgram(shaderProgram);
+	GLint program = glCreateProgram();
+	glAttachShader(program, vertexShaderId);
+	glAttachShader(program, fragmentShaderId);
+	glLinkProgram(program);
 
 
 	// Delete the instances once the program is created and linked
 	glDeleteShader(vertexShaderId);
 	glDeleteShader(fragmentShaderId);
 
+	return program;
 }
 
 
@@ -230,7 +623,12 @@ void UCreateShader(void) {
  * @return void
  */
 void UResizeWindow(int width, int height) {
-	glViewport(0, 0, width, height);
+	// The render stage sets the viewport, it may be on another thread
+	WindowWidth = width;
+	WindowHeight = height;
+	if (height > 0) {
+		camera.SetAspect((GLfloat)width / (GLfloat)height);
+	}
 }
 
 
@@ -240,58 +638,8 @@ void UResizeWindow(int width, int height) {
  * @returns void
  */
 void UCreateBuffers(void) {
-
-	// Init the vertices of the two triangles
-	// BOTH TRIANGLES WILL BE SHARING THE SECOND INDEX
-	GLfloat verts[] = {
-            -0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f,  // Top Right Vertex 0
-             0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f,  // Bottom Right Vertex 1
-             0.5f,  0.5f, -0.5f, 1.0f, 0.0f, 0.0f,    // Bottom Left Vertex 2
-             0.5f,  0.5f, -0.5f, 1.0f, 0.0f, 0.0f,    // Top Left Vertex 3
-            -0.5f,  0.5f, -0.5f, 1.0f, 0.0f, 0.0f,
-            -0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f,
-
-
-            -0.5f, -0.5f,  0.5f, 0.0f, 1.0f, 0.0f,   // Top Right Vertex 0
-             0.5f, -0.5f,  0.5f, 0.0f, 1.0f, 0.0f,  // Bottom Right Vertex 1
-             0.5f,  0.5f,  0.5f, 0.0f, 1.0f, 0.0f,    // Bottom Left Vertex 2
-             0.5f,  0.5f,  0.5f, 0.0f, 1.0f, 0.0f,     // Top Left Vertex 3
-            -0.5f,  0.5f,  0.5f, 0.0f, 1.0f, 0.0f,
-            -0.5f, -0.5f,  0.5f, 0.0f, 1.0f, 0.0f,
-
-
-            -0.5f,  0.5f,  0.5f, 0.0f, 0.0f, 1.0f,   // Top Right Vertex 0
-            -0.5f,  0.5f, -0.5f, 0.0f, 0.0f, 1.0f,  // Bottom Right Vertex 1
-            -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, 1.0f,    // Bottom Left Vertex 2
-            -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, 1.0f,    // Top Left Vertex 3
-            -0.5f, -0.5f,  0.5f, 0.0f, 0.0f, 1.0f,
-            -0.5f,  0.5f,  0.5f, 0.0f, 0.0f, 1.0f,
-
-
-             0.5f,  0.5f,  0.5f, 1.0f, 1.0f, 0.0f,   // Top Right Vertex 0
-             0.5f,  0.5f, -0.5f, 1.0f, 1.0f, 0.0f,  // Bottom Right Vertex 1
-             0.5f, -0.5f, -0.5f, 1.0f, 1.0f, 0.0f,    // Bottom Left Vertex 2
-             0.5f, -0.5f, -0.5f, 1.0f, 1.0f, 0.0f,     // Top Left Vertex 3
-             0.5f, -0.5f,  0.5f, 1.0f, 0.0f, 0.0f,
-             0.5f,  0.5f,  0.5f, 1.0f, 1.0f, 0.0f,
-
-
-            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, 1.0f,  // Top Right Vertex 0
-             0.5f, -0.5f, -0.5f, 0.0f, 1.0f, 1.0f,  // Bottom Right Vertex 1
-             0.5f, -0.5f,  0.5f, 0.0f, 1.0f, 1.0f,   // Bottom Left Vertex 2
-             0.5f, -0.5f,  0.5f, 0.0f, 1.0f, 1.0f,     // Top Left Vertex 3
-            -0.5f, -0.5f,  0.5f, 0.0f, 1.0f, 1.0f,
-            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, 1.0f,
-
-            -0.5f,  0.5f, -0.5f, 1.0f, 0.0f, 1.0f,   // Top Right Vertex 0
-             0.5f,  0.5f, -0.5f, 1.0f, 0.0f, 1.0f,  // Bottom Right Vertex 1
-             0.5f,  0.5f,  0.5f, 1.0f, 0.0f, 1.0f,    // Bottom Left Vertex 2
-             0.5f,  0.5f,  0.5f, 1.0f, 0.0f, 1.0f,     // Top Left Vertex 3
-            -0.5f,  0.5f,  0.5f, 1.0f, 0.0f, 1.0f,
-            -0.5f,  0.5f, -0.5f, 1.0f, 0.0f, 1.0f,
-	};
-
-
+	// Vertices come from common/DemoMeshes.h, position, normal and color
+	vector<GLfloat> vertices = UAddFlatNormals(ColorCubeVertices, DemoMeshVertexCount, 6);
 
 	// Generate buffer IDs
 	glGenVertexArrays(1, &VAO);
@@ -302,40 +650,94 @@ void UCreateBuffers(void) {
 
 	// Activates the VBO in relation to the vertices
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+	UVertexLayout();
+
+	// Deactivate the VAO
+	glBindVertexArray(0);
 
+	if (!shadows) {
+		return;
+	}
+
+	// The floor goes just under the lowest vertex, the model turns about y only
+	GLfloat lowest = 0.0f;
+	for (size_t i = 0; i < vertices.size(); i += 9) {
+		GLfloat length = sqrt(vertices[i] * vertices[i] + vertices[i + 1] * vertices[i + 1] + vertices[i + 2] * vertices[i + 2]);
+		casterRadius = max(casterRadius, ModelScale * length);
+		lowest = min(lowest, vertices[i + 1]);
+	}
+	groundHeight = ModelScale * lowest - 0.01f;
+
+	const GLfloat h = groundHeight, grey = 0.6f;
+	const GLfloat ground[] = {
+		-12.0f, h, -12.0f,  0.0f, 1.0f, 0.0f,  grey, grey, grey,
+		12.0f, h, 12.0f,  0.0f, 1.0f, 0.0f,  grey, grey, grey,
+		12.0f, h, -12.0f,  0.0f, 1.0f, 0.0f,  grey, grey, grey,
+		12.0f, h, 12.0f,  0.0f, 1.0f, 0.0f,  grey, grey, grey,
+		-12.0f, h, -12.0f,  0.0f, 1.0f, 0.0f,  grey, grey, grey,
+		-12.0f, h, 12.0f,  0.0f, 1.0f, 0.0f,  grey, grey, grey
+	};
+	glGenVertexArrays(1, &groundVAO);
+	glGenBuffers(1, &groundVBO);
+	glBindVertexArray(groundVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, groundVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(ground), ground, GL_STATIC_DRAW);
+	UVertexLayout();
+	glBindVertexArray(0);
+}
+
+/*
+ * @desc Attributes of the bound VBO: position 0, color 1 and normal 2
+ * @returns void
+ */
+void UVertexLayout(void) {
 	// Set attrs for pointer 0
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)0);
 	glEnableVertexAttribArray(0);
 
 	// set attrs pointer 1
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
 	glEnableVertexAttribArray(1);
 
-	// Deactivate the VAO
-	glBindVertexArray(0);
+	// Normals, only the lit shader reads them
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(2);
 }
 
 /*
  * This function check if it's alt and check what type of mouse input is it
  */
 void IsAlt(int button, int state, int x, int y) {
-	if(button == GLUT_LEFT_BUTTON  && glutGetModifiers() == GLUT_ACTIVE_ALT) {
+	inputRecorder.Button(glutGet(GLUT_ELAPSED_TIME), button, state, UModifiers(), x, y);
+	lastInputTime = chrono::steady_clock::now();
+	inputPending = true;
+
+	if(button == GLUT_LEFT_BUTTON  && UModifiers() == GLUT_ACTIVE_ALT) {
 		currentKey = button;
 	}
-	else if(button == GLUT_RIGHT_BUTTON  && glutGetModifiers() == GLUT_ACTIVE_ALT){
+	else if(button == GLUT_RIGHT_BUTTON  && UModifiers() == GLUT_ACTIVE_ALT){
 
 		currentKey = button;
 	}
 
+	// Zooming lasts as long as the drag
+	if (state == GLUT_UP) {
+		zoomDirection = 0;
+	}
 }
 
 /*
- * @desc This function handles mouse movement
+ * @desc This function handles mouse movement, it only records what the mouse
+ *       did; USimulate turns it into camera movement on the next step
  */
 void UMouseMove(int x, int y) {
+	inputRecorder.Motion(glutGet(GLUT_ELAPSED_TIME), UModifiers(), x, y);
+	lastInputTime = chrono::steady_clock::now();
+	inputPending = true;
+
 	// Rotating movement
-	if (currentKey == GLUT_LEFT_BUTTON && glutGetModifiers() == GLUT_ACTIVE_ALT) {
+	if (currentKey == GLUT_LEFT_BUTTON && UModifiers() == GLUT_ACTIVE_ALT) {
 		if(mouseDetected ) {
 			lastMouseX = x;
 			lastMouseY = y;
@@ -350,64 +752,85 @@ void UMouseMove(int x, int y) {
 		lastMouseX = x;
 		lastMouseY = y;
 
-		// Apply sensitivity
-		mouseXOffset *= sensitivity;
-		mouseYOffset *= sensitivity;
-
-		yaw += mouseXOffset;
-		pitch += mouseYOffset;
-
-		if (pitch > 89.0f) {
-			pitch = 89.0f;
-		}
-		if (pitch < -89.0f) {
-			pitch = 89.0f;
-		}
-
-		front.x = 10.0f * cos(yaw);
-		front.y = 10.0f * sin(pitch);
-		front.z = sin(yaw) * cos(pitch) * 10.0f;
+		rotateInputX += mouseXOffset;
+		rotateInputY += mouseYOffset;
 	}
 
 	// Right click + ALT detected
 	// Zoom in/out action
-	else if (currentKey == GLUT_RIGHT_BUTTON  && glutGetModifiers() == GLUT_ACTIVE_ALT) {
+	else if (currentKey == GLUT_RIGHT_BUTTON  && UModifiers() == GLUT_ACTIVE_ALT) {
 		if(mouseDetected ) {
 			lastMouseX = x;
 			lastMouseY = y;
 			mouseDetected = false;
 		}
 
-		// Direct of movement in terms of x and y
-		mouseXOffset = x - lastMouseX;
+		// The mouse direction in terms of the Y-axis, measured from where
+		// the last rotation ended
 		mouseYOffset = lastMouseY - y;
+		zoomDirection = mouseYOffset < 0 ? -1 : mouseYOffset > 0 ? 1 : 0;
+	}
+}
 
-		// Update with new mouse coords
+/*
+ * @desc One fixed step of the camera: applies the rotation gathered since
+ *       the last step and zooms at cameraSpeed while a zoom drag is held
+ * @returns void
+ */
+void USimulate(double stepMilliseconds) {
+	previousCamera = camera;
 
-		// Apply sensitivity
-		mouseXOffset *= sensitivity;
-		mouseYOffset *= sensitivity;
+	// The camera clamps the pitch short of straight up and down
+	if (rotateInputX != 0.0f || rotateInputY != 0.0f) {
+		camera.Rotate(rotateInputX * sensitivity, rotateInputY * sensitivity);
+		rotateInputX = rotateInputY = 0.0f;
+	}
 
-		yaw += mouseXOffset;
-		pitch += mouseYOffset;
+	// Mouse up moves the camera in, down moves it out
+	if (zoomDirection != 0) {
+		camera.Zoom(1.0f - (GLfloat)(zoomDirection * cameraSpeed * stepMilliseconds));
+	}
+}
 
-		// Prevents pitch to go into unwanted position
-	    if (pitch > 89.0f) {
-	    	pitch = 89.0f;
-	    }
-	    // Prevents pitch to go into unwanted position
-	    if (pitch < -89.0f) {
-	    	pitch = -89.0f;
-	    }
+/*
+ * @desc Modifier keys of the input event being handled, the recorded ones
+ *       while replaying
+ * @returns GLUT_ACTIVE_* bits
+ */
+int UModifiers(void) {
+	return inputReplay.IsOpen() ? inputReplay.Modifiers() : glutGetModifiers();
+}
 
-	    // The below statement checks the mouse direction in terms of the Y-axis
-	    if (mouseYOffset < 0) {
-	    	front += front * sensitivity;
-	    }
-	    else if (mouseYOffset > 0) {
+/*
+ * @desc Advances the replay clock and dispatches the events it passed. The
+ *       clock follows real time times replaySpeed, or one 60 Hz step per
+ *       frame at speed 0 so every run renders exactly the same frames
+ * @returns void
+ */
+void UReplayInput(void) {
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	if (replayStarted) {
+		double milliseconds = chrono::duration<double, milli>(now - lastFrame).count();
+		frameTimes.Add(milliseconds);
+		replayTime += replaySpeed > 0.0 ? milliseconds * replaySpeed : InputReplayFrameStep;
+	}
+	lastFrame = now;
+	replayStarted = true;
 
-	    	front -= front * sensitivity;
-	    }
+	if (inputReplay.Finished()) {
+		frameTimes.Print(cout, "replay frame time");
+		glutLeaveMainLoop();
+		return;
 	}
+	inputReplay.Pump(replayTime, IsAlt, UMouseMove);
 }
 
+/*
+ * @desc Stops the render thread and flushes the
+ *       input log when the window is closed
+ * @returns void
+ */
+void UCloseWindow(void) {
+	renderThread.Stop();
+	inputRecorder.Close();
+}
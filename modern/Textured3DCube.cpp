@@ -1,11 +1,18 @@
 /*
  * @author Jacob William
- * @desc This program creates a 2d triangle with imported texture
+ * @desc This program creates a 2d triangle with imported texture.
+ *       The cube and its texture are streamed in through the residency
+ *       manager, -budget sets its VRAM budget in MiB and the memory report
+ *       is printed with the stats and when the window closes.
+ *       -lights N circles N point lights around the regular textured cube,
+ *       shaded through clustered light lists, -brute loops over all of them.
  *
  */
 
 
 #include <iostream>
+#include <cstdlib>
+#include <random>
 #include <GL/glew.h>
 #include <GL/freeglut.h>
 
@@ -17,6 +24,15 @@
 // SOIL2 library import
 #include "SOIL2/SOIL2.h"
 
+#include "common/AssetDatabase.h"
+#include "common/ClusteredLighting.h"
+#include "common/DemoMeshes.h"
+#include "common/JobSystem.h"
+#include "common/MipGenerator.h"
+#include "common/Residency.h"
+#include "common/TextureCompression.h"
+#include "common/VirtualTexture.h"
+
 // Use the standard name spaces
 using namespace std;
 
@@ -29,18 +45,50 @@ using namespace std;
 #endif
 
 // Declaration of variables
-GLuint VAO, VBO, EBO, texture;
 GLint shaderProgram, WindowWidth = 800, WindowHeight = 600;
 GLfloat degrees = glm::radians(-45.0f);
 
+// -virtual streams the texture through the page cache
+bool useVirtual = false;
+UVirtualTexture* virtualTexture = NULL;
+GLint virtualProgram, feedbackProgram;
+int lastStatsTime = 0;
+
+// The cube mesh and texture, streamed in on first use
+UResidencyManager residency;
+int cubeMesh, cubeTexture = -1;
+size_t budgetMegabytes = 256;
+
+// -watch reloads snhu.JPG whenever it is saved
+bool watchTexture = false;
+UAssetDatabase assets;
+
+// Builds mip chains and virtual texture pages, for the loader thread too
+UJobSystem* jobs;
+
+// -lights shades the cube with point lights binned into clusters every frame
+size_t lightCount = 0;
+bool bruteForceLights = false;
+vector<UPointLight> lights, restingLights;
+UClusteredLights clusters;
+GLint litProgram;
+
 /*
  * Prototypes to init functions before implementation
  */
 void UResizeWindow(int, int);
 void URenderGraphics(void);
 void UCreateShader(void);
-void UCreateBuffers(void);
-void UGenerateTexture(void);
+void UCloseWindow(void);
+bool UStreamCube(UMesh&);
+bool UStreamTexture(UTexture&);
+bool UGenerateVirtualTexture(void);
+bool UDecodeTexture(const string&, vector<UImage>&);
+bool UReloadTexture(const string&, vector<UImage>&);
+void UTextureReloaded(const vector<UImage>&);
+void USetMatrices(GLint, const glm::mat4&, const glm::mat4&, const glm::mat4&);
+void UCreateLights(void);
+void UMoveLights(int);
 
 
 /*
@@ -48,16 +96,22 @@ void UGenerateTexture(void);
  */
 const GLchar* VertexShader = GLSL(330,
 		layout (location = 0) in vec3 position;
+		layout (location = 1) in vec3 normal;
 		layout (location = 2) in vec2 textureCoordinates;
 
 		out vec2 mobileTextureCoordinate;
+		out vec3 viewPosition;
+		out vec3 viewNormal;
 
 		uniform mat4 model;
 		uniform mat4 view;
 		uniform mat4 projection;
 		void main() {
-			gl_Position = projection * view * model * vec4(position, 1.0f);
+			vec4 eye = view * model * vec4(position, 1.0f);
+			gl_Position = projection * eye;
 			mobileTextureCoordinate = vec2(textureCoordinates.x, 1.0f - textureCoordinates.y);
+			viewPosition = eye.xyz;
+			viewNormal = mat3(view * model) * normal;
 		}
 );
 
@@ -78,6 +132,83 @@ const GLchar* FragmentShader = GLSL(330,
 	}
 );
 
+/*
+ * Fragment shader of -lights, goes after ClusteredLightingShader. The
+ * texture is the albedo under a dim ambient term
+ */
+const GLchar* LitFragmentShader = GLSL_PART(
+	in vec2 mobileTextureCoordinate;
+	in vec3 viewPosition;
+	in vec3 viewNormal;
+
+	out vec4 gpuTexture;
+
+	uniform sampler2D uTexture;
+	void main() {
+		vec4 albedo = texture(uTexture, mobileTextureCoordinate);
+		vec3 points = UShadeClustered(viewPosition, viewNormal, albedo.rgb, 32.0);
+		gpuTexture = vec4(albedo.rgb * 0.3 + points, albedo.a);
+	}
+);
+
+/*
+ * Fragment shader sampling the virtual texture: the indirection texture
+ * gives the atlas slot and level of the best resident page for this pixel
+ */
+const GLchar* VirtualFragmentShader = GLSL(330,
+
+	in vec2 mobileTextureCoordinate;
+
+	out vec4 gpuTexture;
+
+	uniform sampler2D uAtlas;
+	uniform sampler2D uIndirection;
+	uniform float uVirtualSize;
+	uniform float uPageSize;
+	uniform float uBorder;
+	uniform float uAtlasSize;
+	uniform float uMaxLevel;
+	uniform vec2 uUvScale;
+
+	void main() {
+		vec2 virtualUv = clamp(mobileTextureCoordinate, 0.0, 0.9999) * uUvScale;
+		vec2 texel = virtualUv * uVirtualSize;
+		float level = clamp(floor(0.5 * log2(max(dot(dFdx(texel), dFdx(texel)), dot(dFdy(texel), dFdy(texel))))), 0.0, uMaxLevel);
+
+		// Slot x, slot y, level actually resident
+		vec4 entry = floor(textureLod(uIndirection, virtualUv, level) * 255.0 + 0.5);
+		float pages = uVirtualSize / uPageSize / exp2(entry.z);
+		vec2 local = fract(virtualUv * pages);
+		vec2 atlasTexel = entry.xy * (uPageSize + 2.0 * uBorder) + uBorder + local * uPageSize;
+		gpuTexture = textureLod(uAtlas, atlasTexel / uAtlasSize, 0.0);
+	}
+);
+
+/*
+ * Feedback shader, writes the page and level each pixel wants. The target is
+ * VirtualFeedbackScale times smaller, uFeedbackBias undoes the coarser derivatives
+ */
+const GLchar* FeedbackFragmentShader = GLSL(330,
+
+	in vec2 mobileTextureCoordinate;
+
+	out vec4 feedback;
+
+	uniform float uVirtualSize;
+	uniform float uPageSize;
+	uniform float uMaxLevel;
+	uniform vec2 uUvScale;
+	uniform float uFeedbackBias;
+
+	void main() {
+		vec2 virtualUv = clamp(mobileTextureCoordinate, 0.0, 0.9999) * uUvScale;
+		vec2 texel = virtualUv * uVirtualSize;
+		float level = clamp(floor(0.5 * log2(max(dot(dFdx(texel), dFdx(texel)), dot(dFdy(texel), dFdy(texel)))) - uFeedbackBias), 0.0, uMaxLevel);
+		vec2 page = floor(virtualUv * uVirtualSize / uPageSize / exp2(level));
+		feedback = vec4(page, level, 255.0) / 255.0;
+	}
+);
+
 // Main function
 int main(int argc, char * argv[]) {
 
@@ -85,6 +216,36 @@ int main(int argc, char * argv[]) {
 	// Init freeglut
 	glutInit(&argc, argv);
 
+	for (int i = 1; i < argc; ++i) {
+		if (string(argv[i]) == "-virtual") {
+			useVirtual = true;
+		}
+		else if (string(argv[i]) == "-watch") {
+			watchTexture = true;
+		}
+		else if (string(argv[i]) == "-budget" && i + 1 < argc) {
+			char* end;
+			long megabytes = strtol(argv[++i], &end, 10);
+			if (end == argv[i] || *end != '\0' || megabytes <= 0 || megabytes > (1L << 20)) {
+				cout << "-budget needs a size in MiB above 0, not " << argv[i] << endl;
+				return -1;
+			}
+			budgetMegabytes = (size_t)megabytes;
+		}
+		else if (string(argv[i]) == "-lights" && i + 1 < argc) {
+			char* end;
+			long count = strtol(argv[++i], &end, 10);
+			if (end == argv[i] || *end != '\0' || count < 0 || (size_t)count > ClusterMaxLights) {
+				cout << "-lights needs 0 to " << ClusterMaxLights << " lights, not " << argv[i] << endl;
+				return -1;
+			}
+			lightCount = (size_t)count;
+		}
+		else if (string(argv[i]) == "-brute") {
+			bruteForceLights = true;
+		}
+	}
+
 	// Creates memory buffer for the window
 	glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA);
 
@@ -106,14 +267,47 @@ int main(int argc, char * argv[]) {
 	}
 
 
+	jobs = new UJobSystem();
+
 	// Calls the function to create shader
 	UCreateShader();
 
-	// Calls the function to draw the two triangles for this assigment
-	UCreateBuffers();
+	// Registers the cube, the buffers are created on the first frame
+	residency.SetBudget(budgetMegabytes << 20);
+	cubeMesh = residency.AddMesh("cube", UStreamCube);
+
+	// Generates textures, the plain one as well when no page file can be made
+	if (useVirtual && !UGenerateVirtualTexture()) {
+		cout << "Falling back to the regular texture" << endl;
+		useVirtual = false;
+	}
+	if (!useVirtual) {
+		cubeTexture = residency.AddTexture("snhu", UStreamTexture);
+	}
+
+	// The page cache has its own fragment shader, the lights stay with the
+	// regular texture
+	if (lightCount > 0 && useVirtual) {
+		cout << "-lights is ignored with -virtual" << endl;
+		lightCount = 0;
+	}
+	if (lightCount > 0) {
+		UCreateLights();
+		cout << lightCount << " point lights, " << (bruteForceLights ? "every light per fragment" : "clustered") << endl;
+	}
 
-	// Generates textures
-	UGenerateTexture();
+	// The page file is cut once, only the plain texture reloads. The loader
+	// rewrites snhu.utex and the residency manager streams it in again
+	if (watchTexture && !useVirtual) {
+		assets.WatchTexture("snhu.JPG", UReloadTexture, UTextureReloaded);
+		if (assets.Start(false)) {
+			cout << "Watching snhu.JPG" << endl;
+		}
+		else {
+			cout << "inotify is not available, -watch is off" << endl;
+			watchTexture = false;
+		}
+	}
 
 	glUseProgram(shaderProgram);
 	// Sets the background color to clear
@@ -122,16 +316,13 @@ int main(int argc, char * argv[]) {
 	// Renders graphics in the window
 	glutDisplayFunc(URenderGraphics);
 
+	// Frees the GL objects while the context still exists, GLUT exits
+	// from inside the loop
+	glutCloseFunc(UCloseWindow);
 
 	// Starts the OpenGL loop in the background
 	glutMainLoop();
 
-
-	// Deconstructors
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
-
 	// Termination of the program due to a successful exit
 	return 0;
 }
@@ -142,6 +333,8 @@ int main(int argc, char * argv[]) {
  * @return void
  */
 void UResizeWindow(int width, int height) {
+	WindowWidth = width;
+	WindowHeight = height;
 	glViewport(0, 0, width, height);
 }
 
@@ -151,11 +344,24 @@ void UResizeWindow(int width, int height) {
  */
 void URenderGraphics(void) {
 
+	// A reloaded texture is swapped in before anything draws
+	if (watchTexture) {
+		assets.Update(cout);
+	}
+
 	// Enables z axis
 	glEnable(GL_DEPTH_TEST);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	glBindVertexArray(VAO);
+	residency.BeginFrame();
+	UMesh* cube = residency.Mesh(cubeMesh);
+	if (cube == NULL) {
+		// Keeps asking for frames until the mesh streams in
+		glutPostRedisplay();
+		glutSwapBuffers();
+		return;
+	}
+	glBindVertexArray(cube->vertexArray);
 
 	// Model
 	glm::mat4 model;
@@ -174,154 +380,372 @@ void URenderGraphics(void) {
 	glm::mat4 projection;
 	projection = glm::perspective(45.0f, (GLfloat)WindowWidth / (GLfloat)WindowHeight, 0.1f, 100.0f);
 
-	// Set values returned from each variable to its corresponding variable
-	GLint modelLocation = glGetUniformLocation(shaderProgram, "model");
-	GLint viewLocation = glGetUniformLocation(shaderProgram, "view");
-	GLint proLocation = glGetUniformLocation(shaderProgram, "projection");
+	if (useVirtual) {
+		// Small pass telling the cache which pages this view needs
+		virtualTexture->BeginFeedback(WindowWidth, WindowHeight);
+		glUseProgram(feedbackProgram);
+		USetMatrices(feedbackProgram, model, view, projection);
+		virtualTexture->SetUniforms(feedbackProgram);
+		glUniform1f(glGetUniformLocation(feedbackProgram, "uFeedbackBias"), log2((float)VirtualFeedbackScale));
+		glDrawArrays(GL_TRIANGLES, 0, 36);
+		virtualTexture->EndFeedback(WindowWidth, WindowHeight);
+		virtualTexture->Update();
+
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glUseProgram(virtualProgram);
+		USetMatrices(virtualProgram, model, view, projection);
+		virtualTexture->Bind(virtualProgram, 0, 1);
+		glDrawArrays(GL_TRIANGLES, 0, 36);
+
+		int now = glutGet(GLUT_ELAPSED_TIME);
+		if (now - lastStatsTime >= 5000) {
+			UPrintVirtualTextureStats(cout, virtualTexture->Stats());
+			lastStatsTime = now;
+		}
+	}
+	else {
+		GLint program = lightCount > 0 ? litProgram : shaderProgram;
+		glUseProgram(program);
+		USetMatrices(program, model, view, projection);
+
+		// Light lists for this view, the field of view read back from the
+		// projection. They take units 1 to 3
+		if (lightCount > 0) {
+			UMoveLights(glutGet(GLUT_ELAPSED_TIME));
+			clusters.Update(*jobs, lights, glm::value_ptr(view), 2.0f * atan(1.0f / projection[1][1]),
+				(GLfloat)WindowWidth / (GLfloat)WindowHeight, 0.1f, 100.0f);
+			clusters.Bind(program, 1, WindowWidth, WindowHeight, bruteForceLights);
+		}
 
-	// Specify the model, view, and location values in relation to the matrix
-	glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(model));
-	glUniformMatrix4fv(viewLocation, 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(proLocation, 1, GL_FALSE, glm::value_ptr(projection));
+		// Activates texture, a missing one samples black
+		UTexture* texture = residency.Texture(cubeTexture);
+		glBindTexture(GL_TEXTURE_2D, texture != NULL ? texture->texture : 0);
 
 
-	// Flags to the main loop
-	glutPostRedisplay();
-
-	// Activates texture
-	glBindTexture(GL_TEXTURE_2D, texture);
+		glDrawArrays(GL_TRIANGLES, 0, cube->vertexCount);
 
+		int now = glutGet(GLUT_ELAPSED_TIME);
+		if (now - lastStatsTime >= 5000) {
+			residency.PrintStats(cout);
+			if (lightCount > 0) {
+				clusters.PrintStats(cout);
+			}
+			lastStatsTime = now;
+		}
+	}
 
-	glDrawArrays(GL_TRIANGLES, 0, 36);
+	// Flags to the main loop
+	glutPostRedisplay();
 
 	// Deactivator
 	glBindVertexArray(0);
 
 	// Buffer flipper
 	glutSwapBuffers();
+	if (watchTexture) {
+		assets.Presented(cout);
+	}
 }
 
-void UCreateShader(void) {
+/*
+ * @desc Specifies the model, view, and projection values of program
+ * @returns void
+ */
+void USetMatrices(GLint program, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) {
+	GLint modelLocation = glGetUniformLocation(program, "model");
+	GLint viewLocation = glGetUniformLocation(program, "view");
+	GLint proLocation = glGetUniformLocation(program, "projection");
+
+	glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+	glUniformMatrix4fv(viewLocation, 1, GL_FALSE, glm::value_ptr(view));
+	glUniformMatrix4fv(proLocation, 1, GL_FALSE, glm::value_ptr(projection));
+}
+
+/*
+ * @desc Compiles and links one vertex and fragment shader pair
+ * @returns program name
+ */
+GLint UCreateProgram(const GLchar* vertexSource, const GLchar* fragmentSource) {
 
 	// Vertex shader
 	GLint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShaderId, 1, &VertexShader, NULL);
+	glShaderSource(vertexShaderId, 1, &vertexSource, NULL);
 	glCompileShader(vertexShaderId);
 
 
 	// Fragment shader
 	GLint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShaderId, 1, &FragmentShader, NULL);
+	glShaderSource(fragmentShaderId, 1, &fragmentSource, NULL);
 	glCompileShader(fragmentShaderId);
 
-	// Shader program
 	// Create shader program
-	shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShaderId);
-	glAttachShader(shaderProgram, fragmentShaderId);
-	glLinkProgram(shaderProgram);
+	GLint program = glCreateProgram();
+	glAttachShader(program, vertexShaderId);
+	glAttachShader(program, fragmentShaderId);
+	glLinkProgram(program);
 
 
 	// Delete the instances once the program is created and linked
 	glDeleteShader(vertexShaderId);
 	glDeleteShader(fragmentShaderId);
 
+	return program;
+}
+
+void UCreateShader(void) {
+	shaderProgram = UCreateProgram(VertexShader, FragmentShader);
+	virtualProgram = UCreateProgram(VertexShader, VirtualFragmentShader);
+	feedbackProgram = UCreateProgram(VertexShader, FeedbackFragmentShader);
+
+	string litSource = string("#version 330\n") + ClusteredLightingShader + LitFragmentShader;
+	litProgram = UCreateProgram(VertexShader, litSource.c_str());
 }
 
 /*
- * @desc this fucntion draw triangles according to the assigment
+ * @desc Prints the memory report and frees everything while the context
+ *       still exists
  * @returns void
  */
-void UCreateBuffers() {
-	// Init the vertices of the two triangles
-	// BOTH TRIANGLES WILL BE SHARING THE SECOND INDEX
-	GLfloat verts[] = {
-            -0.5f, -0.5f, -0.5f, 0.0f, 0.0f,  // Top Right Vertex 0
-             0.5f, -0.5f, -0.5f, 1.0f, 0.0f,  // Bottom Right Vertex 1
-             0.5f,  0.5f, -0.5f, 1.0f, 1.0f,    // Bottom Left Vertex 2
-             0.5f,  0.5f, -0.5f, 1.0f, 1.0f,    // Top Left Vertex 3
-            -0.5f,  0.5f, -0.5f, 0.0f, 1.0f,
-            -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-
-
-            -0.5f, -0.5f,  0.5f, 0.0f,  0.0f,   // Top Right Vertex 0
-             0.5f, -0.5f,  0.5f, 1.0f, 0.0f,  // Bottom Right Vertex 1
-             0.5f,  0.5f,  0.5f, 1.0f, 1.0f,    // Bottom Left Vertex 2
-             0.5f,  0.5f,  0.5f, 1.0f, 1.0f,     // Top Left Vertex 3
-            -0.5f,  0.5f,  0.5f, 0.0f, 1.0f,
-            -0.5f, -0.5f,  0.5f, 0.0f, 0.0f,
-
-
-            -0.5f,  0.5f,  0.5f, 1.0f, 0.0f,   // Top Right Vertex 0
-            -0.5f,  0.5f, -0.5f, 1.0f, 1.0f,  // Bottom Right Vertex 1
-            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,    // Bottom Left Vertex 2
-            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,    // Top Left Vertex 3
-            -0.5f, -0.5f,  0.5f, 0.0f, 0.0f,
-            -0.5f,  0.5f,  0.5f, 1.0f, 0.0f,
-
-
-             0.5f,  0.5f,  0.5f, 1.0f,  0.0f,   // Top Right Vertex 0
-             0.5f,  0.5f, -0.5f, 1.0f, 1.0f,  // Bottom Right Vertex 1
-             0.5f, -0.5f, -0.5f, 0.0f, 1.0f,    // Bottom Left Vertex 2
-             0.5f, -0.5f, -0.5f, 0.0f, 1.0f,     // Top Left Vertex 3
-             0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-             0.5f,  0.5f,  0.5f, 0.0f, 1.0f,
-
-
-            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,  // Top Right Vertex 0
-             0.5f, -0.5f, -0.5f, 1.0f, 1.0f,  // Bottom Right Vertex 1
-             0.5f, -0.5f,  0.5f,  1.0f, 0.0f,   // Bottom Left Vertex 2
-             0.5f, -0.5f,  0.5f,  1.0f, 0.0f,     // Top Left Vertex 3
-            -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-            -0.5f, -0.5f, -0.5f, 0.0f,  1.0f,
-
-            -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,   // Top Right Vertex 0
-             0.5f,  0.5f, -0.5f, 1.0f, 1.0f,  // Bottom Right Vertex 1
-             0.5f,  0.5f,  0.5f, 1.0f, 0.0f,    // Bottom Left Vertex 2
-             0.5f,  0.5f,  0.5f, 1.0f, 0.0f,    // Top Left Vertex 3
-            -0.5f,  0.5f,  0.5f, 0.0f, 0.0f,
-            -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-	};
-
+void UCloseWindow(void) {
+	residency.Report(cout);
+	residency.Destroy();
+	glDeleteProgram(shaderProgram);
+	glDeleteProgram(virtualProgram);
+	glDeleteProgram(feedbackProgram);
+	glDeleteProgram(litProgram);
+	clusters.Destroy();
+	delete virtualTexture;
+	virtualTexture = NULL;
+	assets.Close();
+	delete jobs;
+	jobs = NULL;
+}
 
+/*
+ * @desc this fucntion draw triangles according to the assigment
+ * @returns true, the vertices are built in
+ */
+bool UStreamCube(UMesh& mesh) {
+	// Vertices come from common/DemoMeshes.h, position, normal and texture
+	// coordinates; only the -lights shader reads the normals
+	vector<GLfloat> vertices = UAddFlatNormals(TexturedCubeVertices, DemoMeshVertexCount, 5);
 
 	// Generate buffer IDs
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
+	glGenVertexArrays(1, &mesh.vertexArray);
+	glGenBuffers(1, &mesh.vertexBuffer);
+	mesh.vertexCount = DemoMeshVertexCount;
 
 	// Activates the vertex object before binding any VBOs
-	glBindVertexArray(VAO);
+	glBindVertexArray(mesh.vertexArray);
 
 	// Activates the VBO in relation to the vertices
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
 
 	// Set attrs for pointer 0
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (GLvoid*)0);
 	glEnableVertexAttribArray(0);
 
+	// Normals
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(1);
+
 	// set attrs pointer 2
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
 	glEnableVertexAttribArray(2);
 
 	// Deactivate the VAO
 	glBindVertexArray(0);
+	return true;
 }
 
-void UGenerateTexture() {
+/*
+ * @desc Loads the compressed cache snhu.utex when it exists, otherwise
+ *       decodes snhu.JPG and writes the cache for the next launch
+ * @returns false when neither can be read
+ */
+bool UStreamTexture(UTexture& texture) {
+
+
+	glGenTextures(1, &texture.texture);
+	glBindTexture(GL_TEXTURE_2D, texture.texture);
 
+	int start = glutGet(GLUT_ELAPSED_TIME);
+
+	// Compressed blocks and mips straight from the mapped file
+	UTextureLoadStats stats;
+	if (ULoadCompressedTexture("snhu.utex", &stats)) {
+		cout << "snhu.utex: " << stats.width << "x" << stats.height << ", " << stats.levels << " levels, "
+			<< stats.gpuBytes / 1024 << " KiB VRAM, " << glutGet(GLUT_ELAPSED_TIME) - start << " ms" << endl;
+		texture.width = stats.width;
+		texture.height = stats.height;
+		texture.layers = 1;
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return true;
+	}
+
+	vector<UImage> levels;
+	if (!UDecodeTexture("snhu.JPG", levels)) {
+		cout << "Failed to load snhu.JPG" << endl;
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return false;
+	}
+	for (size_t l = 0; l < levels.size(); ++l) {
+		glTexImage2D(GL_TEXTURE_2D, (GLint)l, GL_RGBA8, levels[l].width, levels[l].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[l].pixels.data());
+	}
 
-	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	// Uncompressed RGBA plus a third for the mips
+	int width = levels[0].width, height = levels[0].height;
+	texture.width = width;
+	texture.height = height;
+	texture.layers = 1;
+	cout << "snhu.JPG: " << width << "x" << height << ", " << (size_t)width * height * 4 * 4 / 3 / 1024
+		<< " KiB VRAM, " << glutGet(GLUT_ELAPSED_TIME) - start << " ms" << endl;
+
+	// Encode the cache for the next launch from the same levels
+	UTextureCodec codec;
+	if (!UPreferredCodec(false, codec)) {
+		cout << "No compressed texture format, snhu.JPG is decoded every launch" << endl;
+	}
+	else if (!UWriteCompressedTexture("snhu.utex", levels, codec)) {
+		cout << "Failed to write snhu.utex" << endl;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return true;
+}
+
+/*
+ * @desc Decodes an image file into gamma correct RGBA mip levels, the mips
+ *       built on every core instead of by glGenerateMipmap
+ * @returns false when the file cannot be decoded
+ */
+bool UDecodeTexture(const string& path, vector<UImage>& levels) {
 	int width, height;
 	// Texture file loader
-	unsigned char* image = SOIL_load_image("snhu.JPG", &width, &height, 0, SOIL_LOAD_RGB);
+	unsigned char* image = SOIL_load_image(path.c_str(), &width, &height, 0, SOIL_LOAD_RGB);
+	if (image == NULL) {
+		return false;
+	}
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+	UImage rgba;
+	rgba.width = width;
+	rgba.height = height;
+	rgba.pixels.resize((size_t)width * height * 4);
+	for (int i = 0; i < width * height; ++i) {
+		memcpy(&rgba.pixels[i * 4], &image[i * 3], 3);
+		rgba.pixels[i * 4 + 3] = 255;
+	}
+	SOIL_free_image_data(image);
+
+	levels = UGenerateMipChain(*jobs, rgba);
+	return true;
+}
+
+/*
+ * @desc Loader thread side of -watch: decodes the saved image and rewrites
+ *       the compressed cache the texture streams from. A cache that cannot
+ *       be written is removed, the texture then streams from the image
+ * @returns false when the image cannot be decoded
+ */
+bool UReloadTexture(const string& path, vector<UImage>& levels) {
+	if (!UDecodeTexture(path, levels)) {
+		return false;
+	}
+	UTextureCodec codec;
+	if (!UPreferredCodec(false, codec) || !UWriteCompressedTexture("snhu.utex", levels, codec)) {
+		cout << "Failed to write snhu.utex" << endl;
+		remove("snhu.utex");
+	}
+	return true;
+}
+
+/*
+ * @desc GL thread side of -watch, between frames: streams the texture in
+ *       again, so its size is measured anew and its format kept
+ * @returns void
+ */
+void UTextureReloaded(const vector<UImage>&) {
+	if (!residency.Reload(cubeTexture)) {
+		cout << "Failed to stream the reloaded texture" << endl;
+	}
+}
+
+/*
+ * @desc Opens the page file snhu.vtex, cutting it from snhu.JPG first when
+ *       it does not exist yet
+ * @returns false when neither works, virtualTexture is then NULL
+ */
+bool UGenerateVirtualTexture() {
+	virtualTexture = new UVirtualTexture();
+	if (virtualTexture->Open("snhu.vtex")) {
+		return true;
+	}
 
-	glGenerateMipmap(GL_TEXTURE_2D);
+	int width, height;
+	unsigned char* image = SOIL_load_image("snhu.JPG", &width, &height, 0, SOIL_LOAD_RGBA);
+	if (image == NULL) {
+		cout << "Failed to load snhu.JPG: " << SOIL_last_result() << endl;
+		delete virtualTexture;
+		virtualTexture = NULL;
+		return false;
+	}
 
+	UImage rgba;
+	rgba.width = width;
+	rgba.height = height;
+	rgba.pixels.assign(image, image + (size_t)width * height * 4);
 	SOIL_free_image_data(image);
 
-	glBindTexture(GL_TEXTURE_2D, 0);
+	if (!UWriteVirtualTexture("snhu.vtex", *jobs, rgba) || !virtualTexture->Open("snhu.vtex")) {
+		cout << "Failed to create snhu.vtex" << endl;
+		delete virtualTexture;
+		virtualTexture = NULL;
+		return false;
+	}
+	return true;
+}
+
+/*
+ * @desc Scatters the point lights in a shell around the cube with random
+ *       colors and creates the cluster buffers
+ * @returns void
+ */
+void UCreateLights(void) {
+	mt19937 random(7);
+	uniform_real_distribution<float> angle(0.0f, 6.2831853f), distance(1.5f, 3.0f), height(-1.5f, 1.5f), radius(1.0f, 2.5f), unit(0.0f, 1.0f);
+
+	restingLights.resize(lightCount);
+	for (size_t i = 0; i < lightCount; ++i) {
+		UPointLight& light = restingLights[i];
+		float around = angle(random), away = distance(random);
+		light.position[0] = away * cos(around);
+		light.position[1] = height(random);
+		light.position[2] = away * sin(around);
+		light.radius = radius(random);
+
+		// Saturated colors, one channel always full
+		int full = (int)(unit(random) * 3.0f) % 3;
+		for (int c = 0; c < 3; ++c) {
+			light.color[c] = c == full ? 1.0f : unit(random);
+		}
+		light.intensity = 1.0f + 2.0f * unit(random);
+	}
+	lights = restingLights;
+
+	clusters.Create();
+}
+
+/*
+ * @desc Each light circles the cube at its own pace
+ * @returns void
+ */
+void UMoveLights(int now) {
+	float time = now * 0.001f;
+	for (size_t i = 0; i < lightCount; ++i) {
+		float turn = time * (0.2f + (i % 7) * 0.05f);
+		float c = cos(turn), s = sin(turn);
+		lights[i].position[0] = restingLights[i].position[0] * c - restingLights[i].position[2] * s;
+		lights[i].position[2] = restingLights[i].position[0] * s + restingLights[i].position[2] * c;
+	}
 }
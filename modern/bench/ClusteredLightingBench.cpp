@@ -0,0 +1,230 @@
+/*
+ * @author Jacob William
+ * @desc Times the clustered light assignment for 16 to 16384 point lights
+ *       with 1 thread and every core. With -gl it also opens a 1280x720
+ *       GLUT window, shades a lit floor through the cluster lists and
+ *       compares the frame time with looping over every light per fragment
+ *
+ *       g++ -O2 -std=c++11 -pthread ClusteredLightingBench.cpp -o ClusteredLightingBench -lGLEW -lGL -lglut
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+// Importing glm headers
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../common/ClusteredLighting.h"
+
+// Use the standard name spaces
+using namespace std;
+
+#ifndef GLSL
+#define GLSL(Version, Source) "#version " #Version "\n" #Source
+#endif
+
+const int Runs = 5;
+const int Frames = 20;
+const int Width = 1280, Height = 720;
+const float FieldOfView = 0.785398f, NearPlane = 0.1f, FarPlane = 200.0f;
+
+// Looping over every light per fragment gets too slow to wait for past this
+const size_t BruteForceLimit = 4096;
+
+/*
+ * Floor vertex shader
+ */
+const GLchar* VertexShader = GLSL(330,
+		layout (location = 0) in vec3 position;
+		out vec3 viewPosition;
+		out vec3 viewNormal;
+		uniform mat4 view;
+		uniform mat4 projection;
+		void main() {
+			vec4 eyePosition = view * vec4(position, 1.0f);
+			gl_Position = projection * eyePosition;
+			viewPosition = eyePosition.xyz;
+			viewNormal = mat3(view) * vec3(0.0, 1.0, 0.0);
+		}
+);
+
+/*
+ * Floor fragment shader, compiled after ClusteredLightingShader
+ */
+const GLchar* FragmentShader = GLSL_PART(
+	in vec3 viewPosition;
+	in vec3 viewNormal;
+	out vec4 gpuColor;
+	void main() {
+		gpuColor = vec4(UShadeClustered(viewPosition, viewNormal, vec3(0.8), 32.0), 1.0);
+	}
+);
+
+/*
+ * @desc Lights spread over a 100 x 100 floor, hovering just above it
+ * @returns the lights
+ */
+vector<UPointLight> UMakeLights(size_t count) {
+	mt19937 random(1);
+	uniform_real_distribution<float> position(-50.0f, 50.0f), height(0.5f, 3.0f), radius(2.0f, 6.0f), unit(0.0f, 1.0f);
+	vector<UPointLight> lights(count);
+	for (size_t i = 0; i < count; ++i) {
+		lights[i].position[0] = position(random);
+		lights[i].position[1] = height(random);
+		lights[i].position[2] = position(random);
+		lights[i].radius = radius(random);
+		lights[i].color[0] = unit(random);
+		lights[i].color[1] = unit(random);
+		lights[i].color[2] = unit(random);
+		lights[i].intensity = 4.0f;
+	}
+	return lights;
+}
+
+/*
+ * @desc Best of Runs assignments
+ * @returns milliseconds
+ */
+double UTimeAssign(UJobSystem& jobs, UClusteredLights& clusters, const vector<UPointLight>& lights, const glm::mat4& view) {
+	double best = 1e30;
+	for (int r = 0; r < Runs; ++r) {
+		clusters.Assign(jobs, lights, glm::value_ptr(view), FieldOfView, (float)Width / Height, NearPlane, FarPlane);
+		best = min(best, clusters.Stats().assignMilliseconds);
+	}
+	return best;
+}
+
+/*
+ * @desc Mean of Frames floor draws, each waited for with glFinish
+ * @returns milliseconds
+ */
+double UTimeShading(GLuint program, GLuint vertexArray, const UClusteredLights& clusters, bool bruteForce) {
+	clusters.Bind(program, 0, Width, Height, bruteForce);
+	glBindVertexArray(vertexArray);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+	glFinish();
+
+	auto start = chrono::steady_clock::now();
+	for (int f = 0; f < Frames; ++f) {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+		glFinish();
+	}
+	glBindVertexArray(0);
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / Frames;
+}
+
+/*
+ * @desc Compiles the floor program
+ * @returns the program
+ */
+GLuint UCreateProgram(void) {
+	GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShaderId, 1, &VertexShader, NULL);
+	glCompileShader(vertexShaderId);
+
+	const GLchar* sources[] = { "#version 330\n", ClusteredLightingShader, FragmentShader };
+	GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShaderId, 3, sources, NULL);
+	glCompileShader(fragmentShaderId);
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShaderId);
+	glAttachShader(program, fragmentShaderId);
+	glLinkProgram(program);
+	glDeleteShader(vertexShaderId);
+	glDeleteShader(fragmentShaderId);
+	return program;
+}
+
+/*
+ * @desc One quad covering the light field at y = 0
+ * @returns the vertex array
+ */
+GLuint UCreateFloor(GLuint& buffer) {
+	const GLfloat vertices[] = {
+		-50.0f, 0.0f, -50.0f,  50.0f, 0.0f, -50.0f,  50.0f, 0.0f, 50.0f,
+		50.0f, 0.0f, 50.0f,  -50.0f, 0.0f, 50.0f,  -50.0f, 0.0f, -50.0f
+	};
+	GLuint vertexArray;
+	glGenVertexArrays(1, &vertexArray);
+	glGenBuffers(1, &buffer);
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
+	glEnableVertexAttribArray(0);
+	glBindVertexArray(0);
+	return vertexArray;
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	bool gl = argc > 1 && strcmp(argv[1], "-gl") == 0;
+	GLuint program = 0, floorArray = 0, floorBuffer = 0;
+	if (gl) {
+		glutInit(&argc, argv);
+		glutInitDisplayMode(GLUT_DEPTH | GLUT_RGBA);
+		glutInitWindowSize(Width, Height);
+		glutCreateWindow("ClusteredLightingBench");
+		glewExperimental = GL_TRUE;
+		if (glewInit() != GLEW_OK) {
+			cout << "Failed to initialize GLEW" << endl;
+			return 1;
+		}
+		glViewport(0, 0, Width, Height);
+		glEnable(GL_DEPTH_TEST);
+		program = UCreateProgram();
+		floorArray = UCreateFloor(floorBuffer);
+	}
+
+	UJobSystem single(0);
+	UJobSystem all;
+	UClusteredLights clusters;
+	if (gl) {
+		clusters.Create();
+	}
+
+	// Looking down the floor from one edge, most lights are on screen
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 25.0f, 60.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(FieldOfView, (float)Width / Height, NearPlane, FarPlane);
+
+	for (size_t count = 16; count <= 16384; count *= 4) {
+		vector<UPointLight> lights = UMakeLights(count);
+
+		double one = UTimeAssign(single, clusters, lights, view);
+		double many = UTimeAssign(all, clusters, lights, view);
+		UClusterStats stats = clusters.Stats();
+		cout << count << " lights (" << stats.visibleLights << " visible, " << stats.indices << " list entries, at most "
+			<< stats.maxPerCluster << " per cluster): assign 1 thread " << one << " ms, " << all.ThreadCount()
+			<< " threads " << many << " ms" << endl;
+
+		if (gl) {
+			clusters.Upload();
+			glUseProgram(program);
+			glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+			glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+			cout << "  clustered " << UTimeShading(program, floorArray, clusters, false) << " ms/frame";
+			if (count <= BruteForceLimit) {
+				cout << ", every light " << UTimeShading(program, floorArray, clusters, true) << " ms/frame";
+			}
+			cout << endl;
+		}
+	}
+
+	if (gl) {
+		clusters.Destroy();
+		glDeleteVertexArrays(1, &floorArray);
+		glDeleteBuffers(1, &floorBuffer);
+		glDeleteProgram(program);
+	}
+	return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * @author Jacob William
+ * @desc Measures the cost of recording and replaying deferred command lists,
+ *       100k objects each recording a model matrix and a draw. Replay goes
+ *       through a dispatcher that only checksums the arguments, so the
+ *       number is the decode loop cost without any driver work. Needs no
+ *       GL context.
+ *
+ *       g++ -O2 -std=c++11 -pthread CommandListBench.cpp -o CommandListBench
+ */
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+
+#include "../common/CommandList.h"
+#include "../common/JobSystem.h"
+
+// Use the standard name spaces
+using namespace std;
+
+const size_t ObjectCount = 100000;
+const int Runs = 50;
+
+/*
+ * Replay target that touches every argument without calling GL
+ */
+struct UChecksumDispatch {
+	double sum;
+	UChecksumDispatch() : sum(0.0) {}
+	void BindProgram(GLuint program) { sum += program; }
+	void BindVertexArray(GLuint vertexArray) { sum += vertexArray; }
+	void BindTexture(GLenum unit, GLenum target, GLuint texture) { sum += unit + target + texture; }
+	void Uniform1i(GLint location, GLint value) { sum += location + value; }
+	void Uniform1f(GLint location, GLfloat value) { sum += location + value; }
+	void Uniform4f(GLint location, const GLfloat* value) { sum += location + value[0]; }
+	void UniformMatrix4(GLint location, const GLfloat* value) { sum += location + value[12]; }
+	void DrawArrays(GLenum mode, GLint first, GLsizei count) { sum += mode + first + count; }
+	void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances, GLuint baseInstance) {
+		sum += mode + first + count + instances + baseInstance;
+	}
+};
+
+/*
+ * @desc Records the objects [begin, end) into list
+ * @returns void
+ */
+void URecordObjects(UCommandList& list, size_t begin, size_t end) {
+	GLfloat model[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	list.BindProgram(1);
+	list.BindVertexArray(1);
+	for (size_t i = begin; i < end; ++i) {
+		model[12] = (GLfloat)i;
+		list.UniformMatrix4(0, model);
+		list.DrawArrays(GL_TRIANGLES, 0, 36);
+	}
+}
+
+// Main function
+int main(void) {
+
+	unsigned cores = thread::hardware_concurrency();
+	if (cores == 0) {
+		cores = 1;
+	}
+
+	for (unsigned threads = 1; threads <= cores; ++threads) {
+		UJobSystem jobs(threads - 1);
+		size_t grain = (ObjectCount + threads * 4 - 1) / (threads * 4);
+		vector<UCommandList> lists((ObjectCount + grain - 1) / grain);
+
+		double recordSeconds = 0.0, replaySeconds = 0.0;
+		size_t commands = 0;
+		UChecksumDispatch dispatch;
+
+		for (int run = 0; run <= Runs; ++run) {
+			auto start = chrono::steady_clock::now();
+			for (size_t l = 0; l < lists.size(); ++l) {
+				lists[l].Reset();
+			}
+			jobs.ParallelFor(ObjectCount, grain, [&](size_t begin, size_t end) {
+				URecordObjects(lists[begin / grain], begin, end);
+			});
+			auto recorded = chrono::steady_clock::now();
+			commands = UReplayCommands(lists.data(), lists.size(), dispatch);
+			auto replayed = chrono::steady_clock::now();
+
+			// First run only grows the lists
+			if (run > 0) {
+				recordSeconds += chrono::duration<double>(recorded - start).count();
+				replaySeconds += chrono::duration<double>(replayed - recorded).count();
+			}
+		}
+
+		double per100k = 100000.0 / commands / Runs * 1000.0;
+		cout << threads << " thread(s): record " << recordSeconds * per100k << " ms, replay "
+			<< replaySeconds * per100k << " ms per 100k commands (" << commands << " commands, checksum "
+			<< dispatch.sum << ")" << endl;
+	}
+
+	return 0;
+}
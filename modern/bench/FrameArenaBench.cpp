@@ -0,0 +1,104 @@
+/*
+ * @author Jacob William
+ * @desc Checks that a warmed up 100k object frame (transforms, culling,
+ *       sorting, instance writing and command recording) makes no heap
+ *       allocations, and prints the frame arena counters
+ *
+ *       g++ -O2 -std=c++11 -pthread FrameArenaBench.cpp -o FrameArenaBench
+ */
+
+#include <iostream>
+#include <atomic>
+#include <cstdlib>
+
+// Importing glm headers
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../common/FrameScene.h"
+
+// Use the standard name spaces
+using namespace std;
+
+const size_t ObjectCount = 100000;
+// Two frames per arena, the first frame of each may overflow and regrow it
+const int WarmUpFrames = 4;
+const int Frames = 100;
+
+// Heap calls from any thread, operator new goes through malloc as well
+atomic<size_t> mallocCalls(0);
+
+#ifdef __GLIBC__
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+
+extern "C" void* malloc(size_t size) {
+	mallocCalls.fetch_add(1, memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+	mallocCalls.fetch_add(1, memory_order_relaxed);
+	return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* memory, size_t size) {
+	mallocCalls.fetch_add(1, memory_order_relaxed);
+	return __libc_realloc(memory, size);
+}
+#else
+void* operator new(size_t size) {
+	mallocCalls.fetch_add(1, memory_order_relaxed);
+	void* memory = malloc(size);
+	if (memory == NULL) {
+		throw bad_alloc();
+	}
+	return memory;
+}
+
+void operator delete(void* memory) noexcept {
+	free(memory);
+}
+#endif
+
+// Main function
+int main(void) {
+
+	glm::vec3 cameraPosition = glm::vec3(0.0f, 0.0f, 60.0f);
+	glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 200.0f);
+	glm::mat4 viewProjection = projection * view;
+
+	USceneObjects scene;
+	UScatterObjects(scene, ObjectCount, 50.0f, 4, 42);
+
+	UJobSystem jobs;
+	UFrameArenas arenas(1 << 20);
+	UFrameData frame;
+
+	UAllocationStats stats;
+	size_t before = 0;
+	for (int f = 0; f < WarmUpFrames + Frames; ++f) {
+		if (f == WarmUpFrames) {
+			before = mallocCalls.load();
+		}
+
+		UBuildFrame(jobs, scene, glm::value_ptr(viewProjection), &cameraPosition.x, 0.016f, arenas.Current(), frame);
+		URecordObjectCommands(jobs, frame, 1, 1, 36);
+
+		if (f == WarmUpFrames + Frames - 1) {
+			stats = arenas.Current().Stats();
+		}
+		arenas.Flip();
+	}
+
+	// Counted before printing, the first write to cout allocates its buffer
+	size_t calls = mallocCalls.load() - before;
+	UPrintAllocationStats(cout, "frame arena", stats);
+	cout << ObjectCount << " objects, " << jobs.ThreadCount() << " threads: "
+		<< calls << " malloc calls in " << Frames << " frames after warm-up" << endl;
+
+	return calls == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,239 @@
+/*
+ * @author Jacob William
+ * @desc Frame time cost of recording. Renders a field of instanced cubes
+ *       offscreen at 1080p and 4K and times three runs at each size: no
+ *       capture, a plain glReadPixels into memory every frame, and the
+ *       UFrameCapture ring writing a Y4M file. Overhead is relative to the
+ *       run without capture; the ring aims for under 5%. Needs a display.
+ *
+ *       g++ -O2 -std=c++11 -pthread FrameCaptureBench.cpp -o FrameCaptureBench -lGLEW -lGL -lglut -lSOIL2
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+// Importing glm headers
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../common/DemoMeshes.h"
+#include "../common/FrameCapture.h"
+
+// Use the standard name spaces
+using namespace std;
+
+// Vertex and  Fragment Shader
+#ifndef GLSL
+#define GLSL(Version, Source) "#version " #Version "\n" #Source
+#endif
+
+const int Frames = 120;
+const char* const CapturePath = "capture_bench.y4m";
+
+/*
+ * Cubes on a side * side * side grid placed from the instance id
+ */
+const GLchar* VertexShader = GLSL(330,
+		layout (location = 0) in vec3 position;
+		layout (location = 1) in vec3 color;
+
+		out vec3 mobileColor;
+
+		uniform mat4 viewProjection;
+		uniform int uSide;
+		uniform float uAngle;
+		void main() {
+			vec3 cell = vec3(gl_InstanceID % uSide, (gl_InstanceID / uSide) % uSide, gl_InstanceID / (uSide * uSide));
+			float angle = uAngle + float(gl_InstanceID);
+			vec3 turned = vec3(position.x * cos(angle) + position.z * sin(angle), position.y, position.z * cos(angle) - position.x * sin(angle));
+			gl_Position = viewProjection * vec4(turned + (cell - float(uSide) * 0.5) * 1.5, 1.0f);
+			mobileColor = color;
+		}
+);
+
+const GLchar* FragmentShader = GLSL(330,
+		in vec3 mobileColor;
+
+		out vec4 gpuColor;
+
+		void main() {
+			gpuColor = vec4(mobileColor, 1.0);
+		}
+);
+
+enum UCaptureMode {
+	UCaptureNone,
+	UCaptureBlocking,
+	UCaptureRing
+};
+
+/*
+ * @desc Compiles and links one vertex and fragment shader pair
+ * @returns program name
+ */
+GLuint UCreateProgram(const GLchar* vertexSource, const GLchar* fragmentSource) {
+	GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShaderId, 1, &vertexSource, NULL);
+	glCompileShader(vertexShaderId);
+
+	GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShaderId, 1, &fragmentSource, NULL);
+	glCompileShader(fragmentShaderId);
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShaderId);
+	glAttachShader(program, fragmentShaderId);
+	glLinkProgram(program);
+
+	glDeleteShader(vertexShaderId);
+	glDeleteShader(fragmentShaderId);
+	return program;
+}
+
+/*
+ * @desc Renders Frames frames into an offscreen target of the given size
+ * @returns milliseconds per frame, negative when the capture file cannot be opened
+ */
+double URunFrames(int width, int height, UCaptureMode mode, GLuint program, GLuint vertexArray, int side) {
+	GLuint framebuffer, renderbuffers[2];
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(2, renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+	glViewport(0, 0, width, height);
+	glEnable(GL_DEPTH_TEST);
+
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, side * 0.5f, side * 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (GLfloat)width / (GLfloat)height, 0.1f, 500.0f);
+	glm::mat4 viewProjection = projection * view;
+	glUseProgram(program);
+	glUniformMatrix4fv(glGetUniformLocation(program, "viewProjection"), 1, GL_FALSE, glm::value_ptr(viewProjection));
+	glUniform1i(glGetUniformLocation(program, "uSide"), side);
+	glBindVertexArray(vertexArray);
+
+	UFrameCapture capture;
+	if (mode == UCaptureRing && !capture.Open(CapturePath, width, height, 60)) {
+		cout << "Failed to open " << CapturePath << endl;
+		glBindVertexArray(0);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteRenderbuffers(2, renderbuffers);
+		glDeleteFramebuffers(1, &framebuffer);
+		return -1.0;
+	}
+	vector<unsigned char> pixels(mode == UCaptureBlocking ? (size_t)width * height * 4 : 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	auto start = chrono::steady_clock::now();
+	for (int f = 0; f < Frames + 10; ++f) {
+		// Ten frames of warm up fill the capture ring
+		if (f == 10) {
+			glFinish();
+			start = chrono::steady_clock::now();
+		}
+
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glUniform1f(glGetUniformLocation(program, "uAngle"), f * 0.02f);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, DemoMeshVertexCount, side * side * side);
+
+		if (mode == UCaptureBlocking) {
+			glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		}
+		else if (mode == UCaptureRing) {
+			capture.Capture();
+		}
+		glutSwapBuffers();
+	}
+	glFinish();
+	double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / Frames;
+
+	if (mode == UCaptureRing) {
+		capture.Close();
+		UCaptureStats stats = capture.Stats();
+		cout << "    capture call " << stats.captureMilliseconds / (Frames + 10) << " ms, encoder wait "
+			<< stats.waitMilliseconds / (Frames + 10) << " ms, encode ";
+		if (stats.frames > 0) {
+			cout << stats.encodeMilliseconds / stats.frames << " ms per frame" << endl;
+		}
+		else {
+			cout << "nothing, no frame was written" << endl;
+		}
+		remove(CapturePath);
+	}
+
+	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteRenderbuffers(2, renderbuffers);
+	glDeleteFramebuffers(1, &framebuffer);
+	return milliseconds;
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	int side = argc > 1 ? atoi(argv[1]) : 24;
+
+	glutInit(&argc, argv);
+	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);
+	glutInitWindowSize(64, 64);
+	glutCreateWindow("FrameCaptureBench");
+	glutHideWindow();
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK) {
+		cout << "Failed to initialize GLEW" << endl;
+		return 1;
+	}
+
+	GLuint program = UCreateProgram(VertexShader, FragmentShader);
+	GLuint vertexArray, vertexBuffer;
+	glGenVertexArrays(1, &vertexArray);
+	glGenBuffers(1, &vertexBuffer);
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(ColorCubeVertices), ColorCubeVertices, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glBindVertexArray(0);
+
+	cout << "INFO: OpenGL Renderer: " << glGetString(GL_RENDERER) << endl;
+	cout << side * side * side << " cubes, " << Frames << " frames per run" << endl;
+
+	const int Sizes[][2] = { { 1920, 1080 }, { 3840, 2160 } };
+	for (int s = 0; s < 2; ++s) {
+		int width = Sizes[s][0], height = Sizes[s][1];
+		cout << width << "x" << height << endl;
+
+		double none = URunFrames(width, height, UCaptureNone, program, vertexArray, side);
+		cout << "  no capture: " << none << " ms/frame" << endl;
+
+		double blocking = URunFrames(width, height, UCaptureBlocking, program, vertexArray, side);
+		cout << "  glReadPixels: " << blocking << " ms/frame, overhead " << (blocking / none - 1.0) * 100.0 << "%" << endl;
+
+		double ring = URunFrames(width, height, UCaptureRing, program, vertexArray, side);
+		if (ring < 0.0) {
+			glDeleteVertexArrays(1, &vertexArray);
+			glDeleteBuffers(1, &vertexBuffer);
+			glDeleteProgram(program);
+			return 1;
+		}
+		cout << "  PBO ring + Y4M: " << ring << " ms/frame, overhead " << (ring / none - 1.0) * 100.0 << "%" << endl;
+	}
+
+	glDeleteVertexArrays(1, &vertexArray);
+	glDeleteBuffers(1, &vertexBuffer);
+	glDeleteProgram(program);
+	return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * @author Jacob William
+ * @desc Measures frame CPU time of the FrameScene stages for a 100k object
+ *       scene with 1 thread up to every core
+ *
+ *       g++ -O2 -std=c++11 -pthread JobSystemBench.cpp -o JobSystemBench
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+
+// Importing glm headers
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../common/FrameScene.h"
+
+// Use the standard name spaces
+using namespace std;
+
+const size_t ObjectCount = 100000;
+const int Frames = 100;
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	size_t objects = argc > 1 ? (size_t)atol(argv[1]) : ObjectCount;
+	unsigned cores = thread::hardware_concurrency();
+	if (cores == 0) {
+		cores = 1;
+	}
+
+	// Same camera as the demos, looking into the middle of the field
+	glm::vec3 cameraPosition = glm::vec3(0.0f, 0.0f, 60.0f);
+	glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 200.0f);
+	glm::mat4 viewProjection = projection * view;
+
+	cout << objects << " objects, " << Frames << " frames per run" << endl;
+
+	double singleThreaded = 0.0;
+	for (unsigned threads = 1; threads <= cores; ++threads) {
+		USceneObjects scene;
+		UScatterObjects(scene, objects, 50.0f, 4, 42);
+
+		UJobSystem jobs(threads - 1);
+		UFrameArenas arenas;
+		UFrameData frame;
+
+		// Warm up allocations
+		UBuildFrame(jobs, scene, glm::value_ptr(viewProjection), &cameraPosition.x, 0.016f, arenas.Current(), frame);
+		arenas.Flip();
+
+		auto start = chrono::steady_clock::now();
+		for (int f = 0; f < Frames; ++f) {
+			UBuildFrame(jobs, scene, glm::value_ptr(viewProjection), &cameraPosition.x, 0.016f, arenas.Current(), frame);
+			arenas.Flip();
+		}
+		double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / Frames;
+
+		if (threads == 1) {
+			singleThreaded = milliseconds;
+		}
+		cout << threads << " thread(s): " << milliseconds << " ms/frame, speedup "
+			<< singleThreaded / milliseconds << "x, visible " << frame.visibleCount
+			<< ", batches " << frame.batches.size() << endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,302 @@
+/*
+ * @author Jacob William
+ * @desc Draws 10k quads that each have their own texture and times three
+ *       ways of doing it: a bind and a draw per object, the material table
+ *       as an array texture, and the material table with bindless handles
+ *       when the driver exposes ARB_bindless_texture. Needs a display.
+ *
+ *       g++ -O2 -std=c++11 MaterialTableBench.cpp -o MaterialTableBench -lGLEW -lGL -lglut
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+#include "../common/MaterialTable.h"
+
+// Use the standard name spaces
+using namespace std;
+
+// Vertex and  Fragment Shader
+#ifndef GLSL
+#define GLSL(Version, Source) "#version " #Version "\n" #Source
+#endif
+
+#ifndef GLSL_BODY
+#define GLSL_BODY(Source) #Source
+#endif
+
+const int ObjectCount = 10000;
+const int Frames = 100;
+
+/*
+ * Quads on a grid in clip space, offset and region per instance
+ */
+const GLchar* VertexShader = GLSL(330,
+		layout (location = 0) in vec2 position;
+		layout (location = 1) in vec2 offset;
+		layout (location = 2) in vec4 region;
+		layout (location = 3) in float material;
+
+		out vec2 mobileTextureCoordinate;
+		flat out float mobileMaterial;
+
+		uniform float uScale;
+		void main() {
+			gl_Position = vec4(offset + position * uScale, 0.0f, 1.0f);
+			mobileTextureCoordinate = region.xy + position * region.zw;
+			mobileMaterial = material;
+		}
+);
+
+const GLchar* MaterialFragmentShader = GLSL_BODY(
+
+	in vec2 mobileTextureCoordinate;
+	flat in float mobileMaterial;
+
+	out vec4 gpuTexture;
+
+	void main() {
+		gpuTexture = USampleMaterial(mobileMaterial, mobileTextureCoordinate);
+	}
+);
+
+const GLchar* BindFragmentShader = GLSL(330,
+
+	in vec2 mobileTextureCoordinate;
+	flat in float mobileMaterial;
+
+	out vec4 gpuTexture;
+
+	uniform sampler2D uTexture;
+	void main() {
+		gpuTexture = texture(uTexture, mobileTextureCoordinate);
+	}
+);
+
+/*
+ * @desc Compiles and links one vertex and fragment shader pair
+ * @returns program name
+ */
+GLuint UCreateProgram(const GLchar* vertexSource, const GLchar* fragmentSource) {
+	GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShaderId, 1, &vertexSource, NULL);
+	glCompileShader(vertexShaderId);
+
+	GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShaderId, 1, &fragmentSource, NULL);
+	glCompileShader(fragmentShaderId);
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShaderId);
+	glAttachShader(program, fragmentShaderId);
+	glLinkProgram(program);
+
+	glDeleteShader(vertexShaderId);
+	glDeleteShader(fragmentShaderId);
+	return program;
+}
+
+/*
+ * @desc Small checkerboards, every one a different size and color
+ * @returns the images
+ */
+vector<UImage> UMakeImages(int count) {
+	vector<UImage> images(count);
+	for (int i = 0; i < count; ++i) {
+		UImage& image = images[i];
+		image.width = 16 + (i * 37) % 33;
+		image.height = 16 + (i * 53) % 33;
+		image.pixels.resize(image.width * image.height * 4);
+
+		unsigned char red = (unsigned char)(i * 67), green = (unsigned char)(i * 131), blue = (unsigned char)(i * 199);
+		int cell = 2 + i % 6;
+		for (int y = 0; y < image.height; ++y) {
+			for (int x = 0; x < image.width; ++x) {
+				bool dark = ((x / cell) + (y / cell)) % 2 == 0;
+				unsigned char* pixel = &image.pixels[(y * image.width + x) * 4];
+				pixel[0] = dark ? red / 2 : red;
+				pixel[1] = dark ? green / 2 : green;
+				pixel[2] = dark ? blue / 2 : blue;
+				pixel[3] = 255;
+			}
+		}
+	}
+	return images;
+}
+
+/*
+ * @desc Quad plus one instance per object: grid offset, region and material
+ * @returns vertex array name
+ */
+GLuint UCreateInstances(int count, const vector<UPackedRegion>& regions, GLuint buffers[2]) {
+	GLfloat quad[] = { 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+
+	int side = 1;
+	while (side * side < count) {
+		++side;
+	}
+
+	const int InstanceFloats = 2 + 4 + 1;
+	vector<GLfloat> instances(count * InstanceFloats);
+	for (int i = 0; i < count; ++i) {
+		GLfloat* instance = &instances[i * InstanceFloats];
+		instance[0] = -1.0f + 2.0f * (i % side) / side;
+		instance[1] = -1.0f + 2.0f * (i / side) / side;
+		instance[2] = regions[i].uvOffset[0];
+		instance[3] = regions[i].uvOffset[1];
+		instance[4] = regions[i].uvScale[0];
+		instance[5] = regions[i].uvScale[1];
+		instance[6] = regions[i].layer;
+	}
+
+	GLuint vertexArray;
+	glGenVertexArrays(1, &vertexArray);
+	glGenBuffers(2, buffers);
+	glBindVertexArray(vertexArray);
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid*)0);
+	glEnableVertexAttribArray(0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+	glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(GLfloat), instances.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, InstanceFloats * sizeof(GLfloat), (GLvoid*)0);
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, InstanceFloats * sizeof(GLfloat), (GLvoid*)(2 * sizeof(GLfloat)));
+	glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, InstanceFloats * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
+	for (GLuint attribute = 1; attribute <= 3; ++attribute) {
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribDivisor(attribute, 1);
+	}
+
+	glBindVertexArray(0);
+	return vertexArray;
+}
+
+/*
+ * @desc Average of Frames frames after a short warm up, each ends in glFinish
+ * @returns milliseconds per frame
+ */
+template <typename DrawFn>
+double UTimeFrames(DrawFn draw) {
+	for (int f = 0; f < 10; ++f) {
+		draw();
+	}
+	glFinish();
+
+	auto start = chrono::steady_clock::now();
+	for (int f = 0; f < Frames; ++f) {
+		glClear(GL_COLOR_BUFFER_BIT);
+		draw();
+		glutSwapBuffers();
+	}
+	glFinish();
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / Frames;
+}
+
+/*
+ * @desc Times one material table mode, the table picks array when bindless is missing
+ * @returns void
+ */
+void UBenchTable(const vector<UImage>& images, bool allowBindless, float scale) {
+	UMaterialTable materials;
+	materials.Create(images, allowBindless);
+	if (allowBindless && materials.Mode() != UMaterialBindless) {
+		cout << "bindless handles: not supported by this driver" << endl;
+		materials.Destroy();
+		return;
+	}
+
+	vector<UPackedRegion> regions(images.size());
+	for (size_t i = 0; i < images.size(); ++i) {
+		regions[i] = materials.Region(i);
+	}
+
+	string source = materials.BuildShader(MaterialFragmentShader);
+	GLuint program = UCreateProgram(VertexShader, source.c_str());
+	GLuint buffers[2];
+	GLuint vertexArray = UCreateInstances((int)images.size(), regions, buffers);
+
+	double milliseconds = UTimeFrames([&]() {
+		glUseProgram(program);
+		glUniform1f(glGetUniformLocation(program, "uScale"), scale);
+		materials.Bind(program);
+		glBindVertexArray(vertexArray);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)images.size());
+	});
+	cout << materials.ModeName() << ": " << milliseconds << " ms/frame, 1 draw, 1 bind" << endl;
+
+	glDeleteVertexArrays(1, &vertexArray);
+	glDeleteBuffers(2, buffers);
+	glDeleteProgram(program);
+	materials.Destroy();
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	int objects = argc > 1 ? atoi(argv[1]) : ObjectCount;
+
+	glutInit(&argc, argv);
+	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);
+	glutInitWindowSize(800, 800);
+	glutCreateWindow("MaterialTableBench");
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK) {
+		cout << "Failed to initialize GLEW" << endl;
+		return 1;
+	}
+
+	vector<UImage> images = UMakeImages(objects);
+	int side = 1;
+	while (side * side < objects) {
+		++side;
+	}
+	float scale = 2.0f / side;
+	cout << objects << " objects, one texture each, " << Frames << " frames per mode" << endl;
+
+	// Per object binds
+	{
+		vector<GLuint> textures(objects);
+		glGenTextures(objects, textures.data());
+		vector<UPackedRegion> regions(objects);
+		for (int i = 0; i < objects; ++i) {
+			glBindTexture(GL_TEXTURE_2D, textures[i]);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, images[i].width, images[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, images[i].pixels.data());
+			glGenerateMipmap(GL_TEXTURE_2D);
+
+			UPackedRegion whole = { { 0.0f, 0.0f }, { 1.0f, 1.0f }, 0.0f };
+			regions[i] = whole;
+		}
+
+		GLuint program = UCreateProgram(VertexShader, BindFragmentShader);
+		GLuint buffers[2];
+		GLuint vertexArray = UCreateInstances(objects, regions, buffers);
+
+		double milliseconds = UTimeFrames([&]() {
+			glUseProgram(program);
+			glUniform1f(glGetUniformLocation(program, "uScale"), scale);
+			glBindVertexArray(vertexArray);
+			for (int i = 0; i < objects; ++i) {
+				glBindTexture(GL_TEXTURE_2D, textures[i]);
+				glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 6, 1, i);
+			}
+		});
+		cout << "per object binds: " << milliseconds << " ms/frame, " << objects << " draws, " << objects << " binds" << endl;
+
+		glDeleteVertexArrays(1, &vertexArray);
+		glDeleteBuffers(2, buffers);
+		glDeleteProgram(program);
+		glDeleteTextures(objects, textures.data());
+	}
+
+	UBenchTable(images, false, scale);
+	UBenchTable(images, true, scale);
+
+	return 0;
+}
@@ -0,0 +1,268 @@
+/*
+ * @author Jacob William
+ * @desc GPU time per frame of the FlatChair chair tessellated to 240k, 960k
+ *       and 2.16M triangles (or up to the level given), drawn three ways into
+ *       an offscreen 1280x720 target behind a hidden window: indexed with
+ *       float vertices and 32 bit indices, every meshlet, and the meshlets
+ *       left after frustum and cone culling. Back faces are culled by GL in
+ *       all three. Two camera paths run Frames frames each, an orbit with the
+ *       whole chair in view and a close-up orbit where most of it is off
+ *       screen. Exits with 1 if culling ever drops everything.
+ *
+ *       g++ -O2 -std=c++11 MeshletBench.cpp -o MeshletBench -lGLEW -lGL -lglut
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+// Importing glm headers
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../common/DemoMeshes.h"
+#include "../common/Meshlets.h"
+
+// Use the standard name spaces
+using namespace std;
+
+#ifndef GLSL
+#define GLSL(Version, Source) "#version " #Version "\n" #Source
+#endif
+
+const int Width = 1280, Height = 720;
+const int Frames = 240;
+const float ModelScale = 2.0f;
+
+const GLchar* VertexShader = GLSL(330,
+		layout (location = 0) in vec3 position;
+		layout (location = 1) in vec3 color;
+		layout (location = 2) in vec3 normal;
+		out vec3 shade;
+		uniform mat4 model;
+		uniform mat4 viewProjection;
+		void main() {
+			gl_Position = viewProjection * model * vec4(position, 1.0);
+			shade = color * (0.3 + 0.7 * abs(normalize(normal).y));
+		}
+);
+
+const GLchar* FragmentShader = GLSL(330,
+	in vec3 shade;
+	out vec4 gpuColor;
+	void main() {
+		gpuColor = vec4(shade, 1.0);
+	}
+);
+
+enum UDrawMode { IndexedDraw, AllMeshlets, CulledMeshlets };
+
+// The same mesh as float vertices and 32 bit indices
+struct UIndexedMesh {
+	GLuint vertexArray, vertexBuffer, indexBuffer;
+	GLsizei indexCount;
+	size_t bytes;
+};
+
+/*
+ * @desc Uploads the welded mesh in the layout FlatChair uses
+ * @returns the mesh
+ */
+UIndexedMesh UCreateIndexed(const vector<GLfloat>& vertices, const vector<uint32_t>& indices) {
+	UIndexedMesh mesh;
+	glGenVertexArrays(1, &mesh.vertexArray);
+	glGenBuffers(1, &mesh.vertexBuffer);
+	glGenBuffers(1, &mesh.indexBuffer);
+	glBindVertexArray(mesh.vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(2);
+	glBindVertexArray(0);
+	mesh.indexCount = (GLsizei)indices.size();
+	mesh.bytes = vertices.size() * sizeof(GLfloat) + indices.size() * sizeof(uint32_t);
+	return mesh;
+}
+
+/*
+ * @desc Runs one camera path in one mode
+ * @returns false if a culled frame drew nothing
+ */
+bool URunPath(const char* name, bool closeUp, UDrawMode mode, GLuint program, const UIndexedMesh& indexed, UMeshletMesh& meshlets) {
+	static const char* modes[] = { "indexed", "all meshlets", "culled meshlets" };
+	glm::mat4 model = glm::scale(glm::mat4(), glm::vec3(ModelScale, ModelScale, ModelScale));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)Width / Height, 0.1f, 100.0f);
+	GLint viewProjectionLocation = glGetUniformLocation(program, "viewProjection");
+	glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(model));
+
+	GLuint query;
+	glGenQueries(1, &query);
+	double gpuMilliseconds = 0.0, cullMilliseconds = 0.0;
+	size_t triangles = 0;
+	bool drewSomething = true;
+	for (int frame = 0; frame < Frames; ++frame) {
+		float angle = frame * 6.2831853f / Frames;
+		float distance = closeUp ? 1.6f : 6.0f;
+		glm::vec3 eye(distance * cos(angle), closeUp ? 0.8f : 2.5f, distance * sin(angle));
+		glm::vec3 target = closeUp ? glm::vec3(0.5f, 0.4f, 0.5f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::mat4 view = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 viewProjection = projection * view;
+		glUniformMatrix4fv(viewProjectionLocation, 1, GL_FALSE, glm::value_ptr(viewProjection));
+
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		if (mode == CulledMeshlets) {
+			glm::vec3 camera = eye / ModelScale;
+			meshlets.Cull(glm::value_ptr(viewProjection * model), glm::value_ptr(camera));
+			cullMilliseconds += meshlets.Stats().cullMilliseconds;
+			triangles += meshlets.Stats().trianglesDrawn;
+			drewSomething = drewSomething && meshlets.Stats().visible > 0;
+		}
+
+		glBeginQuery(GL_TIME_ELAPSED, query);
+		if (mode == IndexedDraw) {
+			glBindVertexArray(indexed.vertexArray);
+			glDrawElements(GL_TRIANGLES, indexed.indexCount, GL_UNSIGNED_INT, (GLvoid*)0);
+			glBindVertexArray(0);
+			triangles += indexed.indexCount / 3;
+		}
+		else if (mode == AllMeshlets) {
+			meshlets.DrawAll();
+			triangles += meshlets.TriangleCount();
+		}
+		else {
+			meshlets.Draw();
+		}
+		glEndQuery(GL_TIME_ELAPSED);
+
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+		gpuMilliseconds += nanoseconds / 1e6;
+	}
+	glDeleteQueries(1, &query);
+
+	cout << "  " << name << ", " << modes[mode] << ": " << gpuMilliseconds / Frames << " ms GPU, "
+		<< (double)triangles / Frames / 1e6 << " M triangles submitted";
+	if (mode == CulledMeshlets) {
+		cout << ", " << cullMilliseconds / Frames << " ms CPU culling";
+	}
+	cout << endl;
+	return drewSomething;
+}
+
+/*
+ * @desc Builds one tessellation level and runs every path and mode on it
+ * @returns false if culling ever drew nothing
+ */
+bool URunLevel(int level, GLuint program) {
+	vector<GLfloat> vertices = UAddFlatNormals(ChairVertices, DemoMeshVertexCount, 6);
+	vertices = UTessellate(vertices.data(), vertices.size() / 9, 9, level);
+	UAddBackFaces(vertices);
+
+	vector<GLfloat> unique;
+	vector<uint32_t> indices;
+	UWeldVertices(vertices, 9, unique, indices);
+	vector<GLfloat>().swap(vertices);
+	UMeshletData data;
+	UBuildMeshlets(unique, indices, data);
+
+	UIndexedMesh indexed = UCreateIndexed(unique, indices);
+	UMeshletMesh meshlets;
+	meshlets.Create(data);
+	cout << indices.size() / 3 << " triangles in " << data.meshlets.size() << " meshlets, " << indexed.bytes / 1024
+		<< " KiB indexed, " << meshlets.Stats().gpuBytes / 1024 << " KiB as meshlets" << endl;
+
+	bool passed = true;
+	for (int path = 0; path < 2; ++path) {
+		for (int mode = IndexedDraw; mode <= CulledMeshlets; ++mode) {
+			passed = URunPath(path == 0 ? "orbit" : "close-up", path == 1, (UDrawMode)mode, program, indexed, meshlets) && passed;
+		}
+	}
+
+	meshlets.Destroy();
+	glDeleteVertexArrays(1, &indexed.vertexArray);
+	glDeleteBuffers(1, &indexed.vertexBuffer);
+	glDeleteBuffers(1, &indexed.indexBuffer);
+	return passed;
+}
+
+/*
+ * @desc Compiles the program shared by every mode
+ * @returns the program
+ */
+GLuint UCreateProgram(void) {
+	GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShaderId, 1, &VertexShader, NULL);
+	glCompileShader(vertexShaderId);
+
+	GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShaderId, 1, &FragmentShader, NULL);
+	glCompileShader(fragmentShaderId);
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShaderId);
+	glAttachShader(program, fragmentShaderId);
+	glLinkProgram(program);
+	glDeleteShader(vertexShaderId);
+	glDeleteShader(fragmentShaderId);
+	return program;
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	int largest = argc > 1 ? atoi(argv[1]) : 300;
+
+	glutInit(&argc, argv);
+	glutInitDisplayMode(GLUT_RGBA);
+	glutInitWindowSize(64, 64);
+	glutCreateWindow("MeshletBench");
+	glutHideWindow();
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK) {
+		cout << "Failed to initialize GLEW" << endl;
+		return 1;
+	}
+	cout << "INFO: OpenGL Renderer: " << glGetString(GL_RENDERER) << ", "
+		<< (UMeshletMesh::IndirectSupported() ? "multi-draw indirect" : "base vertex multi-draw") << endl;
+
+	// Offscreen target, independent of whatever the window system gives us
+	GLuint framebuffer, renderbuffers[2];
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(2, renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, Width, Height);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, Width, Height);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+	glViewport(0, 0, Width, Height);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_CULL_FACE);
+
+	GLuint program = UCreateProgram();
+	glUseProgram(program);
+
+	bool passed = true;
+	for (int level = 100; level <= largest; level += 100) {
+		passed = URunLevel(level, program) && passed;
+	}
+
+	glDeleteProgram(program);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteRenderbuffers(2, renderbuffers);
+	glDeleteFramebuffers(1, &framebuffer);
+	if (!passed) {
+		cout << "FAILED: culling dropped every meshlet" << endl;
+		return 1;
+	}
+	return 0;
+}
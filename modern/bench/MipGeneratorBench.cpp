@@ -0,0 +1,122 @@
+/*
+ * @author Jacob William
+ * @desc Times the CPU mip generator on 4K and 8K RGBA images with 1 thread
+ *       and every core. With -gl it also opens a GLUT window and times
+ *       glTexImage2D + glGenerateMipmap against uploading the CPU levels
+ *
+ *       g++ -O2 -std=c++11 -pthread MipGeneratorBench.cpp -o MipGeneratorBench -lGLEW -lGL -lglut
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+#include "../common/MipGenerator.h"
+
+// Use the standard name spaces
+using namespace std;
+
+const int Runs = 3;
+
+/*
+ * @desc Fills an image with a noisy gradient so no level is flat
+ * @returns the image
+ */
+UImage UMakeTestImage(int size) {
+	UImage image;
+	image.width = size;
+	image.height = size;
+	image.pixels.resize((size_t)size * size * 4);
+	unsigned seed = 1;
+	for (size_t i = 0; i < image.pixels.size(); i += 4) {
+		seed = seed * 1664525u + 1013904223u;
+		size_t pixel = i / 4;
+		image.pixels[i + 0] = (unsigned char)((pixel % size) * 255 / size);
+		image.pixels[i + 1] = (unsigned char)((pixel / size) * 255 / size);
+		image.pixels[i + 2] = (unsigned char)(seed >> 24);
+		image.pixels[i + 3] = 255;
+	}
+	return image;
+}
+
+/*
+ * @desc Best of Runs mip chain builds
+ * @returns milliseconds
+ */
+double UTimeCpu(UJobSystem& jobs, const UImage& image, vector<UImage>& levels) {
+	double best = 1e30;
+	for (int r = 0; r < Runs; ++r) {
+		auto start = chrono::steady_clock::now();
+		levels = UGenerateMipChain(jobs, image);
+		best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+/*
+ * @desc Best of Runs texture creations, either level 0 plus glGenerateMipmap
+ *       or every level from the CPU
+ * @returns milliseconds
+ */
+double UTimeGpu(const vector<UImage>& levels, bool generate) {
+	double best = 1e30;
+	for (int r = 0; r < Runs; ++r) {
+		GLuint texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glFinish();
+
+		auto start = chrono::steady_clock::now();
+		size_t count = generate ? 1 : levels.size();
+		for (size_t l = 0; l < count; ++l) {
+			glTexImage2D(GL_TEXTURE_2D, (GLint)l, GL_RGBA8, levels[l].width, levels[l].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[l].pixels.data());
+		}
+		if (generate) {
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+		glFinish();
+		best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+
+		glDeleteTextures(1, &texture);
+	}
+	return best;
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	bool gl = argc > 1 && strcmp(argv[1], "-gl") == 0;
+	if (gl) {
+		glutInit(&argc, argv);
+		glutInitDisplayMode(GLUT_RGBA);
+		glutCreateWindow("MipGeneratorBench");
+		glewExperimental = GL_TRUE;
+		if (glewInit() != GLEW_OK) {
+			cout << "Failed to initialize GLEW" << endl;
+			return 1;
+		}
+	}
+
+	UJobSystem single(0);
+	UJobSystem all;
+
+	const int sizes[] = { 4096, 8192 };
+	for (int s = 0; s < 2; ++s) {
+		UImage image = UMakeTestImage(sizes[s]);
+		vector<UImage> levels;
+
+		double one = UTimeCpu(single, image, levels);
+		double many = UTimeCpu(all, image, levels);
+		cout << sizes[s] << "x" << sizes[s] << ", " << levels.size() << " levels: 1 thread " << one
+			<< " ms, " << all.ThreadCount() << " threads " << many << " ms, speedup " << one / many << "x" << endl;
+
+		if (gl) {
+			cout << "  glGenerateMipmap upload " << UTimeGpu(levels, true) << " ms, CPU levels upload "
+				<< UTimeGpu(levels, false) << " ms (+ " << many << " ms generation)" << endl;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * @author Jacob William
+ * @desc Particles simulated and drawn per second by the GPU particle system
+ *       for 64k to 1M particles (or up to the count given), rendered into an
+ *       offscreen 1280x720 target behind a hidden window so it runs headless,
+ *       for example under llvmpipe with Xvfb and LIBGL_ALWAYS_SOFTWARE=1.
+ *       Each size fills the buffer first, then times Frames frames waited for
+ *       with glFinish. Exits with 1 if the live count is ever empty or past
+ *       the capacity. Needs GL 4.3.
+ *
+ *       g++ -O2 -std=c++11 ParticleSystemBench.cpp -o ParticleSystemBench -lGLEW -lGL -lglut
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+// Importing glm headers
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../common/ParticleSystem.h"
+
+// Use the standard name spaces
+using namespace std;
+
+const int Width = 1280, Height = 720;
+const int Frames = 120;
+const float Step = 1.0f / 60.0f;
+
+/*
+ * @desc Fills one buffer of capacity particles and times it
+ * @returns false if the live count came out wrong
+ */
+bool URunSize(GLuint capacity, const glm::mat4& view, const glm::mat4& projection) {
+	UParticleSettings settings;
+	settings.capacity = capacity;
+	settings.lifetime = 2.0f;
+	settings.emitRate = capacity / (0.75f * settings.lifetime);
+	settings.origin[0] = settings.origin[1] = settings.origin[2] = 0.0f;
+	settings.speed = 12.0f;
+	settings.spread = 0.5f;
+	settings.gravity = 9.8f;
+	settings.size = 0.05f;
+
+	UParticleSystem particles;
+	if (!particles.Create(settings)) {
+		cout << "particle programs did not link" << endl;
+		return false;
+	}
+
+	// A full lifetime of frames reaches the steady state
+	int warmup = (int)(settings.lifetime / Step) + 1;
+	for (int f = 0; f < warmup; ++f) {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		particles.Simulate(Step);
+		particles.Draw(glm::value_ptr(view), glm::value_ptr(projection));
+	}
+	GLuint live = particles.LiveCount();
+	particles.ResetStats();
+
+	auto start = chrono::steady_clock::now();
+	for (int f = 0; f < Frames; ++f) {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		particles.Simulate(Step);
+		particles.Draw(glm::value_ptr(view), glm::value_ptr(projection));
+		glFinish();
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	GLuint liveAfter = particles.LiveCount();
+
+	UParticleStats stats = particles.Stats();
+	double perSecond = (live + liveAfter) / 2.0 * Frames / seconds;
+	cout << capacity << " capacity, " << liveAfter << " live: " << seconds * 1000.0 / Frames << " ms/frame, "
+		<< perSecond / 1e6 << " M particles/s simulated and drawn";
+	if (stats.timedFrames > 0) {
+		cout << " (simulate " << stats.simulateMilliseconds / stats.timedFrames << " ms, draw "
+			<< stats.drawMilliseconds / stats.timedFrames << " ms GPU)";
+	}
+	cout << endl;
+
+	particles.Destroy();
+	return live > 0 && live <= capacity && liveAfter > 0 && liveAfter <= capacity;
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	GLuint largest = argc > 1 ? (GLuint)atol(argv[1]) : 1u << 20;
+
+	glutInit(&argc, argv);
+	glutInitDisplayMode(GLUT_RGBA);
+	glutInitWindowSize(64, 64);
+	glutCreateWindow("ParticleSystemBench");
+	glutHideWindow();
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK) {
+		cout << "Failed to initialize GLEW" << endl;
+		return 1;
+	}
+	cout << "INFO: OpenGL Renderer: " << glGetString(GL_RENDERER) << endl;
+	if (!UParticleSystem::Supported()) {
+		cout << "GL 4.3 compute shaders and storage buffers in vertex shaders are not available" << endl;
+		return 1;
+	}
+
+	// Offscreen target, independent of whatever the window system gives us
+	GLuint framebuffer, renderbuffers[2];
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(2, renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, Width, Height);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, Width, Height);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+	glViewport(0, 0, Width, Height);
+	glEnable(GL_DEPTH_TEST);
+
+	// The fountain fills most of the view
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 4.0f, 14.0f), glm::vec3(0.0f, 3.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)Width / Height, 0.1f, 100.0f);
+
+	bool passed = true;
+	for (GLuint capacity = 1u << 16; capacity <= largest; capacity *= 4) {
+		passed = URunSize(capacity, view, projection) && passed;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteRenderbuffers(2, renderbuffers);
+	glDeleteFramebuffers(1, &framebuffer);
+	if (!passed) {
+		cout << "FAILED: live particle count out of range" << endl;
+		return 1;
+	}
+	return 0;
+}
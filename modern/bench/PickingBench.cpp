@@ -0,0 +1,124 @@
+/*
+ * @author Jacob William
+ * @desc Ray picking throughput against a BVH over a procedural scene of
+ *       about 10M triangles: a terrain, a field of scattered spheres and a
+ *       tessellated chair in the middle, or as many triangles as given on the
+ *       command line. Prints the build, then picks per second through random
+ *       pixels of an orbiting camera on one thread and on all of them. A few
+ *       picks are checked against testing every triangle; exits with 1 if
+ *       one disagrees. Needs no GL context.
+ *
+ *       g++ -O2 -std=c++11 -pthread PickingBench.cpp -o PickingBench
+ *       ./PickingBench [triangles]
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "../common/Bvh.h"
+#include "../common/Camera.h"
+#include "../common/ProceduralMeshes.h"
+
+// Use the standard name spaces
+using namespace std;
+
+const int Width = 1280, Height = 720;
+const size_t Picks = 1000000;
+const int CameraPositions = 16;
+const int CheckedPicks = 16;
+
+/*
+ * @desc Camera and pixel of pick number i, hashed so every run and every
+ *       thread count casts the same rays
+ * @returns void, origin and direction of the ray
+ */
+void UPickRay(const vector<UCamera>& cameras, size_t i, float origin[3], float direction[3]) {
+	const UCamera& camera = cameras[i % CameraPositions];
+	int x = (int)(UHashUnit(3, (uint32_t)i, 0) * Width), y = (int)(UHashUnit(3, (uint32_t)i, 1) * Height);
+	camera.Ray(x, y, Width, Height, origin, direction);
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	size_t triangles = argc > 1 ? (size_t)atof(argv[1]) : 10000000;
+	UJobSystem jobs;
+	cout << jobs.ThreadCount() << " threads" << endl;
+
+	// A fifth terrain, a fifth chair and the rest spheres of 108 triangles
+	UProceduralMesh terrain, chair, pebble, field;
+	UGenerateTerrain(jobs, triangles / 5, 64.0f, 7, terrain);
+	UGenerateChair(jobs, triangles / 5, chair);
+	UGenerateSphere(jobs, 96, pebble);
+	UGenerateInstanceField(jobs, pebble, triangles * 3 / 5 / pebble.TriangleCount(), 60.0f, 7, field);
+
+	// Chair scaled up and standing on the middle of the terrain
+	const float chairTransform[16] = { 10, 0, 0, 0, 0, 10, 0, 0, 0, 0, 10, 0, 0, 8, 0, 1 };
+	UBvh bvh;
+	bvh.AddMesh(terrain.vertices.get(), ProceduralStride, terrain.vertexCount, terrain.indices.get(), terrain.indexCount);
+	bvh.AddMesh(chair.vertices.get(), ProceduralStride, chair.vertexCount, chair.indices.get(), chair.indexCount, chairTransform);
+	bvh.AddMesh(field.vertices.get(), ProceduralStride, field.vertexCount, field.indices.get(), field.indexCount);
+	bvh.Build(jobs);
+	bvh.PrintStats(cout);
+
+	vector<UCamera> cameras(CameraPositions);
+	for (int c = 0; c < CameraPositions; ++c) {
+		cameras[c].SetZoomRange(1.0f, 1000.0f);
+		cameras[c].SetDistance(c % 2 == 0 ? 150.0f : 40.0f);
+		cameras[c].SetAngles(c * 6.2831853f / CameraPositions, 0.45f);
+		cameras[c].SetPerspective(0.785398f, (float)Width / Height, 0.1f, 1000.0f);
+	}
+
+	// One thread, then all of them
+	size_t hits = 0;
+	auto start = chrono::steady_clock::now();
+	for (size_t i = 0; i < Picks; ++i) {
+		float origin[3], direction[3];
+		UBvhHit hit;
+		UPickRay(cameras, i, origin, direction);
+		hits += bvh.Intersect(origin, direction, hit);
+	}
+	double single = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	vector<size_t> chunkHits((Picks + 4095) / 4096);
+	start = chrono::steady_clock::now();
+	jobs.ParallelFor(Picks, 4096, [&](size_t begin, size_t end) {
+		size_t local = 0;
+		for (size_t i = begin; i < end; ++i) {
+			float origin[3], direction[3];
+			UBvhHit hit;
+			UPickRay(cameras, i, origin, direction);
+			local += bvh.Intersect(origin, direction, hit);
+		}
+		chunkHits[begin / 4096] = local;
+	});
+	double parallel = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	size_t parallelHits = 0;
+	for (size_t h : chunkHits) {
+		parallelHits += h;
+	}
+
+	cout << Picks << " picks, " << 100.0 * hits / Picks << "% hit: " << Picks / single / 1e6 << " M picks/s on one thread ("
+		<< single * 1e9 / Picks << " ns each), " << Picks / parallel / 1e6 << " M picks/s on " << jobs.ThreadCount() << endl;
+
+	// The hierarchy must find what testing every triangle finds
+	bool passed = hits == parallelHits;
+	for (int i = 0; i < CheckedPicks; ++i) {
+		float origin[3], direction[3];
+		UBvhHit hit, expected;
+		UPickRay(cameras, (size_t)i * 7919, origin, direction);
+		bool found = bvh.Intersect(origin, direction, hit), wanted = bvh.IntersectAll(origin, direction, expected);
+		if (found != wanted || (found && fabs(hit.distance - expected.distance) > 1e-4f * expected.distance)) {
+			cout << "pick " << i << " disagrees: " << (found ? hit.distance : -1.0f) << " against " << (wanted ? expected.distance : -1.0f) << endl;
+			passed = false;
+		}
+	}
+	if (!passed) {
+		cout << "FAILED: picks disagree with the brute force test" << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * @author Jacob William
+ * @desc Generation throughput of the procedural meshes. Every generator
+ *       builds 1M and 10M triangles, or up to the count given on the command
+ *       line in steps of ten, on all cores. Prints millions of triangles and
+ *       GiB written per second. The smallest size is also built on the
+ *       calling thread alone, which gives the speedup and checks that the
+ *       output does not depend on the thread count. Exits with 1 if it does.
+ *       Needs no GL context.
+ *
+ *       g++ -O2 -std=c++11 -pthread ProceduralMeshesBench.cpp -o ProceduralMeshesBench
+ *       ./ProceduralMeshesBench [maxTriangles]
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+
+#include "../common/ProceduralMeshes.h"
+
+// Use the standard name spaces
+using namespace std;
+
+typedef function<void(UJobSystem&, size_t, UProceduralMesh&)> UGenerator;
+
+/*
+ * @desc FNV-1a over the vertex and index bytes
+ * @returns the hash
+ */
+uint64_t UHashMesh(const UProceduralMesh& mesh) {
+	uint64_t hash = 14695981039346656037ull;
+	const unsigned char* bytes = (const unsigned char*)mesh.vertices.get();
+	for (size_t i = 0; i < mesh.vertexCount * ProceduralStride * sizeof(GLfloat); ++i) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	bytes = (const unsigned char*)mesh.indices.get();
+	for (size_t i = 0; i < mesh.indexCount * sizeof(uint32_t); ++i) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+/*
+ * @desc Builds one mesh and times it, the mesh is freed before returning
+ * @returns seconds taken, built and bytes set to the output's size and hash
+ *          to its hash when not NULL
+ */
+double UTimeGenerator(const UGenerator& generator, UJobSystem& jobs, size_t triangles, size_t& built, size_t& bytes, uint64_t* hash) {
+	UProceduralMesh mesh;
+	auto start = chrono::steady_clock::now();
+	generator(jobs, triangles, mesh);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	built = mesh.TriangleCount();
+	bytes = mesh.Bytes();
+	if (hash != NULL) {
+		*hash = UHashMesh(mesh);
+	}
+	return seconds;
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	size_t maxTriangles = argc > 1 ? (size_t)atof(argv[1]) : 10000000;
+	UJobSystem jobs;
+	UJobSystem single(0);
+	cout << jobs.ThreadCount() << " threads" << endl;
+
+	// Fields scatter spheres of 108 triangles
+	UProceduralMesh pebble;
+	UGenerateSphere(jobs, 96, pebble);
+
+	const char* names[] = { "cube", "sphere", "chair", "terrain", "field" };
+	UGenerator generators[] = {
+		[](UJobSystem& jobs, size_t triangles, UProceduralMesh& mesh) { UGenerateCube(jobs, triangles, mesh); },
+		[](UJobSystem& jobs, size_t triangles, UProceduralMesh& mesh) { UGenerateSphere(jobs, triangles, mesh); },
+		[](UJobSystem& jobs, size_t triangles, UProceduralMesh& mesh) { UGenerateChair(jobs, triangles, mesh); },
+		[](UJobSystem& jobs, size_t triangles, UProceduralMesh& mesh) { UGenerateTerrain(jobs, triangles, 64.0f, 7, mesh); },
+		[&pebble](UJobSystem& jobs, size_t triangles, UProceduralMesh& mesh) {
+			UGenerateInstanceField(jobs, pebble, max<size_t>(1, triangles / pebble.TriangleCount()), 100.0f, 7, mesh);
+		}
+	};
+
+	bool passed = true;
+	for (int g = 0; g < 5; ++g) {
+		for (size_t triangles = 1000000; triangles <= maxTriangles; triangles *= 10) {
+			size_t built, bytes;
+			uint64_t hash;
+			bool first = triangles == 1000000;
+			double seconds = UTimeGenerator(generators[g], jobs, triangles, built, bytes, first ? &hash : NULL);
+			cout << names[g] << " " << built << " triangles: " << seconds * 1000.0 << " ms, "
+				<< built / seconds / 1e6 << " Mtri/s, " << bytes / seconds / (1 << 30) << " GiB/s";
+
+			if (first) {
+				size_t singleBuilt, singleBytes;
+				uint64_t singleHash;
+				double singleSeconds = UTimeGenerator(generators[g], single, triangles, singleBuilt, singleBytes, &singleHash);
+				cout << ", " << singleSeconds / seconds << "x over one thread";
+				if (singleHash != hash || singleBuilt != built) {
+					cout << " MISMATCH";
+					passed = false;
+				}
+			}
+			cout << endl;
+		}
+	}
+	if (!passed) {
+		cout << "FAILED: output depends on the thread count" << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * @author Jacob William
+ * @desc Stress test for the residency manager: 128 textures and 128 meshes,
+ *       over four times the 24 MiB budget, with 16 of each used per frame.
+ *       Three access patterns run 600 frames each behind a hidden window: a
+ *       window sliding over the assets, a sweep that uses the next 16 every
+ *       frame (the worst case for LRU) and a random pick. Prints streams,
+ *       evictions and streaming time per frame and the peak residency, then
+ *       the memory report. Exits with 1 if a frame ends over the budget or a
+ *       resource fails to stream.
+ *
+ *       g++ -O2 -std=c++11 ResidencyBench.cpp -o ResidencyBench -lGLEW -lGL -lglut
+ */
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <vector>
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+#include "../common/Residency.h"
+
+// Use the standard name spaces
+using namespace std;
+
+const int AssetCount = 128;
+const int UsedPerFrame = 16;
+const int Frames = 600;
+const size_t Budget = (size_t)24 << 20;
+const int TextureSize = 256;
+
+enum UAccessPattern { SlidingAccess, SweepAccess, RandomAccess };
+
+// Source data the streamers upload from, kept in memory so only the upload is timed
+vector<vector<unsigned char> > texturePixels;
+vector<vector<GLfloat> > meshVertices;
+
+/*
+ * @desc Uploads texture index with a full mip chain
+ * @returns true
+ */
+bool UStreamTexture(int index, UTexture& texture) {
+	glGenTextures(1, &texture.texture);
+	glBindTexture(GL_TEXTURE_2D, texture.texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, TextureSize, TextureSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, texturePixels[index].data());
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	texture.width = texture.height = TextureSize;
+	texture.layers = 1;
+	return true;
+}
+
+/*
+ * @desc Uploads mesh index as position and normal pairs
+ * @returns true
+ */
+bool UStreamMesh(int index, UMesh& mesh) {
+	const vector<GLfloat>& vertices = meshVertices[index];
+	glGenVertexArrays(1, &mesh.vertexArray);
+	glGenBuffers(1, &mesh.vertexBuffer);
+	glBindVertexArray(mesh.vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(1);
+	glBindVertexArray(0);
+	mesh.vertexCount = (GLsizei)(vertices.size() / 6);
+	return true;
+}
+
+/*
+ * @desc Fills the sources, textures are noise and meshes are 8k to 32k
+ *       vertices so the sizes differ
+ * @returns void
+ */
+void UCreateSources(void) {
+	mt19937 random(7);
+	texturePixels.resize(AssetCount);
+	meshVertices.resize(AssetCount);
+	for (int a = 0; a < AssetCount; ++a) {
+		texturePixels[a].resize((size_t)TextureSize * TextureSize * 4);
+		for (size_t i = 0; i < texturePixels[a].size(); ++i) {
+			texturePixels[a][i] = (unsigned char)random();
+		}
+		meshVertices[a].resize((size_t)8192 * (1 + a % 4) * 6);
+		for (size_t i = 0; i < meshVertices[a].size(); ++i) {
+			meshVertices[a][i] = (GLfloat)(random() % 1000) * 0.001f;
+		}
+	}
+}
+
+/*
+ * @desc First asset of a frame's working set, the set is UsedPerFrame
+ *       consecutive assets
+ * @returns the index
+ */
+int UFirstUsed(UAccessPattern pattern, int frame, mt19937& random) {
+	switch (pattern) {
+	case SlidingAccess:
+		return frame / 10 % AssetCount;
+	case SweepAccess:
+		return frame * UsedPerFrame % AssetCount;
+	default:
+		return (int)(random() % AssetCount);
+	}
+}
+
+/*
+ * @desc Runs one access pattern on a fresh manager
+ * @returns false if a frame ended over budget or a stream failed
+ */
+bool URunPattern(const char* name, UAccessPattern pattern, bool printReport) {
+	UResidencyManager residency;
+	residency.SetBudget(Budget);
+	vector<int> textures(AssetCount), meshes(AssetCount);
+	for (int a = 0; a < AssetCount; ++a) {
+		ostringstream textureName, meshName;
+		textureName << "noise" << a;
+		meshName << "grid" << a;
+		textures[a] = residency.AddTexture(textureName.str(), [a](UTexture& texture) { return UStreamTexture(a, texture); });
+		meshes[a] = residency.AddMesh(meshName.str(), [a](UMesh& mesh) { return UStreamMesh(a, mesh); });
+	}
+
+	mt19937 random(11);
+	bool passed = true;
+	auto start = chrono::steady_clock::now();
+	for (int frame = 0; frame < Frames; ++frame) {
+		residency.BeginFrame();
+		int first = UFirstUsed(pattern, frame, random);
+		for (int u = 0; u < UsedPerFrame; ++u) {
+			int a = (first + u) % AssetCount;
+			if (residency.Texture(textures[a]) == NULL || residency.Mesh(meshes[a]) == NULL) {
+				passed = false;
+			}
+		}
+		glFinish();
+		if (residency.Stats().residentBytes > Budget) {
+			passed = false;
+		}
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	UResidencyStats stats = residency.Stats();
+	double uses = (double)Frames * UsedPerFrame * 2;
+	cout << name << ": " << (double)stats.streams / Frames << " streams, " << (double)stats.evictions / Frames
+		<< " evictions, " << stats.streamMilliseconds / Frames << " ms streaming, " << seconds * 1000.0 / Frames
+		<< " ms per frame, " << 100.0 * stats.hits / uses << "% hits, peak " << stats.peakBytes / 1024 << " KiB" << endl;
+	if (printReport) {
+		residency.Report(cout);
+	}
+	residency.Destroy();
+	return passed && stats.failures == 0 && stats.overBudgetFrames == 0;
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	glutInit(&argc, argv);
+	glutInitDisplayMode(GLUT_RGBA);
+	glutInitWindowSize(64, 64);
+	glutCreateWindow("ResidencyBench");
+	glutHideWindow();
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK) {
+		cout << "Failed to initialize GLEW" << endl;
+		return 1;
+	}
+	cout << "INFO: OpenGL Renderer: " << glGetString(GL_RENDERER) << endl;
+
+	UCreateSources();
+	cout << AssetCount << " textures and " << AssetCount << " meshes, " << UsedPerFrame << " of each per frame, "
+		<< (Budget >> 20) << " MiB budget" << endl;
+
+	bool passed = URunPattern("sliding", SlidingAccess, false);
+	passed = URunPattern("sweep", SweepAccess, false) && passed;
+	passed = URunPattern("random", RandomAccess, true) && passed;
+	if (!passed) {
+		cout << "FAILED: over budget or a resource did not stream" << endl;
+		return 1;
+	}
+	return 0;
+}
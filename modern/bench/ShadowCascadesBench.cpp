@@ -0,0 +1,175 @@
+/*
+ * @author Jacob William
+ * @desc Shadow pass cost per frame for a 64 x 64 field of cubes (4096
+ *       casters) under a directional light at 1280x720 with four 2048
+ *       cascades. Three camera paths run 600 frames each: a still camera,
+ *       an orbit and a dolly towards the field. Each path runs with the
+ *       cascade cache and with every cascade redrawn every frame, and prints
+ *       cascades redrawn, shadow pass GPU time and CPU submission time per
+ *       frame. Needs a display.
+ *
+ *       g++ -O2 -std=c++11 ShadowCascadesBench.cpp -o ShadowCascadesBench -lGLEW -lGL -lglut
+ */
+
+#include <iostream>
+#include <chrono>
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+// Importing glm headers
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../common/DemoMeshes.h"
+#include "../common/ShadowCascades.h"
+
+// Use the standard name spaces
+using namespace std;
+
+#ifndef GLSL
+#define GLSL(Version, Source) "#version " #Version "\n" #Source
+#endif
+
+const int Width = 1280, Height = 720;
+const int Frames = 600;
+const int FieldSide = 64;
+const int ShadowMapSize = 2048;
+const float NearPlane = 0.1f, FarPlane = 200.0f;
+
+/*
+ * Casters, each instance is a cube placed on the field by its index
+ */
+const GLchar* ShadowVertexShader = GLSL(330,
+		layout (location = 0) in vec3 position;
+		uniform mat4 lightViewProjection;
+		uniform int side;
+		void main() {
+			vec2 cell = vec2(gl_InstanceID % side, gl_InstanceID / side) - 0.5 * float(side);
+			gl_Position = lightViewProjection * vec4(position + vec3(cell.x * 2.0, 0.5, cell.y * 2.0), 1.0);
+		}
+);
+
+const GLchar* ShadowFragmentShader = GLSL(330,
+	void main() {
+	}
+);
+
+enum UCameraPath { StillCamera, OrbitCamera, DollyCamera };
+
+/*
+ * @desc Camera of one frame of a path, all look at the field's centre
+ * @returns the view matrix
+ */
+glm::mat4 UCameraView(UCameraPath path, int frame) {
+	float angle = path == OrbitCamera ? frame * 0.005f : 0.0f;
+	float distance = path == DollyCamera ? 80.0f - frame * 0.1f : 80.0f;
+	glm::vec3 eye(distance * cos(angle), 30.0f, distance * sin(angle));
+	return glm::lookAt(eye, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+/*
+ * @desc Runs one camera path. Without the cache every frame is a caster
+ *       change, so all cascades are redrawn
+ * @returns void
+ */
+void URunPath(const char* name, UCameraPath path, bool cache, GLuint program, GLuint vertexArray) {
+	UShadowCascades cascades;
+	cascades.Create(ShadowMapSize);
+
+	glm::vec3 towardsLight = glm::normalize(glm::vec3(0.4f, 1.0f, 0.3f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)Width / Height, NearPlane, FarPlane);
+	const float fieldRadius = FieldSide * 1.5f;
+	const float casters[4] = { 0.0f, 0.5f, 0.0f, fieldRadius };
+
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "side"), FieldSide);
+	GLint lightLocation = glGetUniformLocation(program, "lightViewProjection");
+	glBindVertexArray(vertexArray);
+
+	double cpuMilliseconds = 0.0;
+	for (int frame = 0; frame < Frames; ++frame) {
+		glm::mat4 view = UCameraView(path, frame);
+		auto start = chrono::steady_clock::now();
+		cascades.Update(glm::value_ptr(view), glm::value_ptr(projection), NearPlane, FarPlane,
+			glm::value_ptr(towardsLight), casters, cache ? 0 : frame + 1);
+		cascades.Render([lightLocation](const float* lightViewProjection) {
+			glUniformMatrix4fv(lightLocation, 1, GL_FALSE, lightViewProjection);
+			glDrawArraysInstanced(GL_TRIANGLES, 0, DemoMeshVertexCount, FieldSide * FieldSide);
+		});
+		cpuMilliseconds += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		glFinish();
+
+		// The first frame fills every cascade on both runs, its timer is read
+		// ShadowQueryLatency frames later
+		if (frame == ShadowQueryLatency) {
+			cascades.ResetStats();
+			cpuMilliseconds = 0.0;
+		}
+	}
+	glBindVertexArray(0);
+
+	UShadowStats stats = cascades.Stats();
+	cout << name << (cache ? ", cached: " : ", redrawn: ") << (double)stats.cascadesRendered / stats.frames
+		<< " cascades, " << (stats.timedFrames > 0 ? stats.gpuMilliseconds / stats.timedFrames : 0.0) << " ms GPU, "
+		<< cpuMilliseconds / stats.frames << " ms CPU per frame" << endl;
+	cascades.Destroy();
+}
+
+/*
+ * @desc Compiles the depth only program
+ * @returns the program
+ */
+GLuint UCreateProgram(void) {
+	GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShaderId, 1, &ShadowVertexShader, NULL);
+	glCompileShader(vertexShaderId);
+
+	GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShaderId, 1, &ShadowFragmentShader, NULL);
+	glCompileShader(fragmentShaderId);
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShaderId);
+	glAttachShader(program, fragmentShaderId);
+	glLinkProgram(program);
+	glDeleteShader(vertexShaderId);
+	glDeleteShader(fragmentShaderId);
+	return program;
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	glutInit(&argc, argv);
+	glutInitDisplayMode(GLUT_DEPTH | GLUT_RGBA);
+	glutInitWindowSize(Width, Height);
+	glutCreateWindow("ShadowCascadesBench");
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK) {
+		cout << "Failed to initialize GLEW" << endl;
+		return 1;
+	}
+
+	GLuint program = UCreateProgram();
+	GLuint vertexArray, buffer;
+	glGenVertexArrays(1, &vertexArray);
+	glGenBuffers(1, &buffer);
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(ColorCubeVertices), ColorCubeVertices, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)0);
+	glEnableVertexAttribArray(0);
+	glBindVertexArray(0);
+
+	const char* names[] = { "still camera", "orbit", "dolly" };
+	for (int path = StillCamera; path <= DollyCamera; ++path) {
+		URunPath(names[path], (UCameraPath)path, true, program, vertexArray);
+		URunPath(names[path], (UCameraPath)path, false, program, vertexArray);
+	}
+
+	glDeleteVertexArrays(1, &vertexArray);
+	glDeleteBuffers(1, &buffer);
+	glDeleteProgram(program);
+	return 0;
+}
@@ -0,0 +1,159 @@
+/*
+ * @author Jacob William
+ * @desc Renders the cube, textured cube and chair demos with the software
+ *       rasterizer to software_*.bmp, then measures Mtris/s and Mpix/s on a
+ *       field of cubes with 1 thread up to every core. No GL driver needed.
+ *
+ *       g++ -O2 -std=c++11 -pthread SoftwareRasterizerBench.cpp -o SoftwareRasterizerBench -lSOIL2
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+// Importing glm headers
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// SOIL2 library import
+#include "SOIL2/SOIL2.h"
+
+#include "../common/DemoMeshes.h"
+#include "../common/SoftwareRasterizer.h"
+
+// Use the standard name spaces
+using namespace std;
+
+const int Width = 800, Height = 600;
+const int Frames = 20;
+
+// Same interleaving as the demos' glVertexAttribPointer calls
+const USoftwareVertexLayout ColorLayout = { 6, 0, 3, -1, false };
+const USoftwareVertexLayout TexturedLayout = { 5, 0, -1, 3, true };
+
+/*
+ * @desc Draws one demo mesh with the transform of the demos' URenderGraphics
+ *       and saves it
+ * @returns void
+ */
+void URenderDemo(USoftwareRasterizer& rasterizer, const GLfloat* vertices, const USoftwareVertexLayout& layout, const char* path) {
+	glm::mat4 model;
+	model = glm::rotate(model, glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	model = glm::scale(model, glm::vec3(2.0f, 2.0f, 2.0f));
+
+	glm::mat4 view;
+	view = glm::translate(view, glm::vec3(0.0f, 0.0f, -5.0f));
+
+	glm::mat4 projection;
+	projection = glm::perspective(glm::radians(45.0f), (GLfloat)Width / (GLfloat)Height, 0.1f, 100.0f);
+
+	rasterizer.Clear(0.0f, 0.0f, 0.0f, 1.0f);
+	rasterizer.Draw(vertices, layout, NULL, DemoMeshVertexCount,
+		glm::value_ptr(model), glm::value_ptr(view), glm::value_ptr(projection));
+	rasterizer.Finish();
+
+	const UImage& image = rasterizer.Color();
+	if (!SOIL_save_image(path, SOIL_SAVE_TYPE_BMP, image.width, image.height, 4, image.pixels.data())) {
+		cout << "Failed to write " << path << endl;
+		return;
+	}
+	cout << path << ": " << rasterizer.Stats().pixels << " pixels" << endl;
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	int grid = 20;
+	if (argc > 2) {
+		cout << "Unknown argument " << argv[2] << endl;
+		return 1;
+	}
+	if (argc > 1) {
+		char* end;
+		long value = strtol(argv[1], &end, 10);
+		if (end == argv[1] || *end != '\0' || value <= 0 || value > 100) {
+			cout << "Grid size needs to be between 1 and 100, not " << argv[1] << endl;
+			return 1;
+		}
+		grid = (int)value;
+	}
+	unsigned cores = thread::hardware_concurrency();
+	if (cores == 0) {
+		cores = 1;
+	}
+
+	// Texture of Textured3DCube, or a checkerboard without it
+	UImage texture;
+	unsigned char* pixels = SOIL_load_image("snhu.JPG", &texture.width, &texture.height, 0, SOIL_LOAD_RGBA);
+	if (pixels != NULL) {
+		texture.pixels.assign(pixels, pixels + (size_t)texture.width * texture.height * 4);
+		SOIL_free_image_data(pixels);
+	}
+	else {
+		texture.width = texture.height = 64;
+		texture.pixels.resize(64 * 64 * 4);
+		for (int i = 0; i < 64 * 64; ++i) {
+			unsigned char value = ((i % 64) / 8 + (i / 64) / 8) % 2 ? 255 : 64;
+			texture.pixels[i * 4 + 0] = texture.pixels[i * 4 + 1] = texture.pixels[i * 4 + 2] = value;
+			texture.pixels[i * 4 + 3] = 255;
+		}
+	}
+
+	{
+		UJobSystem jobs;
+		USoftwareRasterizer rasterizer(jobs, Width, Height);
+		URenderDemo(rasterizer, ColorCubeVertices, ColorLayout, "software_cube.bmp");
+		rasterizer.BindTexture(&texture);
+		URenderDemo(rasterizer, TexturedCubeVertices, TexturedLayout, "software_textured_cube.bmp");
+		rasterizer.BindTexture(NULL);
+		URenderDemo(rasterizer, ChairVertices, ColorLayout, "software_chair.bmp");
+	}
+
+	// Field of cubes in front of the camera
+	vector<glm::mat4> models;
+	for (int z = 0; z < grid; ++z) {
+		for (int y = 0; y < grid; ++y) {
+			for (int x = 0; x < grid; ++x) {
+				glm::mat4 model;
+				model = glm::translate(model, glm::vec3((x - grid / 2) * 1.5f, (y - grid / 2) * 1.5f, -z * 1.5f));
+				model = glm::rotate(model, glm::radians(15.0f * (x + y + z)), glm::vec3(0.3f, 1.0f, 0.0f));
+				models.push_back(model);
+			}
+		}
+	}
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, grid * 1.2f), glm::vec3(0.0f, 0.0f, -grid * 0.75f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (GLfloat)Width / (GLfloat)Height, 0.1f, 500.0f);
+
+	cout << models.size() << " cubes, " << Width << "x" << Height << ", " << Frames << " frames per run" << endl;
+
+	double singleThreaded = 0.0;
+	for (unsigned threads = 1; threads <= cores; ++threads) {
+		UJobSystem jobs(threads - 1);
+		USoftwareRasterizer rasterizer(jobs, Width, Height);
+
+		size_t triangles = 0, pixelsWritten = 0;
+		auto start = chrono::steady_clock::now();
+		for (int f = 0; f < Frames; ++f) {
+			rasterizer.Clear(0.0f, 0.0f, 0.0f, 1.0f);
+			for (size_t i = 0; i < models.size(); ++i) {
+				rasterizer.Draw(ColorCubeVertices, ColorLayout, NULL, DemoMeshVertexCount,
+					glm::value_ptr(models[i]), glm::value_ptr(view), glm::value_ptr(projection));
+			}
+			rasterizer.Finish();
+			triangles += rasterizer.Stats().triangles;
+			pixelsWritten += rasterizer.Stats().pixels;
+		}
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		if (threads == 1) {
+			singleThreaded = seconds;
+		}
+		cout << threads << " thread(s): " << seconds * 1000.0 / Frames << " ms/frame, "
+			<< triangles / seconds / 1e6 << " Mtris/s, " << pixelsWritten / seconds / 1e6 << " Mpix/s, speedup "
+			<< singleThreaded / seconds << "x" << endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * @author Jacob William
+ * @desc Benchmarks the batched model-matrix kernels against each other and
+ *       checks them against glm::translate * glm::mat4_cast * glm::scale
+ *
+ *       g++ -O2 -std=c++11 TransformKernelBench.cpp -o TransformKernelBench
+ */
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+// Importing glm headers
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../common/TransformKernel.h"
+
+// Use the standard name spaces
+using namespace std;
+
+// Number of instances per run and number of runs averaged
+const size_t InstanceCount = 1 << 20;
+const int Runs = 20;
+
+// Largest difference from glm allowed, elements go up to about 50
+const float GlmTolerance = 1.0e-4f;
+
+/*
+ * @desc Random float in [lo, hi)
+ */
+float URandom(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / ((float)RAND_MAX + 1.0f);
+}
+
+/*
+ * @desc Times one kernel and prints matrices per second on this core
+ * @returns void
+ */
+void UTimeKernel(UTransformKernelFn kernel, const UTransformSoA& soa, vector<float>& out) {
+	// Warm up caches and page in the output
+	kernel(soa, 0, InstanceCount, out.data());
+
+	auto start = chrono::steady_clock::now();
+	for (int run = 0; run < Runs; ++run) {
+		kernel(soa, 0, InstanceCount, out.data());
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	double perSecond = (double)InstanceCount * Runs / seconds;
+	cout << UTransformKernelName(kernel) << ": " << perSecond / 1.0e6 << " M matrices/s per core" << endl;
+}
+
+// Main function
+int main(void) {
+
+	srand(1234);
+
+	// Random SoA transforms with normalized quaternions
+	vector<float> tx(InstanceCount), ty(InstanceCount), tz(InstanceCount);
+	vector<float> qx(InstanceCount), qy(InstanceCount), qz(InstanceCount), qw(InstanceCount);
+	vector<float> sx(InstanceCount), sy(InstanceCount), sz(InstanceCount);
+
+	for (size_t i = 0; i < InstanceCount; ++i) {
+		tx[i] = URandom(-50.0f, 50.0f);
+		ty[i] = URandom(-50.0f, 50.0f);
+		tz[i] = URandom(-50.0f, 50.0f);
+
+		float x = URandom(-1.0f, 1.0f), y = URandom(-1.0f, 1.0f);
+		float z = URandom(-1.0f, 1.0f), w = URandom(-1.0f, 1.0f);
+		float length = sqrt(x * x + y * y + z * z + w * w);
+		qx[i] = x / length;
+		qy[i] = y / length;
+		qz[i] = z / length;
+		qw[i] = w / length;
+
+		sx[i] = URandom(0.1f, 4.0f);
+		sy[i] = URandom(0.1f, 4.0f);
+		sz[i] = URandom(0.1f, 4.0f);
+	}
+
+	UTransformSoA soa = {
+		tx.data(), ty.data(), tz.data(),
+		qx.data(), qy.data(), qz.data(), qw.data(),
+		sx.data(), sy.data(), sz.data()
+	};
+
+	vector<float> reference(InstanceCount * 16), out(InstanceCount * 16);
+
+	// Accuracy against glm for a slice of the instances
+	UBuildMatricesScalar(soa, 0, InstanceCount, reference.data());
+	float glmError = 0.0f;
+	for (size_t i = 0; i < 4096; ++i) {
+		glm::mat4 model;
+		model = glm::translate(model, glm::vec3(tx[i], ty[i], tz[i]));
+		model = model * glm::mat4_cast(glm::quat(qw[i], qx[i], qy[i], qz[i]));
+		model = glm::scale(model, glm::vec3(sx[i], sy[i], sz[i]));
+
+		const float* expected = glm::value_ptr(model);
+		for (int e = 0; e < 16; ++e) {
+			glmError = max(glmError, fabs(expected[e] - reference[i * 16 + e]));
+		}
+	}
+	cout << "scalar vs glm max abs error: " << glmError << endl;
+
+	int status = EXIT_SUCCESS;
+	if (!(glmError <= GlmTolerance)) {
+		cout << "scalar differs from glm by more than " << GlmTolerance << endl;
+		status = EXIT_FAILURE;
+	}
+
+	// Every SIMD path must match the scalar path exactly
+	UTransformKernelFn kernels[] = {
+		UBuildMatricesScalar,
+#ifdef TRANSFORM_KERNEL_X86
+		UBuildMatricesSSE,
+		__builtin_cpu_supports("avx2") ? UBuildMatricesAVX2 : UBuildMatricesSSE,
+#endif
+	};
+
+	for (UTransformKernelFn kernel : kernels) {
+		kernel(soa, 0, InstanceCount, out.data());
+
+		size_t mismatches = 0;
+		for (size_t e = 0; e < out.size(); ++e) {
+			mismatches += out[e] != reference[e];
+		}
+		if (mismatches != 0) {
+			cout << UTransformKernelName(kernel) << ": " << mismatches << " elements differ from scalar" << endl;
+			status = EXIT_FAILURE;
+		}
+
+		UTimeKernel(kernel, soa, out);
+	}
+
+	cout << "selected kernel: " << UTransformKernelName(USelectTransformKernel()) << endl;
+
+	return status;
+}
@@ -0,0 +1,686 @@
+/*
+ * @author Jacob William
+ * @desc Hot reload of shader programs, meshes and textures. A loader thread
+ *       waits on inotify for the watched files to be saved, reads and
+ *       parses or decodes them off the GL thread and queues the result.
+ *       Update, called by the GL thread at the start of a frame, compiles
+ *       and links new programs (in the driver's background threads when it
+ *       has ARB_parallel_shader_compile, checked again every frame until
+ *       done), uploads new meshes and textures and swaps them in, so a frame
+ *       draws entirely with the old or entirely with the new version. A file
+ *       that fails to load, compile or link leaves the previous version in
+ *       place. Linux only.
+ *
+ *       Programs are swapped by overwriting the GL name the caller draws
+ *       with; meshes go through the caller's upload function and textures
+ *       either way. A texture replaced by name keeps its internal format
+ *       and sampler state.
+ */
+
+#ifndef ASSET_DATABASE_H
+#define ASSET_DATABASE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <GL/glew.h>
+
+#include "DemoMeshes.h"
+#include "Image.h"
+
+#ifndef GL_COMPLETION_STATUS_ARB
+#define GL_COMPLETION_STATUS_ARB 0x91B1
+#endif
+
+// Reads the file at path on the loader thread into a triangle list
+typedef std::function<bool(const std::string& path, std::vector<GLfloat>& vertices)> UMeshLoader;
+
+// Puts a loaded triangle list into the caller's buffers on the GL thread
+typedef std::function<void(const std::vector<GLfloat>& vertices)> UMeshUpload;
+
+// Decodes the file at path on the loader thread into RGBA8 mip levels, one level gets glGenerateMipmap
+typedef std::function<bool(const std::string& path, std::vector<UImage>& levels)> UTextureLoader;
+
+// Puts decoded levels into a texture the caller owns, on the GL thread
+typedef std::function<void(const std::vector<UImage>& levels)> UTextureUpload;
+
+struct UReloadStats {
+	uint64_t reloads;
+	uint64_t failures;
+	double latencyMilliseconds;	// save to first frame presented, summed
+	double worstMilliseconds;
+};
+
+/*
+ * @desc Whole file as a string
+ * @returns false when it cannot be opened
+ */
+inline bool UReadTextFile(const std::string& path, std::string& text) {
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	std::stringstream contents;
+	contents << file.rdbuf();
+	text = contents.str();
+	return true;
+}
+
+/*
+ * @desc Breaks a GLSL(...) string, which the preprocessor flattened onto
+ *       one line, back into one statement per line with tab indents
+ * @returns the formatted source
+ */
+inline std::string UFormatGLSL(const std::string& source) {
+	std::string out;
+	int depth = 0, parentheses = 0;
+	bool lineStart = true;
+	for (size_t i = 0; i < source.size(); ++i) {
+		char c = source[i];
+		if (c == '\n') {
+			out += '\n';
+			lineStart = true;
+			continue;
+		}
+		if (lineStart && (c == ' ' || c == '\t')) {
+			continue;
+		}
+		if (c == '}') {
+			--depth;
+			if (!lineStart) {
+				out += '\n';
+				lineStart = true;
+			}
+		}
+		if (lineStart) {
+			out.append(std::max(depth, 0), '\t');
+			lineStart = false;
+		}
+		out += c;
+
+		parentheses += c == '(' ? 1 : c == ')' ? -1 : 0;
+		size_t next = source.find_first_not_of(' ', i + 1);
+		bool semicolonNext = next != std::string::npos && source[next] == ';';
+		if (c == '{' || (c == ';' && parentheses == 0) || (c == '}' && !semicolonNext)) {
+			depth += c == '{';
+			out += '\n';
+			lineStart = true;
+		}
+	}
+	return out;
+}
+
+/*
+ * @desc Writes a shader made of parts to path unless the file exists, so a
+ *       demo can hand its built-in GLSL out for editing
+ * @returns false when the file had to be written and could not be
+ */
+inline bool UExportShader(const std::string& path, const std::vector<const GLchar*>& parts) {
+	std::ifstream existing(path.c_str());
+	if (existing) {
+		return true;
+	}
+	std::string source;
+	for (size_t i = 0; i < parts.size(); ++i) {
+		source += parts[i];
+	}
+	std::ofstream file(path.c_str(), std::ios::binary);
+	file << UFormatGLSL(source);
+	return (bool)file;
+}
+
+/*
+ * @desc Writes a position and color triangle list (6 floats per vertex)
+ *       as OBJ unless the file exists, colors as the common "v x y z r g b"
+ *       extension
+ * @returns false when the file had to be written and could not be
+ */
+inline bool UExportObj(const std::string& path, const GLfloat* vertices, GLsizei vertexCount) {
+	std::ifstream existing(path.c_str());
+	if (existing) {
+		return true;
+	}
+	std::ofstream file(path.c_str());
+	for (GLsizei v = 0; v < vertexCount; ++v) {
+		const GLfloat* vertex = vertices + v * 6;
+		file << "v " << vertex[0] << " " << vertex[1] << " " << vertex[2] << " " << vertex[3] << " " << vertex[4] << " " << vertex[5] << "\n";
+	}
+	for (GLsizei v = 0; v + 2 < vertexCount; v += 3) {
+		file << "f " << v + 1 << " " << v + 2 << " " << v + 3 << "\n";
+	}
+	return (bool)file;
+}
+
+/*
+ * @desc Reads the positions, optional vertex colors and faces of an OBJ
+ *       file, polygons as triangle fans, into the position, normal, color
+ *       layout of UAddFlatNormals. Texture coordinates and normals in the
+ *       file are ignored
+ * @returns false when the file is missing, malformed or has no triangles
+ */
+inline bool ULoadObj(const std::string& path, std::vector<GLfloat>& vertices) {
+	std::ifstream file(path.c_str());
+	if (!file) {
+		return false;
+	}
+	std::vector<GLfloat> points;		// x y z r g b
+	std::vector<GLfloat> triangles;
+	std::string line;
+	while (std::getline(file, line)) {
+		std::istringstream words(line);
+		std::string kind;
+		words >> kind;
+		if (kind == "v") {
+			GLfloat v[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+			if (!(words >> v[0] >> v[1] >> v[2])) {
+				return false;
+			}
+			GLfloat color[3];
+			if (words >> color[0] >> color[1] >> color[2]) {
+				std::copy(color, color + 3, v + 3);
+			}
+			points.insert(points.end(), v, v + 6);
+		}
+		else if (kind == "f") {
+			std::vector<long> corners;
+			std::string corner;
+			while (words >> corner) {
+				long index = atol(corner.c_str());
+				index = index < 0 ? (long)(points.size() / 6) + index : index - 1;
+				if (index < 0 || index >= (long)(points.size() / 6)) {
+					return false;
+				}
+				corners.push_back(index);
+			}
+			for (size_t c = 2; c < corners.size(); ++c) {
+				long fan[3] = { corners[0], corners[c - 1], corners[c] };
+				for (int k = 0; k < 3; ++k) {
+					triangles.insert(triangles.end(), points.begin() + fan[k] * 6, points.begin() + fan[k] * 6 + 6);
+				}
+			}
+		}
+	}
+	if (triangles.empty()) {
+		return false;
+	}
+	vertices = UAddFlatNormals(triangles.data(), (GLsizei)(triangles.size() / 6), 6);
+	return true;
+}
+
+class UAssetDatabase {
+public:
+
+	UAssetDatabase() : inotify(-1), running(false), parallelCompile(false), loadNow(false) {
+		memset(&stats, 0, sizeof(stats));
+	}
+
+	// Only the loader thread, GL objects go with Close
+	~UAssetDatabase() {
+		UStopLoader();
+	}
+
+	/*
+	 * @desc Reloads program from the two files whenever either is saved
+	 * @returns void
+	 */
+	void WatchProgram(GLuint* program, const std::string& vertexPath, const std::string& fragmentPath) {
+		UAsset asset;
+		asset.kind = UAssetProgram;
+		asset.paths[0] = vertexPath;
+		asset.paths[1] = fragmentPath;
+		asset.handle = program;
+		assets.push_back(asset);
+	}
+
+	void WatchMesh(const std::string& path, UMeshLoader load, UMeshUpload upload) {
+		UAsset asset;
+		asset.kind = UAssetMesh;
+		asset.paths[0] = path;
+		asset.handle = NULL;
+		asset.meshLoader = load;
+		asset.meshUpload = upload;
+		assets.push_back(asset);
+	}
+
+	void WatchTexture(GLuint* texture, const std::string& path, UTextureLoader load) {
+		UAsset asset;
+		asset.kind = UAssetTexture;
+		asset.paths[0] = path;
+		asset.handle = texture;
+		asset.textureLoader = load;
+		assets.push_back(asset);
+	}
+
+	/*
+	 * @desc For textures held elsewhere, a residency manager say: upload
+	 *       gets the decoded levels instead of a GL name being overwritten
+	 * @returns void
+	 */
+	void WatchTexture(const std::string& path, UTextureLoader load, UTextureUpload upload) {
+		UAsset asset;
+		asset.kind = UAssetTexture;
+		asset.paths[0] = path;
+		asset.handle = NULL;
+		asset.textureLoader = load;
+		asset.textureUpload = upload;
+		assets.push_back(asset);
+	}
+
+	/*
+	 * @desc Starts watching after every Watch call, on the GL thread. With
+	 *       loadFirst the files are loaded once straight away, so edits from
+	 *       an earlier run replace the built-in versions
+	 * @returns false when inotify is not available
+	 */
+	bool Start(bool loadFirst) {
+		loadNow = loadFirst;
+		inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (inotify < 0) {
+			return false;
+		}
+		for (size_t a = 0; a < assets.size(); ++a) {
+			for (int p = 0; p < 2 && !assets[a].paths[p].empty(); ++p) {
+				std::string directory = UDirectory(assets[a].paths[p]);
+				int watch = inotify_add_watch(inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+				if (watch >= 0) {
+					directories[watch] = directory;
+				}
+			}
+		}
+		if (GLEW_ARB_parallel_shader_compile) {
+			glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+			parallelCompile = true;
+		}
+		running = true;
+		loader = std::thread(&UAssetDatabase::ULoaderLoop, this);
+		return true;
+	}
+
+	/*
+	 * @desc Frame boundary, GL thread: takes what the loader finished,
+	 *       starts compiling new programs and swaps in every asset that is
+	 *       ready. Failures are written to out
+	 * @returns void
+	 */
+	void Update(std::ostream& out) {
+		std::vector<ULoaded> loaded;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			loaded.swap(ready);
+		}
+
+		for (size_t i = 0; i < loaded.size(); ++i) {
+			ULoaded& result = loaded[i];
+			UAsset& asset = assets[result.asset];
+			if (!result.ok) {
+				out << "reload " << UName(asset) << " failed to load, keeping the previous version" << std::endl;
+				stats.failures++;
+				continue;
+			}
+			if (asset.kind == UAssetProgram) {
+				UStartProgram(result);
+			}
+			else if (asset.kind == UAssetMesh) {
+				asset.meshUpload(result.vertices);
+				USwapped(result);
+			}
+			else if (asset.handle == NULL) {
+				asset.textureUpload(result.levels);
+				USwapped(result);
+			}
+			else {
+				GLuint previous = *asset.handle;
+				*asset.handle = UUploadTexture(previous, result.levels);
+				glDeleteTextures(1, &previous);
+				USwapped(result);
+			}
+		}
+
+		for (size_t i = 0; i < compiling.size();) {
+			UCompiling& job = compiling[i];
+			GLint done = GL_TRUE;
+			if (parallelCompile) {
+				glGetProgramiv(job.program, GL_COMPLETION_STATUS_ARB, &done);
+			}
+			if (!done) {
+				++i;
+				continue;
+			}
+			UAsset& asset = assets[job.asset];
+			GLint linked = GL_FALSE;
+			glGetProgramiv(job.program, GL_LINK_STATUS, &linked);
+			if (linked == GL_TRUE) {
+				GLuint previous = *asset.handle;
+				*asset.handle = job.program;
+				glDeleteProgram(previous);
+				ULoaded result;
+				result.asset = job.asset;
+				result.initial = job.initial;
+				result.changed = job.changed;
+				USwapped(result);
+			}
+			else {
+				out << "reload " << UName(asset) << " did not link, keeping the previous version" << std::endl;
+				UPrintLogs(out, job);
+				glDeleteProgram(job.program);
+				stats.failures++;
+			}
+			glDeleteShader(job.shaders[0]);
+			glDeleteShader(job.shaders[1]);
+			compiling.erase(compiling.begin() + i);
+		}
+	}
+
+	/*
+	 * @desc Call after the frame is swapped: writes the time from each file
+	 *       save to this, the first frame drawn with the new version
+	 * @returns void
+	 */
+	void Presented(std::ostream& out) {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < swapped.size(); ++i) {
+			if (swapped[i].initial) {
+				continue;
+			}
+			double milliseconds = std::chrono::duration<double, std::milli>(now - swapped[i].changed).count();
+			stats.reloads++;
+			stats.latencyMilliseconds += milliseconds;
+			stats.worstMilliseconds = std::max(stats.worstMilliseconds, milliseconds);
+			out << "reload " << UName(assets[swapped[i].asset]) << ": " << milliseconds << " ms from save to first frame" << std::endl;
+		}
+		swapped.clear();
+	}
+
+	UReloadStats Stats(void) const {
+		return stats;
+	}
+
+	/*
+	 * @desc Stops the loader and drops unfinished work, GL thread
+	 * @returns void
+	 */
+	void Close(void) {
+		UStopLoader();
+		for (size_t i = 0; i < compiling.size(); ++i) {
+			glDeleteProgram(compiling[i].program);
+			glDeleteShader(compiling[i].shaders[0]);
+			glDeleteShader(compiling[i].shaders[1]);
+		}
+		compiling.clear();
+		ready.clear();
+		swapped.clear();
+	}
+
+private:
+
+	enum UAssetKind { UAssetProgram, UAssetMesh, UAssetTexture };
+
+	struct UAsset {
+		UAssetKind kind;
+		std::string paths[2];		// vertex and fragment for programs
+		GLuint* handle;
+		UMeshLoader meshLoader;
+		UMeshUpload meshUpload;
+		UTextureLoader textureLoader;
+		UTextureUpload textureUpload;
+	};
+
+	// What the loader thread hands to the GL thread
+	struct ULoaded {
+		size_t asset;
+		bool ok;
+		bool initial;
+		std::chrono::steady_clock::time_point changed;
+		std::string sources[2];
+		std::vector<GLfloat> vertices;
+		std::vector<UImage> levels;
+	};
+
+	struct UCompiling {
+		size_t asset;
+		GLuint program;
+		GLuint shaders[2];
+		bool initial;
+		std::chrono::steady_clock::time_point changed;
+	};
+
+	struct USwap {
+		size_t asset;
+		bool initial;
+		std::chrono::steady_clock::time_point changed;
+	};
+
+	void UStopLoader(void) {
+		if (running) {
+			running = false;
+			loader.join();
+		}
+		if (inotify >= 0) {
+			close(inotify);
+			inotify = -1;
+		}
+	}
+
+	static std::string UDirectory(const std::string& path) {
+		size_t slash = path.find_last_of('/');
+		return slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+	}
+
+	static std::string UFileName(const std::string& path) {
+		size_t slash = path.find_last_of('/');
+		return slash == std::string::npos ? path : path.substr(slash + 1);
+	}
+
+	static std::string UName(const UAsset& asset) {
+		return asset.kind == UAssetProgram ? asset.paths[0] + " + " + asset.paths[1] : asset.paths[0];
+	}
+
+	/*
+	 * @desc Loader thread: the first load of everything, then every save of
+	 *       a watched file. Several events for one asset in one read load it
+	 *       once
+	 * @returns void
+	 */
+	void ULoaderLoop(void) {
+		for (size_t a = 0; a < assets.size() && loadNow; ++a) {
+			ULoad(a, true, std::chrono::steady_clock::now());
+		}
+
+		alignas(struct inotify_event) char buffer[4096];
+		while (running) {
+			pollfd request = { inotify, POLLIN, 0 };
+			if (poll(&request, 1, 100) <= 0) {
+				continue;
+			}
+			std::chrono::steady_clock::time_point changed = std::chrono::steady_clock::now();
+			ssize_t length = read(inotify, buffer, sizeof(buffer));
+			std::vector<bool> due(assets.size(), false);
+			for (ssize_t offset = 0; offset < length;) {
+				const inotify_event* event = (const inotify_event*)(buffer + offset);
+				offset += sizeof(inotify_event) + event->len;
+				if (event->len == 0 || directories.find(event->wd) == directories.end()) {
+					continue;
+				}
+				const std::string& directory = directories[event->wd];
+				for (size_t a = 0; a < assets.size(); ++a) {
+					for (int p = 0; p < 2; ++p) {
+						const std::string& path = assets[a].paths[p];
+						if (!path.empty() && UDirectory(path) == directory && UFileName(path) == event->name) {
+							due[a] = true;
+						}
+					}
+				}
+			}
+			for (size_t a = 0; a < assets.size(); ++a) {
+				if (due[a]) {
+					ULoad(a, false, changed);
+				}
+			}
+		}
+	}
+
+	/*
+	 * @desc Reads or decodes one asset and queues it for the GL thread
+	 * @returns void
+	 */
+	void ULoad(size_t index, bool initial, std::chrono::steady_clock::time_point changed) {
+		const UAsset& asset = assets[index];
+		ULoaded result;
+		result.asset = index;
+		result.initial = initial;
+		result.changed = changed;
+		if (asset.kind == UAssetProgram) {
+			result.ok = UReadTextFile(asset.paths[0], result.sources[0]) && UReadTextFile(asset.paths[1], result.sources[1]);
+		}
+		else if (asset.kind == UAssetMesh) {
+			result.ok = asset.meshLoader(asset.paths[0], result.vertices);
+		}
+		else {
+			result.ok = asset.textureLoader(asset.paths[0], result.levels) && !result.levels.empty();
+		}
+
+		// A missing file on the first load just keeps the built-in version
+		if (initial && !result.ok) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		ready.push_back(result);
+	}
+
+	/*
+	 * @desc Issues compile and link without waiting for them; an older
+	 *       unfinished build of the same program is dropped
+	 * @returns void
+	 */
+	void UStartProgram(const ULoaded& result) {
+		for (size_t i = 0; i < compiling.size(); ++i) {
+			if (compiling[i].asset == result.asset) {
+				glDeleteProgram(compiling[i].program);
+				glDeleteShader(compiling[i].shaders[0]);
+				glDeleteShader(compiling[i].shaders[1]);
+				compiling.erase(compiling.begin() + i);
+				break;
+			}
+		}
+
+		UCompiling job;
+		job.asset = result.asset;
+		job.initial = result.initial;
+		job.changed = result.changed;
+		const GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+		job.program = glCreateProgram();
+		for (int s = 0; s < 2; ++s) {
+			const GLchar* source = result.sources[s].c_str();
+			job.shaders[s] = glCreateShader(types[s]);
+			glShaderSource(job.shaders[s], 1, &source, NULL);
+			glCompileShader(job.shaders[s]);
+			glAttachShader(job.program, job.shaders[s]);
+		}
+		glLinkProgram(job.program);
+		compiling.push_back(job);
+	}
+
+	/*
+	 * @desc Compiler output of a failed build
+	 * @returns void
+	 */
+	static void UPrintLogs(std::ostream& out, const UCompiling& job) {
+		GLchar log[4096];
+		for (int s = 0; s < 2; ++s) {
+			GLint compiled = GL_FALSE;
+			glGetShaderiv(job.shaders[s], GL_COMPILE_STATUS, &compiled);
+			if (compiled != GL_TRUE) {
+				glGetShaderInfoLog(job.shaders[s], sizeof(log), NULL, log);
+				out << log;
+			}
+		}
+		glGetProgramInfoLog(job.program, sizeof(log), NULL, log);
+		out << log << std::endl;
+	}
+
+	/*
+	 * @desc New texture from the decoded levels with the internal format and
+	 *       sampler state of previous, RGBA8 and trilinear when there is
+	 *       none. A compressed format the driver will not encode into falls
+	 *       back to RGBA8
+	 * @returns the texture
+	 */
+	static GLuint UUploadTexture(GLuint previous, const std::vector<UImage>& levels) {
+		GLint format = GL_RGBA8, minFilter = GL_LINEAR_MIPMAP_LINEAR, magFilter = GL_LINEAR;
+		GLint wrapS = GL_REPEAT, wrapT = GL_REPEAT;
+		if (previous != 0 && glIsTexture(previous)) {
+			glBindTexture(GL_TEXTURE_2D, previous);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+			glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &minFilter);
+			glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &magFilter);
+			glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &wrapS);
+			glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, &wrapT);
+		}
+
+		GLuint texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		while (glGetError() != GL_NO_ERROR) {
+		}
+		glTexImage2D(GL_TEXTURE_2D, 0, format, levels[0].width, levels[0].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[0].pixels.data());
+		if (glGetError() != GL_NO_ERROR) {
+			format = GL_RGBA8;
+			glTexImage2D(GL_TEXTURE_2D, 0, format, levels[0].width, levels[0].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[0].pixels.data());
+		}
+		for (size_t l = 1; l < levels.size(); ++l) {
+			glTexImage2D(GL_TEXTURE_2D, (GLint)l, format, levels[l].width, levels[l].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[l].pixels.data());
+		}
+		if (levels.size() > 1) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+		}
+		else if (minFilter != GL_LINEAR && minFilter != GL_NEAREST) {
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return texture;
+	}
+
+	void USwapped(const ULoaded& result) {
+		USwap swap;
+		swap.asset = result.asset;
+		swap.initial = result.initial;
+		swap.changed = result.changed;
+		swapped.push_back(swap);
+	}
+
+	std::vector<UAsset> assets;
+	std::map<int, std::string> directories;
+	int inotify;
+	std::atomic<bool> running;
+	std::thread loader;
+	bool parallelCompile;
+	bool loadNow;
+
+	std::mutex mutex;
+	std::vector<ULoaded> ready;		// loader thread to GL thread, under mutex
+
+	std::vector<UCompiling> compiling;
+	std::vector<USwap> swapped;
+	UReloadStats stats;
+};
+
+#endif // ASSET_DATABASE_H
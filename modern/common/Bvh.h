@@ -0,0 +1,652 @@
+/*
+ * @author Jacob William
+ * @desc Triangle bounding volume hierarchy for ray picking. Meshes are added
+ *       in world space, indexed or not, and built together with binned SAH.
+ *       The top of the tree is split on the calling thread with large nodes
+ *       binned across the job system, then the subtrees below it build one
+ *       per job. Triangles are then reordered so every leaf is a contiguous
+ *       run of precomputed edges.
+ *
+ *       Traversal visits the nearer child first and tests ray against box
+ *       with SSE, four lanes of slabs at once, when the compiler targets it
+ *       (always on x86-64), scalar otherwise.
+ */
+
+#ifndef BVH_H
+#define BVH_H
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "JobSystem.h"
+
+#if defined(__SSE2__)
+#define BVH_SSE 1
+#include <emmintrin.h>
+#endif
+
+// Binned SAH: bins per axis, largest leaf, and traversal cost against one triangle test
+const int BvhBins = 12;
+const uint32_t BvhMaxLeafTriangles = 8;
+const float BvhTraversalCost = 1.0f;
+
+// Nodes above this many triangles bin in parallel, smaller ones become subtree jobs
+const uint32_t BvhParallelTriangles = 16384;
+
+/*
+ * 32 byte node. count is 0 for inner nodes, whose children sit at
+ * leftFirst and leftFirst + 1; a leaf holds count triangles from leftFirst
+ */
+struct UBvhNode {
+	float min[3];
+	uint32_t leftFirst;
+	float max[3];
+	uint32_t count;
+};
+
+// Triangle as a corner and two edges, what the intersection test reads
+struct UBvhTriangle {
+	float v0[3];
+	float e1[3];
+	float e2[3];
+};
+
+// Nearest hit, triangle numbered within its mesh, u and v barycentric along e1 and e2
+struct UBvhHit {
+	float distance;
+	float u, v;
+	uint32_t mesh;
+	uint32_t triangle;
+};
+
+struct UBvhStats {
+	size_t triangles;
+	size_t nodes;
+	size_t leaves;
+	size_t bytes;
+	double buildMilliseconds;
+};
+
+class UBvh {
+public:
+
+	UBvh() : nodes(NULL), nodeCount(0), meshCount(0), subtreeTriangles(0) {
+		stats = UBvhStats();
+	}
+
+	/*
+	 * @desc Adds a mesh, kept until Clear. vertices start with xyz every
+	 *       stride floats; without indices every three vertices form a
+	 *       triangle. transform is an optional column major model matrix
+	 * @returns the mesh number reported in hits
+	 */
+	uint32_t AddMesh(const float* vertices, size_t stride, size_t vertexCount, const uint32_t* indices, size_t indexCount, const float* transform = NULL) {
+		size_t count = (indices != NULL ? indexCount : vertexCount) / 3;
+		size_t first = triangles.size();
+		triangles.resize(first + count);
+		meshIds.resize(first + count, (uint32_t)meshCount);
+		triangleIds.resize(first + count);
+		for (size_t t = 0; t < count; ++t) {
+			float corners[3][3];
+			for (int k = 0; k < 3; ++k) {
+				const float* p = vertices + (indices != NULL ? indices[t * 3 + k] : t * 3 + k) * stride;
+				for (int c = 0; c < 3; ++c) {
+					corners[k][c] = transform == NULL ? p[c]
+						: transform[c] * p[0] + transform[4 + c] * p[1] + transform[8 + c] * p[2] + transform[12 + c];
+				}
+			}
+			UBvhTriangle& triangle = triangles[first + t];
+			for (int c = 0; c < 3; ++c) {
+				triangle.v0[c] = corners[0][c];
+				triangle.e1[c] = corners[1][c] - corners[0][c];
+				triangle.e2[c] = corners[2][c] - corners[0][c];
+			}
+			triangleIds[first + t] = (uint32_t)t;
+		}
+		return (uint32_t)meshCount++;
+	}
+
+	/*
+	 * @desc Builds the hierarchy over every mesh added so far
+	 * @returns void
+	 */
+	void Build(UJobSystem& jobs) {
+		auto start = std::chrono::steady_clock::now();
+		uint32_t count = (uint32_t)triangles.size();
+		// Children come in pairs at even indices on 64 byte boundaries, so
+		// one cache line holds both boxes a step tests. Node 1 stays unused
+		nodeMemory.reset(new char[(2 * (size_t)count + 2) * sizeof(UBvhNode) + 64]);
+		nodes = (UBvhNode*)(((uintptr_t)nodeMemory.get() + 63) & ~(uintptr_t)63);
+		nodes[1] = UBvhNode();
+		nodeCount = 2;
+
+		// Bounds of every triangle, partitioned in place as nodes split so
+		// each pass reads them in order
+		primitives.resize(count);
+		jobs.ParallelFor(count, std::max<size_t>(1, count / 1024), [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; ++t) {
+				const UBvhTriangle& triangle = triangles[t];
+				UBounds& box = primitives[t].bounds;
+				for (int c = 0; c < 3; ++c) {
+					float a = triangle.v0[c], b = a + triangle.e1[c], d = a + triangle.e2[c];
+					box.min[c] = std::min(a, std::min(b, d));
+					box.max[c] = std::max(a, std::max(b, d));
+				}
+				primitives[t].triangle = (uint32_t)t;
+			}
+		});
+
+		// Subtrees are jobs of their own, at most about two thousand of them.
+		// They build serially: a nested ParallelFor would usually find the
+		// thread's job ring busy with outer jobs and run inline anyway
+		UBounds root, centroids;
+		UMeasure(&jobs, 0, count, root, centroids);
+		USetBounds(nodes[0], root);
+		std::vector<USubtree> subtrees;
+		subtreeTriangles = std::max<uint32_t>(BvhParallelTriangles, count / 1024);
+		USubdivide(&jobs, 0, 0, count, centroids, &subtrees);
+		jobs.ParallelFor(subtrees.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				USubdivide(NULL, subtrees[i].node, subtrees[i].first, subtrees[i].count, subtrees[i].centroids, NULL);
+			}
+		});
+
+		// Leaves refer to primitive order, rewrite the triangles in that order
+		std::vector<UBvhTriangle> sorted(count);
+		std::vector<uint32_t> sortedMeshes(count), sortedTriangles(count);
+		jobs.ParallelFor(count, std::max<size_t>(1, count / 1024), [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				uint32_t t = primitives[i].triangle;
+				sorted[i] = triangles[t];
+				sortedMeshes[i] = meshIds[t];
+				sortedTriangles[i] = triangleIds[t];
+			}
+		});
+		triangles.swap(sorted);
+		meshIds.swap(sortedMeshes);
+		triangleIds.swap(sortedTriangles);
+		std::vector<UPrimitive>().swap(primitives);
+
+		stats.triangles = count;
+		stats.nodes = nodeCount - 1;
+		stats.leaves = 0;
+		for (size_t n = 0; n < nodeCount; ++n) {
+			stats.leaves += nodes[n].count > 0;
+		}
+		stats.bytes = stats.nodes * sizeof(UBvhNode) + count * (sizeof(UBvhTriangle) + 2 * sizeof(uint32_t));
+		stats.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/*
+	 * @desc Nearest triangle along the ray closer than maxDistance, direction
+	 *       need not be normalized; distance is then in its lengths
+	 * @returns true and fills hit if something was hit
+	 */
+	bool Intersect(const float origin[3], const float direction[3], UBvhHit& hit, float maxDistance = FLT_MAX) const {
+		if (nodeCount == 0 || triangles.empty()) {
+			return false;
+		}
+		URay ray;
+		for (int c = 0; c < 3; ++c) {
+			ray.origin[c] = origin[c];
+			ray.inverse[c] = direction[c] != 0.0f ? 1.0f / direction[c] : std::copysign(FLT_MAX, direction[c]);
+		}
+#ifdef BVH_SSE
+		ray.origin4 = _mm_setr_ps(origin[0], origin[1], origin[2], 0.0f);
+		ray.inverse4 = _mm_setr_ps(ray.inverse[0], ray.inverse[1], ray.inverse[2], 0.0f);
+#endif
+
+		float nearest = maxDistance;
+		size_t best = triangles.size();
+		float bestU = 0.0f, bestV = 0.0f;
+		uint32_t stack[128];
+		int depth = 0;
+		uint32_t node = 0;
+		if (URayBox(nodes[0], ray, nearest) == FLT_MAX) {
+			return false;
+		}
+
+		while (true) {
+			const UBvhNode& current = nodes[node];
+			if (current.count > 0) {
+				for (uint32_t i = current.leftFirst; i < current.leftFirst + current.count; ++i) {
+					float t, u, v;
+					if (URayTriangle(triangles[i], origin, direction, t, u, v) && t < nearest) {
+						nearest = t;
+						best = i;
+						bestU = u;
+						bestV = v;
+					}
+				}
+			}
+			else {
+				// Nearer child next, the other waits on the stack
+				uint32_t left = current.leftFirst, right = left + 1;
+				float leftDistance = URayBox(nodes[left], ray, nearest);
+				float rightDistance = URayBox(nodes[right], ray, nearest);
+				if (leftDistance > rightDistance) {
+					std::swap(leftDistance, rightDistance);
+					std::swap(left, right);
+				}
+				if (leftDistance != FLT_MAX) {
+					if (rightDistance != FLT_MAX) {
+						stack[depth++] = right;
+					}
+					node = left;
+					continue;
+				}
+			}
+
+			// Pop, skipping boxes that start beyond the nearest hit so far
+			bool found = false;
+			while (depth > 0 && !found) {
+				node = stack[--depth];
+				found = URayBox(nodes[node], ray, nearest) != FLT_MAX;
+			}
+			if (!found) {
+				break;
+			}
+		}
+
+		if (best == triangles.size()) {
+			return false;
+		}
+		hit.distance = nearest;
+		hit.u = bestU;
+		hit.v = bestV;
+		hit.mesh = meshIds[best];
+		hit.triangle = triangleIds[best];
+		return true;
+	}
+
+	/*
+	 * @desc Tests every triangle, for checking the hierarchy
+	 * @returns true and fills hit if something was hit
+	 */
+	bool IntersectAll(const float origin[3], const float direction[3], UBvhHit& hit, float maxDistance = FLT_MAX) const {
+		float nearest = maxDistance;
+		size_t best = triangles.size();
+		for (size_t i = 0; i < triangles.size(); ++i) {
+			float t, u, v;
+			if (URayTriangle(triangles[i], origin, direction, t, u, v) && t < nearest) {
+				nearest = t;
+				best = i;
+				hit.u = u;
+				hit.v = v;
+			}
+		}
+		if (best == triangles.size()) {
+			return false;
+		}
+		hit.distance = nearest;
+		hit.mesh = meshIds[best];
+		hit.triangle = triangleIds[best];
+		return true;
+	}
+
+	const UBvhStats& Stats(void) const {
+		return stats;
+	}
+
+	void PrintStats(std::ostream& out) const {
+		out << "bvh: " << stats.triangles << " triangles, " << stats.nodes << " nodes, " << stats.leaves << " leaves averaging "
+			<< (stats.leaves > 0 ? (double)stats.triangles / stats.leaves : 0.0) << " triangles, "
+			<< stats.bytes / (1024 * 1024) << " MiB, built in " << stats.buildMilliseconds << " ms" << std::endl;
+	}
+
+	/*
+	 * @desc Drops every mesh and the hierarchy
+	 * @returns void
+	 */
+	void Clear(void) {
+		std::vector<UBvhTriangle>().swap(triangles);
+		std::vector<uint32_t>().swap(meshIds);
+		std::vector<uint32_t>().swap(triangleIds);
+		nodeMemory.reset();
+		nodes = NULL;
+		nodeCount = 0;
+		meshCount = 0;
+		stats = UBvhStats();
+	}
+
+private:
+
+	struct UBounds {
+		float min[3];
+		float max[3];
+	};
+
+	// Ray with its reciprocal direction, also in SSE registers when available
+	struct URay {
+		float origin[3];
+		float inverse[3];
+#ifdef BVH_SSE
+		__m128 origin4;
+		__m128 inverse4;
+#endif
+	};
+
+	struct UBin {
+		UBounds bounds;
+		uint32_t count;
+	};
+
+	// Triangle bounds the build sorts
+	struct UPrimitive {
+		UBounds bounds;
+		uint32_t triangle;
+	};
+
+	// Node left for a job, bounds already set
+	struct USubtree {
+		uint32_t node;
+		uint32_t first;
+		uint32_t count;
+		UBounds centroids;
+	};
+
+	std::vector<UBvhTriangle> triangles;
+	std::vector<uint32_t> meshIds, triangleIds;
+	std::unique_ptr<char[]> nodeMemory;
+	UBvhNode* nodes;
+	std::atomic<size_t> nodeCount;
+	size_t meshCount;
+	UBvhStats stats;
+
+	// Build only
+	std::vector<UPrimitive> primitives;
+	uint32_t subtreeTriangles;
+
+	static void UEmpty(UBounds& box) {
+		for (int c = 0; c < 3; ++c) {
+			box.min[c] = FLT_MAX;
+			box.max[c] = -FLT_MAX;
+		}
+	}
+
+	static void UGrow(UBounds& box, const UBounds& other) {
+		for (int c = 0; c < 3; ++c) {
+			box.min[c] = std::min(box.min[c], other.min[c]);
+			box.max[c] = std::max(box.max[c], other.max[c]);
+		}
+	}
+
+	static float UArea(const UBounds& box) {
+		float x = box.max[0] - box.min[0], y = box.max[1] - box.min[1], z = box.max[2] - box.min[2];
+		return x * y + y * z + z * x;
+	}
+
+	static void USetBounds(UBvhNode& node, const UBounds& box) {
+		for (int c = 0; c < 3; ++c) {
+			node.min[c] = box.min[c];
+			node.max[c] = box.max[c];
+		}
+	}
+
+	static float UCentroid(const UPrimitive& primitive, int axis) {
+		return 0.5f * (primitive.bounds.min[axis] + primitive.bounds.max[axis]);
+	}
+
+	/*
+	 * @desc Chunk size splitting count triangles into at most 256 jobs, or
+	 *       one chunk when serial or too small to be worth it
+	 */
+	static size_t UGrain(const UJobSystem* jobs, uint32_t count) {
+		return jobs != NULL && count > BvhParallelTriangles ? std::max<size_t>(4096, count / 256) : std::max<size_t>(1, count);
+	}
+
+	/*
+	 * @desc Runs body over [0, count) in grain chunks, on the job system when given
+	 * @returns void
+	 */
+	template <typename Body>
+	static void UForChunks(UJobSystem* jobs, size_t count, size_t grain, const Body& body) {
+		if (jobs != NULL) {
+			jobs->ParallelFor(count, grain, body);
+		}
+		else if (count > 0) {
+			body(0, count);
+		}
+	}
+
+	/*
+	 * @desc Bounds of a range of primitives and of their centroids
+	 * @returns void
+	 */
+	void UMeasure(UJobSystem* jobs, uint32_t first, uint32_t count, UBounds& box, UBounds& centroids) const {
+		UEmpty(box);
+		UEmpty(centroids);
+		size_t grain = UGrain(jobs, count);
+		size_t chunks = (count + grain - 1) / grain;
+		UBounds single[2];
+		std::vector<UBounds> several(chunks > 1 ? 2 * chunks : 0);
+		UBounds* partial = chunks > 1 ? several.data() : single;
+		UForChunks(jobs, count, grain, [&](size_t begin, size_t end) {
+			UBounds& local = partial[2 * (begin / grain)];
+			UBounds& localCentroids = partial[2 * (begin / grain) + 1];
+			UEmpty(local);
+			UEmpty(localCentroids);
+			for (size_t i = begin; i < end; ++i) {
+				const UPrimitive& primitive = primitives[first + i];
+				UGrow(local, primitive.bounds);
+				for (int c = 0; c < 3; ++c) {
+					float centre = UCentroid(primitive, c);
+					localCentroids.min[c] = std::min(localCentroids.min[c], centre);
+					localCentroids.max[c] = std::max(localCentroids.max[c], centre);
+				}
+			}
+		});
+		for (size_t p = 0; p < 2 * chunks; p += 2) {
+			UGrow(box, partial[p]);
+			UGrow(centroids, partial[p + 1]);
+		}
+	}
+
+	/*
+	 * @desc Splits node over primitives [first, first + count) at the cheapest bin
+	 *       boundary of any axis, or leaves it a leaf when no split pays.
+	 *       With jobs, nodes of up to subtreeTriangles go to subtrees instead
+	 * @returns void
+	 */
+	void USubdivide(UJobSystem* jobs, uint32_t node, uint32_t first, uint32_t count, const UBounds& centroids, std::vector<USubtree>* subtrees) {
+		UBvhNode& current = nodes[node];
+		current.leftFirst = first;
+		current.count = count;
+		if (count <= 1) {
+			return;
+		}
+		if (jobs != NULL && count <= subtreeTriangles) {
+			USubtree subtree = { node, first, count, centroids };
+			subtrees->push_back(subtree);
+			return;
+		}
+
+		// Bin the centroids on every axis, large nodes per chunk in parallel
+		float scale[3];
+		for (int c = 0; c < 3; ++c) {
+			float extent = centroids.max[c] - centroids.min[c];
+			scale[c] = extent > 0.0f ? BvhBins / extent : 0.0f;
+		}
+		size_t grain = UGrain(jobs, count);
+		size_t chunks = (count + grain - 1) / grain;
+		UBin single[3 * BvhBins];
+		std::vector<UBin> several(chunks > 1 ? chunks * 3 * BvhBins : 0);
+		UBin* partial = chunks > 1 ? several.data() : single;
+		UForChunks(jobs, count, grain, [&](size_t begin, size_t end) {
+			UBin* bins = &partial[begin / grain * 3 * BvhBins];
+			for (int b = 0; b < 3 * BvhBins; ++b) {
+				UEmpty(bins[b].bounds);
+				bins[b].count = 0;
+			}
+			for (size_t i = begin; i < end; ++i) {
+				const UPrimitive& primitive = primitives[first + i];
+				for (int c = 0; c < 3; ++c) {
+					UBin& bin = bins[c * BvhBins + UBinOf(primitive, c, centroids, scale)];
+					UGrow(bin.bounds, primitive.bounds);
+					++bin.count;
+				}
+			}
+		});
+		UBin bins[3 * BvhBins];
+		for (int b = 0; b < 3 * BvhBins; ++b) {
+			bins[b] = partial[b];
+			for (size_t chunk = 1; chunk < chunks; ++chunk) {
+				const UBin& other = partial[chunk * 3 * BvhBins + b];
+				UGrow(bins[b].bounds, other.bounds);
+				bins[b].count += other.count;
+			}
+		}
+
+		// Sweep the boundaries, costs relative to one triangle test in this node
+		float parentArea = std::max(UArea(UNodeBounds(current)), FLT_MIN);
+		float bestCost = FLT_MAX;
+		int bestAxis = -1, bestSplit = 0;
+		UBounds bestLeft, bestRight;
+		for (int c = 0; c < 3; ++c) {
+			if (scale[c] == 0.0f) {
+				continue;
+			}
+			UBounds leftBounds[BvhBins], rightBounds;
+			uint32_t leftCounts[BvhBins];
+			UBounds running;
+			UEmpty(running);
+			uint32_t runningCount = 0;
+			for (int b = 0; b < BvhBins - 1; ++b) {
+				UGrow(running, bins[c * BvhBins + b].bounds);
+				runningCount += bins[c * BvhBins + b].count;
+				leftBounds[b] = running;
+				leftCounts[b] = runningCount;
+			}
+			UEmpty(rightBounds);
+			uint32_t rightCount = 0;
+			for (int b = BvhBins - 1; b > 0; --b) {
+				UGrow(rightBounds, bins[c * BvhBins + b].bounds);
+				rightCount += bins[c * BvhBins + b].count;
+				uint32_t leftCount = leftCounts[b - 1];
+				if (leftCount == 0 || rightCount == 0) {
+					continue;
+				}
+				float cost = BvhTraversalCost + (UArea(leftBounds[b - 1]) * leftCount + UArea(rightBounds) * rightCount) / parentArea;
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = c;
+					bestSplit = b;
+					bestLeft = leftBounds[b - 1];
+					bestRight = rightBounds;
+				}
+			}
+		}
+
+		uint32_t leftCount;
+		UBounds childCentroids[2];
+		if (bestAxis < 0 || (bestCost >= (float)count && count <= BvhMaxLeafTriangles)) {
+			// Every centroid in one spot, halve the range if it is too big for a leaf
+			if (bestAxis >= 0 || count <= BvhMaxLeafTriangles) {
+				return;
+			}
+			leftCount = count / 2;
+			UMeasure(jobs, first, leftCount, bestLeft, childCentroids[0]);
+			UMeasure(jobs, first + leftCount, count - leftCount, bestRight, childCentroids[1]);
+		}
+		else {
+			UPrimitive* begin = &primitives[first];
+			UPrimitive* middle = std::partition(begin, begin + count, [&](const UPrimitive& primitive) {
+				return UBinOf(primitive, bestAxis, centroids, scale) < bestSplit;
+			});
+			leftCount = (uint32_t)(middle - begin);
+
+			// Children need their own centroid bounds before binning
+			UBounds box;
+			UMeasure(jobs, first, leftCount, box, childCentroids[0]);
+			UMeasure(jobs, first + leftCount, count - leftCount, box, childCentroids[1]);
+		}
+
+		uint32_t left = (uint32_t)nodeCount.fetch_add(2);
+		current.leftFirst = left;
+		current.count = 0;
+		USetBounds(nodes[left], bestLeft);
+		USetBounds(nodes[left + 1], bestRight);
+
+		USubdivide(jobs, left, first, leftCount, childCentroids[0], subtrees);
+		USubdivide(jobs, left + 1, first + leftCount, count - leftCount, childCentroids[1], subtrees);
+	}
+
+	static UBounds UNodeBounds(const UBvhNode& node) {
+		UBounds box;
+		for (int c = 0; c < 3; ++c) {
+			box.min[c] = node.min[c];
+			box.max[c] = node.max[c];
+		}
+		return box;
+	}
+
+	static int UBinOf(const UPrimitive& primitive, int axis, const UBounds& centroids, const float* scale) {
+		int bin = (int)((UCentroid(primitive, axis) - centroids.min[axis]) * scale[axis]);
+		return std::min(BvhBins - 1, std::max(0, bin));
+	}
+
+	/*
+	 * @desc Moller-Trumbore, hits from either side
+	 * @returns true with distance and barycentrics if the ray crosses the triangle ahead
+	 */
+	static bool URayTriangle(const UBvhTriangle& triangle, const float origin[3], const float direction[3], float& t, float& u, float& v) {
+		const float* e1 = triangle.e1;
+		const float* e2 = triangle.e2;
+		float p[3] = { direction[1] * e2[2] - direction[2] * e2[1], direction[2] * e2[0] - direction[0] * e2[2], direction[0] * e2[1] - direction[1] * e2[0] };
+		float determinant = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+		if (std::fabs(determinant) < 1e-12f) {
+			return false;
+		}
+		float inverse = 1.0f / determinant;
+		float s[3] = { origin[0] - triangle.v0[0], origin[1] - triangle.v0[1], origin[2] - triangle.v0[2] };
+		u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverse;
+		if (u < 0.0f || u > 1.0f) {
+			return false;
+		}
+		float q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+		v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * inverse;
+		if (v < 0.0f || u + v > 1.0f) {
+			return false;
+		}
+		t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inverse;
+		return t > 0.0f;
+	}
+
+#ifdef BVH_SSE
+	/*
+	 * @desc Slab test of the three axes in one go. The fourth lane holds the
+	 *       node's index fields and is left out of the reductions
+	 * @returns distance to the box, 0 from inside, FLT_MAX on a miss or
+	 *          beyond limit
+	 */
+	static float URayBox(const UBvhNode& node, const URay& ray, float limit) {
+		__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.min), ray.origin4), ray.inverse4);
+		__m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.max), ray.origin4), ray.inverse4);
+		__m128 entry = _mm_min_ps(t1, t2), exit = _mm_max_ps(t1, t2);
+		__m128 near = _mm_max_ss(_mm_max_ss(entry, _mm_shuffle_ps(entry, entry, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(entry, entry, _MM_SHUFFLE(2, 2, 2, 2)));
+		__m128 far = _mm_min_ss(_mm_min_ss(exit, _mm_shuffle_ps(exit, exit, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(exit, exit, _MM_SHUFFLE(2, 2, 2, 2)));
+		float enter = std::max(0.0f, _mm_cvtss_f32(near)), leave = _mm_cvtss_f32(far);
+		return enter <= leave && enter < limit ? enter : FLT_MAX;
+	}
+#else
+	// Scalar slab test, same results as the SSE one
+	static float URayBox(const UBvhNode& node, const URay& ray, float limit) {
+		float enter = 0.0f, leave = FLT_MAX;
+		for (int c = 0; c < 3; ++c) {
+			float t1 = (node.min[c] - ray.origin[c]) * ray.inverse[c], t2 = (node.max[c] - ray.origin[c]) * ray.inverse[c];
+			enter = std::max(enter, std::min(t1, t2));
+			leave = std::min(leave, std::max(t1, t2));
+		}
+		return enter <= leave && enter < limit ? enter : FLT_MAX;
+	}
+#endif
+};
+
+#endif // BVH_H
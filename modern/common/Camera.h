@@ -0,0 +1,323 @@
+/*
+ * @author Jacob William
+ * @desc Orbit and first person camera. The orientation is a yaw around y and
+ *       a pitch clamped short of straight up or down; an orbit camera sits
+ *       distance away from its target, a first person camera at its own
+ *       position. View and projection matrices and their inverses are built
+ *       in closed form from the camera basis, only when something changed
+ *       since the last read.
+ *
+ *       Matrices are column major with the layout of glm::mat4 and
+ *       glm::lookAt / glm::perspective, so they go straight to
+ *       glUniformMatrix4fv or glm::make_mat4.
+ */
+
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <algorithm>
+#include <cmath>
+
+enum UCameraMode { OrbitCamera, FirstPersonCamera };
+
+// Pitch limit, just under 90 degrees so the basis never degenerates
+const float CameraMaxPitch = 1.55f;
+
+class UCamera {
+public:
+
+	/*
+	 * @desc Orbit camera 10 units out along +x looking at the origin, 45
+	 *       degree field of view
+	 */
+	UCamera() : mode(OrbitCamera), yaw(0.0f), pitch(0.0f), distance(10.0f), minDistance(0.01f), maxDistance(1000.0f),
+			fovY(0.785398f), aspect(4.0f / 3.0f), nearPlane(0.1f), farPlane(100.0f), viewDirty(true), projectionDirty(true) {
+		target[0] = target[1] = target[2] = 0.0f;
+		position[0] = position[1] = position[2] = 0.0f;
+	}
+
+	/*
+	 * @desc Switches mode without moving the view: an orbit camera becomes
+	 *       first person at its eye, a first person camera orbits the point
+	 *       distance ahead of it
+	 * @returns void
+	 */
+	void SetMode(UCameraMode newMode) {
+		if (newMode == mode) {
+			return;
+		}
+		UUpdateView();
+		for (int c = 0; c < 3; ++c) {
+			if (newMode == FirstPersonCamera) {
+				position[c] = eye[c];
+			}
+			else {
+				target[c] = eye[c] + forward[c] * distance;
+			}
+		}
+		mode = newMode;
+		viewDirty = true;
+	}
+
+	UCameraMode Mode(void) const {
+		return mode;
+	}
+
+	void SetTarget(float x, float y, float z) {
+		target[0] = x;
+		target[1] = y;
+		target[2] = z;
+		viewDirty = true;
+	}
+
+	void SetPosition(float x, float y, float z) {
+		position[0] = x;
+		position[1] = y;
+		position[2] = z;
+		viewDirty = true;
+	}
+
+	/*
+	 * @desc Orbit distance, clamped to the zoom range
+	 * @returns void
+	 */
+	void SetDistance(float newDistance) {
+		distance = std::min(maxDistance, std::max(minDistance, newDistance));
+		viewDirty = true;
+	}
+
+	void SetZoomRange(float nearest, float farthest) {
+		minDistance = nearest;
+		maxDistance = farthest;
+		SetDistance(distance);
+	}
+
+	/*
+	 * @desc Sets yaw and pitch in radians, a positive pitch looks down,
+	 *       from above the target when orbiting
+	 * @returns void
+	 */
+	void SetAngles(float newYaw, float newPitch) {
+		yaw = newYaw;
+		pitch = std::min(CameraMaxPitch, std::max(-CameraMaxPitch, newPitch));
+		viewDirty = true;
+	}
+
+	void Rotate(float yawDelta, float pitchDelta) {
+		SetAngles(yaw + yawDelta, pitch + pitchDelta);
+	}
+
+	/*
+	 * @desc Scales the orbit distance; in first person moves along the
+	 *       view as far as the same zoom would have
+	 * @returns void
+	 */
+	void Zoom(float factor) {
+		if (mode == OrbitCamera) {
+			SetDistance(distance * factor);
+			return;
+		}
+		Move((1.0f - factor) * distance, 0.0f, 0.0f);
+	}
+
+	/*
+	 * @desc Moves along the view direction, its right and world up, the
+	 *       target in orbit mode and the position in first person
+	 * @returns void
+	 */
+	void Move(float ahead, float right, float up) {
+		UUpdateView();
+		float* point = mode == OrbitCamera ? target : position;
+		for (int c = 0; c < 3; ++c) {
+			point[c] += forward[c] * ahead + side[c] * right;
+		}
+		point[1] += up;
+		viewDirty = true;
+	}
+
+	/*
+	 * @desc Vertical field of view in radians, width over height and the
+	 *       depth range
+	 * @returns void
+	 */
+	void SetPerspective(float newFovY, float newAspect, float newNear, float newFar) {
+		fovY = newFovY;
+		aspect = newAspect;
+		nearPlane = newNear;
+		farPlane = newFar;
+		projectionDirty = true;
+	}
+
+	void SetAspect(float newAspect) {
+		aspect = newAspect;
+		projectionDirty = true;
+	}
+
+	/*
+	 * @desc Blends the pose of two cameras, for rendering between fixed
+	 *       simulation steps. Mode and projection come from to
+	 * @returns void
+	 */
+	void Blend(const UCamera& from, const UCamera& to, float alpha) {
+		*this = to;
+		yaw = from.yaw + (to.yaw - from.yaw) * alpha;
+		pitch = from.pitch + (to.pitch - from.pitch) * alpha;
+		distance = from.distance + (to.distance - from.distance) * alpha;
+		for (int c = 0; c < 3; ++c) {
+			target[c] = from.target[c] + (to.target[c] - from.target[c]) * alpha;
+			position[c] = from.position[c] + (to.position[c] - from.position[c]) * alpha;
+		}
+		viewDirty = true;
+	}
+
+	float Yaw(void) const {
+		return yaw;
+	}
+
+	float Pitch(void) const {
+		return pitch;
+	}
+
+	float Distance(void) const {
+		return distance;
+	}
+
+	const float* Eye(void) const {
+		UUpdateView();
+		return eye;
+	}
+
+	const float* Forward(void) const {
+		UUpdateView();
+		return forward;
+	}
+
+	const float* View(void) const {
+		UUpdateView();
+		return view;
+	}
+
+	// Camera to world, the basis in the columns and the eye as translation
+	const float* InverseView(void) const {
+		UUpdateView();
+		return inverseView;
+	}
+
+	const float* Projection(void) const {
+		UUpdateProjection();
+		return projection;
+	}
+
+	const float* InverseProjection(void) const {
+		UUpdateProjection();
+		return inverseProjection;
+	}
+
+	/*
+	 * @desc World space ray through the centre of pixel x, y of a window
+	 *       of width by height, y down from the top as GLUT reports it
+	 * @returns void, origin and the normalized direction
+	 */
+	void Ray(int x, int y, int width, int height, float origin[3], float direction[3]) const {
+		UUpdateView();
+		float tanHalf = std::tan(0.5f * fovY);
+		float right = (2.0f * (x + 0.5f) / width - 1.0f) * tanHalf * aspect;
+		float upward = (1.0f - 2.0f * (y + 0.5f) / height) * tanHalf;
+		float length = 0.0f;
+		for (int c = 0; c < 3; ++c) {
+			origin[c] = eye[c];
+			direction[c] = forward[c] + side[c] * right + up[c] * upward;
+			length += direction[c] * direction[c];
+		}
+		length = std::sqrt(length);
+		for (int c = 0; c < 3; ++c) {
+			direction[c] /= length;
+		}
+	}
+
+private:
+
+	UCameraMode mode;
+	float target[3], position[3];
+	float yaw, pitch, distance, minDistance, maxDistance;
+	float fovY, aspect, nearPlane, farPlane;
+
+	// Derived on demand
+	mutable bool viewDirty, projectionDirty;
+	mutable float eye[3], forward[3], side[3], up[3];
+	mutable float view[16], inverseView[16], projection[16], inverseProjection[16];
+
+	/*
+	 * @desc Basis, eye and both view matrices from yaw and pitch. Forward
+	 *       points from the eye into the scene, side to the right
+	 * @returns void
+	 */
+	void UUpdateView(void) const {
+		if (!viewDirty) {
+			return;
+		}
+		float cy = std::cos(yaw), sy = std::sin(yaw), cp = std::cos(pitch), sp = std::sin(pitch);
+		forward[0] = -cp * cy;
+		forward[1] = -sp;
+		forward[2] = -cp * sy;
+		side[0] = sy;
+		side[1] = 0.0f;
+		side[2] = -cy;
+
+		// side x forward
+		up[0] = -sp * cy;
+		up[1] = cp;
+		up[2] = -sp * sy;
+		for (int c = 0; c < 3; ++c) {
+			eye[c] = mode == OrbitCamera ? target[c] - forward[c] * distance : position[c];
+		}
+
+		// Rows side, up and -forward, the transpose of the inverse
+		for (int c = 0; c < 3; ++c) {
+			view[c * 4 + 0] = side[c];
+			view[c * 4 + 1] = up[c];
+			view[c * 4 + 2] = -forward[c];
+			view[c * 4 + 3] = 0.0f;
+			inverseView[0 + c] = side[c];
+			inverseView[4 + c] = up[c];
+			inverseView[8 + c] = -forward[c];
+			inverseView[12 + c] = eye[c];
+		}
+		view[12] = -(side[0] * eye[0] + side[1] * eye[1] + side[2] * eye[2]);
+		view[13] = -(up[0] * eye[0] + up[1] * eye[1] + up[2] * eye[2]);
+		view[14] = forward[0] * eye[0] + forward[1] * eye[1] + forward[2] * eye[2];
+		view[15] = 1.0f;
+		inverseView[3] = inverseView[7] = inverseView[11] = 0.0f;
+		inverseView[15] = 1.0f;
+		viewDirty = false;
+	}
+
+	/*
+	 * @desc Perspective matrix and its inverse, only five entries of each
+	 *       are not zero
+	 * @returns void
+	 */
+	void UUpdateProjection(void) const {
+		if (!projectionDirty) {
+			return;
+		}
+		float focal = 1.0f / std::tan(0.5f * fovY);
+		float a = (farPlane + nearPlane) / (nearPlane - farPlane);
+		float b = 2.0f * farPlane * nearPlane / (nearPlane - farPlane);
+		std::fill(projection, projection + 16, 0.0f);
+		std::fill(inverseProjection, inverseProjection + 16, 0.0f);
+		projection[0] = focal / aspect;
+		projection[5] = focal;
+		projection[10] = a;
+		projection[11] = -1.0f;
+		projection[14] = b;
+		inverseProjection[0] = aspect / focal;
+		inverseProjection[5] = 1.0f / focal;
+		inverseProjection[11] = 1.0f / b;
+		inverseProjection[14] = -1.0f;
+		inverseProjection[15] = a / b;
+		projectionDirty = false;
+	}
+};
+
+#endif // CAMERA_H
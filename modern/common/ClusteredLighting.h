@@ -0,0 +1,470 @@
+/*
+ * @author Jacob William
+ * @desc Clustered forward lighting for thousands of point lights. The view
+ *       frustum is cut into a grid of screen tiles and exponential depth
+ *       slices; every frame the CPU assigns each light to the clusters its
+ *       sphere can touch and uploads one light list per cluster. A fragment
+ *       then only loops over the lights of its own cluster, so its cost
+ *       follows the lights near it instead of the lights in the scene.
+ *
+ *       Lights are moved to view space four at a time with SSE and binned
+ *       one depth slice per job. The lists reach the shader through texture
+ *       buffers, so GL 3.3 is enough.
+ */
+
+#ifndef CLUSTERED_LIGHTING_H
+#define CLUSTERED_LIGHTING_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <vector>
+#include <GL/glew.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "JobSystem.h"
+
+// Cluster grid, screen tiles across and down and depth slices
+const int ClusterTilesX = 16;
+const int ClusterTilesY = 9;
+const int ClusterSlices = 24;
+const int ClusterTilesPerSlice = ClusterTilesX * ClusterTilesY;
+const int ClusterCount = ClusterTilesPerSlice * ClusterSlices;
+
+// Light indices are 16 bit on the GPU
+const size_t ClusterMaxLights = 65535;
+
+// Index list entries per frame, lights past this are dropped from their clusters
+const size_t ClusterMaxIndices = 1 << 22;
+
+// Lights per transform job
+const size_t ClusterLightGrain = 1024;
+
+struct UPointLight {
+	float position[3];	// world space
+	float radius;		// no light past this distance
+	float color[3];
+	float intensity;
+};
+
+struct UClusterStats {
+	size_t lights;
+	size_t visibleLights;
+	size_t indices;
+	size_t maxPerCluster;
+	size_t dropped;
+	double assignMilliseconds;
+};
+
+#ifndef GLSL_PART
+#define GLSL_PART(Source) #Source "\n"
+#endif
+
+/*
+ * Fragment shader part, goes after the #version line. UShadeClustered takes
+ * a view space position and normal and returns the Blinn-Phong sum of the
+ * lights in the fragment's cluster, both faces are lit
+ */
+const GLchar* ClusteredLightingShader = GLSL_PART(
+	uniform samplerBuffer uClusterLights;
+	uniform usamplerBuffer uClusterGrid;
+	uniform usamplerBuffer uClusterIndices;
+	uniform ivec3 uClusterSize;
+	uniform vec2 uClusterTileScale;
+	uniform float uClusterSliceScale;
+	uniform float uClusterSliceBias;
+	uniform int uClusterLightCount;
+	uniform bool uClusterBruteForce;
+
+	vec3 UShadeClustered(vec3 position, vec3 normal, vec3 albedo, float shininess) {
+		vec3 n = normalize(normal);
+		vec3 v = normalize(-position);
+		if (dot(n, v) < 0.0) {
+			n = -n;
+		}
+
+		int slice = clamp(int(log(-position.z) * uClusterSliceScale + uClusterSliceBias), 0, uClusterSize.z - 1);
+		ivec2 tile = min(ivec2(gl_FragCoord.xy * uClusterTileScale), uClusterSize.xy - 1);
+		int cluster = (slice * uClusterSize.y + tile.y) * uClusterSize.x + tile.x;
+		uvec2 range = uClusterBruteForce ? uvec2(0u, uint(uClusterLightCount)) : texelFetch(uClusterGrid, cluster).xy;
+
+		vec3 color = vec3(0.0);
+		for (uint i = 0u; i < range.y; ++i) {
+			int light = uClusterBruteForce ? int(i) : int(texelFetch(uClusterIndices, int(range.x + i)).x);
+			vec4 positionRadius = texelFetch(uClusterLights, light * 2);
+			vec3 toLight = positionRadius.xyz - position;
+			float distanceSquared = dot(toLight, toLight);
+			float radiusSquared = positionRadius.w * positionRadius.w;
+			if (distanceSquared >= radiusSquared) {
+				continue;
+			}
+			vec4 colorIntensity = texelFetch(uClusterLights, light * 2 + 1);
+			vec3 l = toLight * inversesqrt(distanceSquared);
+			vec3 h = normalize(l + v);
+
+			// Inverse square falloff windowed to reach zero at the radius
+			float window = 1.0 - distanceSquared / radiusSquared;
+			float attenuation = window * window / (1.0 + distanceSquared);
+			float diffuse = max(dot(n, l), 0.0);
+			float specular = diffuse > 0.0 ? pow(max(dot(n, h), 0.0), shininess) : 0.0;
+			color += colorIntensity.rgb * (colorIntensity.w * attenuation) * (albedo * diffuse + vec3(specular));
+		}
+		return color;
+	}
+);
+
+class UClusteredLights {
+public:
+
+	UClusteredLights() : lightBuffer(0), gridBuffer(0), indexBuffer(0), sliceScale(0.0f), sliceBias(0.0f) {
+		memset(textures, 0, sizeof(textures));
+		memset(&stats, 0, sizeof(stats));
+		grid.resize(ClusterCount * 2);
+		sliceIndices.resize(ClusterSlices);
+		sliceCounts.resize(ClusterCount);
+	}
+
+	/*
+	 * @desc Creates the buffers and their texture views
+	 * @returns void
+	 */
+	void Create(void) {
+		GLuint* buffers[3] = { &lightBuffer, &gridBuffer, &indexBuffer };
+		GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R16UI };
+		glGenTextures(3, textures);
+		for (int i = 0; i < 3; ++i) {
+			glGenBuffers(1, buffers[i]);
+			glBindBuffer(GL_TEXTURE_BUFFER, *buffers[i]);
+			glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+			glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+			glTexBuffer(GL_TEXTURE_BUFFER, formats[i], *buffers[i]);
+		}
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	void Destroy(void) {
+		glDeleteTextures(3, textures);
+		glDeleteBuffers(1, &lightBuffer);
+		glDeleteBuffers(1, &gridBuffer);
+		glDeleteBuffers(1, &indexBuffer);
+		memset(textures, 0, sizeof(textures));
+		lightBuffer = gridBuffer = indexBuffer = 0;
+	}
+
+	/*
+	 * @desc Builds the cluster light lists for one view on the CPU, no GL
+	 *       calls. view is the column-major world to view matrix of a
+	 *       symmetric perspective projection
+	 * @parameters job system, lights, view matrix, vertical field of view in
+	 *             radians, aspect ratio, near and far planes
+	 * @returns void
+	 */
+	void Assign(UJobSystem& jobs, const std::vector<UPointLight>& lights, const float* view, float fovY, float aspect, float nearPlane, float farPlane) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		size_t count = std::min(lights.size(), ClusterMaxLights);
+		gpuLights.resize(count * 8);
+		ranges.resize(count);
+
+		float tanY = tanf(fovY * 0.5f);
+		float tanX = tanY * aspect;
+		sliceScale = ClusterSlices / logf(farPlane / nearPlane);
+		sliceBias = -logf(nearPlane) * sliceScale;
+
+		jobs.ParallelFor(count, ClusterLightGrain, [&](size_t begin, size_t end) {
+			UTransformLights(lights.data(), view, begin, end);
+			for (size_t i = begin; i < end; ++i) {
+				UFindRange(i, tanX, tanY, nearPlane, farPlane);
+			}
+		});
+
+		jobs.ParallelFor(ClusterSlices, 1, [&](size_t begin, size_t end) {
+			for (size_t slice = begin; slice < end; ++slice) {
+				UBinSlice((int)slice);
+			}
+		});
+
+		// Slices are packed back to back into one index list
+		size_t total = 0;
+		for (int slice = 0; slice < ClusterSlices; ++slice) {
+			total += sliceIndices[slice].size();
+		}
+		indices.resize(std::min(total, ClusterMaxIndices));
+
+		stats.lights = count;
+		stats.visibleLights = 0;
+		stats.maxPerCluster = 0;
+		stats.dropped = 0;
+		for (size_t i = 0; i < count; ++i) {
+			stats.visibleLights += ranges[i].visible;
+		}
+
+		size_t base = 0;
+		for (int slice = 0; slice < ClusterSlices; ++slice) {
+			const std::vector<uint16_t>& list = sliceIndices[slice];
+			size_t kept = base < ClusterMaxIndices ? std::min(list.size(), ClusterMaxIndices - base) : 0;
+			if (kept > 0) {
+				memcpy(&indices[base], list.data(), kept * sizeof(uint16_t));
+			}
+			for (int tile = 0; tile < ClusterTilesPerSlice; ++tile) {
+				int cluster = slice * ClusterTilesPerSlice + tile;
+				size_t offset = base + grid[cluster * 2];
+				size_t lightCount = sliceCounts[cluster];
+				size_t fits = offset < ClusterMaxIndices ? std::min(lightCount, ClusterMaxIndices - offset) : 0;
+				grid[cluster * 2] = (uint32_t)std::min(offset, ClusterMaxIndices);
+				grid[cluster * 2 + 1] = (uint32_t)fits;
+				stats.maxPerCluster = std::max(stats.maxPerCluster, fits);
+				stats.dropped += lightCount - fits;
+			}
+			base += list.size();
+		}
+		stats.indices = indices.size();
+		stats.assignMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/*
+	 * @desc Orphans the three buffers and uploads the last Assign
+	 * @returns void
+	 */
+	void Upload(void) {
+		UUpload(lightBuffer, gpuLights.size() * sizeof(float), gpuLights.data());
+		UUpload(gridBuffer, grid.size() * sizeof(uint32_t), grid.data());
+		UUpload(indexBuffer, indices.size() * sizeof(uint16_t), indices.data());
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	/*
+	 * @desc Assign followed by Upload
+	 * @returns void
+	 */
+	void Update(UJobSystem& jobs, const std::vector<UPointLight>& lights, const float* view, float fovY, float aspect, float nearPlane, float farPlane) {
+		Assign(jobs, lights, view, fovY, aspect, nearPlane, farPlane);
+		Upload();
+	}
+
+	/*
+	 * @desc Binds the light textures to three units from firstUnit and sets
+	 *       the uniforms of ClusteredLightingShader, program must be in use.
+	 *       bruteForce makes every fragment loop over every light
+	 * @returns void
+	 */
+	void Bind(GLuint program, GLint firstUnit, int viewportWidth, int viewportHeight, bool bruteForce) const {
+		const char* samplers[3] = { "uClusterLights", "uClusterGrid", "uClusterIndices" };
+		for (int i = 0; i < 3; ++i) {
+			glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+			glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+			glUniform1i(glGetUniformLocation(program, samplers[i]), firstUnit + i);
+		}
+		glActiveTexture(GL_TEXTURE0);
+
+		glUniform3i(glGetUniformLocation(program, "uClusterSize"), ClusterTilesX, ClusterTilesY, ClusterSlices);
+		glUniform2f(glGetUniformLocation(program, "uClusterTileScale"), (float)ClusterTilesX / viewportWidth, (float)ClusterTilesY / viewportHeight);
+		glUniform1f(glGetUniformLocation(program, "uClusterSliceScale"), sliceScale);
+		glUniform1f(glGetUniformLocation(program, "uClusterSliceBias"), sliceBias);
+		glUniform1i(glGetUniformLocation(program, "uClusterLightCount"), (GLint)stats.lights);
+		glUniform1i(glGetUniformLocation(program, "uClusterBruteForce"), bruteForce);
+	}
+
+	UClusterStats Stats(void) const {
+		return stats;
+	}
+
+	/*
+	 * @desc Offset and count into Indices per cluster, slice major then rows
+	 */
+	const std::vector<uint32_t>& Grid(void) const {
+		return grid;
+	}
+
+	const std::vector<uint16_t>& Indices(void) const {
+		return indices;
+	}
+
+	/*
+	 * @desc One line: lights, visible, list entries, densest cluster and time
+	 * @returns void
+	 */
+	void PrintStats(std::ostream& out) const {
+		out << "clusters: " << stats.lights << " lights, " << stats.visibleLights << " visible, " << stats.indices
+			<< " list entries, at most " << stats.maxPerCluster << " per cluster";
+		if (stats.dropped > 0) {
+			out << ", " << stats.dropped << " dropped";
+		}
+		out << ", assigned in " << stats.assignMilliseconds << " ms" << std::endl;
+	}
+
+private:
+
+	// Clusters a light covers, inclusive, only meaningful when visible
+	struct ULightRange {
+		uint8_t x0, x1, y0, y1, z0, z1;
+		bool visible;
+	};
+
+	/*
+	 * @desc Writes view space position, radius, color and intensity of the
+	 *       given lights into gpuLights
+	 * @returns void
+	 */
+	void UTransformLights(const UPointLight* lights, const float* m, size_t begin, size_t end) {
+		size_t i = begin;
+#ifdef __SSE__
+		__m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+		__m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+		__m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+		__m128 m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m14 = _mm_set1_ps(m[14]);
+		for (; i + 4 <= end; i += 4) {
+			// Position and radius of four lights, turned into x, y, z and r rows
+			__m128 x = _mm_loadu_ps(lights[i].position);
+			__m128 y = _mm_loadu_ps(lights[i + 1].position);
+			__m128 z = _mm_loadu_ps(lights[i + 2].position);
+			__m128 r = _mm_loadu_ps(lights[i + 3].position);
+			_MM_TRANSPOSE4_PS(x, y, z, r);
+
+			__m128 vx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m4, y)), _mm_add_ps(_mm_mul_ps(m8, z), m12));
+			__m128 vy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, x), _mm_mul_ps(m5, y)), _mm_add_ps(_mm_mul_ps(m9, z), m13));
+			__m128 vz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, x), _mm_mul_ps(m6, y)), _mm_add_ps(_mm_mul_ps(m10, z), m14));
+			_MM_TRANSPOSE4_PS(vx, vy, vz, r);
+
+			float* out = &gpuLights[i * 8];
+			_mm_storeu_ps(out, vx);
+			_mm_storeu_ps(out + 4, _mm_loadu_ps(lights[i].color));
+			_mm_storeu_ps(out + 8, vy);
+			_mm_storeu_ps(out + 12, _mm_loadu_ps(lights[i + 1].color));
+			_mm_storeu_ps(out + 16, vz);
+			_mm_storeu_ps(out + 20, _mm_loadu_ps(lights[i + 2].color));
+			_mm_storeu_ps(out + 24, r);
+			_mm_storeu_ps(out + 28, _mm_loadu_ps(lights[i + 3].color));
+		}
+#endif
+		for (; i < end; ++i) {
+			const float* p = lights[i].position;
+			float* out = &gpuLights[i * 8];
+			out[0] = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+			out[1] = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+			out[2] = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+			out[3] = lights[i].radius;
+			memcpy(out + 4, lights[i].color, 4 * sizeof(float));
+		}
+	}
+
+	/*
+	 * @desc Screen tiles and depth slices the light's bounding box can reach.
+	 *       The smallest and largest x / depth over the box decide the
+	 *       horizontal extent, likewise for y
+	 * @returns void
+	 */
+	void UFindRange(size_t light, float tanX, float tanY, float nearPlane, float farPlane) {
+		const float* p = &gpuLights[light * 8];
+		ULightRange& range = ranges[light];
+		range.visible = false;
+
+		float radius = p[3];
+		float depth = -p[2];
+		float depth0 = std::max(depth - radius, nearPlane);
+		float depth1 = std::min(depth + radius, farPlane);
+		if (depth0 > depth1) {
+			return;
+		}
+
+		float left = p[0] - radius, right = p[0] + radius;
+		float bottom = p[1] - radius, top = p[1] + radius;
+		float xMin = left / (left < 0.0f ? depth0 : depth1) / tanX;
+		float xMax = right / (right > 0.0f ? depth0 : depth1) / tanX;
+		float yMin = bottom / (bottom < 0.0f ? depth0 : depth1) / tanY;
+		float yMax = top / (top > 0.0f ? depth0 : depth1) / tanY;
+		if (xMin > 1.0f || xMax < -1.0f || yMin > 1.0f || yMax < -1.0f) {
+			return;
+		}
+
+		range.x0 = (uint8_t)UTile(xMin, ClusterTilesX);
+		range.x1 = (uint8_t)UTile(xMax, ClusterTilesX);
+		range.y0 = (uint8_t)UTile(yMin, ClusterTilesY);
+		range.y1 = (uint8_t)UTile(yMax, ClusterTilesY);
+		range.z0 = (uint8_t)USlice(depth0);
+		range.z1 = (uint8_t)USlice(depth1);
+		range.visible = true;
+	}
+
+	static int UTile(float ndc, int tiles) {
+		return std::min(std::max((int)((ndc * 0.5f + 0.5f) * tiles), 0), tiles - 1);
+	}
+
+	int USlice(float depth) const {
+		return std::min(std::max((int)(logf(depth) * sliceScale + sliceBias), 0), ClusterSlices - 1);
+	}
+
+	/*
+	 * @desc Counts the lights of every cluster in one slice, then writes
+	 *       their indices; grid offsets are left relative to the slice
+	 * @returns void
+	 */
+	void UBinSlice(int slice) {
+		uint32_t* counts = &sliceCounts[slice * ClusterTilesPerSlice];
+		uint32_t* offsets = &grid[slice * ClusterTilesPerSlice * 2];
+		std::fill(counts, counts + ClusterTilesPerSlice, 0);
+
+		for (size_t i = 0; i < ranges.size(); ++i) {
+			const ULightRange& range = ranges[i];
+			if (!range.visible || slice < range.z0 || slice > range.z1) {
+				continue;
+			}
+			for (int y = range.y0; y <= range.y1; ++y) {
+				for (int x = range.x0; x <= range.x1; ++x) {
+					++counts[y * ClusterTilesX + x];
+				}
+			}
+		}
+
+		uint32_t total = 0;
+		for (int tile = 0; tile < ClusterTilesPerSlice; ++tile) {
+			offsets[tile * 2] = total;
+			offsets[tile * 2 + 1] = total;
+			total += counts[tile];
+		}
+
+		// The count slot doubles as the write cursor until Assign packs the slices
+		std::vector<uint16_t>& list = sliceIndices[slice];
+		list.resize(total);
+		for (size_t i = 0; i < ranges.size(); ++i) {
+			const ULightRange& range = ranges[i];
+			if (!range.visible || slice < range.z0 || slice > range.z1) {
+				continue;
+			}
+			for (int y = range.y0; y <= range.y1; ++y) {
+				for (int x = range.x0; x <= range.x1; ++x) {
+					list[offsets[(y * ClusterTilesX + x) * 2 + 1]++] = (uint16_t)i;
+				}
+			}
+		}
+	}
+
+	static void UUpload(GLuint buffer, size_t size, const void* data) {
+		glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+		glBufferData(GL_TEXTURE_BUFFER, std::max(size, (size_t)16), NULL, GL_STREAM_DRAW);
+		if (size > 0) {
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+		}
+	}
+
+	GLuint lightBuffer, gridBuffer, indexBuffer;
+	GLuint textures[3];
+	float sliceScale, sliceBias;
+	UClusterStats stats;
+
+	std::vector<float> gpuLights;				// view space position, radius, color, intensity
+	std::vector<ULightRange> ranges;
+	std::vector<uint32_t> grid;					// offset and count per cluster
+	std::vector<uint32_t> sliceCounts;			// lights per cluster
+	std::vector<std::vector<uint16_t> > sliceIndices;
+	std::vector<uint16_t> indices;
+};
+
+#endif // CLUSTERED_LIGHTING_H
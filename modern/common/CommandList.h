@@ -0,0 +1,265 @@
+/*
+ * @author Jacob William
+ * @desc Deferred GL command lists. Any thread may record binds, uniforms and
+ *       draws into its own list, the lists are linear byte buffers that keep
+ *       their memory between frames. The GL thread then replays every list
+ *       in order in a single loop, so the driver still sees one stream.
+ */
+
+#ifndef COMMAND_LIST_H
+#define COMMAND_LIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <GL/glew.h>
+
+// Command identifiers, stored in front of every command's payload
+enum UCommandType {
+	UCommandBindProgram,
+	UCommandBindVertexArray,
+	UCommandBindTexture,
+	UCommandUniform1i,
+	UCommandUniform1f,
+	UCommandUniform4f,
+	UCommandUniformMatrix4,
+	UCommandDrawArrays,
+	UCommandDrawArraysInstanced
+};
+
+// Every command starts with this header, size includes the header
+struct UCommandHeader {
+	uint16_t type;
+	uint16_t size;
+};
+
+struct UCmdBindProgram { UCommandHeader header; GLuint program; };
+struct UCmdBindVertexArray { UCommandHeader header; GLuint vertexArray; };
+struct UCmdBindTexture { UCommandHeader header; GLenum unit; GLenum target; GLuint texture; };
+struct UCmdUniform1i { UCommandHeader header; GLint location; GLint value; };
+struct UCmdUniform1f { UCommandHeader header; GLint location; GLfloat value; };
+struct UCmdUniform4f { UCommandHeader header; GLint location; GLfloat value[4]; };
+struct UCmdUniformMatrix4 { UCommandHeader header; GLint location; GLfloat value[16]; };
+struct UCmdDrawArrays { UCommandHeader header; GLenum mode; GLint first; GLsizei count; };
+struct UCmdDrawArraysInstanced { UCommandHeader header; GLenum mode; GLint first; GLsizei count; GLsizei instances; GLuint baseInstance; };
+
+class UCommandList {
+public:
+
+	UCommandList() : used(0), commands(0) {
+	}
+
+	/*
+	 * @desc Forgets the recorded commands but keeps the memory
+	 * @returns void
+	 */
+	void Reset(void) {
+		used = 0;
+		commands = 0;
+	}
+
+	size_t Size(void) const {
+		return used;
+	}
+
+	size_t CommandCount(void) const {
+		return commands;
+	}
+
+	const unsigned char* Data(void) const {
+		return bytes.data();
+	}
+
+	void BindProgram(GLuint program) {
+		UCmdBindProgram* command = UAppend<UCmdBindProgram>(UCommandBindProgram);
+		command->program = program;
+	}
+
+	void BindVertexArray(GLuint vertexArray) {
+		UCmdBindVertexArray* command = UAppend<UCmdBindVertexArray>(UCommandBindVertexArray);
+		command->vertexArray = vertexArray;
+	}
+
+	void BindTexture(GLenum unit, GLenum target, GLuint texture) {
+		UCmdBindTexture* command = UAppend<UCmdBindTexture>(UCommandBindTexture);
+		command->unit = unit;
+		command->target = target;
+		command->texture = texture;
+	}
+
+	void Uniform1i(GLint location, GLint value) {
+		UCmdUniform1i* command = UAppend<UCmdUniform1i>(UCommandUniform1i);
+		command->location = location;
+		command->value = value;
+	}
+
+	void Uniform1f(GLint location, GLfloat value) {
+		UCmdUniform1f* command = UAppend<UCmdUniform1f>(UCommandUniform1f);
+		command->location = location;
+		command->value = value;
+	}
+
+	void Uniform4f(GLint location, const GLfloat value[4]) {
+		UCmdUniform4f* command = UAppend<UCmdUniform4f>(UCommandUniform4f);
+		command->location = location;
+		memcpy(command->value, value, sizeof(command->value));
+	}
+
+	void UniformMatrix4(GLint location, const GLfloat value[16]) {
+		UCmdUniformMatrix4* command = UAppend<UCmdUniformMatrix4>(UCommandUniformMatrix4);
+		command->location = location;
+		memcpy(command->value, value, sizeof(command->value));
+	}
+
+	void DrawArrays(GLenum mode, GLint first, GLsizei count) {
+		UCmdDrawArrays* command = UAppend<UCmdDrawArrays>(UCommandDrawArrays);
+		command->mode = mode;
+		command->first = first;
+		command->count = count;
+	}
+
+	void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances, GLuint baseInstance) {
+		UCmdDrawArraysInstanced* command = UAppend<UCmdDrawArraysInstanced>(UCommandDrawArraysInstanced);
+		command->mode = mode;
+		command->first = first;
+		command->count = count;
+		command->instances = instances;
+		command->baseInstance = baseInstance;
+	}
+
+private:
+
+	std::vector<unsigned char> bytes;
+	size_t used;
+	size_t commands;
+
+	/*
+	 * @desc Bumps the write position by one command, the buffer only grows
+	 *       while warming up and is reused after that
+	 * @returns pointer to the command with its header filled in
+	 */
+	template <typename Command>
+	Command* UAppend(UCommandType type) {
+		// Keeps every command 4 byte aligned
+		size_t size = (sizeof(Command) + 3) & ~(size_t)3;
+		if (used + size > bytes.size()) {
+			bytes.resize(bytes.size() * 2 > used + size ? bytes.size() * 2 : used + size + 4096);
+		}
+
+		Command* command = (Command*)&bytes[used];
+		command->header.type = (uint16_t)type;
+		command->header.size = (uint16_t)size;
+		used += size;
+		++commands;
+		return command;
+	}
+};
+
+/*
+ * Sends replayed commands to the current GL context
+ */
+struct UGLDispatch {
+	void BindProgram(GLuint program) { glUseProgram(program); }
+	void BindVertexArray(GLuint vertexArray) { glBindVertexArray(vertexArray); }
+	void BindTexture(GLenum unit, GLenum target, GLuint texture) { glActiveTexture(unit); glBindTexture(target, texture); }
+	void Uniform1i(GLint location, GLint value) { glUniform1i(location, value); }
+	void Uniform1f(GLint location, GLfloat value) { glUniform1f(location, value); }
+	void Uniform4f(GLint location, const GLfloat* value) { glUniform4fv(location, 1, value); }
+	void UniformMatrix4(GLint location, const GLfloat* value) { glUniformMatrix4fv(location, 1, GL_FALSE, value); }
+	void DrawArrays(GLenum mode, GLint first, GLsizei count) { glDrawArrays(mode, first, count); }
+	void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances, GLuint baseInstance) {
+		glDrawArraysInstancedBaseInstance(mode, first, count, instances, baseInstance);
+	}
+};
+
+/*
+ * @desc Replays lists in order through dispatch, GL by default; redundant
+ *       program and vertex array binds across list boundaries are skipped
+ * @parameters lists, list count, dispatcher
+ * @returns number of commands replayed
+ */
+template <typename Dispatch>
+size_t UReplayCommands(const UCommandList* lists, size_t listCount, Dispatch& dispatch) {
+	size_t replayed = 0;
+	GLuint currentProgram = 0, currentVertexArray = 0;
+
+	for (size_t l = 0; l < listCount; ++l) {
+		const unsigned char* cursor = lists[l].Data();
+		const unsigned char* end = cursor + lists[l].Size();
+
+		while (cursor < end) {
+			const UCommandHeader* header = (const UCommandHeader*)cursor;
+
+			switch (header->type) {
+			case UCommandBindProgram: {
+				const UCmdBindProgram* command = (const UCmdBindProgram*)cursor;
+				if (command->program != currentProgram) {
+					dispatch.BindProgram(command->program);
+					currentProgram = command->program;
+				}
+				break;
+			}
+			case UCommandBindVertexArray: {
+				const UCmdBindVertexArray* command = (const UCmdBindVertexArray*)cursor;
+				if (command->vertexArray != currentVertexArray) {
+					dispatch.BindVertexArray(command->vertexArray);
+					currentVertexArray = command->vertexArray;
+				}
+				break;
+			}
+			case UCommandBindTexture: {
+				const UCmdBindTexture* command = (const UCmdBindTexture*)cursor;
+				dispatch.BindTexture(command->unit, command->target, command->texture);
+				break;
+			}
+			case UCommandUniform1i: {
+				const UCmdUniform1i* command = (const UCmdUniform1i*)cursor;
+				dispatch.Uniform1i(command->location, command->value);
+				break;
+			}
+			case UCommandUniform1f: {
+				const UCmdUniform1f* command = (const UCmdUniform1f*)cursor;
+				dispatch.Uniform1f(command->location, command->value);
+				break;
+			}
+			case UCommandUniform4f: {
+				const UCmdUniform4f* command = (const UCmdUniform4f*)cursor;
+				dispatch.Uniform4f(command->location, command->value);
+				break;
+			}
+			case UCommandUniformMatrix4: {
+				const UCmdUniformMatrix4* command = (const UCmdUniformMatrix4*)cursor;
+				dispatch.UniformMatrix4(command->location, command->value);
+				break;
+			}
+			case UCommandDrawArrays: {
+				const UCmdDrawArrays* command = (const UCmdDrawArrays*)cursor;
+				dispatch.DrawArrays(command->mode, command->first, command->count);
+				break;
+			}
+			case UCommandDrawArraysInstanced: {
+				const UCmdDrawArraysInstanced* command = (const UCmdDrawArraysInstanced*)cursor;
+				dispatch.DrawArraysInstanced(command->mode, command->first, command->count,
+						command->instances, command->baseInstance);
+				break;
+			}
+			}
+
+			cursor += header->size;
+			++replayed;
+		}
+	}
+	return replayed;
+}
+
+/*
+ * @desc Replays lists in order on the current GL context
+ * @returns number of commands replayed
+ */
+inline size_t UReplayCommands(const UCommandList* lists, size_t listCount) {
+	UGLDispatch dispatch;
+	return UReplayCommands(lists, listCount, dispatch);
+}
+
+#endif // COMMAND_LIST_H
@@ -0,0 +1,331 @@
+/*
+ * @author Jacob William
+ * @desc Vertex data of the single mesh demos, shared with the software
+ *       rasterizer so both backends draw exactly the same triangles
+ */
+
+#ifndef DEMO_MESHES_H
+#define DEMO_MESHES_H
+
+#include <cmath>
+#include <vector>
+#include <GL/glew.h>
+
+// Every demo mesh is a plain triangle list of this many vertices
+const GLsizei DemoMeshVertexCount = 36;
+
+// Two triangles of InvertedTriangles sharing one vertex, clip space xy and rgba
+const GLfloat InvertedTrianglesVertices[] = {
+		// First triangle
+		-1.0f, 1.0f,
+		1.0f, 0.0f, 0.0f, 1.0f,
+
+		// Shared Index
+		-0.5f, 0.0f,
+		0.0f, 1.0f, 0.0f, 1.0f,
+
+		-1.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 1.0f,
+
+		// Second triangle
+		0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 1.0f,
+		0.0f, -1.0f,
+		0.0f, 0.0f, 1.0f, 1.0f
+};
+
+const GLushort InvertedTrianglesIndices[] = { 0, 1, 2, 3, 4, 1 };
+
+// Colored cube of RotationZoomPane3DCube, position and color per vertex
+const GLfloat ColorCubeVertices[] = {
+            -0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f,  // Top Right Vertex 0
+             0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f,  // Bottom Right Vertex 1
+             0.5f,  0.5f, -0.5f, 1.0f, 0.0f, 0.0f,    // Bottom Left Vertex 2
+             0.5f,  0.5f, -0.5f, 1.0f, 0.0f, 0.0f,    // Top Left Vertex 3
+            -0.5f,  0.5f, -0.5f, 1.0f, 0.0f, 0.0f,
+            -0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f,
+
+
+            -0.5f, -0.5f,  0.5f, 0.0f, 1.0f, 0.0f,   // Top Right Vertex 0
+             0.5f, -0.5f,  0.5f, 0.0f, 1.0f, 0.0f,  // Bottom Right Vertex 1
+             0.5f,  0.5f,  0.5f, 0.0f, 1.0f, 0.0f,    // Bottom Left Vertex 2
+             0.5f,  0.5f,  0.5f, 0.0f, 1.0f, 0.0f,     // Top Left Vertex 3
+            -0.5f,  0.5f,  0.5f, 0.0f, 1.0f, 0.0f,
+            -0.5f, -0.5f,  0.5f, 0.0f, 1.0f, 0.0f,
+
+
+            -0.5f,  0.5f,  0.5f, 0.0f, 0.0f, 1.0f,   // Top Right Vertex 0
+            -0.5f,  0.5f, -0.5f, 0.0f, 0.0f, 1.0f,  // Bottom Right Vertex 1
+            -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, 1.0f,    // Bottom Left Vertex 2
+            -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, 1.0f,    // Top Left Vertex 3
+            -0.5f, -0.5f,  0.5f, 0.0f, 0.0f, 1.0f,
+            -0.5f,  0.5f,  0.5f, 0.0f, 0.0f, 1.0f,
+
+
+             0.5f,  0.5f,  0.5f, 1.0f, 1.0f, 0.0f,   // Top Right Vertex 0
+             0.5f,  0.5f, -0.5f, 1.0f, 1.0f, 0.0f,  // Bottom Right Vertex 1
+             0.5f, -0.5f, -0.5f, 1.0f, 1.0f, 0.0f,    // Bottom Left Vertex 2
+             0.5f, -0.5f, -0.5f, 1.0f, 1.0f, 0.0f,     // Top Left Vertex 3
+             0.5f, -0.5f,  0.5f, 1.0f, 0.0f, 0.0f,
+             0.5f,  0.5f,  0.5f, 1.0f, 1.0f, 0.0f,
+
+
+            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, 1.0f,  // Top Right Vertex 0
+             0.5f, -0.5f, -0.5f, 0.0f, 1.0f, 1.0f,  // Bottom Right Vertex 1
+             0.5f, -0.5f,  0.5f, 0.0f, 1.0f, 1.0f,   // Bottom Left Vertex 2
+             0.5f, -0.5f,  0.5f, 0.0f, 1.0f, 1.0f,     // Top Left Vertex 3
+            -0.5f, -0.5f,  0.5f, 0.0f, 1.0f, 1.0f,
+            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f, 1.0f,
+
+            -0.5f,  0.5f, -0.5f, 1.0f, 0.0f, 1.0f,   // Top Right Vertex 0
+             0.5f,  0.5f, -0.5f, 1.0f, 0.0f, 1.0f,  // Bottom Right Vertex 1
+             0.5f,  0.5f,  0.5f, 1.0f, 0.0f, 1.0f,    // Bottom Left Vertex 2
+             0.5f,  0.5f,  0.5f, 1.0f, 0.0f, 1.0f,     // Top Left Vertex 3
+            -0.5f,  0.5f,  0.5f, 1.0f, 0.0f, 1.0f,
+            -0.5f,  0.5f, -0.5f, 1.0f, 0.0f, 1.0f,
+};
+
+// Textured cube of Textured3DCube, position and texture coordinate per vertex
+const GLfloat TexturedCubeVertices[] = {
+            -0.5f, -0.5f, -0.5f, 0.0f, 0.0f,  // Top Right Vertex 0
+             0.5f, -0.5f, -0.5f, 1.0f, 0.0f,  // Bottom Right Vertex 1
+             0.5f,  0.5f, -0.5f, 1.0f, 1.0f,    // Bottom Left Vertex 2
+             0.5f,  0.5f, -0.5f, 1.0f, 1.0f,    // Top Left Vertex 3
+            -0.5f,  0.5f, -0.5f, 0.0f, 1.0f,
+            -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+
+
+            -0.5f, -0.5f,  0.5f, 0.0f,  0.0f,   // Top Right Vertex 0
+             0.5f, -0.5f,  0.5f, 1.0f, 0.0f,  // Bottom Right Vertex 1
+             0.5f,  0.5f,  0.5f, 1.0f, 1.0f,    // Bottom Left Vertex 2
+             0.5f,  0.5f,  0.5f, 1.0f, 1.0f,     // Top Left Vertex 3
+            -0.5f,  0.5f,  0.5f, 0.0f, 1.0f,
+            -0.5f, -0.5f,  0.5f, 0.0f, 0.0f,
+
+
+            -0.5f,  0.5f,  0.5f, 1.0f, 0.0f,   // Top Right Vertex 0
+            -0.5f,  0.5f, -0.5f, 1.0f, 1.0f,  // Bottom Right Vertex 1
+            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,    // Bottom Left Vertex 2
+            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,    // Top Left Vertex 3
+            -0.5f, -0.5f,  0.5f, 0.0f, 0.0f,
+            -0.5f,  0.5f,  0.5f, 1.0f, 0.0f,
+
+
+             0.5f,  0.5f,  0.5f, 1.0f,  0.0f,   // Top Right Vertex 0
+             0.5f,  0.5f, -0.5f, 1.0f, 1.0f,  // Bottom Right Vertex 1
+             0.5f, -0.5f, -0.5f, 0.0f, 1.0f,    // Bottom Left Vertex 2
+             0.5f, -0.5f, -0.5f, 0.0f, 1.0f,     // Top Left Vertex 3
+             0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+             0.5f,  0.5f,  0.5f, 0.0f, 1.0f,
+
+
+            -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,  // Top Right Vertex 0
+             0.5f, -0.5f, -0.5f, 1.0f, 1.0f,  // Bottom Right Vertex 1
+             0.5f, -0.5f,  0.5f,  1.0f, 0.0f,   // Bottom Left Vertex 2
+             0.5f, -0.5f,  0.5f,  1.0f, 0.0f,     // Top Left Vertex 3
+            -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+            -0.5f, -0.5f, -0.5f, 0.0f,  1.0f,
+
+            -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,   // Top Right Vertex 0
+             0.5f,  0.5f, -0.5f, 1.0f, 1.0f,  // Bottom Right Vertex 1
+             0.5f,  0.5f,  0.5f, 1.0f, 0.0f,    // Bottom Left Vertex 2
+             0.5f,  0.5f,  0.5f, 1.0f, 0.0f,    // Top Left Vertex 3
+            -0.5f,  0.5f,  0.5f, 0.0f, 0.0f,
+            -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+};
+
+// Chair of FlatChair, position and color per vertex
+const GLfloat ChairVertices[] = {
+			// Stand
+
+			// A
+			-0.5f, 0.0f, 0.0f,
+			1.0f, 0.5f, 0.5f,
+
+			// B
+			0.5f, 0.0f, 0.0f,
+			1.0f, 0.5f, 0.5f,
+
+			// F
+			-0.5f, 0.0f, 1.0f,
+			1.0f, 0.5f, 0.5f,
+
+
+			// F
+			-0.5f, 0.0f, 1.0f,
+			1.0f, 0.5f, 0.5f,
+			// B
+			0.5f, 0.0f, 0.0f,
+			1.0f, 0.5f, 0.5f,
+			// E
+			0.5f, 0.0f, 1.0f,
+			1.0f, 0.5f, 0.5f,
+
+
+			// SEATTTTTT
+			// A
+			-0.5f, 0.0f, 0.0f,
+			1.0f, 0.2f, 1.0f,
+
+			// C
+			-0.5f, -1.0f, 0.0f,
+			1.0f, 0.2f, 1.0f,
+
+			// B
+			0.5f, 0.0f, 0.0f,
+			1.0f, 0.2f, 1.0f,
+
+			// C
+			-0.5f, -1.0f, 0.0f,
+			1.0f, 0.2f, 1.0f,
+
+			// B
+			0.5f, 0.0f, 0.0f,
+			1.0f, 0.2f, 1.0f,
+
+			// D
+			0.5f, -1.0f, 0.0f,
+			1.0f, 0.2f, 1.0f,
+
+
+			/*
+			 * LEGS
+			 */
+
+			// RIGHT BACK LEG
+			// A
+			-0.5f, 0.0f, 0.0f,
+			0.0f, 0.2f, 1.0f,
+
+			// G
+			-0.3f, 0.0f, 0.0f,
+			0.0f, 0.2f, 1.0f,
+
+			// X
+			-0.5f, 0.0f, -1.0f,
+			0.0f, 0.2f, 1.0f,
+
+			// X
+			-0.5f, 0.0f, -1.0f,
+			0.0f, 0.2f, 1.0f,
+
+			// G
+			-0.3f, 0.0f, 0.0f,
+			0.0f, 0.2f, 1.0f,
+
+			// Z
+			-0.3f, 0.0f, -1.0f,
+			0.0f, 0.2f, 1.0f,
+
+			// LEFT BACK LEG
+			// B
+			0.5f, 0.0f, 0.0f,
+			1.0f, 0.2f, 1.0f,
+
+			// H
+			0.3f, 0.0f, 0.0f,
+			1.0f, 0.2f, 1.0f,
+
+			// U
+			0.5f, 0.0f, -1.0f,
+			1.0f, 0.2f, 1.0f,
+
+			// H
+			0.3f, 0.0f, 0.0f,
+			1.0f, 0.2f, 1.0f,
+
+			// U
+			0.5f, 0.0f, -1.0f,
+			1.0f, 0.2f, 1.0f,
+
+			// Y
+			0.3f, 0.0f, -1.0f,
+			1.0f, 0.2f, 1.0f,
+
+
+			// Right front Leg
+			// C
+			-0.5f, -1.0f, 0.0f,
+			1.0f, 0.2f, 1.0f,
+
+			// N
+			-0.5f, -1.0f, -1.0f,
+			1.0f, 0.2f, 1.0f,
+
+			// K
+			-0.3f, -1.0f, 0.0f,
+			1.0f, 0.2f, 1.0f,
+
+			// K
+			-0.3f, -1.0f, 0.0f,
+			1.0f, 0.2f, 1.0f,
+			// N
+			-0.5f, -1.0f, -1.0f,
+			1.0f, 0.2f, 1.0f,
+			// L
+			-0.3f, -1.0f, -1.0f,
+			1.0f, 0.2f, 1.0f,
+
+			// Left front leg
+			// D
+			0.5f, -1.0f, 0.0f,
+			1.0f, 0.2f, 1.0f,
+
+
+			// Q
+			0.5f, -1.0f, -1.0f,
+			1.0f, 0.2f, 1.0f,
+
+
+			// J
+			0.3f, -1.0f, -1.0f,
+			1.0f, 0.2f, 1.0f,
+
+
+			// I
+			0.3f, -1.0f, 0.0f,
+			1.0f, 0.2f, 1.0f,
+
+			// J
+			0.3f, -1.0f, -1.0f,
+			1.0f, 0.2f, 1.0f,
+			// D
+			0.5f, -1.0f, 0.0f,
+			1.0f, 0.2f, 1.0f,
+};
+
+/*
+ * @desc Inserts a flat normal after the position of every vertex of a
+ *       triangle list. Normals point away from the origin, which is outward
+ *       for the cube; lit shaders should still light both faces
+ * @parameters vertices starting with xyz, vertex count, floats per vertex
+ * @returns the vertices with stride + 3 floats each
+ */
+inline std::vector<GLfloat> UAddFlatNormals(const GLfloat* vertices, GLsizei vertexCount, int stride) {
+	std::vector<GLfloat> out;
+	out.reserve((size_t)vertexCount * (stride + 3));
+	for (GLsizei triangle = 0; triangle + 2 < vertexCount; triangle += 3) {
+		const GLfloat* a = vertices + triangle * stride;
+		const GLfloat* b = a + stride;
+		const GLfloat* c = b + stride;
+		GLfloat u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		GLfloat v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		GLfloat n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+		GLfloat length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		GLfloat centre[3] = { a[0] + b[0] + c[0], a[1] + b[1] + c[1], a[2] + b[2] + c[2] };
+		if (n[0] * centre[0] + n[1] * centre[1] + n[2] * centre[2] < 0.0f) {
+			length = -length;
+		}
+		for (int corner = 0; corner < 3; ++corner) {
+			const GLfloat* vertex = a + corner * stride;
+			out.insert(out.end(), vertex, vertex + 3);
+			for (int i = 0; i < 3; ++i) {
+				out.push_back(length != 0.0f ? n[i] / length : 0.0f);
+			}
+			out.insert(out.end(), vertex + 3, vertex + stride);
+		}
+	}
+	return out;
+}
+
+#endif // DEMO_MESHES_H
@@ -0,0 +1,81 @@
+/*
+ * @author Jacob William
+ * @desc Fixed timestep clock. The simulation always advances in steps of the
+ *       same length, however fast frames come; a frame runs the whole steps
+ *       its elapsed time covers and renders the leftover as a blend factor
+ *       between the last two simulated states.
+ */
+
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+#include <algorithm>
+
+// Steps one frame may run before time is dropped, so a long stall does not
+// turn into ever longer catch up frames
+const int FixedTimestepMaxSteps = 8;
+
+// Step lengths in milliseconds, 10 kHz to 1 Hz
+const double FixedTimestepMinStep = 0.1;
+const double FixedTimestepMaxStep = 1000.0;
+
+class UFixedTimestep {
+public:
+
+	explicit UFixedTimestep(double stepMilliseconds) : step(FixedTimestepMinStep), accumulator(0.0), last(0.0), started(false) {
+		SetStep(stepMilliseconds);
+	}
+
+	/*
+	 * @desc Moves the clock to now, in milliseconds on any monotonic scale
+	 * @returns the number of steps to simulate this frame
+	 */
+	int Advance(double now) {
+		if (!started) {
+			started = true;
+			last = now;
+			return 0;
+		}
+		accumulator += now - last;
+		last = now;
+
+		int steps = (int)(accumulator / step);
+		if (steps > FixedTimestepMaxSteps) {
+			steps = FixedTimestepMaxSteps;
+			accumulator = std::min(accumulator - steps * step, step);
+		}
+		else {
+			accumulator -= steps * step;
+		}
+		return steps;
+	}
+
+	/*
+	 * @desc How far rendering is past the last step, 0 to 1
+	 */
+	double Alpha(void) const {
+		return accumulator / step;
+	}
+
+	double Step(void) const {
+		return step;
+	}
+
+	/*
+	 * @desc Clamps to the step range, a zero, negative or NaN step would
+	 *       never advance or never stop
+	 * @returns void
+	 */
+	void SetStep(double stepMilliseconds) {
+		step = std::min(FixedTimestepMaxStep, std::max(FixedTimestepMinStep, stepMilliseconds));
+	}
+
+private:
+
+	double step;
+	double accumulator;
+	double last;
+	bool started;
+};
+
+#endif // FIXED_TIMESTEP_H
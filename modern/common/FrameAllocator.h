@@ -0,0 +1,290 @@
+/*
+ * @author Jacob William
+ * @desc Allocators for render data. UFrameArena is a bump allocator for data
+ *       that only lives for one frame, UFrameArenas double-buffers two of them
+ *       so the previous frame stays readable while the next one is built.
+ *       UPool hands out fixed size slots for long-lived objects such as
+ *       meshes, textures and programs. Both keep counters for the profiler.
+ */
+
+#ifndef FRAME_ALLOCATOR_H
+#define FRAME_ALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <vector>
+
+/*
+ * Counters shown by UPrintAllocationStats
+ */
+struct UAllocationStats {
+	size_t allocations;
+	size_t bytesUsed;
+	size_t peakBytes;
+	size_t capacity;
+
+	// Allocations that did not fit and went to the heap
+	size_t overflows;
+};
+
+class UFrameArena {
+public:
+
+	/*
+	 * @desc Reserves capacity bytes up front, grows on Reset if a frame overflowed
+	 */
+	explicit UFrameArena(size_t capacity = 16 << 20) : base(NULL), capacity(0), offset(0), allocations(0), peakBytes(0), overflowBytes(0) {
+		UReserve(capacity);
+	}
+
+	~UFrameArena() {
+		UFreeOverflow();
+		free(base);
+	}
+
+	/*
+	 * @desc Bumps the offset, safe to call from several workers at once
+	 * @parameters size in bytes, power of two alignment
+	 * @returns memory valid until the next Reset
+	 */
+	void* Allocate(size_t size, size_t alignment = 16) {
+		allocations.fetch_add(1, std::memory_order_relaxed);
+
+		size_t padded = (size + alignment - 1) & ~(alignment - 1);
+		size_t start = offset.fetch_add(padded + alignment, std::memory_order_relaxed);
+		if (start + padded + alignment <= capacity) {
+			uintptr_t address = ((uintptr_t)(base + start) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+			return (void*)address;
+		}
+
+		// Out of room, fall back to the heap for the rest of this frame
+		std::lock_guard<std::mutex> lock(overflowMutex);
+		void* memory = malloc(size + alignment);
+		overflow.push_back(memory);
+		overflowBytes += size + alignment;
+		return (void*)(((uintptr_t)memory + alignment - 1) & ~(uintptr_t)(alignment - 1));
+	}
+
+	/*
+	 * @desc Typed array allocation, elements are not constructed
+	 * @returns count elements of T
+	 */
+	template <typename T>
+	T* Allocate(size_t count) {
+		return (T*)Allocate(count * sizeof(T), alignof(T) > 16 ? alignof(T) : 16);
+	}
+
+	/*
+	 * @desc Releases everything from this frame; if the frame overflowed the
+	 *       arena is regrown so the next frames fit without touching the heap
+	 * @returns void
+	 */
+	void Reset(void) {
+		size_t used = UUsedBytes();
+		if (used > peakBytes) {
+			peakBytes = used;
+		}
+
+		if (!overflow.empty()) {
+			UFreeOverflow();
+			free(base);
+			base = NULL;
+			UReserve(peakBytes + peakBytes / 2);
+		}
+
+		offset.store(0, std::memory_order_relaxed);
+		allocations.store(0, std::memory_order_relaxed);
+	}
+
+	/*
+	 * @desc Snapshot of the counters for the current frame
+	 * @returns stats
+	 */
+	UAllocationStats Stats(void) const {
+		UAllocationStats stats;
+		stats.allocations = allocations.load(std::memory_order_relaxed);
+		stats.bytesUsed = UUsedBytes();
+		stats.peakBytes = peakBytes > stats.bytesUsed ? peakBytes : stats.bytesUsed;
+		stats.capacity = capacity;
+		stats.overflows = overflow.size();
+		return stats;
+	}
+
+private:
+
+	char* base;
+	size_t capacity;
+	std::atomic<size_t> offset;
+	std::atomic<size_t> allocations;
+	size_t peakBytes;
+
+	std::mutex overflowMutex;
+	std::vector<void*> overflow;
+	size_t overflowBytes;
+
+	size_t UUsedBytes(void) const {
+		size_t used = offset.load(std::memory_order_relaxed);
+		return (used < capacity ? used : capacity) + overflowBytes;
+	}
+
+	void UReserve(size_t bytes) {
+		base = (char*)malloc(bytes);
+		if (base == NULL) {
+			throw std::bad_alloc();
+		}
+		capacity = bytes;
+	}
+
+	void UFreeOverflow(void) {
+		for (size_t i = 0; i < overflow.size(); ++i) {
+			free(overflow[i]);
+		}
+		overflow.clear();
+		overflowBytes = 0;
+	}
+};
+
+/*
+ * Two arenas used on alternate frames, call Flip right after glutSwapBuffers
+ */
+class UFrameArenas {
+public:
+
+	explicit UFrameArenas(size_t capacity = 16 << 20) : current(0) {
+		arenas[0] = new UFrameArena(capacity);
+		arenas[1] = new UFrameArena(capacity);
+	}
+
+	~UFrameArenas() {
+		delete arenas[0];
+		delete arenas[1];
+	}
+
+	// Arena for the frame being built
+	UFrameArena& Current(void) {
+		return *arenas[current];
+	}
+
+	// Arena of the frame that was just submitted, still valid until the next Flip
+	UFrameArena& Previous(void) {
+		return *arenas[current ^ 1];
+	}
+
+	/*
+	 * @desc Starts a new frame, the arena from two frames ago is recycled
+	 * @returns void
+	 */
+	void Flip(void) {
+		current ^= 1;
+		arenas[current]->Reset();
+	}
+
+private:
+
+	UFrameArena* arenas[2];
+	int current;
+};
+
+/*
+ * Fixed size slots for long-lived objects, memory comes in blocks of
+ * SlotsPerBlock and freed slots are reused before a new block is taken
+ */
+template <typename T, size_t SlotsPerBlock = 256>
+class UPool {
+public:
+
+	UPool() : freeList(NULL), live(0), peak(0), allocations(0) {
+	}
+
+	~UPool() {
+		for (size_t b = 0; b < blocks.size(); ++b) {
+			free(blocks[b]);
+		}
+	}
+
+	/*
+	 * @desc Constructs a T in a free slot
+	 * @returns the new object
+	 */
+	T* Create(void) {
+		if (freeList == NULL) {
+			UAddBlock();
+		}
+
+		USlot* slot = freeList;
+		freeList = slot->next;
+
+		++allocations;
+		if (++live > peak) {
+			peak = live;
+		}
+		return new (slot->storage) T();
+	}
+
+	/*
+	 * @desc Destroys the object and returns its slot
+	 * @returns void
+	 */
+	void Destroy(T* object) {
+		object->~T();
+		USlot* slot = (USlot*)object;
+		slot->next = freeList;
+		freeList = slot;
+		--live;
+	}
+
+	UAllocationStats Stats(void) const {
+		UAllocationStats stats;
+		stats.allocations = allocations;
+		stats.bytesUsed = live * sizeof(USlot);
+		stats.peakBytes = peak * sizeof(USlot);
+		stats.capacity = blocks.size() * SlotsPerBlock * sizeof(USlot);
+		stats.overflows = 0;
+		return stats;
+	}
+
+private:
+
+	union USlot {
+		USlot* next;
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	std::vector<USlot*> blocks;
+	USlot* freeList;
+	size_t live, peak, allocations;
+
+	void UAddBlock(void) {
+		USlot* block = (USlot*)malloc(SlotsPerBlock * sizeof(USlot));
+		if (block == NULL) {
+			throw std::bad_alloc();
+		}
+		for (size_t i = 0; i < SlotsPerBlock; ++i) {
+			block[i].next = (i + 1 < SlotsPerBlock) ? &block[i + 1] : freeList;
+		}
+		freeList = block;
+		blocks.push_back(block);
+	}
+};
+
+/*
+ * @desc Writes one line of allocator counters for the profiler output
+ * @returns void
+ */
+inline void UPrintAllocationStats(std::ostream& out, const char* name, const UAllocationStats& stats) {
+	out << name << ": " << stats.allocations << " allocs, "
+		<< stats.bytesUsed / 1024 << " KiB used, "
+		<< stats.peakBytes / 1024 << " KiB peak, "
+		<< stats.capacity / 1024 << " KiB capacity";
+	if (stats.overflows > 0) {
+		out << ", " << stats.overflows << " overflows";
+	}
+	out << "\n";
+}
+
+#endif // FRAME_ALLOCATOR_H
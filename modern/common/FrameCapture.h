@@ -0,0 +1,374 @@
+/*
+ * @author Jacob William
+ * @desc Video capture without stalling the GL thread. Every frame is copied
+ *       into one of a ring of pixel pack buffers with a fence; two frames
+ *       later, when the GPU has long finished that copy, the buffer is mapped
+ *       and the pointer goes to an encoder thread, which writes either one
+ *       raw Y4M stream (C420jpeg, plays in ffplay and mpv and feeds straight
+ *       into ffmpeg) or a numbered PNG sequence. The buffer is unmapped on the
+ *       GL thread once the encoder is done, just before its slot comes round
+ *       again. When the encoder falls behind the GL thread waits for it
+ *       rather than dropping frames.
+ */
+
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+
+// SOIL2 library import
+#include "SOIL2/SOIL2.h"
+
+#include "Readback.h"
+
+// Frame N is handed to the encoder while frame N + 2 is being captured
+const size_t CaptureLatency = 2;
+
+// Latency plus up to three frames queued or encoding
+const size_t CaptureRingSize = 5;
+
+enum UCaptureFormat {
+	UCaptureY4M,
+	UCapturePNG
+};
+
+struct UCaptureStats {
+	size_t frames;
+	double captureMilliseconds;	// GL thread time spent in Capture, waits included
+	double waitMilliseconds;	// part of the above spent waiting for the encoder
+	double encodeMilliseconds;	// encoder thread time
+};
+
+enum UCaptureSlotState {
+	UCaptureSlotFree,
+	UCaptureSlotReading,
+	UCaptureSlotEncoding,
+	UCaptureSlotEncoded
+};
+
+class UFrameCapture {
+public:
+
+	UFrameCapture() : format(UCaptureY4M), digits(0), file(NULL), width(0), height(0), frameNumber(0), stopping(false) {
+		stats.frames = 0;
+		stats.captureMilliseconds = stats.waitMilliseconds = stats.encodeMilliseconds = 0.0;
+	}
+
+	/*
+	 * @desc Starts a capture of the bottom left width * height pixels of the
+	 *       read framebuffer. A path ending in .y4m writes one stream,
+	 *       anything else names PNG files with exactly one %d or %0Nd for
+	 *       the frame number, e.g. frame%05d.png, and %% for a percent sign.
+	 *       The size is fixed until Close, the caller keeps the window at it
+	 * @returns false when the output cannot be created or the pattern has
+	 *          no single frame number
+	 */
+	bool Open(const std::string& path, int captureWidth, int captureHeight, int framesPerSecond) {
+		Close();
+		width = captureWidth;
+		height = captureHeight;
+		frameNumber = 0;
+		stats.frames = 0;
+		stats.captureMilliseconds = stats.waitMilliseconds = stats.encodeMilliseconds = 0.0;
+
+		format = path.size() > 4 && path.compare(path.size() - 4, 4, ".y4m") == 0 ? UCaptureY4M : UCapturePNG;
+		if (format == UCapturePNG && !UParsePattern(path)) {
+			return false;
+		}
+		if (format == UCaptureY4M) {
+			file = fopen(path.c_str(), "wb");
+			if (file == NULL) {
+				return false;
+			}
+			fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, framesPerSecond);
+		}
+
+		slots.resize(CaptureRingSize);
+		states.assign(CaptureRingSize, UCaptureSlotFree);
+		pixels.assign(CaptureRingSize, (const unsigned char*)NULL);
+		stopping = false;
+		worker = std::thread(&UFrameCapture::UEncodeLoop, this);
+		return true;
+	}
+
+	bool IsOpen(void) const {
+		return worker.joinable();
+	}
+
+	int Width(void) const {
+		return width;
+	}
+
+	int Height(void) const {
+		return height;
+	}
+
+	/*
+	 * @desc Queues the current frame, call after drawing and before the swap
+	 * @returns void
+	 */
+	void Capture(void) {
+		if (!IsOpen()) {
+			return;
+		}
+		auto start = std::chrono::steady_clock::now();
+
+		if (frameNumber >= CaptureLatency) {
+			UHandOff((frameNumber - CaptureLatency) % CaptureRingSize);
+		}
+
+		size_t slot = frameNumber % CaptureRingSize;
+		UReclaim(slot);
+		slots[slot].Start(0, 0, width, height);
+		states[slot] = UCaptureSlotReading;
+		++frameNumber;
+
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.captureMilliseconds += milliseconds;
+	}
+
+	/*
+	 * @desc Encodes the frames still in flight and stops the encoder, called
+	 *       explicitly while the context is alive
+	 * @returns void
+	 */
+	void Close(void) {
+		if (!IsOpen()) {
+			return;
+		}
+
+		size_t first = frameNumber > CaptureLatency ? frameNumber - CaptureLatency : 0;
+		for (size_t n = first; n < frameNumber; ++n) {
+			UHandOff(n % CaptureRingSize);
+		}
+		for (size_t slot = 0; slot < CaptureRingSize; ++slot) {
+			UReclaim(slot);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		workReady.notify_one();
+		worker.join();
+
+		for (size_t slot = 0; slot < CaptureRingSize; ++slot) {
+			slots[slot].Destroy();
+		}
+		if (file != NULL) {
+			fclose(file);
+			file = NULL;
+		}
+	}
+
+	UCaptureStats Stats(void) const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return stats;
+	}
+
+private:
+
+	/*
+	 * @desc Splits a PNG pattern around its frame number, the path is never
+	 *       used as a format string
+	 * @returns false unless there is exactly one %d or %0Nd
+	 */
+	bool UParsePattern(const std::string& path) {
+		prefix.clear();
+		suffix.clear();
+		digits = -1;
+		for (size_t i = 0; i < path.size(); ++i) {
+			std::string& text = digits < 0 ? prefix : suffix;
+			if (path[i] != '%') {
+				text += path[i];
+				continue;
+			}
+			if (i + 1 < path.size() && path[i + 1] == '%') {
+				text += '%';
+				++i;
+				continue;
+			}
+
+			// %d or %0 and a width, then d
+			size_t end = i + 1;
+			int width = 0;
+			if (end < path.size() && path[end] == '0') {
+				while (++end < path.size() && path[end] >= '0' && path[end] <= '9') {
+					width = width * 10 + (path[end] - '0');
+				}
+			}
+			if (digits >= 0 || end >= path.size() || path[end] != 'd' || width > 16) {
+				return false;
+			}
+			digits = width;
+			i = end;
+		}
+		return digits >= 0;
+	}
+
+	/*
+	 * @desc Maps a finished readback and queues it for the encoder
+	 * @returns void
+	 */
+	void UHandOff(size_t slot) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (states[slot] != UCaptureSlotReading) {
+				return;
+			}
+		}
+		const unsigned char* mapped = slots[slot].Map();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		pixels[slot] = mapped;
+		states[slot] = mapped != NULL ? UCaptureSlotEncoding : UCaptureSlotEncoded;
+		if (mapped != NULL) {
+			queue.push_back(slot);
+			workReady.notify_one();
+		}
+	}
+
+	/*
+	 * @desc Makes a slot free again, waiting for the encoder if it still
+	 *       reads the slot
+	 * @returns void
+	 */
+	void UReclaim(size_t slot) {
+		UHandOff(slot);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		if (states[slot] == UCaptureSlotEncoding) {
+			auto start = std::chrono::steady_clock::now();
+			slotDone.wait(lock, [&]() { return states[slot] != UCaptureSlotEncoding; });
+			stats.waitMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		if (states[slot] == UCaptureSlotEncoded) {
+			if (pixels[slot] != NULL) {
+				slots[slot].Unmap();
+				pixels[slot] = NULL;
+			}
+			states[slot] = UCaptureSlotFree;
+		}
+	}
+
+	void UEncodeLoop(void) {
+		std::unique_lock<std::mutex> lock(mutex);
+		size_t encoded = 0;
+		for (;;) {
+			workReady.wait(lock, [&]() { return stopping || !queue.empty(); });
+			if (queue.empty()) {
+				return;
+			}
+			size_t slot = queue.front();
+			queue.pop_front();
+			const unsigned char* frame = pixels[slot];
+			lock.unlock();
+
+			auto start = std::chrono::steady_clock::now();
+			if (format == UCaptureY4M) {
+				UWriteY4M(frame);
+			}
+			else {
+				UWritePng(frame, encoded);
+			}
+			++encoded;
+			double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			lock.lock();
+			states[slot] = UCaptureSlotEncoded;
+			++stats.frames;
+			stats.encodeMilliseconds += milliseconds;
+			slotDone.notify_one();
+		}
+	}
+
+	/*
+	 * @desc Full range BT.601 in 8.8 fixed point, chroma averaged over 2x2
+	 *       pixels. The source is bottom row first, Y4M is top row first
+	 * @returns void
+	 */
+	void UWriteY4M(const unsigned char* frame) {
+		int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+		yuv.resize((size_t)width * height + (size_t)chromaWidth * chromaHeight * 2);
+		unsigned char* lumaPlane = yuv.data();
+		unsigned char* bluePlane = lumaPlane + (size_t)width * height;
+		unsigned char* redPlane = bluePlane + (size_t)chromaWidth * chromaHeight;
+
+		// One pass over each pair of rows, the frame is read from memory once
+		for (int cy = 0; cy < chromaHeight; ++cy) {
+			int y0 = cy * 2, y1 = y0 + 1 < height ? y0 + 1 : y0;
+			const unsigned char* row0 = frame + (size_t)(height - 1 - y0) * width * 4;
+			const unsigned char* row1 = frame + (size_t)(height - 1 - y1) * width * 4;
+			unsigned char* luma0 = lumaPlane + (size_t)y0 * width;
+			unsigned char* luma1 = lumaPlane + (size_t)y1 * width;
+			unsigned char* blue = bluePlane + (size_t)cy * chromaWidth;
+			unsigned char* red = redPlane + (size_t)cy * chromaWidth;
+
+			for (int x = 0; x < width; ++x) {
+				luma0[x] = (unsigned char)((77 * row0[x * 4] + 150 * row0[x * 4 + 1] + 29 * row0[x * 4 + 2] + 128) >> 8);
+				luma1[x] = (unsigned char)((77 * row1[x * 4] + 150 * row1[x * 4 + 1] + 29 * row1[x * 4 + 2] + 128) >> 8);
+			}
+
+			for (int cx = 0; cx < chromaWidth; ++cx) {
+				int x0 = cx * 2 * 4, x1 = cx * 2 + 1 < width ? x0 + 4 : x0;
+				int r = row0[x0] + row0[x1] + row1[x0] + row1[x1];
+				int g = row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1];
+				int b = row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2];
+				// Sums are four pixels, so 8.8 weights become a shift of 10
+				blue[cx] = (unsigned char)std::min(255, (-43 * r - 85 * g + 128 * b + (128 << 10) + 512) >> 10);
+				red[cx] = (unsigned char)std::min(255, (128 * r - 107 * g - 21 * b + (128 << 10) + 512) >> 10);
+			}
+		}
+
+		fputs("FRAME\n", file);
+		fwrite(yuv.data(), 1, yuv.size(), file);
+	}
+
+	void UWritePng(const unsigned char* frame, size_t index) {
+		flipped.resize((size_t)width * height * 4);
+		for (int y = 0; y < height; ++y) {
+			memcpy(&flipped[(size_t)y * width * 4], frame + (size_t)(height - 1 - y) * width * 4, (size_t)width * 4);
+		}
+
+		std::string number = std::to_string(index);
+		if ((int)number.size() < digits) {
+			number.insert(0, digits - number.size(), '0');
+		}
+		std::string path = prefix + number + suffix;
+		SOIL_save_image(path.c_str(), SOIL_SAVE_TYPE_PNG, width, height, 4, flipped.data());
+	}
+
+	UCaptureFormat format;
+
+	// PNG file names are prefix, the frame number padded to digits, suffix
+	std::string prefix, suffix;
+	int digits;
+	FILE* file;
+	int width, height;
+	size_t frameNumber;
+
+	std::vector<UPixelReadback> slots;
+	std::vector<UCaptureSlotState> states;
+	std::vector<const unsigned char*> pixels;
+
+	// Encoder side, everything below is shared under mutex except the scratch buffers
+	std::thread worker;
+	mutable std::mutex mutex;
+	std::condition_variable workReady, slotDone;
+	std::deque<size_t> queue;
+	bool stopping;
+	UCaptureStats stats;
+	std::vector<unsigned char> yuv, flipped;
+};
+
+#endif // FRAME_CAPTURE_H
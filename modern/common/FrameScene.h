@@ -0,0 +1,313 @@
+/*
+ * @author Jacob William
+ * @desc CPU side of a many-object frame: transform update, frustum culling,
+ *       sort key generation and instance/command writing, each stage spread
+ *       over the job system. The result is a sorted instance buffer and a
+ *       list of draw batches, the only thing left for the GL thread is the
+ *       upload and the draw calls. Per frame arrays come from a frame arena
+ *       so a warmed up frame does not touch the heap.
+ */
+
+#ifndef FRAME_SCENE_H
+#define FRAME_SCENE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "CommandList.h"
+#include "FrameAllocator.h"
+#include "JobSystem.h"
+#include "TransformKernel.h"
+
+/*
+ * Scene objects stored as structure of arrays
+ */
+struct USceneObjects {
+	size_t count;
+	std::vector<float> tx, ty, tz;
+	std::vector<float> qx, qy, qz, qw;
+	std::vector<float> sx, sy, sz;
+
+	// Spin around the y axis in radians per second
+	std::vector<float> spin;
+
+	// Bounding sphere radius of the unscaled mesh
+	std::vector<float> radius;
+	std::vector<uint32_t> mesh;
+
+	UTransformSoA Transforms(void) const {
+		UTransformSoA soa = {
+			tx.data(), ty.data(), tz.data(),
+			qx.data(), qy.data(), qz.data(), qw.data(),
+			sx.data(), sy.data(), sz.data()
+		};
+		return soa;
+	}
+};
+
+// One visible object and its sort key
+struct USortItem {
+	uint64_t key;
+	uint32_t object;
+};
+
+// Instances [firstInstance, firstInstance + instanceCount) all use mesh
+struct UDrawBatch {
+	uint32_t mesh;
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+};
+
+/*
+ * Everything produced for one frame, the arrays live in the arena passed to
+ * UBuildFrame and stay valid until that arena is reset
+ */
+struct UFrameData {
+	float* matrices;
+	USortItem* sorted;
+	float* instances;
+	size_t visibleCount;
+	std::vector<UDrawBatch> batches;
+	std::vector<UCommandList> commandLists;
+
+	UFrameData() : matrices(NULL), sorted(NULL), instances(NULL), visibleCount(0) {
+	}
+};
+
+/*
+ * @desc Scatters count objects in a cube of the given half extent
+ * @parameters scene, object count, half extent, number of meshes, seed
+ * @returns void
+ */
+inline void UScatterObjects(USceneObjects& scene, size_t count, float extent, uint32_t meshCount, unsigned seed) {
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> position(-extent, extent), unit(-1.0f, 1.0f), size(0.2f, 1.0f);
+
+	scene.count = count;
+	std::vector<float>* arrays[] = {
+		&scene.tx, &scene.ty, &scene.tz, &scene.qx, &scene.qy, &scene.qz, &scene.qw,
+		&scene.sx, &scene.sy, &scene.sz, &scene.spin, &scene.radius
+	};
+	for (size_t a = 0; a < sizeof(arrays) / sizeof(arrays[0]); ++a) {
+		arrays[a]->resize(count);
+	}
+	scene.mesh.resize(count);
+
+	for (size_t i = 0; i < count; ++i) {
+		scene.tx[i] = position(random);
+		scene.ty[i] = position(random);
+		scene.tz[i] = position(random);
+
+		float x = unit(random), y = unit(random), z = unit(random), w = unit(random) + 1.5f;
+		float length = std::sqrt(x * x + y * y + z * z + w * w);
+		scene.qx[i] = x / length;
+		scene.qy[i] = y / length;
+		scene.qz[i] = z / length;
+		scene.qw[i] = w / length;
+
+		scene.sx[i] = scene.sy[i] = scene.sz[i] = size(random);
+		scene.spin[i] = unit(random);
+
+		// Unit cube centred on the origin
+		scene.radius[i] = 0.8660254f;
+		scene.mesh[i] = (uint32_t)(i % meshCount);
+	}
+}
+
+/*
+ * @desc Extracts the six normalized frustum planes from a column-major view projection
+ * @returns void
+ */
+inline void UExtractFrustum(const float m[16], float planes[6][4]) {
+	for (int p = 0; p < 6; ++p) {
+		int row = p / 2;
+		float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+		for (int c = 0; c < 4; ++c) {
+			planes[p][c] = m[c * 4 + 3] + sign * m[c * 4 + row];
+		}
+
+		float length = std::sqrt(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+		for (int c = 0; c < 4; ++c) {
+			planes[p][c] /= length;
+		}
+	}
+}
+
+/*
+ * @desc Sorts items by key then object, chunks are sorted in parallel then merged pairwise
+ * @parameters job system, items, scratch space of the same size, item count
+ * @returns items or scratch, whichever holds the sorted result
+ */
+inline USortItem* UParallelSort(UJobSystem& jobs, USortItem* items, USortItem* scratch, size_t count) {
+	struct UByKey {
+		bool operator()(const USortItem& a, const USortItem& b) const {
+			return a.key < b.key || (a.key == b.key && a.object < b.object);
+		}
+	};
+
+	size_t chunk = std::max<size_t>(4096, (count + jobs.ThreadCount() * 4 - 1) / (jobs.ThreadCount() * 4));
+
+	jobs.ParallelFor(count, chunk, [&](size_t begin, size_t end) {
+		std::sort(items + begin, items + end, UByKey());
+	});
+
+	USortItem* source = items;
+	USortItem* target = scratch;
+
+	for (size_t width = chunk; width < count; width *= 2) {
+		jobs.ParallelFor((count + 2 * width - 1) / (2 * width), 1, [&](size_t begin, size_t end) {
+			for (size_t pair = begin; pair < end; ++pair) {
+				size_t left = pair * 2 * width;
+				size_t middle = std::min(left + width, count);
+				size_t right = std::min(left + 2 * width, count);
+				std::merge(source + left, source + middle, source + middle, source + right,
+						target + left, UByKey());
+			}
+		});
+		std::swap(source, target);
+	}
+	return source;
+}
+
+/*
+ * @desc Runs every CPU stage of a frame across the job system
+ * @parameters job system, scene, column-major view projection, camera position,
+ *             seconds since last frame, arena for this frame, frame output,
+ *             false to keep scene order within a mesh instead of front to back
+ * @returns void
+ */
+inline void UBuildFrame(UJobSystem& jobs, USceneObjects& scene, const float viewProjection[16],
+		const float camera[3], float deltaTime, UFrameArena& arena, UFrameData& frame, bool frontToBack = true) {
+
+	size_t count = scene.count;
+	size_t grain = std::max<size_t>(1024, count / 1024);
+	size_t chunks = (count + grain - 1) / grain;
+
+	frame.matrices = arena.Allocate<float>(count * 16);
+	USortItem* items = arena.Allocate<USortItem>(count);
+	uint32_t* chunkVisible = arena.Allocate<uint32_t>(chunks);
+
+	float planes[6][4];
+	UExtractFrustum(viewProjection, planes);
+
+	UTransformSoA transforms = scene.Transforms();
+
+	// Transform update: spin every object then rebuild its model matrix
+	jobs.ParallelFor(count, grain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			float half = 0.5f * scene.spin[i] * deltaTime;
+			float s = std::sin(half), c = std::cos(half);
+			float x = scene.qx[i], y = scene.qy[i], z = scene.qz[i], w = scene.qw[i];
+
+			// q * (0, sin, 0, cos)
+			scene.qx[i] = x * c - z * s;
+			scene.qy[i] = y * c + w * s;
+			scene.qz[i] = z * c + x * s;
+			scene.qw[i] = w * c - y * s;
+		}
+		UBuildMatrices(transforms, begin, end - begin, frame.matrices);
+	});
+
+	// Culling and sort keys, each chunk packs its visible objects at its own start
+	jobs.ParallelFor(count, grain, [&](size_t begin, size_t end) {
+		USortItem* out = items + begin;
+		uint32_t visible = 0;
+
+		for (size_t i = begin; i < end; ++i) {
+			float x = scene.tx[i], y = scene.ty[i], z = scene.tz[i];
+			float radius = scene.radius[i] * std::max(scene.sx[i], std::max(scene.sy[i], scene.sz[i]));
+
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; ++p) {
+				inside = planes[p][0] * x + planes[p][1] * y + planes[p][2] * z + planes[p][3] >= -radius;
+			}
+			if (!inside) {
+				continue;
+			}
+
+			// Mesh first to batch draws, then front to back for early depth rejection
+			float dx = x - camera[0], dy = y - camera[1], dz = z - camera[2];
+			float distance = dx * dx + dy * dy + dz * dz;
+			uint32_t depthBits = (uint32_t)i;
+			if (frontToBack) {
+				memcpy(&depthBits, &distance, sizeof(depthBits));
+			}
+
+			out[visible].key = ((uint64_t)scene.mesh[i] << 32) | depthBits;
+			out[visible].object = (uint32_t)i;
+			++visible;
+		}
+		chunkVisible[begin / grain] = visible;
+	});
+
+	// Compact the per chunk results
+	size_t* offsets = arena.Allocate<size_t>(chunks + 1);
+	offsets[0] = 0;
+	for (size_t c = 0; c < chunks; ++c) {
+		offsets[c + 1] = offsets[c] + chunkVisible[c];
+	}
+	frame.visibleCount = offsets[chunks];
+	USortItem* compacted = arena.Allocate<USortItem>(frame.visibleCount);
+
+	jobs.ParallelFor(chunks, 1, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; ++c) {
+			std::copy(items + c * grain, items + c * grain + chunkVisible[c], compacted + offsets[c]);
+		}
+	});
+
+	frame.sorted = UParallelSort(jobs, compacted, items, frame.visibleCount);
+
+	// Command writing: instance matrices in draw order
+	frame.instances = arena.Allocate<float>(frame.visibleCount * 16);
+	jobs.ParallelFor(frame.visibleCount, grain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			memcpy(&frame.instances[i * 16], &frame.matrices[frame.sorted[i].object * 16], 16 * sizeof(float));
+		}
+	});
+
+	// One batch per mesh run
+	frame.batches.clear();
+	for (size_t i = 0; i < frame.visibleCount; ++i) {
+		uint32_t mesh = scene.mesh[frame.sorted[i].object];
+		if (frame.batches.empty() || frame.batches.back().mesh != mesh) {
+			UDrawBatch batch = { mesh, (uint32_t)i, 0 };
+			frame.batches.push_back(batch);
+		}
+		frame.batches.back().instanceCount++;
+	}
+}
+
+/*
+ * @desc Records one draw per visible object into per chunk command lists on
+ *       the workers, each draw picks its matrix from the instance buffer with
+ *       its base instance. Replay the lists in order on the GL thread.
+ * @parameters job system, frame after UBuildFrame, program, vertex array,
+ *             vertices per object
+ * @returns void
+ */
+inline void URecordObjectCommands(UJobSystem& jobs, UFrameData& frame, GLuint program, GLuint vertexArray, GLsizei vertexCount) {
+	size_t grain = std::max<size_t>(1024, frame.visibleCount / 256);
+	size_t chunks = (frame.visibleCount + grain - 1) / grain;
+
+	if (frame.commandLists.size() < chunks) {
+		frame.commandLists.resize(chunks);
+	}
+	for (size_t c = 0; c < frame.commandLists.size(); ++c) {
+		frame.commandLists[c].Reset();
+	}
+
+	jobs.ParallelFor(frame.visibleCount, grain, [&](size_t begin, size_t end) {
+		UCommandList& list = frame.commandLists[begin / grain];
+		list.BindProgram(program);
+		list.BindVertexArray(vertexArray);
+		for (size_t i = begin; i < end; ++i) {
+			list.DrawArraysInstanced(GL_TRIANGLES, 0, vertexCount, 1, (GLuint)i);
+		}
+	});
+}
+
+#endif // FRAME_SCENE_H
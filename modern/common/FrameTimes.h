@@ -0,0 +1,66 @@
+/*
+ * @author Jacob William
+ * @desc Frame time distribution, a mean hides the hitches that percentiles
+ *       show, so benchmark runs print both
+ */
+
+#ifndef FRAME_TIMES_H
+#define FRAME_TIMES_H
+
+#include <algorithm>
+#include <ostream>
+#include <vector>
+
+class UFrameTimes {
+public:
+
+	void Add(double milliseconds) {
+		samples.push_back(milliseconds);
+	}
+
+	void Clear(void) {
+		samples.clear();
+	}
+
+	size_t Count(void) const {
+		return samples.size();
+	}
+
+	/*
+	 * @desc Nearest rank percentile, fraction between 0 and 1
+	 * @returns milliseconds, 0 without samples
+	 */
+	double Percentile(double fraction) const {
+		if (samples.empty()) {
+			return 0.0;
+		}
+		std::vector<double> sorted(samples);
+		size_t rank = std::min(sorted.size() - 1, (size_t)(fraction * (sorted.size() - 1) + 0.5));
+		std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+		return sorted[rank];
+	}
+
+	double Mean(void) const {
+		double sum = 0.0;
+		for (size_t i = 0; i < samples.size(); ++i) {
+			sum += samples[i];
+		}
+		return samples.empty() ? 0.0 : sum / samples.size();
+	}
+
+	/*
+	 * @desc One line: count, mean, min, median, p95, p99 and max
+	 * @returns void
+	 */
+	void Print(std::ostream& out, const char* name) const {
+		out << name << ": " << samples.size() << " frames, mean " << Mean() << " ms, min " << Percentile(0.0)
+			<< ", p50 " << Percentile(0.5) << ", p95 " << Percentile(0.95) << ", p99 " << Percentile(0.99)
+			<< ", max " << Percentile(1.0) << std::endl;
+	}
+
+private:
+
+	std::vector<double> samples;
+};
+
+#endif // FRAME_TIMES_H
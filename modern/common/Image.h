@@ -0,0 +1,43 @@
+/*
+ * @author Jacob William
+ * @desc In-memory RGBA8 images shared by the texture tools
+ */
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <algorithm>
+#include <vector>
+
+// Tightly packed RGBA8 image
+struct UImage {
+	int width;
+	int height;
+	std::vector<unsigned char> pixels;
+};
+
+/*
+ * @desc Halves an image with a 2x2 box filter
+ * @returns the smaller image
+ */
+inline UImage UHalveImage(const UImage& image) {
+	UImage half;
+	half.width = std::max(1, image.width / 2);
+	half.height = std::max(1, image.height / 2);
+	half.pixels.resize(half.width * half.height * 4);
+
+	for (int y = 0; y < half.height; ++y) {
+		for (int x = 0; x < half.width; ++x) {
+			int x0 = std::min(x * 2, image.width - 1), x1 = std::min(x * 2 + 1, image.width - 1);
+			int y0 = std::min(y * 2, image.height - 1), y1 = std::min(y * 2 + 1, image.height - 1);
+			for (int c = 0; c < 4; ++c) {
+				int sum = image.pixels[(y0 * image.width + x0) * 4 + c] + image.pixels[(y0 * image.width + x1) * 4 + c]
+						+ image.pixels[(y1 * image.width + x0) * 4 + c] + image.pixels[(y1 * image.width + x1) * 4 + c];
+				half.pixels[(y * half.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+	return half;
+}
+
+#endif // IMAGE_H
@@ -0,0 +1,140 @@
+/*
+ * @author Jacob William
+ * @desc Perceptual image comparison for rendering regression checks. Pixels
+ *       are compared as CIE Lab colors, where a distance of about 2.3 is the
+ *       smallest difference people notice, and a pixel only counts as wrong
+ *       when no neighbour in the other image matches it either. That absorbs
+ *       edges landing one pixel over, which is where drivers (llvmpipe vs a
+ *       GPU, or two GPU vendors) legitimately disagree.
+ */
+
+#ifndef IMAGE_COMPARE_H
+#define IMAGE_COMPARE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "Image.h"
+
+// Default Lab distance below which two pixels are the same
+const float CompareJustNoticeable = 2.3f;
+
+// Neighbourhood searched for a match, 1 means 3x3
+const int CompareNeighbourhood = 1;
+
+struct UImageDifference {
+	bool sizeMismatch;
+	size_t differentPixels;
+	size_t totalPixels;
+	float maxDelta;
+};
+
+/*
+ * @desc sRGB byte to CIE Lab, D65 white
+ * @returns void
+ */
+inline void USrgbToLab(const unsigned char* rgb, float* lab) {
+	static struct UToLinear {
+		float table[256];
+		UToLinear() {
+			for (int i = 0; i < 256; ++i) {
+				float c = i / 255.0f;
+				table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+		}
+	} toLinear;
+
+	float r = toLinear.table[rgb[0]], g = toLinear.table[rgb[1]], b = toLinear.table[rgb[2]];
+	float xyz[3] = {
+		(0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.95047f,
+		0.2126f * r + 0.7152f * g + 0.0722f * b,
+		(0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.08883f
+	};
+	for (int i = 0; i < 3; ++i) {
+		xyz[i] = xyz[i] > 0.008856f ? std::cbrt(xyz[i]) : 7.787f * xyz[i] + 16.0f / 116.0f;
+	}
+	lab[0] = 116.0f * xyz[1] - 16.0f;
+	lab[1] = 500.0f * (xyz[0] - xyz[1]);
+	lab[2] = 200.0f * (xyz[1] - xyz[2]);
+}
+
+inline float ULabDistance(const float* a, const float* b) {
+	float dl = a[0] - b[0], da = a[1] - b[1], db = a[2] - b[2];
+	return std::sqrt(dl * dl + da * da + db * db);
+}
+
+/*
+ * @desc Closest Lab distance from color to any pixel around (x, y) in lab
+ * @returns the distance
+ */
+inline float UNearestDelta(const float* color, const std::vector<float>& lab, int width, int height, int x, int y) {
+	float best = 1e30f;
+	for (int ny = std::max(0, y - CompareNeighbourhood); ny <= std::min(height - 1, y + CompareNeighbourhood); ++ny) {
+		for (int nx = std::max(0, x - CompareNeighbourhood); nx <= std::min(width - 1, x + CompareNeighbourhood); ++nx) {
+			best = std::min(best, ULabDistance(color, &lab[((size_t)ny * width + nx) * 3]));
+		}
+	}
+	return best;
+}
+
+/*
+ * @desc Compares actual against reference. A pixel differs when its Lab
+ *       distance is over tolerance both ways round against the neighbourhood.
+ *       When diff is given it receives a faded copy of the reference with
+ *       differing pixels in red, brighter the further off they are
+ * @returns counts of differing pixels and the largest distance seen
+ */
+inline UImageDifference UCompareImages(const UImage& reference, const UImage& actual, float tolerance, UImage* diff) {
+	UImageDifference result = { false, 0, (size_t)reference.width * reference.height, 0.0f };
+	if (reference.width != actual.width || reference.height != actual.height) {
+		result.sizeMismatch = true;
+		result.differentPixels = result.totalPixels;
+		return result;
+	}
+
+	int width = reference.width, height = reference.height;
+	std::vector<float> referenceLab(result.totalPixels * 3), actualLab(result.totalPixels * 3);
+	for (size_t i = 0; i < result.totalPixels; ++i) {
+		USrgbToLab(&reference.pixels[i * 4], &referenceLab[i * 3]);
+		USrgbToLab(&actual.pixels[i * 4], &actualLab[i * 3]);
+	}
+
+	if (diff != NULL) {
+		diff->width = width;
+		diff->height = height;
+		diff->pixels.resize(result.totalPixels * 4);
+	}
+
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			size_t i = (size_t)y * width + x;
+			float delta = ULabDistance(&referenceLab[i * 3], &actualLab[i * 3]);
+			bool different = delta > tolerance
+					&& UNearestDelta(&referenceLab[i * 3], actualLab, width, height, x, y) > tolerance
+					&& UNearestDelta(&actualLab[i * 3], referenceLab, width, height, x, y) > tolerance;
+
+			if (different) {
+				++result.differentPixels;
+				result.maxDelta = std::max(result.maxDelta, delta);
+			}
+
+			if (diff != NULL) {
+				unsigned char* out = &diff->pixels[i * 4];
+				if (different) {
+					out[0] = (unsigned char)std::min(255.0f, 128.0f + delta * 2.0f);
+					out[1] = out[2] = 0;
+				}
+				else {
+					// Lightness only, dimmed so the red stands out
+					out[0] = out[1] = out[2] = (unsigned char)(std::max(0.0f, std::min(100.0f, referenceLab[i * 3])) * 0.8f);
+				}
+				out[3] = 255;
+			}
+		}
+	}
+	return result;
+}
+
+#endif // IMAGE_COMPARE_H
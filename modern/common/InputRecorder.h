@@ -0,0 +1,209 @@
+/*
+ * @author Jacob William
+ * @desc Mouse input record and replay. The recorder logs every button and
+ *       motion event with its time and modifier keys to a small binary
+ *       file; the replay feeds the same events back through the demo's own
+ *       handlers, so a camera path can be driven identically run after run.
+ *
+ *       Handlers must ask UInputReplay::Modifiers (through the demo's
+ *       modifier function) instead of glutGetModifiers while replaying,
+ *       GLUT only knows the modifiers inside its own input callbacks.
+ */
+
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+enum UInputEventType {
+	UInputButton,
+	UInputMotion
+};
+
+// One event, 12 bytes on disk with no padding
+struct UInputEvent {
+	uint32_t time;		// milliseconds since recording started
+	uint8_t type;		// UInputEventType
+	uint8_t button;
+	uint8_t state;
+	uint8_t modifiers;
+	int16_t x;
+	int16_t y;
+};
+
+static_assert(sizeof(UInputEvent) == 12, "input log events must stay 12 bytes");
+
+struct UInputLogHeader {
+	char magic[4];		// "UIN1"
+	int32_t windowWidth;
+	int32_t windowHeight;
+};
+
+// Recorded time a frame advances by when replaying at speed 0
+const double InputReplayFrameStep = 1000.0 / 60.0;
+
+class UInputRecorder {
+public:
+
+	UInputRecorder() : file(NULL), start(0) {
+	}
+
+	/*
+	 * @desc Starts a log, now is the current time in milliseconds
+	 * @returns false when the file cannot be created
+	 */
+	bool Open(const std::string& path, int windowWidth, int windowHeight, int now) {
+		Close();
+		file = fopen(path.c_str(), "wb");
+		if (file == NULL) {
+			return false;
+		}
+		UInputLogHeader header;
+		memcpy(header.magic, "UIN1", 4);
+		header.windowWidth = windowWidth;
+		header.windowHeight = windowHeight;
+		fwrite(&header, sizeof(header), 1, file);
+		start = now;
+		return true;
+	}
+
+	bool IsOpen(void) const {
+		return file != NULL;
+	}
+
+	void Button(int now, int button, int state, int modifiers, int x, int y) {
+		UWrite(now, UInputButton, button, state, modifiers, x, y);
+	}
+
+	void Motion(int now, int modifiers, int x, int y) {
+		UWrite(now, UInputMotion, 0, 0, modifiers, x, y);
+	}
+
+	void Close(void) {
+		if (file != NULL) {
+			fclose(file);
+			file = NULL;
+		}
+	}
+
+private:
+
+	void UWrite(int now, int type, int button, int state, int modifiers, int x, int y) {
+		if (file == NULL) {
+			return;
+		}
+		UInputEvent event;
+		event.time = (uint32_t)(now - start);
+		event.type = (uint8_t)type;
+		event.button = (uint8_t)button;
+		event.state = (uint8_t)state;
+		event.modifiers = (uint8_t)modifiers;
+		event.x = (int16_t)x;
+		event.y = (int16_t)y;
+		fwrite(&event, sizeof(event), 1, file);
+	}
+
+	FILE* file;
+	int start;
+};
+
+class UInputReplay {
+public:
+
+	UInputReplay() : next(0), modifiers(0), open(false) {
+		header.windowWidth = header.windowHeight = 0;
+	}
+
+	/*
+	 * @desc Loads a whole log
+	 * @returns false when the file is missing or not an input log
+	 */
+	bool Open(const std::string& path) {
+		events.clear();
+		next = 0;
+		open = false;
+
+		FILE* file = fopen(path.c_str(), "rb");
+		if (file == NULL) {
+			return false;
+		}
+		if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "UIN1", 4) != 0) {
+			fclose(file);
+			return false;
+		}
+		UInputEvent event;
+		while (fread(&event, sizeof(event), 1, file) == 1) {
+			events.push_back(event);
+		}
+		fclose(file);
+		open = true;
+		return true;
+	}
+
+	bool IsOpen(void) const {
+		return open;
+	}
+
+	int WindowWidth(void) const {
+		return header.windowWidth;
+	}
+
+	int WindowHeight(void) const {
+		return header.windowHeight;
+	}
+
+	/*
+	 * @desc Sends every event recorded at or before elapsed milliseconds to
+	 *       the handlers, in order
+	 * @returns void
+	 */
+	template <typename ButtonFn, typename MotionFn>
+	void Pump(double elapsed, ButtonFn button, MotionFn motion) {
+		while (next < events.size() && events[next].time <= elapsed) {
+			const UInputEvent& event = events[next++];
+			modifiers = event.modifiers;
+			if (event.type == UInputButton) {
+				button(event.button, event.state, event.x, event.y);
+			}
+			else {
+				motion(event.x, event.y);
+			}
+		}
+	}
+
+	bool Finished(void) const {
+		return next >= events.size();
+	}
+
+	/*
+	 * @desc Modifier keys of the event being dispatched
+	 */
+	int Modifiers(void) const {
+		return modifiers;
+	}
+
+	/*
+	 * @desc Recorded time of the last event
+	 */
+	double Duration(void) const {
+		return events.empty() ? 0.0 : events.back().time;
+	}
+
+	size_t EventCount(void) const {
+		return events.size();
+	}
+
+private:
+
+	UInputLogHeader header;
+	std::vector<UInputEvent> events;
+	size_t next;
+	int modifiers;
+	bool open;
+};
+
+#endif // INPUT_RECORDER_H
@@ -0,0 +1,361 @@
+/*
+ * @author Jacob William
+ * @desc Work-stealing job system for the CPU side of a frame. Every worker
+ *       (and the thread that owns the job system, normally the GL thread)
+ *       has its own fixed size deque; owners push and pop at the back, idle
+ *       workers steal from the front. Nothing is allocated after start up.
+ *       Jobs count their unfinished children so a parent only completes after
+ *       everything it spawned.
+ *
+ *       Threads outside the pool, a loader thread say, claim one of a few
+ *       spare deques the first time they submit work. Once those are taken,
+ *       or when a thread's ring has no room left, ParallelFor runs its ranges
+ *       inline on the calling thread instead.
+ */
+
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+struct UJob;
+
+// Job entry point, data points at the job's copied payload
+typedef void (*UJobFunction)(UJob* job, const void* data);
+
+/*
+ * A single unit of work, sized to two cache lines
+ */
+struct UJob {
+	UJobFunction function;
+	UJob* parent;
+	std::atomic<int> unfinished;
+	char payload[128 - sizeof(UJobFunction) - sizeof(UJob*) - sizeof(std::atomic<int>)];
+};
+
+class UJobSystem {
+public:
+
+	// Jobs per thread ring, a thread must not have more than this in flight at once
+	static const size_t JobsPerThread = 4096;
+
+	// Deques kept for threads that are neither the owner nor a worker
+	static const size_t ExternalThreads = 4;
+
+	/*
+	 * @desc Starts workerCount background threads, the creating thread is slot 0
+	 * @parameters number of extra worker threads
+	 */
+	explicit UJobSystem(unsigned workerCount = DefaultWorkerCount()) : running(true), id(UNextId()), owner(std::this_thread::get_id()),
+			workers(workerCount), external(0), queues(workerCount + 1 + ExternalThreads) {
+		for (size_t slot = 0; slot < queues.size(); ++slot) {
+			queues[slot].jobs.reset(new UJob[JobsPerThread]);
+			for (size_t j = 0; j < JobsPerThread; ++j) {
+				queues[slot].jobs[j].unfinished.store(0, std::memory_order_relaxed);
+			}
+			queues[slot].nextJob = 0;
+			queues[slot].ring.reset(new UJob*[JobsPerThread]);
+			queues[slot].front = queues[slot].back = 0;
+		}
+
+		for (unsigned i = 0; i < workerCount; ++i) {
+			threads.push_back(std::thread(&UJobSystem::UWorkerLoop, this, i + 1));
+		}
+	}
+
+	~UJobSystem() {
+		running = false;
+		for (size_t i = 0; i < threads.size(); ++i) {
+			threads[i].join();
+		}
+	}
+
+	/*
+	 * @desc Hardware threads minus the one already running the frame
+	 * @returns worker count
+	 */
+	static unsigned DefaultWorkerCount(void) {
+		unsigned cores = std::thread::hardware_concurrency();
+		return cores > 1 ? cores - 1 : 0;
+	}
+
+	/*
+	 * @desc Number of threads executing jobs, including the owner thread
+	 * @returns thread count
+	 */
+	unsigned ThreadCount(void) const {
+		return workers + 1;
+	}
+
+	/*
+	 * @desc Takes a job from the calling thread's ring and copies the payload
+	 *       into it. Throws if the payload does not fit, if the next job in
+	 *       the ring is still in flight or if the thread has no deque
+	 * @parameters function, payload pointer and size, optional parent job
+	 * @returns the new job, not yet scheduled
+	 */
+	UJob* Create(UJobFunction function, const void* data = NULL, size_t size = 0, UJob* parent = NULL) {
+		if (size > sizeof(UJob::payload)) {
+			throw std::length_error("job payload larger than the job's inline storage");
+		}
+		UQueue& queue = queues[UOwnSlot()];
+		UJob* job = &queue.jobs[queue.nextJob % JobsPerThread];
+		if (job->unfinished.load(std::memory_order_acquire) > 0) {
+			throw std::runtime_error("job ring full, too many jobs in flight on one thread");
+		}
+		++queue.nextJob;
+
+		job->function = function;
+		job->parent = parent;
+		job->unfinished.store(1, std::memory_order_relaxed);
+		if (size > 0) {
+			memcpy(job->payload, data, size);
+		}
+
+		if (parent != NULL) {
+			parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	/*
+	 * @desc Pushes a job onto the calling thread's deque
+	 * @returns void
+	 */
+	void Run(UJob* job) {
+		UQueue& queue = queues[UOwnSlot()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		// Every queued job is live in this thread's ring, so Create has already
+		// refused anything that would not fit here
+		queue.ring[queue.back++ % JobsPerThread] = job;
+	}
+
+	/*
+	 * @desc Executes other jobs until the given job and its children are done
+	 * @returns void
+	 */
+	void Wait(const UJob* job) {
+		size_t slot = UOwnSlot();
+		while (job->unfinished.load(std::memory_order_acquire) > 0) {
+			UJob* next = UGetJob(slot);
+			if (next != NULL) {
+				UExecute(next);
+			}
+			else {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	/*
+	 * @desc Splits [0, count) into grain sized ranges and runs body(begin, end)
+	 *       on them across all threads, returns once every range is done. The
+	 *       ranges run inline, in order, when the calling thread has no deque
+	 *       or not enough free jobs left in its ring, as nested loops may
+	 * @returns void
+	 */
+	template <typename Body>
+	void ParallelFor(size_t count, size_t grain, const Body& body) {
+		static_assert(sizeof(URange<Body>) <= sizeof(UJob::payload), "range must fit a job payload");
+		if (count == 0) {
+			return;
+		}
+		if (grain == 0) {
+			grain = 1;
+		}
+
+		size_t slot = USlot();
+		if (slot == NoSlot || !URoom(queues[slot], (count + grain - 1) / grain + 1)) {
+			for (size_t begin = 0; begin < count; begin += grain) {
+				body(begin, begin + grain < count ? begin + grain : count);
+			}
+			return;
+		}
+
+		UJob* root = Create(UEmptyJob);
+		for (size_t begin = 0; begin < count; begin += grain) {
+			URange<Body> range = { &body, begin, begin + grain < count ? begin + grain : count };
+			Run(Create(URangeJob<Body>, &range, sizeof(range), root));
+		}
+		Run(root);
+		Wait(root);
+	}
+
+private:
+
+	struct UQueue {
+		std::mutex mutex;
+		std::unique_ptr<UJob*[]> ring;
+		size_t front, back;
+		std::unique_ptr<UJob[]> jobs;
+		size_t nextJob;
+	};
+
+	template <typename Body>
+	struct URange {
+		const Body* body;
+		size_t begin, end;
+	};
+
+	// Which job system a pool or external thread belongs to, and its deque there
+	struct UBinding {
+		uint64_t system;
+		size_t slot;
+	};
+
+	static const size_t NoSlot = ~(size_t)0;
+
+	std::atomic<bool> running;
+	uint64_t id;
+	std::thread::id owner;
+	unsigned workers;
+	std::atomic<size_t> external;
+	std::vector<UQueue> queues;
+	std::vector<std::thread> threads;
+
+	/*
+	 * @desc Unique per job system, so a binding left over from a destroyed
+	 *       one never matches a later system at the same address
+	 */
+	static uint64_t UNextId(void) {
+		static std::atomic<uint64_t> next(1);
+		return next.fetch_add(1);
+	}
+
+	static UBinding& UThreadBinding(void) {
+		static thread_local UBinding binding = { 0, 0 };
+		return binding;
+	}
+
+	/*
+	 * @desc Index of the calling thread's deque, claiming a spare one for a
+	 *       thread from outside the pool
+	 * @returns the slot, or NoSlot once every spare deque is taken
+	 */
+	size_t USlot(void) {
+		if (std::this_thread::get_id() == owner) {
+			return 0;
+		}
+		UBinding& binding = UThreadBinding();
+		if (binding.system != id) {
+			size_t claimed = external.fetch_add(1);
+			if (claimed >= ExternalThreads) {
+				return NoSlot;
+			}
+			binding.system = id;
+			binding.slot = workers + 1 + claimed;
+		}
+		return binding.slot;
+	}
+
+	size_t UOwnSlot(void) {
+		size_t slot = USlot();
+		if (slot == NoSlot) {
+			throw std::runtime_error("thread has no job deque, every spare one is taken");
+		}
+		return slot;
+	}
+
+	/*
+	 * @desc Whether the next count jobs of a ring are all finished. Only the
+	 *       owning thread creates jobs in it, so the answer cannot go stale
+	 * @returns true if that many jobs can be created
+	 */
+	static bool URoom(const UQueue& queue, size_t count) {
+		if (count > JobsPerThread) {
+			return false;
+		}
+		for (size_t j = 0; j < count; ++j) {
+			if (queue.jobs[(queue.nextJob + j) % JobsPerThread].unfinished.load(std::memory_order_acquire) > 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static void UEmptyJob(UJob*, const void*) {
+	}
+
+	template <typename Body>
+	static void URangeJob(UJob*, const void* data) {
+		const URange<Body>* range = (const URange<Body>*)data;
+		(*range->body)(range->begin, range->end);
+	}
+
+	/*
+	 * @desc Pops from our own deque, otherwise steals from the others in turn
+	 * @returns a job or NULL when every deque is empty
+	 */
+	UJob* UGetJob(size_t slot) {
+		{
+			UQueue& own = queues[slot];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (own.back != own.front) {
+				return own.ring[--own.back % JobsPerThread];
+			}
+		}
+
+		for (size_t i = 1; i < queues.size(); ++i) {
+			UQueue& victim = queues[(slot + i) % queues.size()];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (victim.back != victim.front) {
+				return victim.ring[victim.front++ % JobsPerThread];
+			}
+		}
+		return NULL;
+	}
+
+	/*
+	 * @desc Runs a job and propagates completion up to its parents
+	 * @returns void
+	 */
+	void UExecute(UJob* job) {
+		job->function(job, job->payload);
+
+		// Once the count reaches zero a waiter may reuse the job, so its
+		// parent is read before the decrement
+		while (job != NULL) {
+			UJob* parent = job->parent;
+			if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+				break;
+			}
+			job = parent;
+		}
+	}
+
+	/*
+	 * @desc Background worker, spins briefly then backs off while idle
+	 * @returns void
+	 */
+	void UWorkerLoop(size_t slot) {
+		UBinding& binding = UThreadBinding();
+		binding.system = id;
+		binding.slot = slot;
+		int idle = 0;
+
+		while (running.load(std::memory_order_relaxed)) {
+			UJob* job = UGetJob(slot);
+			if (job != NULL) {
+				UExecute(job);
+				idle = 0;
+			}
+			else if (++idle < 64) {
+				std::this_thread::yield();
+			}
+			else {
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			}
+		}
+	}
+};
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,184 @@
+/*
+ * @author Jacob William
+ * @desc Material texture table, lets objects with different textures share
+ *       one draw. With ARB_bindless_texture every image keeps its own texture
+ *       and the shader reads its handle from a storage buffer; without it the
+ *       images are packed into an array texture with UPackTextures. Either
+ *       way a material is a uv region plus one index the vertex stage
+ *       forwards, so instance data and draw calls are the same in both modes.
+ *
+ *       Fragment shaders are built with BuildShader, which puts the matching
+ *       declarations and USampleMaterial(index, uv) in front of the body.
+ */
+
+#ifndef MATERIAL_TABLE_H
+#define MATERIAL_TABLE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include "TexturePacker.h"
+
+enum UMaterialMode {
+	UMaterialBindless,
+	UMaterialArray
+};
+
+// Storage buffer binding of the handle table, matches BindlessMaterialHeader
+const GLuint MaterialHandleBinding = 0;
+
+// Padding around packed images in array mode
+const int MaterialPadding = 4;
+
+/*
+ * Bindless handles are 64 bit, read as uvec2. The index comes from a flat
+ * per instance varying, rounded rather than truncated; non uniform handle
+ * indexing needs NV_gpu_shader5 or a driver that tolerates it, which is
+ * every driver exposing the extension today
+ */
+const GLchar* const BindlessMaterialHeader =
+	"#version 450\n"
+	"#extension GL_ARB_bindless_texture : require\n"
+	"layout (std430, binding = 0) readonly buffer UMaterialHandles { uvec2 handles[]; };\n"
+	"vec4 USampleMaterial(float material, vec2 uv) {\n"
+	"	return texture(sampler2D(handles[int(material + 0.5)]), uv);\n"
+	"}\n";
+
+const GLchar* const ArrayMaterialHeader =
+	"#version 330\n"
+	"uniform sampler2DArray uMaterials;\n"
+	"vec4 USampleMaterial(float material, vec2 uv) {\n"
+	"	return texture(uMaterials, vec3(uv, material));\n"
+	"}\n";
+
+class UMaterialTable {
+public:
+
+	UMaterialTable() : mode(UMaterialArray), arrayTexture(0), handleBuffer(0), layerCount(0) {
+	}
+
+	/*
+	 * @desc Uploads one material per image, bindless when the driver has it
+	 *       and allowBindless is set, otherwise as a packed array texture
+	 * @returns void
+	 */
+	void Create(const std::vector<UImage>& images, bool allowBindless) {
+		Destroy();
+		mode = allowBindless && GLEW_ARB_bindless_texture && GLEW_ARB_shader_storage_buffer_object ? UMaterialBindless : UMaterialArray;
+		regions.resize(images.size());
+
+		if (mode == UMaterialArray) {
+			UTexturePack pack = UPackTextures(images, 1024, MaterialPadding);
+			arrayTexture = UUploadTexturePack(pack, MaterialPadding);
+			regions = pack.regions;
+			layerCount = pack.layerCount;
+			return;
+		}
+
+		textures.resize(images.size());
+		handles.resize(images.size());
+		glGenTextures((GLsizei)textures.size(), textures.data());
+		for (size_t i = 0; i < images.size(); ++i) {
+			glBindTexture(GL_TEXTURE_2D, textures[i]);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, images[i].width, images[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, images[i].pixels.data());
+			glGenerateMipmap(GL_TEXTURE_2D);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+			// Parameters are frozen once the handle exists
+			handles[i] = glGetTextureHandleARB(textures[i]);
+			glMakeTextureHandleResidentARB(handles[i]);
+
+			UPackedRegion& region = regions[i];
+			region.uvOffset[0] = 0.0f;
+			region.uvOffset[1] = 0.0f;
+			region.uvScale[0] = 1.0f;
+			region.uvScale[1] = 1.0f;
+			region.layer = (float)i;
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenBuffers(1, &handleBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, handleBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, handles.size() * sizeof(GLuint64), handles.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		layerCount = 0;
+	}
+
+	/*
+	 * @desc Frees the GL objects, called explicitly while the context is alive
+	 * @returns void
+	 */
+	void Destroy(void) {
+		for (size_t i = 0; i < handles.size(); ++i) {
+			glMakeTextureHandleNonResidentARB(handles[i]);
+		}
+		if (!textures.empty()) {
+			glDeleteTextures((GLsizei)textures.size(), textures.data());
+		}
+		glDeleteBuffers(1, &handleBuffer);
+		glDeleteTextures(1, &arrayTexture);
+		textures.clear();
+		handles.clear();
+		handleBuffer = 0;
+		arrayTexture = 0;
+	}
+
+	UMaterialMode Mode(void) const {
+		return mode;
+	}
+
+	const char* ModeName(void) const {
+		return mode == UMaterialBindless ? "bindless handles" : "array texture";
+	}
+
+	/*
+	 * @desc Where material i lives: uv remap and the index for USampleMaterial
+	 */
+	const UPackedRegion& Region(size_t i) const {
+		return regions[i];
+	}
+
+	/*
+	 * @desc Array layers used, 0 in bindless mode
+	 */
+	int LayerCount(void) const {
+		return layerCount;
+	}
+
+	/*
+	 * @desc Prepends the declarations for the current mode to a shader body
+	 *       that calls USampleMaterial
+	 * @returns complete fragment shader source
+	 */
+	std::string BuildShader(const GLchar* body) const {
+		return std::string(mode == UMaterialBindless ? BindlessMaterialHeader : ArrayMaterialHeader) + body;
+	}
+
+	/*
+	 * @desc Makes the table visible to program, one buffer or texture bind
+	 * @returns void
+	 */
+	void Bind(GLuint program) const {
+		if (mode == UMaterialBindless) {
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MaterialHandleBinding, handleBuffer);
+		}
+		else {
+			glBindTexture(GL_TEXTURE_2D_ARRAY, arrayTexture);
+			glUniform1i(glGetUniformLocation(program, "uMaterials"), 0);
+		}
+	}
+
+private:
+
+	UMaterialMode mode;
+	GLuint arrayTexture, handleBuffer;
+	int layerCount;
+	std::vector<GLuint> textures;
+	std::vector<GLuint64> handles;
+	std::vector<UPackedRegion> regions;
+};
+
+#endif // MATERIAL_TABLE_H
@@ -0,0 +1,620 @@
+/*
+ * @author Jacob William
+ * @desc Meshlet compression for very large meshes. An offline pass welds a
+ *       triangle list into an indexed mesh and cuts it into meshlets of at
+ *       most MeshletMaxVertices vertices and MeshletMaxTriangles triangles.
+ *       Every meshlet has its own run of vertices, so its indices are 8 bit
+ *       and reach them through the base vertex, and vertices are packed into
+ *       16 bytes: half float position, 10 bit normal and 8 bit color.
+ *       Each meshlet keeps a bounding sphere and the cone its triangles'
+ *       normals fall in. At draw time meshlets outside the frustum, or whose
+ *       whole cone faces away from the camera, are dropped on the CPU and the
+ *       rest go out as one multi-draw, indirect when the driver has it.
+ *
+ *       The cone test culls what GL_CULL_FACE would, so it only holds for
+ *       meshes drawn with back faces culled. Sheets without thickness are
+ *       made double sided first with UAddBackFaces.
+ *
+ *       File layout: UMeshFileHeader, the vertices, the meshlets, then the
+ *       indices, back to back.
+ */
+
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <vector>
+#include <GL/glew.h>
+
+#include "FrameScene.h"
+#include "TextureCompression.h"
+
+// Limits of one meshlet, the sizes mesh shading hardware is built around
+const int MeshletMaxVertices = 64;
+const int MeshletMaxTriangles = 124;
+
+// Cone cutoff of a meshlet whose normals spread too far to ever be culled
+const float MeshletNoCone = 2.0f;
+
+// Half float xyz and padding, GL_INT_2_10_10_10_REV normal, RGBA8 color
+struct UPackedVertex {
+	uint16_t position[4];
+	uint32_t normal;
+	uint8_t color[4];
+};
+
+struct UMeshlet {
+	float center[3];
+	float radius;
+	float coneAxis[3];
+	float coneCutoff;		// sine of the cone's half angle, MeshletNoCone if it has none
+	uint32_t vertexOffset;
+	uint32_t indexOffset;
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+};
+
+struct UMeshFileHeader {
+	char magic[4];
+	uint32_t vertexCount;
+	uint32_t meshletCount;
+	uint32_t indexCount;
+	uint32_t reserved[4];
+};
+
+// Output of the offline pass, what the file holds
+struct UMeshletData {
+	std::vector<UPackedVertex> vertices;
+	std::vector<UMeshlet> meshlets;
+	std::vector<uint8_t> indices;
+};
+
+// Layout of one glMultiDrawElementsIndirect command
+struct UDrawElementsCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// Counters of the last cull, and the size of the mesh
+struct UMeshletStats {
+	size_t meshlets;
+	size_t triangles;
+	size_t visible;
+	size_t frustumCulled;
+	size_t coneCulled;
+	size_t trianglesDrawn;
+	size_t gpuBytes;
+	double cullMilliseconds;
+};
+
+/*
+ * @desc Rounds a float to the nearest half, tiny values flush to zero
+ */
+inline uint16_t UFloatToHalf(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFF;
+	if (exponent <= 0) {
+		return (uint16_t)sign;
+	}
+	if (exponent >= 31) {
+		return (uint16_t)(sign | 0x7C00);
+	}
+
+	// A carry out of the mantissa correctly bumps the exponent
+	uint32_t half = sign | (uint32_t)exponent << 10 | mantissa >> 13;
+	if (mantissa & 0x1000) {
+		++half;
+	}
+	return (uint16_t)half;
+}
+
+/*
+ * @desc Packs a unit vector into GL_INT_2_10_10_10_REV, w is left 0
+ */
+inline uint32_t UPackNormal(const float normal[3]) {
+	uint32_t packed = 0;
+	for (int c = 0; c < 3; ++c) {
+		int value = (int)std::floor(std::max(-1.0f, std::min(1.0f, normal[c])) * 511.0f + 0.5f);
+		packed |= ((uint32_t)value & 0x3FF) << (10 * c);
+	}
+	return packed;
+}
+
+/*
+ * @desc Splits every triangle of a list into level * level smaller ones,
+ *       all attributes interpolated, winding kept. They come out in 7 x 7
+ *       tiles, 64 vertices and 98 triangles, so UBuildMeshlets fills each
+ *       meshlet from one tile
+ * @parameters triangle list, vertex count, floats per vertex, level
+ * @returns the new triangle list
+ */
+inline std::vector<GLfloat> UTessellate(const GLfloat* vertices, size_t vertexCount, int stride, int level) {
+	std::vector<GLfloat> out;
+	out.reserve(vertexCount * level * level * stride);
+	for (size_t triangle = 0; triangle + 2 < vertexCount; triangle += 3) {
+		const GLfloat* a = vertices + triangle * stride;
+		const GLfloat* b = a + stride;
+		const GLfloat* c = b + stride;
+
+		// Point j steps along ab and i along ac
+		auto emit = [&](int i, int j) {
+			float u = (float)j / level, v = (float)i / level;
+			for (int f = 0; f < stride; ++f) {
+				out.push_back(a[f] + (b[f] - a[f]) * u + (c[f] - a[f]) * v);
+			}
+		};
+		const int tile = 7;
+		for (int ti = 0; ti < level; ti += tile) {
+			for (int tj = 0; ti + tj < level; tj += tile) {
+				for (int i = ti; i < std::min(ti + tile, level); ++i) {
+					for (int j = tj; j < tj + tile && i + j < level; ++j) {
+						emit(i, j);
+						emit(i, j + 1);
+						emit(i + 1, j);
+						if (i + j + 1 < level) {
+							emit(i, j + 1);
+							emit(i + 1, j + 1);
+							emit(i + 1, j);
+						}
+					}
+				}
+			}
+		}
+	}
+	return out;
+}
+
+/*
+ * @desc Appends a reversed copy of every triangle with its normal flipped,
+ *       so a sheet drawn with back faces culled still shows both sides
+ * @parameters position, normal, color triangle list
+ * @returns void
+ */
+inline void UAddBackFaces(std::vector<GLfloat>& vertices) {
+	size_t count = vertices.size() / 9;
+	vertices.reserve(vertices.size() * 2);
+	for (size_t triangle = 0; triangle + 2 < count; triangle += 3) {
+		const int order[3] = { 0, 2, 1 };
+		for (int corner = 0; corner < 3; ++corner) {
+			size_t vertex = (triangle + order[corner]) * 9;
+			for (int f = 0; f < 9; ++f) {
+				GLfloat value = vertices[vertex + f];
+				vertices.push_back(f >= 3 && f < 6 ? -value : value);
+			}
+		}
+	}
+}
+
+/*
+ * @desc Merges bit identical vertices of a triangle list
+ * @parameters triangle list, floats per vertex, unique vertices out, indices out
+ * @returns void
+ */
+inline void UWeldVertices(const std::vector<GLfloat>& vertices, int stride, std::vector<GLfloat>& unique, std::vector<uint32_t>& indices) {
+	size_t count = vertices.size() / stride;
+	size_t buckets = 1;
+	while (buckets < count * 2) {
+		buckets <<= 1;
+	}
+
+	// Open addressing, each bucket holds a unique vertex index plus one
+	std::vector<uint32_t> table(buckets, 0);
+	unique.clear();
+	indices.resize(count);
+	for (size_t v = 0; v < count; ++v) {
+		const GLfloat* vertex = &vertices[v * stride];
+		uint32_t hash = 2166136261u;
+		const unsigned char* bytes = (const unsigned char*)vertex;
+		for (size_t b = 0; b < stride * sizeof(GLfloat); ++b) {
+			hash = (hash ^ bytes[b]) * 16777619u;
+		}
+
+		size_t bucket = hash & (buckets - 1);
+		while (table[bucket] != 0 && memcmp(&unique[(table[bucket] - 1) * (size_t)stride], vertex, stride * sizeof(GLfloat)) != 0) {
+			bucket = (bucket + 1) & (buckets - 1);
+		}
+		if (table[bucket] == 0) {
+			unique.insert(unique.end(), vertex, vertex + stride);
+			table[bucket] = (uint32_t)(unique.size() / stride);
+		}
+		indices[v] = table[bucket] - 1;
+	}
+}
+
+/*
+ * @desc Bounds, cone and packed vertices of one meshlet, appended to data
+ * @returns void
+ */
+inline void UFlushMeshlet(const std::vector<GLfloat>& vertices, const std::vector<uint32_t>& local,
+		const std::vector<uint8_t>& triangles, UMeshletData& data) {
+	UMeshlet meshlet;
+	meshlet.vertexOffset = (uint32_t)data.vertices.size();
+	meshlet.indexOffset = (uint32_t)data.indices.size();
+	meshlet.vertexCount = (uint32_t)local.size();
+	meshlet.triangleCount = (uint32_t)(triangles.size() / 3);
+
+	float low[3] = { 1e30f, 1e30f, 1e30f }, high[3] = { -1e30f, -1e30f, -1e30f };
+	for (size_t v = 0; v < local.size(); ++v) {
+		const GLfloat* vertex = &vertices[local[v] * 9];
+		UPackedVertex packed;
+		for (int c = 0; c < 3; ++c) {
+			packed.position[c] = UFloatToHalf(vertex[c]);
+			packed.color[c] = (uint8_t)std::floor(std::max(0.0f, std::min(1.0f, vertex[6 + c])) * 255.0f + 0.5f);
+			low[c] = std::min(low[c], vertex[c]);
+			high[c] = std::max(high[c], vertex[c]);
+		}
+		packed.position[3] = 0;
+		packed.color[3] = 255;
+		packed.normal = UPackNormal(vertex + 3);
+		data.vertices.push_back(packed);
+	}
+
+	float radius = 0.0f;
+	for (int c = 0; c < 3; ++c) {
+		meshlet.center[c] = 0.5f * (low[c] + high[c]);
+	}
+	for (size_t v = 0; v < local.size(); ++v) {
+		const GLfloat* vertex = &vertices[local[v] * 9];
+		float dx = vertex[0] - meshlet.center[0], dy = vertex[1] - meshlet.center[1], dz = vertex[2] - meshlet.center[2];
+		radius = std::max(radius, std::sqrt(dx * dx + dy * dy + dz * dz));
+	}
+	meshlet.radius = radius;
+
+	// The cone comes from the winding, which is what GL_CULL_FACE looks at
+	std::vector<float> normals;
+	float axis[3] = { 0.0f, 0.0f, 0.0f };
+	for (size_t t = 0; t < triangles.size(); t += 3) {
+		const GLfloat* a = &vertices[local[triangles[t]] * 9];
+		const GLfloat* b = &vertices[local[triangles[t + 1]] * 9];
+		const GLfloat* c = &vertices[local[triangles[t + 2]] * 9];
+		float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float w[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		float n[3] = { u[1] * w[2] - u[2] * w[1], u[2] * w[0] - u[0] * w[2], u[0] * w[1] - u[1] * w[0] };
+		float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (length == 0.0f) {
+			continue;
+		}
+		for (int i = 0; i < 3; ++i) {
+			normals.push_back(n[i] / length);
+			axis[i] += n[i] / length;
+		}
+	}
+	float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	float lowestDot = length > 0.0f ? 1.0f : -1.0f;
+	for (int i = 0; i < 3; ++i) {
+		meshlet.coneAxis[i] = length > 0.0f ? axis[i] / length : 0.0f;
+	}
+	for (size_t n = 0; n < normals.size(); n += 3) {
+		lowestDot = std::min(lowestDot, normals[n] * meshlet.coneAxis[0] + normals[n + 1] * meshlet.coneAxis[1] + normals[n + 2] * meshlet.coneAxis[2]);
+	}
+	meshlet.coneCutoff = lowestDot > 0.0f ? std::sqrt(1.0f - lowestDot * lowestDot) : MeshletNoCone;
+
+	data.meshlets.push_back(meshlet);
+	data.indices.insert(data.indices.end(), triangles.begin(), triangles.end());
+}
+
+/*
+ * @desc Cuts an indexed mesh into meshlets in index order, a meshlet is
+ *       closed when the next triangle would take it past either limit.
+ *       Tessellated and scanned meshes come in with enough locality for
+ *       that to fill them well
+ * @parameters position, normal, color vertices, triangle indices, output
+ * @returns void
+ */
+inline void UBuildMeshlets(const std::vector<GLfloat>& vertices, const std::vector<uint32_t>& indices, UMeshletData& data) {
+	std::vector<int> slot(vertices.size() / 9, -1);
+	std::vector<uint32_t> local;
+	std::vector<uint8_t> triangles;
+	local.reserve(MeshletMaxVertices);
+	triangles.reserve(MeshletMaxTriangles * 3);
+
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		int fresh = 0;
+		for (int corner = 0; corner < 3; ++corner) {
+			uint32_t vertex = indices[t + corner];
+			bool repeated = corner > 0 && indices[t] == vertex;
+			repeated = repeated || (corner == 2 && indices[t + 1] == vertex);
+			if (slot[vertex] < 0 && !repeated) {
+				++fresh;
+			}
+		}
+		if (local.size() + fresh > (size_t)MeshletMaxVertices || triangles.size() / 3 + 1 > (size_t)MeshletMaxTriangles) {
+			UFlushMeshlet(vertices, local, triangles, data);
+			for (size_t v = 0; v < local.size(); ++v) {
+				slot[local[v]] = -1;
+			}
+			local.clear();
+			triangles.clear();
+		}
+		for (int corner = 0; corner < 3; ++corner) {
+			uint32_t vertex = indices[t + corner];
+			if (slot[vertex] < 0) {
+				slot[vertex] = (int)local.size();
+				local.push_back(vertex);
+			}
+			triangles.push_back((uint8_t)slot[vertex]);
+		}
+	}
+	if (!triangles.empty()) {
+		UFlushMeshlet(vertices, local, triangles, data);
+	}
+}
+
+/*
+ * @desc Writes the meshlet file read by UMeshletMesh::Load
+ * @returns false if the file cannot be written
+ */
+inline bool UWriteMeshletFile(const char* path, const UMeshletData& data) {
+	UMeshFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "UMS1", 4);
+	header.vertexCount = (uint32_t)data.vertices.size();
+	header.meshletCount = (uint32_t)data.meshlets.size();
+	header.indexCount = (uint32_t)data.indices.size();
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL) {
+		return false;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1
+			&& fwrite(data.vertices.data(), sizeof(UPackedVertex), data.vertices.size(), file) == data.vertices.size()
+			&& fwrite(data.meshlets.data(), sizeof(UMeshlet), data.meshlets.size(), file) == data.meshlets.size()
+			&& fwrite(data.indices.data(), 1, data.indices.size(), file) == data.indices.size();
+	return fclose(file) == 0 && written;
+}
+
+/*
+ * A meshlet mesh on the GPU and the CPU copy of its bounds for culling.
+ * Attributes are position 0, color 1 and normal 2 like the demo meshes
+ */
+class UMeshletMesh {
+public:
+
+	UMeshletMesh() : vertexArray(0), vertexBuffer(0), indexBuffer(0), indirectBuffer(0), allBuffer(0), triangleCount(0) {
+		memset(&stats, 0, sizeof(stats));
+	}
+
+	/*
+	 * @desc Multi-draw indirect needs GL 4.3, without it the draws go
+	 *       through glMultiDrawElementsBaseVertex
+	 */
+	static bool IndirectSupported(void) {
+		return GLEW_ARB_multi_draw_indirect && GLEW_ARB_draw_indirect;
+	}
+
+	/*
+	 * @desc Uploads a file written by UWriteMeshletFile
+	 * @returns false if the file is missing or malformed
+	 */
+	bool Load(const char* path) {
+		UMappedFile file;
+		if (!file.Open(path) || file.Size() < sizeof(UMeshFileHeader)) {
+			return false;
+		}
+		const UMeshFileHeader* header = (const UMeshFileHeader*)file.Data();
+		size_t size = sizeof(UMeshFileHeader) + (size_t)header->vertexCount * sizeof(UPackedVertex)
+			+ (size_t)header->meshletCount * sizeof(UMeshlet) + header->indexCount;
+		if (memcmp(header->magic, "UMS1", 4) != 0 || file.Size() < size) {
+			return false;
+		}
+
+		const UPackedVertex* vertices = (const UPackedVertex*)(header + 1);
+		const UMeshlet* meshlets = (const UMeshlet*)(vertices + header->vertexCount);
+		const uint8_t* indices = (const uint8_t*)(meshlets + header->meshletCount);
+		for (uint32_t m = 0; m < header->meshletCount; ++m) {
+			if (meshlets[m].vertexOffset + meshlets[m].vertexCount > header->vertexCount
+					|| meshlets[m].indexOffset + meshlets[m].triangleCount * 3 > header->indexCount) {
+				return false;
+			}
+		}
+		Create(vertices, header->vertexCount, meshlets, header->meshletCount, indices, header->indexCount);
+		return true;
+	}
+
+	void Create(const UMeshletData& data) {
+		Create(data.vertices.data(), data.vertices.size(), data.meshlets.data(), data.meshlets.size(), data.indices.data(), data.indices.size());
+	}
+
+	void Create(const UPackedVertex* vertices, size_t vertexCount, const UMeshlet* meshletData, size_t meshletCount,
+			const uint8_t* indices, size_t indexCount) {
+		Destroy();
+		meshlets.assign(meshletData, meshletData + meshletCount);
+
+		glGenVertexArrays(1, &vertexArray);
+		glGenBuffers(1, &vertexBuffer);
+		glGenBuffers(1, &indexBuffer);
+		glBindVertexArray(vertexArray);
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(UPackedVertex), vertices, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount, indices, GL_STATIC_DRAW);
+
+		glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(UPackedVertex), (GLvoid*)offsetof(UPackedVertex, position));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(UPackedVertex), (GLvoid*)offsetof(UPackedVertex, color));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(UPackedVertex), (GLvoid*)offsetof(UPackedVertex, normal));
+		glEnableVertexAttribArray(2);
+		glBindVertexArray(0);
+
+		// Every meshlet once, for DrawAll
+		allCommands.resize(meshletCount);
+		triangleCount = 0;
+		for (size_t m = 0; m < meshletCount; ++m) {
+			UCommand(meshlets[m], allCommands[m]);
+			triangleCount += meshlets[m].triangleCount;
+		}
+		commands.reserve(meshletCount);
+		if (IndirectSupported()) {
+			glGenBuffers(1, &allBuffer);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, allBuffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, meshletCount * sizeof(UDrawElementsCommand), allCommands.data(), GL_STATIC_DRAW);
+			glGenBuffers(1, &indirectBuffer);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, meshletCount * sizeof(UDrawElementsCommand), NULL, GL_STREAM_DRAW);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+
+		memset(&stats, 0, sizeof(stats));
+		stats.meshlets = meshletCount;
+		stats.triangles = triangleCount;
+		stats.gpuBytes = vertexCount * sizeof(UPackedVertex) + indexCount;
+	}
+
+	void Destroy(void) {
+		glDeleteVertexArrays(1, &vertexArray);
+		glDeleteBuffers(1, &vertexBuffer);
+		glDeleteBuffers(1, &indexBuffer);
+		glDeleteBuffers(1, &indirectBuffer);
+		glDeleteBuffers(1, &allBuffer);
+		vertexArray = vertexBuffer = indexBuffer = indirectBuffer = allBuffer = 0;
+		meshlets.clear();
+		allCommands.clear();
+		commands.clear();
+	}
+
+	/*
+	 * @desc Keeps the meshlets that are inside the frustum and have a
+	 *       triangle facing the camera. Both are in model space, which holds
+	 *       for uniform scale only
+	 * @parameters projection * view * model, camera position in model space
+	 * @returns void
+	 */
+	void Cull(const float modelViewProjection[16], const float camera[3]) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		float planes[6][4];
+		UExtractFrustum(modelViewProjection, planes);
+
+		commands.clear();
+		stats.frustumCulled = stats.coneCulled = stats.trianglesDrawn = 0;
+		for (size_t m = 0; m < meshlets.size(); ++m) {
+			const UMeshlet& meshlet = meshlets[m];
+			const float* c = meshlet.center;
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; ++p) {
+				inside = planes[p][0] * c[0] + planes[p][1] * c[1] + planes[p][2] * c[2] + planes[p][3] >= -meshlet.radius;
+			}
+			if (!inside) {
+				++stats.frustumCulled;
+				continue;
+			}
+
+			// Every normal in the cone points away from every point of the
+			// sphere as seen from the camera
+			float d[3] = { c[0] - camera[0], c[1] - camera[1], c[2] - camera[2] };
+			float along = d[0] * meshlet.coneAxis[0] + d[1] * meshlet.coneAxis[1] + d[2] * meshlet.coneAxis[2];
+			float distance = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+			if (along >= meshlet.coneCutoff * distance + meshlet.radius * (1.0f + meshlet.coneCutoff)) {
+				++stats.coneCulled;
+				continue;
+			}
+
+			commands.push_back(allCommands[m]);
+			stats.trianglesDrawn += meshlet.triangleCount;
+		}
+		stats.visible = commands.size();
+		stats.cullMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/*
+	 * @desc Draws what survived the last Cull with the bound program
+	 * @returns void
+	 */
+	void Draw(void) {
+		if (IndirectSupported() && !commands.empty()) {
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, meshlets.size() * sizeof(UDrawElementsCommand), NULL, GL_STREAM_DRAW);
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(UDrawElementsCommand), commands.data());
+		}
+		UDraw(commands, indirectBuffer);
+	}
+
+	/*
+	 * @desc Draws every meshlet, for passes the cone test does not hold in
+	 *       such as shadow maps
+	 * @returns void
+	 */
+	void DrawAll(void) {
+		UDraw(allCommands, allBuffer);
+	}
+
+	size_t TriangleCount(void) const {
+		return triangleCount;
+	}
+
+	UMeshletStats Stats(void) const {
+		return stats;
+	}
+
+	/*
+	 * @desc Writes the last cull and the packed size
+	 * @returns void
+	 */
+	void PrintStats(std::ostream& out) const {
+		out << "meshlets: " << stats.visible << " of " << stats.meshlets << " drawn (" << stats.frustumCulled
+			<< " outside the frustum, " << stats.coneCulled << " facing away), " << stats.trianglesDrawn << " of "
+			<< stats.triangles << " triangles, cull " << stats.cullMilliseconds << " ms, "
+			<< stats.gpuBytes / 1024 << " KiB packed, " << (IndirectSupported() ? "indirect" : "base vertex") << " multi-draw\n";
+	}
+
+private:
+
+	GLuint vertexArray, vertexBuffer, indexBuffer, indirectBuffer, allBuffer;
+	std::vector<UMeshlet> meshlets;
+	std::vector<UDrawElementsCommand> allCommands, commands;
+	size_t triangleCount;
+	UMeshletStats stats;
+
+	// Fallback arguments, rebuilt per draw
+	std::vector<GLsizei> counts;
+	std::vector<const GLvoid*> offsets;
+	std::vector<GLint> baseVertices;
+
+	static void UCommand(const UMeshlet& meshlet, UDrawElementsCommand& command) {
+		command.count = meshlet.triangleCount * 3;
+		command.instanceCount = 1;
+		command.firstIndex = meshlet.indexOffset;
+		command.baseVertex = (GLint)meshlet.vertexOffset;
+		command.baseInstance = 0;
+	}
+
+	void UDraw(const std::vector<UDrawElementsCommand>& list, GLuint buffer) {
+		if (list.empty()) {
+			return;
+		}
+		glBindVertexArray(vertexArray);
+		if (IndirectSupported()) {
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_BYTE, (GLvoid*)0, (GLsizei)list.size(), 0);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+		else {
+			counts.resize(list.size());
+			offsets.resize(list.size());
+			baseVertices.resize(list.size());
+			for (size_t d = 0; d < list.size(); ++d) {
+				counts[d] = (GLsizei)list[d].count;
+				offsets[d] = (const GLvoid*)(size_t)list[d].firstIndex;
+				baseVertices[d] = list[d].baseVertex;
+			}
+			glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), GL_UNSIGNED_BYTE, offsets.data(),
+				(GLsizei)list.size(), baseVertices.data());
+		}
+		glBindVertexArray(0);
+	}
+};
+
+#endif // MESHLETS_H
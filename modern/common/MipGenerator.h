@@ -0,0 +1,257 @@
+/*
+ * @author Jacob William
+ * @desc CPU mip chain generator. Each level is a 2:1 separable Lanczos-2
+ *       downsample done in linear light (sRGB is decoded first and encoded
+ *       again per level), so bright and dark detail keep their weight. Rows
+ *       are split into tiles over the job system and the inner loops work on
+ *       whole RGBA pixels with SSE where available.
+ *
+ *       Odd sizes are handled by dropping the last row or column, as the GL
+ *       mip size rules do.
+ */
+
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "Image.h"
+#include "JobSystem.h"
+
+// Rows per job
+const int MipTileRows = 16;
+
+// Taps of the 2:1 kernel, centred between source pixels 3 and 4
+const int MipTaps = 8;
+
+// Kernel weights and sRGB conversion tables, built once on first use
+struct UMipTables {
+	float weights[MipTaps];
+	float toLinear[256];
+	unsigned char toSrgb[4096];
+
+	UMipTables() {
+		const double pi = 3.14159265358979323846;
+
+		// Lanczos-2 at the distances of the 8 source pixels, in destination pixels
+		float sum = 0.0f;
+		for (int k = 0; k < MipTaps; ++k) {
+			double x = (k - 3.5) / 2.0;
+			weights[k] = (float)(2.0 * std::sin(pi * x) * std::sin(pi * x / 2.0) / (pi * pi * x * x));
+			sum += weights[k];
+		}
+		for (int k = 0; k < MipTaps; ++k) {
+			weights[k] /= sum;
+		}
+
+		for (int i = 0; i < 256; ++i) {
+			double c = i / 255.0;
+			toLinear[i] = (float)(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+		}
+
+		// Indexed by 12 bit linear value
+		for (int i = 0; i < 4096; ++i) {
+			double c = i / 4095.0;
+			double s = c <= 0.0031308 ? c * 12.92 : 1.055 * std::pow(c, 1.0 / 2.4) - 0.055;
+			toSrgb[i] = (unsigned char)(s * 255.0 + 0.5);
+		}
+	}
+};
+
+/*
+ * @desc Shared tables, safe to call from worker threads
+ */
+inline const UMipTables& UGetMipTables(void) {
+	static const UMipTables tables;
+	return tables;
+}
+
+/*
+ * @desc Linear float to sRGB byte
+ */
+inline unsigned char ULinearToSrgb(const UMipTables& tables, float value) {
+	int index = (int)(value * 4095.0f + 0.5f);
+	return tables.toSrgb[std::min(4095, std::max(0, index))];
+}
+
+// Linear RGBA float image, one level of the working chain
+struct UMipLevel {
+	int width;
+	int height;
+	std::vector<float> pixels;
+};
+
+/*
+ * @desc Weighted sum of MipTaps RGBA pixels
+ * @returns void, result written to out[0..3]
+ */
+inline void UFilterPixel(const float* const* source, const float* weights, float* out) {
+#ifdef __SSE2__
+	__m128 sum = _mm_setzero_ps();
+	for (int k = 0; k < MipTaps; ++k) {
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(source[k]), _mm_set1_ps(weights[k])));
+	}
+	_mm_storeu_ps(out, sum);
+#else
+	float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int k = 0; k < MipTaps; ++k) {
+		for (int c = 0; c < 4; ++c) {
+			sum[c] += source[k][c] * weights[k];
+		}
+	}
+	for (int c = 0; c < 4; ++c) {
+		out[c] = sum[c];
+	}
+#endif
+}
+
+/*
+ * @desc Weighted sum of MipTaps whole rows of floats
+ * @returns void, result written to out[0..count)
+ */
+inline void UFilterRow(const float* const* rows, const float* weights, size_t count, float* out) {
+	size_t i = 0;
+#ifdef __SSE2__
+	for (; i + 4 <= count; i += 4) {
+		__m128 sum = _mm_setzero_ps();
+		for (int k = 0; k < MipTaps; ++k) {
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[k] + i), _mm_set1_ps(weights[k])));
+		}
+		_mm_storeu_ps(out + i, sum);
+	}
+#endif
+	for (; i < count; ++i) {
+		float sum = 0.0f;
+		for (int k = 0; k < MipTaps; ++k) {
+			sum += rows[k][i] * weights[k];
+		}
+		out[i] = sum;
+	}
+}
+
+/*
+ * @desc Halves an image given as linear rows. The vertical pass runs first
+ *       over whole contiguous rows, the horizontal pass then only sees half
+ *       the rows. Both are split into row tiles over the job system, each
+ *       tile fetches the source rows it needs once
+ * @parameters job system, source size, source(y, scratch) returning row y
+ *             as linear RGBA floats, either in place or written to scratch
+ * @returns the next level
+ */
+template <typename RowSource>
+UMipLevel UDownsampleRows(UJobSystem& jobs, int sourceWidth, int sourceHeight, RowSource source) {
+	const float* weights = UGetMipTables().weights;
+	int width = std::max(1, sourceWidth / 2), height = std::max(1, sourceHeight / 2);
+	size_t sourceRow = (size_t)sourceWidth * 4;
+
+	// Vertical: full width, half height
+	std::vector<float> vertical(sourceRow * height);
+	jobs.ParallelFor(height, MipTileRows, [&](size_t begin, size_t end) {
+		int first = std::max(2 * (int)begin - 3, 0), last = std::min(2 * (int)end + 4, sourceHeight - 1);
+		std::vector<float> scratch(sourceRow * (last - first + 1));
+		std::vector<const float*> fetched(last - first + 1);
+		for (int sy = first; sy <= last; ++sy) {
+			fetched[sy - first] = source(sy, &scratch[(sy - first) * sourceRow]);
+		}
+
+		const float* rows[MipTaps];
+		for (size_t y = begin; y < end; ++y) {
+			for (int k = 0; k < MipTaps; ++k) {
+				int sy = std::min(std::max(2 * (int)y + k - 3, 0), sourceHeight - 1);
+				rows[k] = fetched[sy - first];
+			}
+			UFilterRow(rows, weights, sourceRow, &vertical[y * sourceRow]);
+		}
+	});
+
+	// Horizontal: half width, clamping only near the edges
+	UMipLevel next;
+	next.width = width;
+	next.height = height;
+	next.pixels.resize((size_t)width * height * 4);
+
+	jobs.ParallelFor(height, MipTileRows, [&](size_t begin, size_t end) {
+		const float* taps[MipTaps];
+		for (size_t y = begin; y < end; ++y) {
+			const float* row = &vertical[y * sourceRow];
+			float* out = &next.pixels[y * width * 4];
+			for (int x = 0; x < width; ++x) {
+				int first = 2 * x - 3;
+				if (first >= 0 && first + MipTaps <= sourceWidth) {
+					for (int k = 0; k < MipTaps; ++k) {
+						taps[k] = row + (first + k) * 4;
+					}
+				}
+				else {
+					for (int k = 0; k < MipTaps; ++k) {
+						taps[k] = row + std::min(std::max(first + k, 0), sourceWidth - 1) * 4;
+					}
+				}
+				UFilterPixel(taps, weights, out + x * 4);
+			}
+		}
+	});
+
+	return next;
+}
+
+/*
+ * @desc Builds the full mip chain of an sRGB image, alpha is filtered linearly.
+ *       Level 0 is decoded to linear a tile at a time and never held whole
+ * @parameters job system, level 0
+ * @returns levels, largest first, level 0 is a copy of image
+ */
+inline std::vector<UImage> UGenerateMipChain(UJobSystem& jobs, const UImage& image) {
+	const UMipTables& tables = UGetMipTables();
+	std::vector<UImage> levels(1, image);
+	if (image.width <= 1 && image.height <= 1) {
+		return levels;
+	}
+
+	UMipLevel current = UDownsampleRows(jobs, image.width, image.height, [&](int y, float* scratch) {
+		const unsigned char* row = &image.pixels[(size_t)y * image.width * 4];
+		for (int i = 0; i < image.width * 4; i += 4) {
+			scratch[i + 0] = tables.toLinear[row[i + 0]];
+			scratch[i + 1] = tables.toLinear[row[i + 1]];
+			scratch[i + 2] = tables.toLinear[row[i + 2]];
+			scratch[i + 3] = row[i + 3] / 255.0f;
+		}
+		return (const float*)scratch;
+	});
+
+	for (;;) {
+		UImage level;
+		level.width = current.width;
+		level.height = current.height;
+		level.pixels.resize((size_t)level.width * level.height * 4);
+
+		jobs.ParallelFor(level.height, MipTileRows, [&](size_t begin, size_t end) {
+			for (size_t i = begin * level.width * 4; i < end * level.width * 4; i += 4) {
+				level.pixels[i + 0] = ULinearToSrgb(tables, current.pixels[i + 0]);
+				level.pixels[i + 1] = ULinearToSrgb(tables, current.pixels[i + 1]);
+				level.pixels[i + 2] = ULinearToSrgb(tables, current.pixels[i + 2]);
+				level.pixels[i + 3] = (unsigned char)std::min(255.0f, std::max(0.0f, current.pixels[i + 3] * 255.0f + 0.5f));
+			}
+		});
+		levels.push_back(level);
+
+		if (current.width <= 1 && current.height <= 1) {
+			return levels;
+		}
+		UMipLevel previous;
+		previous.width = current.width;
+		previous.height = current.height;
+		previous.pixels.swap(current.pixels);
+		current = UDownsampleRows(jobs, previous.width, previous.height, [&](int y, float*) {
+			return (const float*)&previous.pixels[(size_t)y * previous.width * 4];
+		});
+	}
+}
+
+#endif // MIP_GENERATOR_H
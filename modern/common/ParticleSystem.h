@@ -0,0 +1,524 @@
+/*
+ * @author Jacob William
+ * @desc GPU particle system. Particles live in two storage buffers used in
+ *       turn; each frame one compute pass ages and moves the live ones and
+ *       appends the survivors to the other buffer through an atomic
+ *       counter, a second appends the newly emitted ones and a one thread
+ *       pass writes the live count into the indirect draw and dispatch
+ *       arguments. Drawing is one instanced billboard per particle from the
+ *       indirect arguments, so the CPU never touches a particle or reads
+ *       the count back. Needs GL 4.3 compute shaders and storage buffers.
+ */
+
+#ifndef PARTICLE_SYSTEM_H
+#define PARTICLE_SYSTEM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <GL/glew.h>
+
+// Threads per compute work group, matches local_size_x in the shaders
+const GLuint ParticleGroupSize = 256;
+
+// Storage buffer bindings, match ParticleBlocksShader
+const GLuint ParticleSourceBinding = 0;
+const GLuint ParticleTargetBinding = 1;
+const GLuint ParticleStateBinding = 2;
+
+// Frames between issuing a timer query and reading it
+const int ParticleQueryLatency = 3;
+
+struct UParticleSettings {
+	GLuint capacity;		// most particles alive at once
+	float emitRate;			// particles per second
+	float lifetime;			// longest life in seconds, each gets 50 to 100% of it
+	float origin[3];
+	float speed;			// launch speed
+	float spread;			// half angle of the launch cone around +y, radians
+	float gravity;
+	float size;				// billboard half size in world units
+};
+
+// One particle in the storage buffers, 32 bytes
+struct UParticle {
+	float position[3];
+	float life;				// seconds left
+	float velocity[3];
+	float lifetime;			// seconds it was born with
+};
+
+// Layout of the state buffer, starts with the indirect draw and dispatch arguments
+struct UParticleState {
+	GLuint drawCount, drawInstances, drawFirst, drawBaseInstance;
+	GLuint dispatchX, dispatchY, dispatchZ;
+	GLuint liveCount;
+	GLuint nextCount;		// append counter of the frame being simulated
+	GLuint padding[3];
+};
+
+struct UParticleStats {
+	uint64_t frames;
+	uint64_t emitted;			// requested, dropped when the buffer is full
+	double simulateMilliseconds;	// GPU, frames whose timers have been read
+	double drawMilliseconds;
+	uint64_t timedFrames;
+};
+
+#ifndef GLSL_PART
+#define GLSL_PART(Source) #Source "\n"
+#endif
+
+/*
+ * Buffers every particle shader declares, goes after the #version line
+ */
+const GLchar* ParticleBlocksShader = GLSL_PART(
+	struct UParticle {
+		vec4 positionLife;
+		vec4 velocityLifetime;
+	};
+	layout (std430, binding = 0) readonly buffer UParticleSource { UParticle source[]; };
+	layout (std430, binding = 1) writeonly buffer UParticleTarget { UParticle target[]; };
+	layout (std430, binding = 2) buffer UParticleStateBlock {
+		uint drawCount;
+		uint drawInstances;
+		uint drawFirst;
+		uint drawBaseInstance;
+		uint dispatchX;
+		uint dispatchY;
+		uint dispatchZ;
+		uint liveCount;
+		uint nextCount;
+	};
+);
+
+/*
+ * Ages and moves the live particles, survivors are appended to the target
+ */
+const GLchar* ParticleSimulateShader = GLSL_PART(
+	layout (local_size_x = 256) in;
+	uniform float uDeltaTime;
+	uniform float uGravity;
+	void main() {
+		uint i = gl_GlobalInvocationID.x;
+		if (i >= liveCount) {
+			return;
+		}
+		UParticle particle = source[i];
+		particle.positionLife.w -= uDeltaTime;
+		if (particle.positionLife.w <= 0.0) {
+			return;
+		}
+		particle.velocityLifetime.y -= uGravity * uDeltaTime;
+		particle.positionLife.xyz += particle.velocityLifetime.xyz * uDeltaTime;
+		target[atomicAdd(nextCount, 1u)] = particle;
+	}
+);
+
+/*
+ * Appends uEmitCount new particles behind the survivors while there is room
+ */
+const GLchar* ParticleEmitShader = GLSL_PART(
+	layout (local_size_x = 256) in;
+	uniform uint uEmitCount;
+	uniform uint uCapacity;
+	uniform uint uSeed;
+	uniform vec3 uOrigin;
+	uniform float uSpeed;
+	uniform float uSpread;
+	uniform float uLifetime;
+
+	uint UHash(uint x) {
+		x ^= x >> 16;
+		x *= 0x7feb352du;
+		x ^= x >> 15;
+		x *= 0x846ca68bu;
+		x ^= x >> 16;
+		return x;
+	}
+
+	float URandom(inout uint state) {
+		state = UHash(state);
+		return float(state) / 4294967295.0;
+	}
+
+	void main() {
+		uint i = gl_GlobalInvocationID.x;
+		if (i >= uEmitCount) {
+			return;
+		}
+		uint slot = atomicAdd(nextCount, 1u);
+		if (slot >= uCapacity) {
+			return;
+		}
+		uint state = uSeed ^ (i * 0x9e3779b9u);
+		float angle = 6.2831853 * URandom(state);
+		float cone = uSpread * sqrt(URandom(state));
+		vec3 direction = vec3(sin(cone) * cos(angle), cos(cone), sin(cone) * sin(angle));
+		float life = uLifetime * (0.5 + 0.5 * URandom(state));
+
+		UParticle particle;
+		particle.positionLife = vec4(uOrigin, life);
+		particle.velocityLifetime = vec4(direction * uSpeed * (0.75 + 0.25 * URandom(state)), life);
+		target[slot] = particle;
+	}
+);
+
+/*
+ * One thread: the appended count becomes next frame's live count and the
+ * indirect arguments
+ */
+const GLchar* ParticleFinishShader = GLSL_PART(
+	layout (local_size_x = 1) in;
+	uniform uint uCapacity;
+	void main() {
+		liveCount = min(nextCount, uCapacity);
+		nextCount = 0u;
+		drawCount = 4u;
+		drawInstances = liveCount;
+		drawFirst = 0u;
+		drawBaseInstance = 0u;
+		dispatchX = (liveCount + 255u) / 256u;
+		dispatchY = 1u;
+		dispatchZ = 1u;
+	}
+);
+
+/*
+ * Billboards facing the camera, one instance per live particle read from
+ * the source buffer
+ */
+const GLchar* ParticleVertexShader = GLSL_PART(
+	uniform mat4 view;
+	uniform mat4 projection;
+	uniform float uSize;
+	out vec2 corner;
+	out float fade;
+	void main() {
+		UParticle particle = source[gl_InstanceID];
+		corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+		vec4 eye = view * vec4(particle.positionLife.xyz, 1.0);
+		eye.xy += corner * uSize;
+		gl_Position = projection * eye;
+		fade = particle.positionLife.w / particle.velocityLifetime.w;
+	}
+);
+
+/*
+ * Round soft sprite, hot while young and cooling as it dies, added to
+ * what is behind it
+ */
+const GLchar* ParticleFragmentShader = GLSL_PART(
+	in vec2 corner;
+	in float fade;
+	out vec4 gpuColor;
+	void main() {
+		float falloff = max(1.0 - dot(corner, corner), 0.0);
+		vec3 color = mix(vec3(1.0, 0.3, 0.05), vec3(1.0, 0.9, 0.5), fade);
+		gpuColor = vec4(color * falloff * fade, 1.0);
+	}
+);
+
+class UParticleSystem {
+public:
+
+	UParticleSystem() : simulateProgram(0), emitProgram(0), finishProgram(0), drawProgram(0), stateBuffer(0),
+			vertexArray(0), current(0), emitCarry(0.0f), seed(1), frame(0) {
+		buffers[0] = buffers[1] = 0;
+		memset(&settings, 0, sizeof(settings));
+		memset(queries, 0, sizeof(queries));
+		memset(pending, 0, sizeof(pending));
+		memset(&stats, 0, sizeof(stats));
+	}
+
+	/*
+	 * @desc Whether the context has what the particles need. GL 4.3 only
+	 *       promises storage blocks to compute and fragment shaders, the
+	 *       draw reads the particles in its vertex shader
+	 * @returns true with compute shaders, storage buffers readable in a
+	 *          vertex shader and indirect draws
+	 */
+	static bool Supported(void) {
+		if (!GLEW_ARB_compute_shader || !GLEW_ARB_shader_storage_buffer_object || !GLEW_ARB_draw_indirect) {
+			return false;
+		}
+		GLint vertexBlocks = 0;
+		glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &vertexBlocks);
+		return vertexBlocks > 0;
+	}
+
+	/*
+	 * @desc Compiles the programs and creates empty particle buffers of
+	 *       settings.capacity particles
+	 * @returns false without support or when a program does not link
+	 */
+	bool Create(const UParticleSettings& particleSettings) {
+		if (!Supported()) {
+			return false;
+		}
+		settings = particleSettings;
+		simulateProgram = UCompileCompute(ParticleSimulateShader);
+		emitProgram = UCompileCompute(ParticleEmitShader);
+		finishProgram = UCompileCompute(ParticleFinishShader);
+		drawProgram = UCompileDraw();
+		if (!simulateProgram || !emitProgram || !finishProgram || !drawProgram) {
+			Destroy();
+			return false;
+		}
+
+		glGenBuffers(2, buffers);
+		for (int b = 0; b < 2; ++b) {
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[b]);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)settings.capacity * sizeof(UParticle), NULL, GL_DYNAMIC_COPY);
+		}
+
+		// Nothing alive, the first simulate dispatch has no groups
+		UParticleState state;
+		memset(&state, 0, sizeof(state));
+		state.drawCount = 4;
+		state.dispatchY = state.dispatchZ = 1;
+		glGenBuffers(1, &stateBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, stateBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(state), &state, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		// Billboards read no attributes but a vertex array must be bound
+		glGenVertexArrays(1, &vertexArray);
+		glGenQueries(ParticleQueryLatency * 2, &queries[0][0]);
+		return true;
+	}
+
+	/*
+	 * @desc Frees the GL objects, called explicitly while the context is alive
+	 * @returns void
+	 */
+	void Destroy(void) {
+		glDeleteProgram(simulateProgram);
+		glDeleteProgram(emitProgram);
+		glDeleteProgram(finishProgram);
+		glDeleteProgram(drawProgram);
+		glDeleteBuffers(2, buffers);
+		glDeleteBuffers(1, &stateBuffer);
+		glDeleteVertexArrays(1, &vertexArray);
+		if (queries[0][0] != 0) {
+			glDeleteQueries(ParticleQueryLatency * 2, &queries[0][0]);
+		}
+		simulateProgram = emitProgram = finishProgram = drawProgram = 0;
+		buffers[0] = buffers[1] = stateBuffer = vertexArray = 0;
+		memset(queries, 0, sizeof(queries));
+	}
+
+	/*
+	 * @desc Advances every particle by deltaTime seconds and emits
+	 *       emitRate * deltaTime new ones, carrying the fraction over. The
+	 *       CPU only issues the three dispatches. Once per frame, before Draw
+	 * @returns void
+	 */
+	void Simulate(float deltaTime) {
+		int slot = (int)(frame % ParticleQueryLatency);
+		if (pending[slot]) {
+			UCollect(slot);
+		}
+		glBeginQuery(GL_TIME_ELAPSED, queries[slot][0]);
+
+		float emit = settings.emitRate * deltaTime + emitCarry;
+		GLuint emitCount = (GLuint)emit;
+		emitCarry = emit - emitCount;
+		if (emitCount > settings.capacity) {
+			emitCount = settings.capacity;
+		}
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ParticleSourceBinding, buffers[current]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ParticleTargetBinding, buffers[1 - current]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ParticleStateBinding, stateBuffer);
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, stateBuffer);
+
+		glUseProgram(simulateProgram);
+		glUniform1f(glGetUniformLocation(simulateProgram, "uDeltaTime"), deltaTime);
+		glUniform1f(glGetUniformLocation(simulateProgram, "uGravity"), settings.gravity);
+		glDispatchComputeIndirect((GLintptr)offsetof(UParticleState, dispatchX));
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		if (emitCount > 0) {
+			glUseProgram(emitProgram);
+			glUniform1ui(glGetUniformLocation(emitProgram, "uEmitCount"), emitCount);
+			glUniform1ui(glGetUniformLocation(emitProgram, "uCapacity"), settings.capacity);
+			glUniform1ui(glGetUniformLocation(emitProgram, "uSeed"), UHash(seed++));
+			glUniform3fv(glGetUniformLocation(emitProgram, "uOrigin"), 1, settings.origin);
+			glUniform1f(glGetUniformLocation(emitProgram, "uSpeed"), settings.speed);
+			glUniform1f(glGetUniformLocation(emitProgram, "uSpread"), settings.spread);
+			glUniform1f(glGetUniformLocation(emitProgram, "uLifetime"), settings.lifetime);
+			glDispatchCompute((emitCount + ParticleGroupSize - 1) / ParticleGroupSize, 1, 1);
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		}
+
+		glUseProgram(finishProgram);
+		glUniform1ui(glGetUniformLocation(finishProgram, "uCapacity"), settings.capacity);
+		glDispatchCompute(1, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+		glEndQuery(GL_TIME_ELAPSED);
+		current = 1 - current;
+		stats.emitted += emitCount;
+	}
+
+	/*
+	 * @desc Draws the live particles as additive billboards, depth tested
+	 *       but not written. Matrices are column-major
+	 * @returns void
+	 */
+	void Draw(const float* view, const float* projection) {
+		int slot = (int)(frame % ParticleQueryLatency);
+		glBeginQuery(GL_TIME_ELAPSED, queries[slot][1]);
+
+		glUseProgram(drawProgram);
+		glUniformMatrix4fv(glGetUniformLocation(drawProgram, "view"), 1, GL_FALSE, view);
+		glUniformMatrix4fv(glGetUniformLocation(drawProgram, "projection"), 1, GL_FALSE, projection);
+		glUniform1f(glGetUniformLocation(drawProgram, "uSize"), settings.size);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ParticleSourceBinding, buffers[current]);
+
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE);
+		glDepthMask(GL_FALSE);
+		glBindVertexArray(vertexArray);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stateBuffer);
+		glDrawArraysIndirect(GL_TRIANGLE_STRIP, (const GLvoid*)offsetof(UParticleState, drawCount));
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		glBindVertexArray(0);
+		glDepthMask(GL_TRUE);
+		glDisable(GL_BLEND);
+
+		glEndQuery(GL_TIME_ELAPSED);
+		pending[slot] = true;
+		stats.frames++;
+		++frame;
+	}
+
+	/*
+	 * @desc Reads the live count back, waits for the GPU so only for stats
+	 * @returns live particles
+	 */
+	GLuint LiveCount(void) const {
+		UParticleState state;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, stateBuffer);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(state), &state);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		return state.liveCount;
+	}
+
+	const UParticleSettings& Settings(void) const {
+		return settings;
+	}
+
+	UParticleStats Stats(void) const {
+		return stats;
+	}
+
+	void ResetStats(void) {
+		memset(&stats, 0, sizeof(stats));
+	}
+
+	/*
+	 * @desc One line: live count and GPU time per frame of each half
+	 * @returns void
+	 */
+	void PrintStats(std::ostream& out) const {
+		out << "particles: " << LiveCount() << " live of " << settings.capacity;
+		if (stats.timedFrames > 0) {
+			out << ", simulate " << stats.simulateMilliseconds / stats.timedFrames << " ms, draw "
+				<< stats.drawMilliseconds / stats.timedFrames << " ms GPU per frame";
+		}
+		out << std::endl;
+	}
+
+private:
+
+	static GLuint UHash(GLuint x) {
+		x ^= x >> 16;
+		x *= 0x7feb352du;
+		x ^= x >> 15;
+		x *= 0x846ca68bu;
+		x ^= x >> 16;
+		return x;
+	}
+
+	/*
+	 * @desc Builds a compute program from the blocks and one kernel
+	 * @returns the program, 0 when it does not link
+	 */
+	static GLuint UCompileCompute(const GLchar* kernel) {
+		const GLchar* sources[] = { "#version 430\n", ParticleBlocksShader, kernel };
+		GLuint shaderId = glCreateShader(GL_COMPUTE_SHADER);
+		glShaderSource(shaderId, 3, sources, NULL);
+		glCompileShader(shaderId);
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, shaderId);
+		glLinkProgram(program);
+		glDeleteShader(shaderId);
+		return ULinked(program);
+	}
+
+	/*
+	 * @desc Builds the billboard program
+	 * @returns the program, 0 when it does not link
+	 */
+	static GLuint UCompileDraw(void) {
+		const GLchar* vertexSources[] = { "#version 430\n", ParticleBlocksShader, ParticleVertexShader };
+		GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(vertexShaderId, 3, vertexSources, NULL);
+		glCompileShader(vertexShaderId);
+
+		const GLchar* fragmentSources[] = { "#version 430\n", ParticleFragmentShader };
+		GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(fragmentShaderId, 2, fragmentSources, NULL);
+		glCompileShader(fragmentShaderId);
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vertexShaderId);
+		glAttachShader(program, fragmentShaderId);
+		glLinkProgram(program);
+		glDeleteShader(vertexShaderId);
+		glDeleteShader(fragmentShaderId);
+		return ULinked(program);
+	}
+
+	static GLuint ULinked(GLuint program) {
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (linked != GL_TRUE) {
+			glDeleteProgram(program);
+			return 0;
+		}
+		return program;
+	}
+
+	/*
+	 * @desc Adds the timers issued ParticleQueryLatency frames ago
+	 * @returns void
+	 */
+	void UCollect(int slot) {
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(queries[slot][0], GL_QUERY_RESULT, &nanoseconds);
+		stats.simulateMilliseconds += nanoseconds / 1e6;
+		glGetQueryObjectui64v(queries[slot][1], GL_QUERY_RESULT, &nanoseconds);
+		stats.drawMilliseconds += nanoseconds / 1e6;
+		stats.timedFrames++;
+		pending[slot] = false;
+	}
+
+	UParticleSettings settings;
+	GLuint simulateProgram, emitProgram, finishProgram, drawProgram;
+	GLuint buffers[2], stateBuffer, vertexArray;
+	int current;			// buffer holding the live particles
+	float emitCarry;
+	GLuint seed;
+	uint64_t frame;
+	GLuint queries[ParticleQueryLatency][2];	// simulate, draw
+	bool pending[ParticleQueryLatency];
+	UParticleStats stats;
+};
+
+#endif // PARTICLE_SYSTEM_H
@@ -0,0 +1,402 @@
+/*
+ * @author Jacob William
+ * @desc Procedural indexed meshes for stress scenes: subdivided cubes,
+ *       spheres, tessellated chairs, terrain grids and fields of scattered
+ *       instances. Every generator takes a triangle budget and rounds it to
+ *       the nearest size it can build, sizes the output once and fills it
+ *       on the job system. Random values are hashed from the seed and the
+ *       element index instead of drawn in order, so the output is the same
+ *       for any thread count.
+ *
+ *       Vertices are position, normal and color like UAddFlatNormals, the
+ *       layout the demos' lit shaders read; indices are 32 bit and
+ *       triangles wind counter-clockwise seen from outside.
+ */
+
+#ifndef PROCEDURAL_MESHES_H
+#define PROCEDURAL_MESHES_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <GL/glew.h>
+
+#include "DemoMeshes.h"
+#include "JobSystem.h"
+#include "Resources.h"
+
+// Floats per vertex: position, normal, color
+const int ProceduralStride = 9;
+
+/*
+ * Generated vertices and indices, left uninitialized until a generator
+ * fills them so the first touch happens on the workers
+ */
+struct UProceduralMesh {
+	std::unique_ptr<GLfloat[]> vertices;
+	std::unique_ptr<uint32_t[]> indices;
+	size_t vertexCount;
+	size_t indexCount;
+
+	UProceduralMesh() : vertexCount(0), indexCount(0) {
+	}
+
+	void Allocate(size_t vertexTotal, size_t indexTotal) {
+		vertices.reset(new GLfloat[vertexTotal * ProceduralStride]);
+		indices.reset(new uint32_t[indexTotal]);
+		vertexCount = vertexTotal;
+		indexCount = indexTotal;
+	}
+
+	size_t TriangleCount(void) const {
+		return indexCount / 3;
+	}
+
+	size_t Bytes(void) const {
+		return vertexCount * ProceduralStride * sizeof(GLfloat) + indexCount * sizeof(uint32_t);
+	}
+};
+
+/*
+ * @desc Integer hash with good avalanche, the source of every random value
+ */
+inline uint32_t UHash(uint32_t x) {
+	x ^= x >> 16;
+	x *= 0x7FEB352Du;
+	x ^= x >> 15;
+	x *= 0x846CA68Bu;
+	x ^= x >> 16;
+	return x;
+}
+
+/*
+ * @desc Random float in [0, 1) for element index, stream picks one of
+ *       several values per element
+ */
+inline float UHashUnit(uint32_t seed, uint32_t index, uint32_t stream) {
+	return (UHash(seed ^ UHash(index * 8 + stream)) >> 8) * (1.0f / 16777216.0f);
+}
+
+/*
+ * @desc Side of the square grid whose quads come closest to triangles
+ *       triangles spread over patches patches
+ */
+inline size_t UGridSide(size_t triangles, size_t patches) {
+	return std::max<size_t>(1, (size_t)(std::sqrt((double)triangles / (2.0 * patches)) + 0.5));
+}
+
+inline void UWriteVertex(GLfloat* out, const float position[3], const float normal[3], const float color[3]) {
+	for (int c = 0; c < 3; ++c) {
+		out[c] = position[c];
+		out[3 + c] = normal[c];
+		out[6 + c] = color[c];
+	}
+}
+
+/*
+ * @desc Fills patches square grids of side quads. Vertex rows and quad rows
+ *       are spread across the job system, vertex(patch, u, v, out) writes
+ *       one vertex for u and v in [0, 1]
+ * @returns void
+ */
+template <typename Vertex>
+inline void UBuildGridPatches(UJobSystem& jobs, size_t patches, size_t side, UProceduralMesh& mesh, const Vertex& vertex) {
+	size_t row = side + 1;
+	mesh.Allocate(patches * row * row, patches * side * side * 6);
+	GLfloat* vertices = mesh.vertices.get();
+	uint32_t* indices = mesh.indices.get();
+
+	// One job per group of rows, at most about a thousand groups
+	size_t rows = patches * row;
+	jobs.ParallelFor(rows, std::max<size_t>(1, rows / 1024), [&](size_t begin, size_t end) {
+		for (size_t r = begin; r < end; ++r) {
+			size_t patch = r / row, j = r % row;
+			for (size_t i = 0; i <= side; ++i) {
+				vertex(patch, (float)i / side, (float)j / side, vertices + (r * row + i) * ProceduralStride);
+			}
+		}
+	});
+
+	size_t quadRows = patches * side;
+	jobs.ParallelFor(quadRows, std::max<size_t>(1, quadRows / 1024), [&](size_t begin, size_t end) {
+		for (size_t r = begin; r < end; ++r) {
+			size_t patch = r / side, j = r % side;
+			uint32_t* out = indices + r * side * 6;
+			for (size_t i = 0; i < side; ++i) {
+				uint32_t a = (uint32_t)(patch * row * row + j * row + i);
+				uint32_t b = a + 1, c = a + 1 + (uint32_t)row, d = a + (uint32_t)row;
+				out[0] = a;
+				out[1] = b;
+				out[2] = c;
+				out[3] = a;
+				out[4] = c;
+				out[5] = d;
+				out += 6;
+			}
+		}
+	});
+}
+
+/*
+ * Cube faces as outward normal, u axis and v axis, u x v is the normal so
+ * the grid winds counter-clockwise from outside
+ */
+const float ProceduralCubeFaces[6][3][3] = {
+	{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+	{ { -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+	{ { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } },
+	{ { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+	{ { 0, 0, 1 }, { 1, 0, 0 }, { 0, 1, 0 } },
+	{ { 0, 0, -1 }, { 0, 1, 0 }, { 1, 0, 0 } }
+};
+
+inline void UCubeFacePoint(size_t face, float u, float v, float point[3]) {
+	const float (*axes)[3] = ProceduralCubeFaces[face];
+	for (int c = 0; c < 3; ++c) {
+		point[c] = 0.5f * axes[0][c] + (u - 0.5f) * axes[1][c] + (v - 0.5f) * axes[2][c];
+	}
+}
+
+/*
+ * @desc Unit cube centred on the origin, every face an n x n grid with a
+ *       flat normal and its own color
+ * @returns void
+ */
+inline void UGenerateCube(UJobSystem& jobs, size_t triangles, UProceduralMesh& mesh) {
+	UBuildGridPatches(jobs, 6, UGridSide(triangles, 6), mesh, [](size_t face, float u, float v, GLfloat* out) {
+		float position[3], color[3];
+		UCubeFacePoint(face, u, v, position);
+		for (int c = 0; c < 3; ++c) {
+			color[c] = 0.35f + 0.65f * std::fabs(ProceduralCubeFaces[face][0][c]) + (ProceduralCubeFaces[face][0][c] < 0.0f ? -0.3f : 0.0f);
+		}
+		UWriteVertex(out, position, ProceduralCubeFaces[face][0], color);
+	});
+}
+
+/*
+ * @desc Sphere of radius 0.5 projected from a subdivided cube, which keeps
+ *       the triangles far more even than latitude and longitude rings
+ * @returns void
+ */
+inline void UGenerateSphere(UJobSystem& jobs, size_t triangles, UProceduralMesh& mesh) {
+	UBuildGridPatches(jobs, 6, UGridSide(triangles, 6), mesh, [](size_t face, float u, float v, GLfloat* out) {
+		float point[3], position[3], normal[3], color[3];
+		UCubeFacePoint(face, u, v, point);
+		float length = std::sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]);
+		for (int c = 0; c < 3; ++c) {
+			normal[c] = point[c] / length;
+			position[c] = 0.5f * normal[c];
+			color[c] = 0.5f + 0.5f * normal[c];
+		}
+		UWriteVertex(out, position, normal, color);
+	});
+}
+
+/*
+ * @desc Smooth value noise on the integer lattice, in [0, 1), with its
+ *       derivatives along x and z
+ */
+inline float UValueNoise(uint32_t seed, float x, float z, float& dx, float& dz) {
+	float fx = std::floor(x), fz = std::floor(z);
+	float tx = x - fx, tz = z - fz;
+	float sx = tx * tx * (3.0f - 2.0f * tx), sz = tz * tz * (3.0f - 2.0f * tz);
+	uint32_t ix = (uint32_t)(int32_t)fx, iz = (uint32_t)(int32_t)fz;
+	float corners[4];
+	for (int k = 0; k < 4; ++k) {
+		corners[k] = UHashUnit(seed, (ix + (k & 1)) * 73856093u ^ (iz + (k >> 1)) * 19349663u, 0);
+	}
+	float bottom = corners[0] + (corners[1] - corners[0]) * sx;
+	float top = corners[2] + (corners[3] - corners[2]) * sx;
+	float edge = corners[1] - corners[0];
+	dx = (edge + (corners[3] - corners[2] - edge) * sz) * 6.0f * tx * (1.0f - tx);
+	dz = (top - bottom) * 6.0f * tz * (1.0f - tz);
+	return bottom + (top - bottom) * sz;
+}
+
+/*
+ * @desc Terrain height, five octaves of value noise, with its slope
+ */
+inline float UTerrainHeight(uint32_t seed, float x, float z, float& dx, float& dz) {
+	float height = 0.0f, amplitude = 2.0f, frequency = 0.15f;
+	dx = dz = 0.0f;
+	for (int octave = 0; octave < 5; ++octave) {
+		float ox, oz;
+		height += amplitude * UValueNoise(seed + octave, x * frequency, z * frequency, ox, oz);
+		dx += amplitude * frequency * ox;
+		dz += amplitude * frequency * oz;
+		amplitude *= 0.5f;
+		frequency *= 2.0f;
+	}
+	return height;
+}
+
+/*
+ * @desc Square heightfield of the given half extent. Normals come from the
+ *       noise derivatives, so no vertex needs its neighbours and rows fill
+ *       independently
+ * @returns void
+ */
+inline void UGenerateTerrain(UJobSystem& jobs, size_t triangles, float extent, uint32_t seed, UProceduralMesh& mesh) {
+	size_t side = UGridSide(triangles, 1);
+	UBuildGridPatches(jobs, 1, side, mesh, [extent, seed](size_t, float u, float v, GLfloat* out) {
+		// u runs along z and v along x, z x x is up
+		float x = -extent + 2.0f * extent * v, z = -extent + 2.0f * extent * u, dx, dz;
+		float position[3] = { x, UTerrainHeight(seed, x, z, dx, dz), z };
+		float normal[3] = { -dx, 1.0f, -dz };
+		float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		for (int c = 0; c < 3; ++c) {
+			normal[c] /= length;
+		}
+
+		// Grass low, rock in the middle, snow on top
+		float t = std::min(1.0f, position[1] / 4.0f);
+		float color[3] = { 0.2f + 0.7f * t, 0.5f + 0.4f * t * t, 0.15f + 0.8f * t * t };
+		UWriteVertex(out, position, normal, color);
+	});
+}
+
+/*
+ * @desc The chair of FlatChair with every triangle split into a level x
+ *       level triangular grid, flat normals and colors kept per face
+ * @returns void
+ */
+inline void UGenerateChair(UJobSystem& jobs, size_t triangles, UProceduralMesh& mesh) {
+	static const std::vector<GLfloat> chair = UAddFlatNormals(ChairVertices, DemoMeshVertexCount, 6);
+	size_t faces = chair.size() / (3 * ProceduralStride);
+	size_t level = std::max<size_t>(1, (size_t)(std::sqrt((double)triangles / faces) + 0.5));
+	size_t faceVertices = (level + 1) * (level + 2) / 2, faceIndices = level * level * 3;
+	mesh.Allocate(faces * faceVertices, faces * faceIndices);
+	GLfloat* vertices = mesh.vertices.get();
+	uint32_t* indices = mesh.indices.get();
+
+	// Row i of a face starts at vertex i(L+1) - i(i-1)/2 and triangle i(2L-i)
+	size_t rows = faces * (level + 1);
+	jobs.ParallelFor(rows, std::max<size_t>(1, rows / 1024), [&](size_t begin, size_t end) {
+		for (size_t r = begin; r < end; ++r) {
+			size_t face = r / (level + 1), i = r % (level + 1);
+			const GLfloat* a = &chair[face * 3 * ProceduralStride];
+			const GLfloat* b = a + ProceduralStride;
+			const GLfloat* c = b + ProceduralStride;
+			size_t rowStart = i * (level + 1) - i * (i - 1) / 2;
+			uint32_t base = (uint32_t)(face * faceVertices);
+			for (size_t j = 0; i + j <= level; ++j) {
+				float s = (float)j / level, t = (float)i / level;
+				float position[3];
+				for (int k = 0; k < 3; ++k) {
+					position[k] = a[k] + (b[k] - a[k]) * s + (c[k] - a[k]) * t;
+				}
+				UWriteVertex(vertices + (base + rowStart + j) * ProceduralStride, position, a + 3, a + 6);
+			}
+			if (i == level) {
+				continue;
+			}
+
+			// Point j steps along ab and i along ac, the same winding as abc.
+			// The chair's winding is mixed, so flip faces wound against their normal
+			GLfloat u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			GLfloat v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			bool flip = (u[1] * v[2] - u[2] * v[1]) * a[3] + (u[2] * v[0] - u[0] * v[2]) * a[4] + (u[0] * v[1] - u[1] * v[0]) * a[5] < 0.0f;
+			int second = flip ? 2 : 1, third = flip ? 1 : 2;
+			size_t nextStart = rowStart + (level + 1 - i);
+			uint32_t* out = indices + face * faceIndices + i * (2 * level - i) * 3;
+			for (size_t j = 0; i + j < level; ++j) {
+				uint32_t p = base + (uint32_t)(rowStart + j), q = base + (uint32_t)(nextStart + j);
+				out[0] = p;
+				out[second] = p + 1;
+				out[third] = q;
+				out += 3;
+				if (i + j + 1 < level) {
+					out[0] = p + 1;
+					out[second] = q + 1;
+					out[third] = q;
+					out += 3;
+				}
+			}
+		}
+	});
+}
+
+/*
+ * @desc Bakes count copies of base into one mesh, each moved to a random
+ *       point of a cube of the given half extent, randomly turned and
+ *       scaled between 0.2 and 1
+ * @returns void
+ */
+inline void UGenerateInstanceField(UJobSystem& jobs, const UProceduralMesh& base, size_t count, float extent, uint32_t seed, UProceduralMesh& mesh) {
+	mesh.Allocate(count * base.vertexCount, count * base.indexCount);
+	GLfloat* vertices = mesh.vertices.get();
+	uint32_t* indices = mesh.indices.get();
+
+	jobs.ParallelFor(count, std::max<size_t>(1, count / 1024), [&](size_t begin, size_t end) {
+		for (size_t instance = begin; instance < end; ++instance) {
+			uint32_t id = (uint32_t)instance;
+			float offset[3], q[4];
+			for (int c = 0; c < 3; ++c) {
+				offset[c] = (2.0f * UHashUnit(seed, id, c) - 1.0f) * extent;
+			}
+			for (int c = 0; c < 4; ++c) {
+				q[c] = 2.0f * UHashUnit(seed, id, 3 + c) - 1.0f;
+			}
+			q[3] += 1.5f;
+			float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+			for (int c = 0; c < 4; ++c) {
+				q[c] /= length;
+			}
+			float scale = 0.2f + 0.8f * UHashUnit(seed, id, 7);
+
+			// Rotation matrix of q, rows
+			float x = q[0], y = q[1], z = q[2], w = q[3];
+			float m[3][3] = {
+				{ 1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y) },
+				{ 2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x) },
+				{ 2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y) }
+			};
+
+			const GLfloat* in = base.vertices.get();
+			GLfloat* out = vertices + instance * base.vertexCount * ProceduralStride;
+			for (size_t v = 0; v < base.vertexCount; ++v, in += ProceduralStride, out += ProceduralStride) {
+				for (int r = 0; r < 3; ++r) {
+					out[r] = offset[r] + scale * (m[r][0] * in[0] + m[r][1] * in[1] + m[r][2] * in[2]);
+					out[3 + r] = m[r][0] * in[3] + m[r][1] * in[4] + m[r][2] * in[5];
+					out[6 + r] = in[6 + r];
+				}
+			}
+
+			uint32_t first = (uint32_t)(instance * base.vertexCount);
+			uint32_t* outIndices = indices + instance * base.indexCount;
+			for (size_t i = 0; i < base.indexCount; ++i) {
+				outIndices[i] = first + base.indices[i];
+			}
+		}
+	});
+}
+
+/*
+ * @desc Uploads a generated mesh with attributes position 0, color 1 and
+ *       normal 2, usable as a residency streamer
+ * @returns true
+ */
+inline bool UUploadProceduralMesh(const UProceduralMesh& source, UMesh& mesh) {
+	glGenVertexArrays(1, &mesh.vertexArray);
+	glGenBuffers(1, &mesh.vertexBuffer);
+	glGenBuffers(1, &mesh.indexBuffer);
+	glBindVertexArray(mesh.vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, source.vertexCount * ProceduralStride * sizeof(GLfloat), source.vertices.get(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, source.indexCount * sizeof(uint32_t), source.indices.get(), GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, ProceduralStride * sizeof(GLfloat), (GLvoid*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, ProceduralStride * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, ProceduralStride * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(2);
+	glBindVertexArray(0);
+	mesh.vertexCount = (GLsizei)source.vertexCount;
+	mesh.indexCount = (GLsizei)source.indexCount;
+	return true;
+}
+
+#endif // PROCEDURAL_MESHES_H
@@ -0,0 +1,143 @@
+/*
+ * @author Jacob William
+ * @desc Asynchronous framebuffer readback. glReadPixels into a pixel pack
+ *       buffer returns as soon as the copy is queued; a fence tells when the
+ *       GPU is done with it, so the CPU only blocks (or maps) once the data
+ *       is really there instead of stalling the pipeline at the read.
+ */
+
+#ifndef READBACK_H
+#define READBACK_H
+
+#include <cstring>
+#include <GL/glew.h>
+
+#include "Image.h"
+
+class UPixelReadback {
+public:
+
+	UPixelReadback() : buffer(0), fence(0), width(0), height(0) {
+	}
+
+	/*
+	 * @desc Queues a copy of the bound read framebuffer into the pack buffer,
+	 *       growing the buffer when the region is bigger than the last one
+	 * @parameters region in window coordinates, origin bottom left
+	 * @returns void
+	 */
+	void Start(int x, int y, int regionWidth, int regionHeight) {
+		if (buffer == 0) {
+			glGenBuffers(1, &buffer);
+		}
+		UDeleteFence();
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+		if (regionWidth * regionHeight != width * height) {
+			glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)regionWidth * regionHeight * 4, NULL, GL_STREAM_READ);
+		}
+		width = regionWidth;
+		height = regionHeight;
+
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*)0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+	}
+
+	/*
+	 * @desc Polls the fence without waiting
+	 * @returns true when Finish will not block
+	 */
+	bool Ready(void) const {
+		if (fence == 0) {
+			return false;
+		}
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+	}
+
+	/*
+	 * @desc Waits for the copy and maps it. The pointer may be handed to
+	 *       another thread, only Map and Unmap need the GL thread, and the
+	 *       buffer must be unmapped before the next Start
+	 * @returns width * height RGBA pixels, bottom row first, or NULL
+	 */
+	const unsigned char* Map(void) {
+		if (fence == 0) {
+			return NULL;
+		}
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+		}
+		UDeleteFence();
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+		const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)width * height * 4, GL_MAP_READ_BIT);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		return pixels;
+	}
+
+	void Unmap(void) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	/*
+	 * @desc Waits for the copy and stores it in image with row 0 at the top,
+	 *       the same orientation SOIL writes and the software rasterizer keeps
+	 * @returns false when nothing was started or the map failed
+	 */
+	bool Finish(UImage& image) {
+		const unsigned char* pixels = Map();
+		if (pixels == NULL) {
+			return false;
+		}
+
+		image.width = width;
+		image.height = height;
+		image.pixels.resize((size_t)width * height * 4);
+		for (int y = 0; y < height; ++y) {
+			memcpy(&image.pixels[(size_t)y * width * 4], pixels + (size_t)(height - 1 - y) * width * 4, (size_t)width * 4);
+		}
+
+		Unmap();
+		return true;
+	}
+
+	int Width(void) const {
+		return width;
+	}
+
+	int Height(void) const {
+		return height;
+	}
+
+	/*
+	 * @desc Frees the GL objects, called explicitly while the context is alive
+	 * @returns void
+	 */
+	void Destroy(void) {
+		UDeleteFence();
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+		width = height = 0;
+	}
+
+private:
+
+	void UDeleteFence(void) {
+		if (fence != 0) {
+			glDeleteSync(fence);
+			fence = 0;
+		}
+	}
+
+	GLuint buffer;
+	GLsync fence;
+	int width, height;
+};
+
+#endif // READBACK_H
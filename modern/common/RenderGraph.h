@@ -0,0 +1,534 @@
+/*
+ * @author Jacob William
+ * @desc Render graph for frames made of several passes. Passes declare the
+ *       render targets they read and write; Compile drops every pass whose
+ *       output never reaches the back buffer (or another imported target),
+ *       orders the rest so writers run before readers and gives transient
+ *       targets with the same size and format one shared texture whenever
+ *       their lifetimes do not overlap. Execute creates the textures and
+ *       framebuffers on first use, binds each pass's outputs and runs it.
+ *
+ *       GL 3.3 has no memory heaps, so aliasing is done at texture level: a
+ *       texture handed to a second target still holds the first one's
+ *       pixels, every pass has to clear or fully overwrite what it writes.
+ *       The writes of a pass become its attachments, in declaration order
+ *       for colors. A pass that only depth tests against a depth target names
+ *       it as its depth test target, it is attached but counts as a read.
+ *       Several writers of one target run in declaration order and readers
+ *       see the last one. Compile and the statistics make no GL calls, so a
+ *       frame can be planned without a context.
+ */
+
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+typedef int UGraphResource;
+
+// Size of the back buffer, set with SetBackBufferSize
+const UGraphResource GraphBackBuffer = 0;
+
+// No depth test target
+const UGraphResource GraphNoResource = -1;
+
+struct UGraphStats {
+	size_t passes;
+	size_t culledPasses;
+	size_t targets;			// transient targets used by the passes that run
+	size_t textures;		// textures backing them after aliasing
+	size_t naiveBytes;		// one texture per declared target
+	size_t aliasedBytes;
+};
+
+/*
+ * @desc Bytes per pixel of the sized internal formats render targets use
+ * @returns bytes, 4 for anything not listed
+ */
+inline size_t UGraphFormatBytes(GLenum format) {
+	switch (format) {
+	case GL_R8:
+		return 1;
+	case GL_RG8:
+	case GL_R16F:
+		return 2;
+	case GL_RGBA32F:
+		return 16;
+	case GL_RGBA16F:
+	case GL_RG32F:
+		return 8;
+	default:
+		return 4;
+	}
+}
+
+inline bool UGraphIsDepthFormat(GLenum format) {
+	return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F
+		|| format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+class URenderGraph {
+public:
+
+	typedef std::function<void(const URenderGraph&)> UPassFunction;
+
+	URenderGraph() : backBufferWidth(0), backBufferHeight(0), compiled(false), realized(false) {
+		UResource backBuffer = { "back buffer", 0, 0, 0, true, -1, -1, -1 };
+		resources.push_back(backBuffer);
+	}
+
+	void SetBackBufferSize(int width, int height) {
+		backBufferWidth = width;
+		backBufferHeight = height;
+	}
+
+	/*
+	 * @desc Declares a transient render target, it only gets a texture if a
+	 *       pass that runs uses it
+	 * @returns the target's handle
+	 */
+	UGraphResource CreateTarget(const std::string& name, int width, int height, GLenum format) {
+		UResource resource = { name, width, height, format, false, -1, -1, -1 };
+		resources.push_back(resource);
+		compiled = false;
+		return (UGraphResource)resources.size() - 1;
+	}
+
+	/*
+	 * @desc Declares a pass. Passes may be added in any order, Compile sorts
+	 *       them by what they read and write. depthTest is attached read-only
+	 * @returns void
+	 */
+	void AddPass(const std::string& name, std::initializer_list<UGraphResource> reads,
+			std::initializer_list<UGraphResource> writes, UPassFunction execute, UGraphResource depthTest = GraphNoResource) {
+		UPass pass;
+		pass.name = name;
+		pass.reads.assign(reads.begin(), reads.end());
+		pass.writes.assign(writes.begin(), writes.end());
+		if (depthTest != GraphNoResource) {
+			pass.reads.push_back(depthTest);
+		}
+		pass.depthTest = depthTest;
+		pass.execute = execute;
+		pass.framebuffer = 0;
+		pass.alive = false;
+		passes.push_back(pass);
+		compiled = false;
+	}
+
+	/*
+	 * @desc Culls, orders and aliases. Reading a target no pass writes, a
+	 *       dependency cycle or a pass writing both the back buffer and a
+	 *       target makes the graph invalid
+	 * @returns false when the graph is invalid
+	 */
+	bool Compile(void) {
+		URelease();
+		order.clear();
+		compiled = false;
+
+		// Writers of every resource, in declaration order
+		std::vector<std::vector<int> > writers(resources.size());
+		for (size_t p = 0; p < passes.size(); ++p) {
+			for (size_t w = 0; w < passes[p].writes.size(); ++w) {
+				writers[passes[p].writes[w]].push_back((int)p);
+			}
+			passes[p].alive = false;
+		}
+
+		// Passes writing an imported target are kept, then everything they depend on
+		std::vector<int> stack;
+		for (size_t p = 0; p < passes.size(); ++p) {
+			for (size_t w = 0; w < passes[p].writes.size(); ++w) {
+				if (resources[passes[p].writes[w]].imported && !passes[p].alive) {
+					passes[p].alive = true;
+					stack.push_back((int)p);
+				}
+			}
+		}
+		while (!stack.empty()) {
+			int p = stack.back();
+			stack.pop_back();
+			std::vector<int> needed = UDependencies(p, writers);
+			for (size_t d = 0; d < needed.size(); ++d) {
+				if (!passes[needed[d]].alive) {
+					passes[needed[d]].alive = true;
+					stack.push_back(needed[d]);
+				}
+			}
+		}
+
+		// Kahn's sort of the live passes, declaration order breaks ties
+		std::vector<int> pending(passes.size(), 0);
+		std::vector<std::vector<int> > dependents(passes.size());
+		for (size_t p = 0; p < passes.size(); ++p) {
+			if (!passes[p].alive) {
+				continue;
+			}
+			for (size_t r = 0; r < passes[p].reads.size(); ++r) {
+				if (!resources[passes[p].reads[r]].imported && writers[passes[p].reads[r]].empty()) {
+					return false;
+				}
+			}
+			std::vector<int> needed = UDependencies((int)p, writers);
+			pending[p] = (int)needed.size();
+			for (size_t d = 0; d < needed.size(); ++d) {
+				dependents[needed[d]].push_back((int)p);
+			}
+			if (!UValidAttachments(passes[p])) {
+				return false;
+			}
+		}
+		std::vector<bool> done(passes.size(), false);
+		size_t alive = 0;
+		for (size_t p = 0; p < passes.size(); ++p) {
+			alive += passes[p].alive;
+		}
+		while (order.size() < alive) {
+			int next = -1;
+			for (size_t p = 0; p < passes.size() && next < 0; ++p) {
+				if (passes[p].alive && !done[p] && pending[p] == 0) {
+					next = (int)p;
+				}
+			}
+			if (next < 0) {
+				order.clear();
+				return false;
+			}
+			done[next] = true;
+			order.push_back(next);
+			for (size_t d = 0; d < dependents[next].size(); ++d) {
+				--pending[dependents[next][d]];
+			}
+		}
+
+		UAssignTextures();
+		compiled = true;
+		return true;
+	}
+
+	/*
+	 * @desc Runs the compiled passes, each with its outputs bound and the
+	 *       viewport set to their size
+	 * @returns void
+	 */
+	void Execute(void) {
+		if (!compiled) {
+			return;
+		}
+		if (!realized) {
+			URealize();
+		}
+		for (size_t i = 0; i < order.size(); ++i) {
+			const UPass& pass = passes[order[i]];
+			glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+			const UResource& target = resources[pass.writes[0]];
+			if (target.imported) {
+				glViewport(0, 0, backBufferWidth, backBufferHeight);
+			}
+			else {
+				glViewport(0, 0, target.width, target.height);
+			}
+			pass.execute(*this);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, backBufferWidth, backBufferHeight);
+	}
+
+	/*
+	 * @desc Texture behind a target, for passes sampling it
+	 * @returns the texture, 0 before Execute or for a culled target
+	 */
+	GLuint Texture(UGraphResource resource) const {
+		int texture = resources[resource].texture;
+		return texture >= 0 && realized ? textures[texture].texture : 0;
+	}
+
+	UGraphStats Stats(void) const {
+		UGraphStats stats = { passes.size(), passes.size() - order.size(), 0, textures.size(), 0, 0 };
+		for (size_t r = 1; r < resources.size(); ++r) {
+			stats.naiveBytes += UBytes(resources[r]);
+			stats.targets += resources[r].texture >= 0;
+		}
+		for (size_t t = 0; t < textures.size(); ++t) {
+			stats.aliasedBytes += UBytes(textures[t].description);
+		}
+		return stats;
+	}
+
+	/*
+	 * @desc Pass order, culled passes and which texture each target landed in
+	 * @returns void
+	 */
+	void PrintPlan(std::ostream& out) const {
+		out << "render graph:";
+		for (size_t i = 0; i < order.size(); ++i) {
+			out << (i == 0 ? " " : " -> ") << passes[order[i]].name;
+		}
+		out << std::endl;
+		for (size_t p = 0; p < passes.size(); ++p) {
+			if (!passes[p].alive) {
+				out << "  culled " << passes[p].name << std::endl;
+			}
+		}
+		for (size_t r = 1; r < resources.size(); ++r) {
+			const UResource& resource = resources[r];
+			if (resource.texture >= 0) {
+				out << "  " << resource.name << " " << resource.width << "x" << resource.height << " texture "
+					<< resource.texture << ", passes " << resource.first << " to " << resource.last << std::endl;
+			}
+		}
+		UGraphStats stats = Stats();
+		out << "  " << stats.targets << " targets in " << stats.textures << " textures, " << stats.aliasedBytes / 1024
+			<< " KB against " << stats.naiveBytes / 1024 << " KB with one texture per target" << std::endl;
+	}
+
+	/*
+	 * @desc Deletes the textures and framebuffers and forgets every pass and
+	 *       target, the back buffer size is kept
+	 * @returns void
+	 */
+	void Destroy(void) {
+		URelease();
+		resources.resize(1);
+		passes.clear();
+		textures.clear();
+		order.clear();
+		compiled = false;
+	}
+
+private:
+
+	struct UResource {
+		std::string name;
+		int width, height;
+		GLenum format;
+		bool imported;
+		int texture;		// index into textures, -1 when unused
+		int first, last;	// positions in order of the first and last pass using it
+	};
+
+	struct UPass {
+		std::string name;
+		std::vector<UGraphResource> reads, writes;
+		UGraphResource depthTest;
+		UPassFunction execute;
+		GLuint framebuffer;
+		bool alive;
+	};
+
+	struct UTexture {
+		UResource description;
+		int freeAfter;		// last pass position of the target using it
+		GLuint texture;
+	};
+
+	static size_t UBytes(const UResource& resource) {
+		return (size_t)resource.width * resource.height * UGraphFormatBytes(resource.format);
+	}
+
+	/*
+	 * @desc Passes that must run before p: the writers of what it reads and
+	 *       the earlier declared writers of what it writes
+	 * @returns pass indices, may repeat
+	 */
+	std::vector<int> UDependencies(int p, const std::vector<std::vector<int> >& writers) const {
+		std::vector<int> needed;
+		for (size_t r = 0; r < passes[p].reads.size(); ++r) {
+			const std::vector<int>& list = writers[passes[p].reads[r]];
+			for (size_t w = 0; w < list.size(); ++w) {
+				if (list[w] != p) {
+					needed.push_back(list[w]);
+				}
+			}
+		}
+		for (size_t r = 0; r < passes[p].writes.size(); ++r) {
+			const std::vector<int>& list = writers[passes[p].writes[r]];
+			for (size_t w = 0; w < list.size() && list[w] < p; ++w) {
+				needed.push_back(list[w]);
+			}
+		}
+		std::sort(needed.begin(), needed.end());
+		needed.erase(std::unique(needed.begin(), needed.end()), needed.end());
+		return needed;
+	}
+
+	/*
+	 * @desc A pass draws either to the back buffer alone or to targets of one
+	 *       size with at most one depth target, written or tested against
+	 * @returns true when the pass can get a framebuffer
+	 */
+	bool UValidAttachments(const UPass& pass) const {
+		if (pass.writes.empty()) {
+			return false;
+		}
+		int depthTargets = 0;
+		if (pass.depthTest != GraphNoResource) {
+			const UResource& depth = resources[pass.depthTest];
+			const UResource& first = resources[pass.writes[0]];
+			if (first.imported || !UGraphIsDepthFormat(depth.format) || depth.width != first.width || depth.height != first.height) {
+				return false;
+			}
+			++depthTargets;
+		}
+		for (size_t w = 0; w < pass.writes.size(); ++w) {
+			const UResource& target = resources[pass.writes[w]];
+			const UResource& first = resources[pass.writes[0]];
+			if (target.imported != first.imported || (target.imported && pass.writes.size() > 1)) {
+				return false;
+			}
+			if (target.width != first.width || target.height != first.height) {
+				return false;
+			}
+			depthTargets += UGraphIsDepthFormat(target.format);
+		}
+		return depthTargets <= 1;
+	}
+
+	/*
+	 * @desc Lifetimes in pass order, then first fit: a target takes the
+	 *       first texture of its size and format that is free before its
+	 *       first pass, otherwise a new texture
+	 * @returns void
+	 */
+	void UAssignTextures(void) {
+		textures.clear();
+		for (size_t r = 0; r < resources.size(); ++r) {
+			resources[r].texture = resources[r].first = resources[r].last = -1;
+		}
+		for (size_t i = 0; i < order.size(); ++i) {
+			const UPass& pass = passes[order[i]];
+			for (int list = 0; list < 2; ++list) {
+				const std::vector<UGraphResource>& used = list == 0 ? pass.reads : pass.writes;
+				for (size_t u = 0; u < used.size(); ++u) {
+					UResource& resource = resources[used[u]];
+					if (resource.first < 0) {
+						resource.first = (int)i;
+					}
+					resource.last = (int)i;
+				}
+			}
+		}
+
+		std::vector<int> byFirstUse;
+		for (size_t r = 1; r < resources.size(); ++r) {
+			if (resources[r].first >= 0) {
+				byFirstUse.push_back((int)r);
+			}
+		}
+		std::stable_sort(byFirstUse.begin(), byFirstUse.end(), [this](int a, int b) {
+			return resources[a].first < resources[b].first;
+		});
+
+		for (size_t i = 0; i < byFirstUse.size(); ++i) {
+			UResource& resource = resources[byFirstUse[i]];
+			for (size_t t = 0; t < textures.size() && resource.texture < 0; ++t) {
+				const UResource& description = textures[t].description;
+				if (textures[t].freeAfter < resource.first && description.width == resource.width
+						&& description.height == resource.height && description.format == resource.format) {
+					resource.texture = (int)t;
+				}
+			}
+			if (resource.texture < 0) {
+				UTexture texture = { resource, -1, 0 };
+				textures.push_back(texture);
+				resource.texture = (int)textures.size() - 1;
+			}
+			textures[resource.texture].freeAfter = resource.last;
+		}
+	}
+
+	/*
+	 * @desc Creates the textures and one framebuffer per pass drawing to them
+	 * @returns void
+	 */
+	void URealize(void) {
+		for (size_t t = 0; t < textures.size(); ++t) {
+			const UResource& description = textures[t].description;
+			bool depth = UGraphIsDepthFormat(description.format);
+			bool stencil = description.format == GL_DEPTH24_STENCIL8 || description.format == GL_DEPTH32F_STENCIL8;
+			glGenTextures(1, &textures[t].texture);
+			glBindTexture(GL_TEXTURE_2D, textures[t].texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, description.format, description.width, description.height, 0,
+					stencil ? GL_DEPTH_STENCIL : (depth ? GL_DEPTH_COMPONENT : GL_RGBA),
+					stencil ? GL_UNSIGNED_INT_24_8 : (depth ? GL_FLOAT : GL_UNSIGNED_BYTE), NULL);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, depth ? GL_NEAREST : GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, depth ? GL_NEAREST : GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		for (size_t i = 0; i < order.size(); ++i) {
+			UPass& pass = passes[order[i]];
+			if (resources[pass.writes[0]].imported) {
+				continue;
+			}
+			glGenFramebuffers(1, &pass.framebuffer);
+			glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+			std::vector<GLenum> drawBuffers;
+			std::vector<UGraphResource> attachments(pass.writes);
+			if (pass.depthTest != GraphNoResource) {
+				attachments.push_back(pass.depthTest);
+			}
+			for (size_t w = 0; w < attachments.size(); ++w) {
+				const UResource& target = resources[attachments[w]];
+				GLuint texture = textures[target.texture].texture;
+				if (UGraphIsDepthFormat(target.format)) {
+					bool stencil = target.format == GL_DEPTH24_STENCIL8 || target.format == GL_DEPTH32F_STENCIL8;
+					glFramebufferTexture2D(GL_FRAMEBUFFER, stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+				}
+				else {
+					GLenum attachment = GL_COLOR_ATTACHMENT0 + (GLenum)drawBuffers.size();
+					glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+					drawBuffers.push_back(attachment);
+				}
+			}
+			if (drawBuffers.empty()) {
+				glDrawBuffer(GL_NONE);
+			}
+			else {
+				glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+			}
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		realized = true;
+	}
+
+	/*
+	 * @desc Deletes what URealize created, a later Execute creates it again
+	 * @returns void
+	 */
+	void URelease(void) {
+		if (!realized) {
+			return;
+		}
+		for (size_t t = 0; t < textures.size(); ++t) {
+			glDeleteTextures(1, &textures[t].texture);
+			textures[t].texture = 0;
+		}
+		for (size_t p = 0; p < passes.size(); ++p) {
+			if (passes[p].framebuffer != 0) {
+				glDeleteFramebuffers(1, &passes[p].framebuffer);
+				passes[p].framebuffer = 0;
+			}
+		}
+		realized = false;
+	}
+
+	int backBufferWidth, backBufferHeight;
+	bool compiled, realized;
+	std::vector<UResource> resources;	// slot 0 is the back buffer
+	std::vector<UPass> passes;
+	std::vector<UTexture> textures;
+	std::vector<int> order;				// live passes in execution order
+};
+
+#endif // RENDER_GRAPH_H
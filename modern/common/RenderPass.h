@@ -0,0 +1,228 @@
+/*
+ * @author Jacob William
+ * @desc Ordered list of render passes. A pass is a name, the depth and
+ *       color state it draws with and a draw function; the list applies each
+ *       state, runs the draws in order and restores the default state. With
+ *       statistics on, every pass is wrapped in pipeline statistics queries
+ *       (GL_ARB_pipeline_statistics_query) and a samples passed query, read
+ *       back a few frames late so the GL thread never waits on them.
+ */
+
+#ifndef RENDER_PASS_H
+#define RENDER_PASS_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#ifndef GL_VERTEX_SHADER_INVOCATIONS_ARB
+#define GL_VERTEX_SHADER_INVOCATIONS_ARB 0x82F0
+#define GL_FRAGMENT_SHADER_INVOCATIONS_ARB 0x82F4
+#endif
+
+// Frames between issuing a pass's queries and reading them
+const int PassQueryLatency = 3;
+
+struct UPassState {
+	GLboolean colorWrite;
+	GLboolean depthWrite;
+	GLenum depthFunc;
+	GLbitfield clear;		// buffers cleared before the pass draws, 0 for none
+};
+
+// Plain opaque drawing, also what the list restores after the last pass
+const UPassState OpaquePassState = { GL_TRUE, GL_TRUE, GL_LESS, 0 };
+
+// Depth only, fills the depth buffer so later passes shade visible pixels once
+const UPassState DepthPrePassState = { GL_FALSE, GL_TRUE, GL_LESS, 0 };
+
+// Shading after a depth pre-pass, only the fragment that won the depth test passes
+const UPassState EqualShadingPassState = { GL_TRUE, GL_FALSE, GL_EQUAL, 0 };
+
+// Blended effects over the opaque scene, depth tested but not written
+const UPassState BlendedPassState = { GL_TRUE, GL_FALSE, GL_LESS, 0 };
+
+// Per frame averages of one pass
+struct UPassStatistics {
+	double vertexInvocations;
+	double fragmentInvocations;
+	double samplesPassed;
+	uint64_t frames;
+};
+
+class URenderPasses {
+public:
+
+	URenderPasses() : statistics(false), frame(0) {
+	}
+
+	/*
+	 * @desc Adds a pass after the existing ones
+	 * @returns void
+	 */
+	void Add(const std::string& name, const UPassState& state, std::function<void()> draw) {
+		UPass pass;
+		pass.name = name;
+		pass.state = state;
+		pass.draw = draw;
+		memset(pass.queries, 0, sizeof(pass.queries));
+		memset(pass.pending, 0, sizeof(pass.pending));
+		memset(&pass.totals, 0, sizeof(pass.totals));
+		passes.push_back(pass);
+		if (statistics) {
+			glGenQueries(PassQueryLatency * 3, &passes.back().queries[0][0]);
+		}
+	}
+
+	/*
+	 * @desc Turns the per pass queries on, call once after the passes are
+	 *       added. Vertex and fragment counts need the pipeline statistics
+	 *       extension, samples passed is always counted
+	 * @returns void
+	 */
+	void EnableStatistics(void) {
+		if (statistics) {
+			return;
+		}
+		statistics = true;
+		for (size_t p = 0; p < passes.size(); ++p) {
+			glGenQueries(PassQueryLatency * 3, &passes[p].queries[0][0]);
+		}
+	}
+
+	bool StatisticsEnabled(void) const {
+		return statistics;
+	}
+
+	/*
+	 * @desc Runs every pass in order
+	 * @returns void
+	 */
+	void Execute(void) {
+		int slot = (int)(frame % PassQueryLatency);
+		bool pipelineStatistics = statistics && GLEW_ARB_pipeline_statistics_query;
+
+		for (size_t p = 0; p < passes.size(); ++p) {
+			UPass& pass = passes[p];
+			if (statistics && pass.pending[slot]) {
+				UCollect(pass, slot, pipelineStatistics);
+			}
+
+			UApply(pass.state);
+			if (statistics) {
+				if (pipelineStatistics) {
+					glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB, pass.queries[slot][0]);
+					glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB, pass.queries[slot][1]);
+				}
+				glBeginQuery(GL_SAMPLES_PASSED, pass.queries[slot][2]);
+			}
+
+			pass.draw();
+
+			if (statistics) {
+				glEndQuery(GL_SAMPLES_PASSED);
+				if (pipelineStatistics) {
+					glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB);
+					glEndQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB);
+				}
+				pass.pending[slot] = true;
+			}
+		}
+		UApply(OpaquePassState);
+		++frame;
+	}
+
+	UPassStatistics Statistics(size_t pass) const {
+		UPassStatistics average = passes[pass].totals;
+		if (average.frames > 0) {
+			average.vertexInvocations /= average.frames;
+			average.fragmentInvocations /= average.frames;
+			average.samplesPassed /= average.frames;
+		}
+		return average;
+	}
+
+	void ResetStatistics(void) {
+		for (size_t p = 0; p < passes.size(); ++p) {
+			memset(&passes[p].totals, 0, sizeof(passes[p].totals));
+		}
+	}
+
+	/*
+	 * @desc One line per pass with its per frame averages since the last reset
+	 * @returns void
+	 */
+	void PrintStatistics(std::ostream& out) const {
+		for (size_t p = 0; p < passes.size(); ++p) {
+			UPassStatistics average = Statistics(p);
+			out << "pass " << passes[p].name << ": ";
+			if (GLEW_ARB_pipeline_statistics_query) {
+				out << (uint64_t)average.vertexInvocations << " vertex, " << (uint64_t)average.fragmentInvocations
+					<< " fragment invocations, ";
+			}
+			out << (uint64_t)average.samplesPassed << " samples passed per frame" << std::endl;
+		}
+	}
+
+	size_t Count(void) const {
+		return passes.size();
+	}
+
+	void Destroy(void) {
+		for (size_t p = 0; p < passes.size(); ++p) {
+			if (statistics) {
+				glDeleteQueries(PassQueryLatency * 3, &passes[p].queries[0][0]);
+			}
+		}
+		passes.clear();
+		statistics = false;
+	}
+
+private:
+
+	struct UPass {
+		std::string name;
+		UPassState state;
+		std::function<void()> draw;
+		GLuint queries[PassQueryLatency][3];	// vertex, fragment, samples passed
+		bool pending[PassQueryLatency];
+		UPassStatistics totals;
+	};
+
+	static void UApply(const UPassState& state) {
+		glColorMask(state.colorWrite, state.colorWrite, state.colorWrite, state.colorWrite);
+		glDepthMask(state.depthWrite);
+		glDepthFunc(state.depthFunc);
+		if (state.clear != 0) {
+			glClear(state.clear);
+		}
+	}
+
+	/*
+	 * @desc Adds the results of the queries issued PassQueryLatency frames ago
+	 * @returns void
+	 */
+	static void UCollect(UPass& pass, int slot, bool pipelineStatistics) {
+		GLuint64 result = 0;
+		if (pipelineStatistics) {
+			glGetQueryObjectui64v(pass.queries[slot][0], GL_QUERY_RESULT, &result);
+			pass.totals.vertexInvocations += (double)result;
+			glGetQueryObjectui64v(pass.queries[slot][1], GL_QUERY_RESULT, &result);
+			pass.totals.fragmentInvocations += (double)result;
+		}
+		glGetQueryObjectui64v(pass.queries[slot][2], GL_QUERY_RESULT, &result);
+		pass.totals.samplesPassed += (double)result;
+		pass.totals.frames++;
+		pass.pending[slot] = false;
+	}
+
+	std::vector<UPass> passes;
+	bool statistics;
+	uint64_t frame;
+};
+
+#endif // RENDER_PASS_H
@@ -0,0 +1,249 @@
+/*
+ * @author Jacob William
+ * @desc Dedicated render thread. The window thread keeps pumping GLUT events
+ *       and builds one immutable snapshot per frame; the render thread owns
+ *       the GL context, takes the newest snapshot from a two entry lock-free
+ *       queue, draws it and presents. A slow frame no longer holds up input
+ *       and a burst of input no longer delays the frame.
+ *
+ *       GLUT makes its own context current before every callback, so the
+ *       render thread draws with a second context sharing objects with it
+ *       and presents through GLX (or WGL on Windows) directly. Vertex arrays
+ *       and framebuffers are never shared between contexts; the setup
+ *       function passed to Start creates them on the render thread. Call
+ *       UInitRenderThreading before glutInit and never make GL calls on the
+ *       window thread while the render thread runs.
+ */
+
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <GL/glew.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <X11/Xlib.h>
+#include <GL/glx.h>
+#endif
+
+#include "SpscQueue.h"
+
+#ifndef _WIN32
+#ifndef GLX_CONTEXT_MAJOR_VERSION_ARB
+#define GLX_CONTEXT_MAJOR_VERSION_ARB 0x2091
+#define GLX_CONTEXT_MINOR_VERSION_ARB 0x2092
+#define GLX_CONTEXT_FLAGS_ARB 0x2094
+#endif
+#ifndef GLX_CONTEXT_PROFILE_MASK_ARB
+#define GLX_CONTEXT_PROFILE_MASK_ARB 0x9126
+#endif
+#endif
+
+// Snapshots in flight: one being drawn, one being built
+const size_t RenderQueueDepth = 2;
+
+/*
+ * @desc Xlib is only thread safe when told before its first call
+ * @returns void
+ */
+inline void UInitRenderThreading(void) {
+#ifndef _WIN32
+	XInitThreads();
+#endif
+}
+
+template <typename Snapshot>
+class URenderThread {
+public:
+
+	typedef std::function<void(void)> USetupFunction;
+	typedef std::function<void(const Snapshot&)> USnapshotFunction;
+
+	URenderThread() : context(NULL), running(false), ready(false) {
+	}
+
+	/*
+	 * @desc Creates a context sharing objects with the one current on the
+	 *       calling thread, which stays current there, and starts drawing
+	 *       into the same window. setup runs once on the render thread and
+	 *       has finished when Start returns; draw renders a snapshot and
+	 *       presented runs after the swap returns
+	 * @returns false when no shared context could be created
+	 */
+	bool Start(USetupFunction setup, USnapshotFunction draw, USnapshotFunction presented) {
+		setupFunction = setup;
+		drawFunction = draw;
+		presentedFunction = presented;
+#ifdef _WIN32
+		deviceContext = wglGetCurrentDC();
+		context = wglCreateContext(deviceContext);
+		if (context != NULL && !wglShareLists(wglGetCurrentContext(), context)) {
+			wglDeleteContext(context);
+			context = NULL;
+		}
+#else
+		display = glXGetCurrentDisplay();
+		drawable = glXGetCurrentDrawable();
+		context = UCreateSharedContext();
+#endif
+		if (context == NULL) {
+			return false;
+		}
+		ready.store(false, std::memory_order_relaxed);
+		running.store(true, std::memory_order_release);
+		thread = std::thread(&URenderThread::URun, this);
+		while (!ready.load(std::memory_order_acquire)) {
+			std::this_thread::yield();
+		}
+		return true;
+	}
+
+	bool IsRunning(void) const {
+		return thread.joinable();
+	}
+
+	/*
+	 * @desc Window thread side
+	 * @returns false when both queue entries are still waiting to be drawn
+	 */
+	bool Submit(const Snapshot& snapshot) {
+		return queue.Push(snapshot);
+	}
+
+	size_t Pending(void) const {
+		return queue.Size();
+	}
+
+	/*
+	 * @desc Stops after the frame in progress and destroys the render
+	 *       thread's context with the vertex arrays and framebuffers only it
+	 *       had. Shared objects live on in the window thread's context
+	 * @returns void
+	 */
+	void Stop(void) {
+		if (!thread.joinable()) {
+			return;
+		}
+		running.store(false, std::memory_order_release);
+		thread.join();
+#ifdef _WIN32
+		wglDeleteContext(context);
+#else
+		glXDestroyContext(display, context);
+#endif
+		context = NULL;
+	}
+
+private:
+
+#ifndef _WIN32
+	/*
+	 * @desc Context on the current one's framebuffer config with the same
+	 *       version, profile and flags, falling back to a legacy context
+	 *       when GLX_ARB_create_context is missing or refuses them
+	 * @returns the context, NULL if none could be created
+	 */
+	GLXContext UCreateSharedContext(void) {
+		GLXContext windowContext = glXGetCurrentContext();
+		int configId = 0;
+		glXQueryContext(display, windowContext, GLX_FBCONFIG_ID, &configId);
+		int configAttributes[] = { GLX_FBCONFIG_ID, configId, None };
+		int configCount = 0;
+		GLXFBConfig* configs = glXChooseFBConfig(display, DefaultScreen(display), configAttributes, &configCount);
+		if (configs == NULL || configCount == 0) {
+			return NULL;
+		}
+
+		GLint major = 0, minor = 0, flags = 0, profile = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+		if (major >= 3) {
+			glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+		}
+		if (major > 3 || (major == 3 && minor >= 2)) {
+			glGetIntegerv(GL_CONTEXT_PROFILE_MASK, &profile);
+		}
+
+		// A refused attribute list is an X error, which would end the program
+		typedef GLXContext (*UCreateContextAttribs)(Display*, GLXFBConfig, GLXContext, Bool, const int*);
+		UCreateContextAttribs createContextAttribs = (UCreateContextAttribs)glXGetProcAddressARB((const GLubyte*)"glXCreateContextAttribsARB");
+		GLXContext shared = NULL;
+		if (createContextAttribs != NULL && major >= 3) {
+			int attributes[] = { GLX_CONTEXT_MAJOR_VERSION_ARB, major, GLX_CONTEXT_MINOR_VERSION_ARB, minor,
+				GLX_CONTEXT_FLAGS_ARB, flags, profile != 0 ? GLX_CONTEXT_PROFILE_MASK_ARB : 0, profile, 0 };
+			XSync(display, False);
+			int (*previousHandler)(Display*, XErrorEvent*) = XSetErrorHandler(UIgnoreXError);
+			shared = createContextAttribs(display, configs[0], windowContext, True, attributes);
+			XSync(display, False);
+			XSetErrorHandler(previousHandler);
+		}
+		if (shared == NULL) {
+			shared = glXCreateNewContext(display, configs[0], GLX_RGBA_TYPE, windowContext, True);
+		}
+		XFree(configs);
+		return shared;
+	}
+
+	static int UIgnoreXError(Display*, XErrorEvent*) {
+		return 0;
+	}
+#endif
+
+	void URun(void) {
+#ifdef _WIN32
+		wglMakeCurrent(deviceContext, context);
+#else
+		glXMakeCurrent(display, drawable, context);
+#endif
+		setupFunction();
+		ready.store(true, std::memory_order_release);
+
+		while (running.load(std::memory_order_acquire)) {
+			// Only the newest snapshot is worth drawing
+			Snapshot snapshot;
+			bool found = false;
+			while (queue.Pop(snapshot)) {
+				found = true;
+			}
+			if (!found) {
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+				continue;
+			}
+
+			drawFunction(snapshot);
+#ifdef _WIN32
+			SwapBuffers(deviceContext);
+#else
+			glXSwapBuffers(display, drawable);
+#endif
+			presentedFunction(snapshot);
+		}
+
+#ifdef _WIN32
+		wglMakeCurrent(NULL, NULL);
+#else
+		glXMakeCurrent(display, None, NULL);
+#endif
+	}
+
+#ifdef _WIN32
+	HDC deviceContext;
+	HGLRC context;
+#else
+	Display* display;
+	GLXDrawable drawable;
+	GLXContext context;
+#endif
+	USetupFunction setupFunction;
+	USnapshotFunction drawFunction, presentedFunction;
+	USpscQueue<Snapshot, RenderQueueDepth> queue;
+	std::atomic<bool> running, ready;
+	std::thread thread;
+};
+
+#endif // RENDER_THREAD_H
@@ -0,0 +1,408 @@
+/*
+ * @author Jacob William
+ * @desc Residency of meshes and textures under a VRAM budget. Every resource
+ *       is registered with a streamer that creates its GL objects; the
+ *       manager measures what the driver allocated, keeps the resident ones
+ *       in an LRU list and deletes the least recently used when a new one
+ *       would not fit. An evicted resource is streamed again the next time
+ *       it is asked for. Resources used in the current frame are never
+ *       evicted, a frame that needs more than the budget goes over it and is
+ *       counted instead.
+ */
+
+#ifndef RESIDENCY_H
+#define RESIDENCY_H
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <list>
+#include <ostream>
+#include <string>
+#include <GL/glew.h>
+
+#include "Resources.h"
+
+// Streamers fill in the GL objects and counts, textures start out as
+// GL_TEXTURE_2D. They return false when the source is gone
+typedef std::function<bool(UMesh&)> UMeshStreamer;
+typedef std::function<bool(UTexture&)> UTextureStreamer;
+
+// Counters printed by the demos
+struct UResidencyStats {
+	size_t budgetBytes;
+	size_t residentBytes;
+	size_t peakBytes;
+	size_t residentCount;
+	size_t totalCount;
+	size_t hits;
+	size_t streams;
+	size_t evictions;
+	size_t failures;
+	size_t overBudgetFrames;
+	double streamMilliseconds;
+};
+
+/*
+ * @desc Bytes the driver reports for every buffer of a mesh
+ */
+inline size_t UMeshBytes(const UMesh& mesh) {
+	size_t bytes = 0;
+	GLuint buffers[2] = { mesh.vertexBuffer, mesh.indexBuffer };
+	for (int b = 0; b < 2; ++b) {
+		if (buffers[b] != 0) {
+			GLint size = 0;
+			glBindBuffer(GL_COPY_READ_BUFFER, buffers[b]);
+			glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+			bytes += size;
+		}
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	return bytes;
+}
+
+/*
+ * @desc Bytes of every level of a texture from the sizes the driver reports,
+ *       compressed levels by their image size and the rest by component bits
+ */
+inline size_t UTextureBytes(const UTexture& texture) {
+	const GLenum components[] = { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE,
+		GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_DEPTH_SIZE, GL_TEXTURE_STENCIL_SIZE };
+	size_t bytes = 0;
+	glBindTexture(texture.target, texture.texture);
+	for (GLint level = 0; ; ++level) {
+		GLint width = 0, height = 0, depth = 0, compressed = 0;
+		glGetTexLevelParameteriv(texture.target, level, GL_TEXTURE_WIDTH, &width);
+		if (width == 0) {
+			break;
+		}
+		glGetTexLevelParameteriv(texture.target, level, GL_TEXTURE_HEIGHT, &height);
+		glGetTexLevelParameteriv(texture.target, level, GL_TEXTURE_DEPTH, &depth);
+		glGetTexLevelParameteriv(texture.target, level, GL_TEXTURE_COMPRESSED, &compressed);
+		if (compressed) {
+			GLint size = 0;
+			glGetTexLevelParameteriv(texture.target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+			bytes += size;
+			continue;
+		}
+		GLint bits = 0;
+		for (int c = 0; c < 6; ++c) {
+			GLint size = 0;
+			glGetTexLevelParameteriv(texture.target, level, components[c], &size);
+			bits += size;
+		}
+		bytes += (size_t)width * height * (depth > 0 ? depth : 1) * bits / 8;
+	}
+	glBindTexture(texture.target, 0);
+	return bytes;
+}
+
+/*
+ * Meshes and textures streamed in on demand and evicted least recently used
+ * first once the budget is reached
+ */
+class UResidencyManager {
+public:
+
+	UResidencyManager() : budget(0), residentBytes(0), frame(0), frameOverBudget(false) {
+		ResetStats();
+	}
+
+	/*
+	 * @desc Budget in bytes for everything resident, 0 for no limit. A lower
+	 *       budget takes effect the next time something is streamed
+	 * @returns void
+	 */
+	void SetBudget(size_t bytes) {
+		budget = bytes;
+	}
+
+	/*
+	 * @desc Registers a mesh, nothing is streamed until it is used
+	 * @returns the handle for Mesh
+	 */
+	int AddMesh(const std::string& name, UMeshStreamer stream) {
+		resources.push_back(UResource(name, false));
+		resources.back().streamMesh = stream;
+		return (int)resources.size() - 1;
+	}
+
+	/*
+	 * @desc Registers a texture, nothing is streamed until it is used
+	 * @returns the handle for Texture
+	 */
+	int AddTexture(const std::string& name, UTextureStreamer stream) {
+		resources.push_back(UResource(name, true));
+		resources.back().streamTexture = stream;
+		return (int)resources.size() - 1;
+	}
+
+	/*
+	 * @desc Marks the start of a frame, what was used in the previous one can
+	 *       be evicted again
+	 * @returns void
+	 */
+	void BeginFrame(void) {
+		++frame;
+		frameOverBudget = false;
+	}
+
+	/*
+	 * @desc Uses a mesh this frame, streaming it in if it was evicted. The
+	 *       pointer stays put, its contents change when it is evicted
+	 * @returns the mesh, NULL if its streamer failed
+	 */
+	UMesh* Mesh(int handle) {
+		return UUse(handle) ? &resources[handle].mesh : NULL;
+	}
+
+	/*
+	 * @desc Uses a texture this frame, streaming it in if it was evicted
+	 * @returns the texture, NULL if its streamer failed
+	 */
+	UTexture* Texture(int handle) {
+		return UUse(handle) ? &resources[handle].texture : NULL;
+	}
+
+	/*
+	 * @desc Streams a resource again after its source changed. A resident
+	 *       one is replaced straight away and measured again, an evicted one
+	 *       picks the change up on its next use
+	 * @returns false if the streamer failed, the resource is then evicted
+	 */
+	bool Reload(int handle) {
+		if (!resources[handle].resident) {
+			return true;
+		}
+		UEvict(handle);
+		return UUse(handle);
+	}
+
+	bool Resident(int handle) const {
+		return resources[handle].resident;
+	}
+
+	/*
+	 * @desc Deletes the GL objects of one resource, it streams in again on use
+	 * @returns void
+	 */
+	void Evict(int handle) {
+		if (resources[handle].resident) {
+			UEvict(handle);
+		}
+	}
+
+	/*
+	 * @desc Deletes everything resident, needs the context to be current
+	 * @returns void
+	 */
+	void Destroy(void) {
+		for (size_t r = 0; r < resources.size(); ++r) {
+			Evict((int)r);
+		}
+	}
+
+	UResidencyStats Stats(void) const {
+		UResidencyStats result;
+		result.budgetBytes = budget;
+		result.residentBytes = residentBytes;
+		result.peakBytes = stats.peakBytes;
+		result.residentCount = lru.size();
+		result.totalCount = resources.size();
+		result.hits = stats.hits;
+		result.streams = stats.streams;
+		result.evictions = stats.evictions;
+		result.failures = stats.failures;
+		result.overBudgetFrames = stats.overBudgetFrames;
+		result.streamMilliseconds = stats.streamMilliseconds;
+		return result;
+	}
+
+	void ResetStats(void) {
+		stats = UCounters();
+		stats.peakBytes = residentBytes;
+	}
+
+	/*
+	 * @desc Writes one line of residency counters
+	 * @returns void
+	 */
+	void PrintStats(std::ostream& out) const {
+		UResidencyStats s = Stats();
+		out << "residency: " << s.residentCount << " of " << s.totalCount << " resident, "
+			<< s.residentBytes / 1024 << " KiB of " << (s.budgetBytes > 0 ? s.budgetBytes / 1024 : 0)
+			<< (s.budgetBytes > 0 ? " KiB budget" : " KiB (no budget)") << ", peak " << s.peakBytes / 1024 << " KiB, "
+			<< s.streams << " streams (" << s.streamMilliseconds << " ms), " << s.evictions << " evictions, "
+			<< s.hits << " hits";
+		if (s.failures > 0) {
+			out << ", " << s.failures << " failed";
+		}
+		if (s.overBudgetFrames > 0) {
+			out << ", " << s.overBudgetFrames << " frames over budget";
+		}
+		out << "\n";
+	}
+
+	/*
+	 * @desc Writes every resource with its size, state and stream count, most
+	 *       recently used first
+	 * @returns void
+	 */
+	void Report(std::ostream& out) const {
+		PrintStats(out);
+		for (std::list<int>::const_iterator r = lru.begin(); r != lru.end(); ++r) {
+			UReportLine(out, resources[*r]);
+		}
+		for (size_t r = 0; r < resources.size(); ++r) {
+			if (!resources[r].resident) {
+				UReportLine(out, resources[r]);
+			}
+		}
+	}
+
+private:
+
+	struct UResource {
+		std::string name;
+		bool isTexture;
+		bool resident;
+		size_t bytes;
+		unsigned lastUsed;
+		size_t streams;
+		UMesh mesh;
+		UTexture texture;
+		UMeshStreamer streamMesh;
+		UTextureStreamer streamTexture;
+		std::list<int>::iterator position;
+
+		UResource(const std::string& name, bool isTexture) : name(name), isTexture(isTexture), resident(false),
+			bytes(0), lastUsed(0), streams(0), mesh(), texture() {
+		}
+	};
+
+	struct UCounters {
+		size_t peakBytes;
+		size_t hits;
+		size_t streams;
+		size_t evictions;
+		size_t failures;
+		size_t overBudgetFrames;
+		double streamMilliseconds;
+
+		UCounters() : peakBytes(0), hits(0), streams(0), evictions(0), failures(0),
+			overBudgetFrames(0), streamMilliseconds(0.0) {
+		}
+	};
+
+	// Deque so the pointers handed out survive later registrations
+	std::deque<UResource> resources;
+
+	// Most recently used at the front
+	std::list<int> lru;
+	size_t budget, residentBytes;
+	unsigned frame;
+	bool frameOverBudget;
+	UCounters stats;
+
+	/*
+	 * @desc Touches a resource, streaming it in when it is not resident
+	 * @returns false if the streamer failed
+	 */
+	bool UUse(int handle) {
+		UResource& resource = resources[handle];
+		resource.lastUsed = frame;
+		if (resource.resident) {
+			lru.splice(lru.begin(), lru, resource.position);
+			++stats.hits;
+			return true;
+		}
+
+		// The size of the last time it was resident makes room up front
+		UMakeRoom(resource.bytes);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bool streamed;
+		if (resource.isTexture) {
+			resource.texture = UTexture();
+			resource.texture.target = GL_TEXTURE_2D;
+			streamed = resource.streamTexture(resource.texture);
+		}
+		else {
+			resource.mesh = UMesh();
+			streamed = resource.streamMesh(resource.mesh);
+		}
+		stats.streamMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (!streamed) {
+			UDelete(resource);
+			++stats.failures;
+			return false;
+		}
+
+		resource.bytes = resource.isTexture ? UTextureBytes(resource.texture) : UMeshBytes(resource.mesh);
+		resource.resident = true;
+		++resource.streams;
+		++stats.streams;
+		lru.push_front(handle);
+		resource.position = lru.begin();
+		residentBytes += resource.bytes;
+
+		// First streams only know their size now
+		UMakeRoom(0);
+		if (residentBytes > stats.peakBytes) {
+			stats.peakBytes = residentBytes;
+		}
+		return true;
+	}
+
+	/*
+	 * @desc Evicts from the back of the LRU list until bytes more fit, stops
+	 *       at the first resource used this frame
+	 * @returns void
+	 */
+	void UMakeRoom(size_t bytes) {
+		if (budget == 0) {
+			return;
+		}
+		while (residentBytes + bytes > budget && !lru.empty()) {
+			int victim = lru.back();
+			if (resources[victim].lastUsed == frame) {
+				break;
+			}
+			UEvict(victim);
+			++stats.evictions;
+		}
+		if (residentBytes + bytes > budget && !frameOverBudget) {
+			frameOverBudget = true;
+			++stats.overBudgetFrames;
+		}
+	}
+
+	void UEvict(int handle) {
+		UResource& resource = resources[handle];
+		UDelete(resource);
+		lru.erase(resource.position);
+		residentBytes -= resource.bytes;
+		resource.resident = false;
+	}
+
+	static void UDelete(UResource& resource) {
+		if (resource.isTexture) {
+			glDeleteTextures(1, &resource.texture.texture);
+			resource.texture.texture = 0;
+		}
+		else {
+			glDeleteVertexArrays(1, &resource.mesh.vertexArray);
+			glDeleteBuffers(1, &resource.mesh.vertexBuffer);
+			glDeleteBuffers(1, &resource.mesh.indexBuffer);
+			resource.mesh = UMesh();
+		}
+	}
+
+	static void UReportLine(std::ostream& out, const UResource& resource) {
+		out << "  " << (resource.isTexture ? "texture " : "mesh    ") << resource.name << ": "
+			<< resource.bytes / 1024 << " KiB, " << (resource.resident ? "resident" : "evicted")
+			<< ", streamed " << resource.streams << "x\n";
+	}
+};
+
+#endif // RESIDENCY_H
@@ -0,0 +1,57 @@
+/*
+ * @author Jacob William
+ * @desc Long-lived GPU resources (meshes, textures, programs) and the pools
+ *       they are allocated from
+ */
+
+#ifndef RESOURCES_H
+#define RESOURCES_H
+
+#include <ostream>
+#include <GL/glew.h>
+
+#include "FrameAllocator.h"
+
+// Vertex array with its buffers
+struct UMesh {
+	GLuint vertexArray;
+	GLuint vertexBuffer;
+	GLuint indexBuffer;
+	GLsizei vertexCount;
+	GLsizei indexCount;
+};
+
+// Texture object and its size
+struct UTexture {
+	GLuint texture;
+	GLenum target;
+	GLsizei width;
+	GLsizei height;
+	GLsizei layers;
+};
+
+// Linked shader program
+struct UProgram {
+	GLuint program;
+};
+
+/*
+ * One pool per resource type
+ */
+struct UResourcePools {
+	UPool<UMesh> meshes;
+	UPool<UTexture> textures;
+	UPool<UProgram> programs;
+
+	/*
+	 * @desc Writes the counters of every pool
+	 * @returns void
+	 */
+	void PrintStats(std::ostream& out) const {
+		UPrintAllocationStats(out, "mesh pool", meshes.Stats());
+		UPrintAllocationStats(out, "texture pool", textures.Stats());
+		UPrintAllocationStats(out, "program pool", programs.Stats());
+	}
+};
+
+#endif // RESOURCES_H
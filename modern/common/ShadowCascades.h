@@ -0,0 +1,397 @@
+/*
+ * @author Jacob William
+ * @desc Cascaded shadow maps for one directional light. The camera's depth
+ *       range is split between uniform and logarithmic spacing, each slice
+ *       gets an orthographic light box around its bounding sphere and the
+ *       cascades are layers of one depth texture array.
+ *
+ *       A box is sized from the sphere, which does not change as the camera
+ *       turns, and is centred on whole texels, so edges do not shimmer. A
+ *       box is also padded and only re-centred once its slice leaves it, so a
+ *       cascade keeps the same projection over many frames. A cascade whose
+ *       projection, light and casters are unchanged keeps last frame's depth
+ *       and draws nothing; a still camera over a static scene renders no
+ *       shadow geometry at all.
+ */
+
+#ifndef SHADOW_CASCADES_H
+#define SHADOW_CASCADES_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <GL/glew.h>
+
+// Cascades, ShadowCascadesShader declares arrays of this size
+const int ShadowCascadeCount = 4;
+
+// 0 spaces the splits evenly, 1 logarithmically
+const float ShadowSplitLambda = 0.75f;
+
+// Extra box size around a slice's sphere, traded against resolution
+const float ShadowCascadePadding = 0.15f;
+
+// Frames between issuing a timer query and reading it
+const int ShadowQueryLatency = 3;
+
+struct UShadowStats {
+	uint64_t frames;
+	uint64_t cascadesRendered;
+	double gpuMilliseconds;		// frames whose timer has been read
+	uint64_t timedFrames;
+};
+
+#ifndef GLSL_PART
+#define GLSL_PART(Source) #Source "\n"
+#endif
+
+/*
+ * Fragment shader part, goes after the #version line. UShadowFactor takes a
+ * world position and its view depth and returns 0 in shadow to 1 lit, 3x3
+ * filtered by the hardware depth compare
+ */
+const GLchar* ShadowCascadesShader = GLSL_PART(
+	uniform sampler2DArrayShadow uShadowMap;
+	uniform mat4 uShadowMatrices[4];
+	uniform vec4 uCascadeEnds;
+
+	float UShadowFactor(vec3 worldPosition, float viewDepth) {
+		int cascade = int(dot(vec4(greaterThanEqual(vec4(viewDepth), uCascadeEnds)), vec4(1.0)));
+		if (cascade > 3) {
+			return 1.0;
+		}
+		vec4 clip = uShadowMatrices[cascade] * vec4(worldPosition, 1.0);
+		vec3 coordinates = clip.xyz * 0.5 + 0.5;
+
+		// Receivers past every caster compare as the cleared far depth
+		coordinates.z = min(coordinates.z, 1.0);
+		vec2 texel = 1.0 / vec2(textureSize(uShadowMap, 0).xy);
+
+		float lit = 0.0;
+		for (int y = -1; y <= 1; ++y) {
+			for (int x = -1; x <= 1; ++x) {
+				lit += texture(uShadowMap, vec4(coordinates.xy + vec2(x, y) * texel, float(cascade), coordinates.z));
+			}
+		}
+		return lit / 9.0;
+	}
+);
+
+/*
+ * @desc Far end of each cascade between the near and far planes, mixing
+ *       uniform and logarithmic spacing by lambda
+ * @returns void
+ */
+inline void UComputeCascadeSplits(float nearPlane, float farPlane, int count, float lambda, float* ends) {
+	for (int i = 1; i <= count; ++i) {
+		float fraction = (float)i / count;
+		float logarithmic = nearPlane * std::pow(farPlane / nearPlane, fraction);
+		float uniform = nearPlane + (farPlane - nearPlane) * fraction;
+		ends[i - 1] = lambda * logarithmic + (1.0f - lambda) * uniform;
+	}
+}
+
+class UShadowCascades {
+public:
+
+	typedef std::function<void(const float* lightViewProjection)> UCasterFunction;
+
+	UShadowCascades() : size(0), texture(0), framebuffer(0), casterVersion(0), frame(0) {
+		memset(queries, 0, sizeof(queries));
+		memset(pending, 0, sizeof(pending));
+		memset(&stats, 0, sizeof(stats));
+		memset(lightDirection, 0, sizeof(lightDirection));
+		for (int c = 0; c < ShadowCascadeCount; ++c) {
+			cascades[c].x = cascades[c].y = cascades[c].half = 0.0f;
+			cascades[c].valid = false;
+			cascades[c].dirty = true;
+		}
+	}
+
+	/*
+	 * @desc Creates the depth array, one size x size layer per cascade
+	 * @returns void
+	 */
+	void Create(int mapSize) {
+		size = mapSize;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, size, size, ShadowCascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		glGenQueries(ShadowQueryLatency, queries);
+	}
+
+	void Destroy(void) {
+		glDeleteTextures(1, &texture);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteQueries(ShadowQueryLatency, queries);
+		texture = framebuffer = 0;
+	}
+
+	/*
+	 * @desc Fits the cascades to this frame's camera without GL calls. view
+	 *       must be a rigid column-major world to view matrix and projection
+	 *       a symmetric glm::perspective style matrix. casters is the world
+	 *       bounding sphere of everything casting shadows (x, y, z, radius),
+	 *       receivers may lie outside it; change version whenever a caster
+	 *       moves
+	 * @returns void
+	 */
+	void Update(const float* view, const float* projection, float nearPlane, float farPlane,
+			const float* towardsLight, const float* casters, unsigned version) {
+		float tanX = 1.0f / projection[0], tanY = 1.0f / projection[5];
+		UComputeCascadeSplits(nearPlane, farPlane, ShadowCascadeCount, ShadowSplitLambda, ends);
+
+		// Light basis, forward points from the light into the scene
+		float direction[3] = { -towardsLight[0], -towardsLight[1], -towardsLight[2] };
+		UNormalize(direction);
+		bool lightChanged = memcmp(direction, lightDirection, sizeof(direction)) != 0;
+		memcpy(lightDirection, direction, sizeof(direction));
+		float up[3] = { 0.0f, 1.0f, 0.0f };
+		if (std::fabs(direction[1]) > 0.99f) {
+			up[0] = 1.0f;
+			up[1] = 0.0f;
+		}
+		UCross(direction, up, right);
+		UNormalize(right);
+		UCross(right, direction, this->up);
+		memcpy(forward, direction, sizeof(forward));
+
+		// Depth range in light space covers every caster
+		float casterDepth = UDot(casters, forward);
+		float depthMin = casterDepth - casters[3], depthMax = casterDepth + casters[3];
+
+		bool castersChanged = version != casterVersion;
+		casterVersion = version;
+
+		float start = nearPlane;
+		for (int c = 0; c < ShadowCascadeCount; ++c) {
+			UCascade& cascade = cascades[c];
+
+			// Slice corners in world space, the view is undone as a rotation and translation
+			float centre[3] = { 0.0f, 0.0f, 0.0f };
+			float corners[8][3];
+			for (int k = 0; k < 8; ++k) {
+				float depth = k < 4 ? start : ends[c];
+				float viewPoint[3] = { (k & 1 ? 1.0f : -1.0f) * depth * tanX, (k & 2 ? 1.0f : -1.0f) * depth * tanY, -depth };
+				UViewToWorld(view, viewPoint, corners[k]);
+				for (int i = 0; i < 3; ++i) {
+					centre[i] += corners[k][i] / 8.0f;
+				}
+			}
+			float radius = 0.0f;
+			for (int k = 0; k < 8; ++k) {
+				float offset[3] = { corners[k][0] - centre[0], corners[k][1] - centre[1], corners[k][2] - centre[2] };
+				radius = std::max(radius, std::sqrt(UDot(offset, offset)));
+			}
+			// Rounded up so float noise does not resize the box
+			radius = std::ceil(radius * 16.0f) / 16.0f;
+
+			float half = radius * (1.0f + ShadowCascadePadding);
+			float texel = 2.0f * half / size;
+			float x = UDot(centre, right), y = UDot(centre, this->up);
+
+			bool resized = !cascade.valid || cascade.half != half;
+			bool outside = std::fabs(x - cascade.x) + radius > cascade.half || std::fabs(y - cascade.y) + radius > cascade.half;
+			if (resized || outside || lightChanged) {
+				cascade.half = half;
+				cascade.x = std::floor(x / texel + 0.5f) * texel;
+				cascade.y = std::floor(y / texel + 0.5f) * texel;
+				cascade.dirty = true;
+			}
+			if (castersChanged || cascade.depthMin != depthMin || cascade.depthMax != depthMax) {
+				cascade.dirty = true;
+			}
+			cascade.depthMin = depthMin;
+			cascade.depthMax = depthMax;
+			cascade.valid = true;
+			UBuildMatrix(cascade);
+			start = ends[c];
+		}
+	}
+
+	/*
+	 * @desc Redraws the cascades marked dirty by Update into their layers.
+	 *       drawCasters gets the light view projection and draws every
+	 *       caster depth only; the viewport and framebuffer are left on the
+	 *       shadow map
+	 * @returns cascades rendered
+	 */
+	int Render(UCasterFunction drawCasters) {
+		int slot = (int)(frame % ShadowQueryLatency);
+		if (pending[slot]) {
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &nanoseconds);
+			stats.gpuMilliseconds += nanoseconds / 1e6;
+			stats.timedFrames++;
+			pending[slot] = false;
+		}
+
+		glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+		int rendered = 0;
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glViewport(0, 0, size, size);
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(2.0f, 4.0f);
+		for (int c = 0; c < ShadowCascadeCount; ++c) {
+			if (!cascades[c].dirty) {
+				continue;
+			}
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, c);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			drawCasters(cascades[c].matrix);
+			cascades[c].dirty = false;
+			++rendered;
+		}
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glEndQuery(GL_TIME_ELAPSED);
+		pending[slot] = true;
+
+		stats.frames++;
+		stats.cascadesRendered += rendered;
+		++frame;
+		return rendered;
+	}
+
+	/*
+	 * @desc Sets the ShadowCascadesShader uniforms and binds the depth array
+	 *       to unit, program must be in use
+	 * @returns void
+	 */
+	void Bind(GLuint program, GLint unit) const {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		glActiveTexture(GL_TEXTURE0);
+		glUniform1i(glGetUniformLocation(program, "uShadowMap"), unit);
+
+		float matrices[ShadowCascadeCount * 16];
+		for (int c = 0; c < ShadowCascadeCount; ++c) {
+			memcpy(matrices + c * 16, cascades[c].matrix, sizeof(cascades[c].matrix));
+		}
+		glUniformMatrix4fv(glGetUniformLocation(program, "uShadowMatrices"), ShadowCascadeCount, GL_FALSE, matrices);
+		glUniform4fv(glGetUniformLocation(program, "uCascadeEnds"), 1, ends);
+	}
+
+	/*
+	 * @desc Cascades Update marked for redrawing
+	 * @returns count
+	 */
+	int DirtyCount(void) const {
+		int dirty = 0;
+		for (int c = 0; c < ShadowCascadeCount; ++c) {
+			dirty += cascades[c].dirty;
+		}
+		return dirty;
+	}
+
+	UShadowStats Stats(void) const {
+		return stats;
+	}
+
+	void ResetStats(void) {
+		memset(&stats, 0, sizeof(stats));
+	}
+
+	/*
+	 * @desc One line: cascades redrawn and GPU time per frame
+	 * @returns void
+	 */
+	void PrintStats(std::ostream& out) const {
+		if (stats.frames == 0) {
+			return;
+		}
+		out << "shadows: " << (double)stats.cascadesRendered / stats.frames << " of " << ShadowCascadeCount
+			<< " cascades redrawn per frame";
+		if (stats.timedFrames > 0) {
+			out << ", " << stats.gpuMilliseconds / stats.timedFrames << " ms GPU per frame";
+		}
+		out << std::endl;
+	}
+
+private:
+
+	struct UCascade {
+		float x, y, half;			// box centre and half size in light space
+		float depthMin, depthMax;
+		float matrix[16];			// world to light clip space, column-major
+		bool valid, dirty;
+	};
+
+	static float UDot(const float* a, const float* b) {
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	static void UCross(const float* a, const float* b, float* out) {
+		out[0] = a[1] * b[2] - a[2] * b[1];
+		out[1] = a[2] * b[0] - a[0] * b[2];
+		out[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	static void UNormalize(float* v) {
+		float length = std::sqrt(UDot(v, v));
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+
+	/*
+	 * @desc Inverse of a rigid view matrix applied to a point: R^T (p - t)
+	 * @returns void
+	 */
+	static void UViewToWorld(const float* view, const float* p, float* out) {
+		float q[3] = { p[0] - view[12], p[1] - view[13], p[2] - view[14] };
+		for (int i = 0; i < 3; ++i) {
+			out[i] = view[i * 4 + 0] * q[0] + view[i * 4 + 1] * q[1] + view[i * 4 + 2] * q[2];
+		}
+	}
+
+	/*
+	 * @desc Orthographic projection of the cascade's box along the light
+	 * @returns void
+	 */
+	void UBuildMatrix(UCascade& cascade) const {
+		float depthScale = 2.0f / (cascade.depthMax - cascade.depthMin);
+		float* m = cascade.matrix;
+		for (int i = 0; i < 3; ++i) {
+			m[i * 4 + 0] = right[i] / cascade.half;
+			m[i * 4 + 1] = up[i] / cascade.half;
+			m[i * 4 + 2] = forward[i] * depthScale;
+			m[i * 4 + 3] = 0.0f;
+		}
+		m[12] = -cascade.x / cascade.half;
+		m[13] = -cascade.y / cascade.half;
+		m[14] = -cascade.depthMin * depthScale - 1.0f;
+		m[15] = 1.0f;
+	}
+
+	int size;
+	GLuint texture, framebuffer;
+	GLuint queries[ShadowQueryLatency];
+	bool pending[ShadowQueryLatency];
+	UCascade cascades[ShadowCascadeCount];
+	float ends[ShadowCascadeCount];
+	float lightDirection[3], right[3], up[3], forward[3];
+	unsigned casterVersion;
+	uint64_t frame;
+	UShadowStats stats;
+};
+
+#endif // SHADOW_CASCADES_H
@@ -0,0 +1,566 @@
+/*
+ * @author Jacob William
+ * @desc CPU rasterizer with the same draw inputs the demos give GL: an
+ *       interleaved vertex buffer, optional indices, and the model, view and
+ *       projection matrices. Draws are only recorded until Finish, which
+ *       transforms, clips against the near plane and bins the triangles into
+ *       64x64 tiles in parallel chunks, then renders every tile as its own
+ *       job. Tiles walk 8x8 blocks: a block is skipped when the triangle is
+ *       behind everything already drawn there (per block max depth) or
+ *       entirely outside one edge, otherwise the edge functions are evaluated
+ *       four pixels at a time with SSE.
+ *
+ *       Depth test is GL_LESS, there is no face culling, as in the demos.
+ *       Pixel centers exactly on an edge follow the top-left fill rule, so
+ *       triangles sharing that edge do not both draw them.
+ */
+
+#ifndef SOFTWARE_RASTERIZER_H
+#define SOFTWARE_RASTERIZER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "Image.h"
+#include "JobSystem.h"
+
+const int RasterTileSize = 64;
+const int RasterBlockSize = 8;
+
+// Triangles per setup job
+const size_t RasterChunkTriangles = 1024;
+
+/*
+ * Where the attributes are in one vertex, in floats; -1 when absent.
+ * flipTexcoordY mirrors the 1 - y the demo vertex shaders apply
+ */
+struct USoftwareVertexLayout {
+	int stride;
+	int position;
+	int color;
+	int texcoord;
+	bool flipTexcoordY;
+};
+
+struct URasterStats {
+	size_t triangles;
+	size_t pixels;
+};
+
+class USoftwareRasterizer {
+public:
+
+	USoftwareRasterizer(UJobSystem& jobs, int width, int height) : jobs(jobs), texture(NULL) {
+		stats.triangles = 0;
+		stats.pixels = 0;
+		Resize(width, height);
+	}
+
+	void Resize(int width, int height) {
+		this->width = width;
+		this->height = height;
+		tilesX = (width + RasterTileSize - 1) / RasterTileSize;
+		tilesY = (height + RasterTileSize - 1) / RasterTileSize;
+		blocksX = (width + RasterBlockSize - 1) / RasterBlockSize;
+		blocksY = (height + RasterBlockSize - 1) / RasterBlockSize;
+		color.width = width;
+		color.height = height;
+		color.pixels.assign((size_t)width * height * 4, 0);
+		depth.assign((size_t)width * height, 1.0f);
+		blockMaxDepth.assign((size_t)blocksX * blocksY, 1.0f);
+	}
+
+	/*
+	 * @desc Clears color and depth, like glClear with both bits
+	 * @returns void
+	 */
+	void Clear(float red, float green, float blue, float alpha) {
+		unsigned char clear[4] = { UToByte(red), UToByte(green), UToByte(blue), UToByte(alpha) };
+		for (size_t i = 0; i < color.pixels.size(); i += 4) {
+			memcpy(&color.pixels[i], clear, 4);
+		}
+		std::fill(depth.begin(), depth.end(), 1.0f);
+		std::fill(blockMaxDepth.begin(), blockMaxDepth.end(), 1.0f);
+		draws.clear();
+		stats.triangles = 0;
+		stats.pixels = 0;
+	}
+
+	/*
+	 * @desc Texture for the following draws, NULL for vertex colors only
+	 * @returns void
+	 */
+	void BindTexture(const UImage* image) {
+		texture = image;
+	}
+
+	/*
+	 * @desc Records a triangle list draw, like glDrawArrays(GL_TRIANGLES) or
+	 *       glDrawElements when indices is not NULL. Buffers must stay alive
+	 *       until Finish
+	 * @parameters vertices, layout, indices or NULL, vertex or index count,
+	 *             column major model, view and projection
+	 * @returns void
+	 */
+	void Draw(const float* vertices, const USoftwareVertexLayout& layout, const uint32_t* indices, size_t count,
+			const float* model, const float* view, const float* projection) {
+		UDraw draw;
+		draw.vertices = vertices;
+		draw.layout = layout;
+		draw.indices = indices;
+		draw.triangleCount = count / 3;
+		draw.texture = texture;
+		float viewProjection[16];
+		UMultiply(projection, view, viewProjection);
+		UMultiply(viewProjection, model, draw.mvp);
+		draws.push_back(draw);
+	}
+
+	/*
+	 * @desc Sets up, bins and rasterizes everything recorded since the last Finish
+	 * @returns void
+	 */
+	void Finish(void) {
+		// Global triangle index of every draw, setup chunks may span draws
+		size_t total = 0;
+		firstTriangle.resize(draws.size());
+		for (size_t d = 0; d < draws.size(); ++d) {
+			firstTriangle[d] = total;
+			total += draws[d].triangleCount;
+		}
+
+		size_t chunkCount = (total + RasterChunkTriangles - 1) / RasterChunkTriangles;
+		if (chunks.size() < chunkCount) {
+			chunks.resize(chunkCount);
+		}
+		for (size_t c = 0; c < chunkCount; ++c) {
+			chunks[c].bins.resize((size_t)tilesX * tilesY);
+		}
+
+		jobs.ParallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+			for (size_t c = begin; c < end; ++c) {
+				USetupChunk(chunks[c], c * RasterChunkTriangles, std::min(total, (c + 1) * RasterChunkTriangles));
+			}
+		});
+
+		std::atomic<size_t> pixels(0);
+		jobs.ParallelFor((size_t)tilesX * tilesY, 1, [&](size_t begin, size_t end) {
+			for (size_t tile = begin; tile < end; ++tile) {
+				pixels += URasterizeTile(tile, chunkCount);
+			}
+		});
+
+		for (size_t c = 0; c < chunkCount; ++c) {
+			stats.triangles += chunks[c].triangles.size();
+		}
+		stats.pixels += pixels;
+		draws.clear();
+	}
+
+	/*
+	 * @desc Color buffer, row 0 is the top of the image
+	 */
+	const UImage& Color(void) const {
+		return color;
+	}
+
+	/*
+	 * @desc Triangles rasterized and pixels written since Clear
+	 */
+	URasterStats Stats(void) const {
+		return stats;
+	}
+
+private:
+
+	// Screen position, depth, 1/w and attributes divided by w
+	struct URasterVertex {
+		float x, y, z, inverseW;
+		float attributes[5];
+	};
+
+	struct UTriangle {
+		// Barycentric weight i = a[i] * x + b[i] * y + c[i]
+		float a[3], b[3], c[3];
+		// Edge i is a top or left edge, a weight of exactly 0 is inside
+		bool topLeft[3];
+		float z[3], inverseW[3];
+		float attributes[3][5];
+		int minX, minY, maxX, maxY;
+		float minZ;
+		bool colored;
+		const UImage* texture;
+	};
+
+	struct UChunk {
+		std::vector<UTriangle> triangles;
+		std::vector<std::vector<uint32_t> > bins;
+	};
+
+	struct UDraw {
+		const float* vertices;
+		USoftwareVertexLayout layout;
+		const uint32_t* indices;
+		size_t triangleCount;
+		const UImage* texture;
+		float mvp[16];
+	};
+
+	UJobSystem& jobs;
+	int width, height, tilesX, tilesY, blocksX, blocksY;
+	UImage color;
+	std::vector<float> depth, blockMaxDepth;
+	const UImage* texture;
+	std::vector<UDraw> draws;
+	std::vector<size_t> firstTriangle;
+	std::vector<UChunk> chunks;
+	URasterStats stats;
+
+	static unsigned char UToByte(float value) {
+		return (unsigned char)(std::min(1.0f, std::max(0.0f, value)) * 255.0f + 0.5f);
+	}
+
+	static void UMultiply(const float* a, const float* b, float* out) {
+		for (int column = 0; column < 4; ++column) {
+			for (int row = 0; row < 4; ++row) {
+				out[column * 4 + row] = a[row] * b[column * 4] + a[4 + row] * b[column * 4 + 1]
+					+ a[8 + row] * b[column * 4 + 2] + a[12 + row] * b[column * 4 + 3];
+			}
+		}
+	}
+
+	/*
+	 * @desc Transforms, clips and bins triangles [first, last) into chunk
+	 * @returns void
+	 */
+	void USetupChunk(UChunk& chunk, size_t first, size_t last) {
+		chunk.triangles.clear();
+		for (size_t b = 0; b < chunk.bins.size(); ++b) {
+			chunk.bins[b].clear();
+		}
+
+		size_t d = std::upper_bound(firstTriangle.begin(), firstTriangle.end(), first) - firstTriangle.begin() - 1;
+		for (size_t t = first; t < last; ++t) {
+			while (t >= firstTriangle[d] + draws[d].triangleCount) {
+				++d;
+			}
+			const UDraw& draw = draws[d];
+			size_t local = t - firstTriangle[d];
+
+			// Clip space vertex plus attributes
+			float clip[4][4], attributes[4][5];
+			for (int v = 0; v < 3; ++v) {
+				size_t index = draw.indices != NULL ? draw.indices[local * 3 + v] : local * 3 + v;
+				const float* vertex = draw.vertices + index * draw.layout.stride;
+				const float* position = vertex + draw.layout.position;
+				for (int row = 0; row < 4; ++row) {
+					clip[v][row] = draw.mvp[row] * position[0] + draw.mvp[4 + row] * position[1]
+						+ draw.mvp[8 + row] * position[2] + draw.mvp[12 + row];
+				}
+				for (int i = 0; i < 3; ++i) {
+					attributes[v][i] = draw.layout.color >= 0 ? vertex[draw.layout.color + i] : 1.0f;
+				}
+				attributes[v][3] = draw.layout.texcoord >= 0 ? vertex[draw.layout.texcoord] : 0.0f;
+				attributes[v][4] = draw.layout.texcoord >= 0 ? vertex[draw.layout.texcoord + 1] : 0.0f;
+				if (draw.layout.flipTexcoordY) {
+					attributes[v][4] = 1.0f - attributes[v][4];
+				}
+			}
+
+			// Trivially outside one of the side planes
+			bool outside = false;
+			for (int axis = 0; axis < 3 && !outside; ++axis) {
+				outside = (clip[0][axis] > clip[0][3] && clip[1][axis] > clip[1][3] && clip[2][axis] > clip[2][3])
+					|| (clip[0][axis] < -clip[0][3] && clip[1][axis] < -clip[1][3] && clip[2][axis] < -clip[2][3]);
+			}
+			if (outside) {
+				continue;
+			}
+
+			// Near plane z >= -w, a triangle becomes at most a quad
+			float polygon[4][4], polygonAttributes[4][5];
+			int count = 0;
+			for (int v = 0; v < 3; ++v) {
+				int next = (v + 1) % 3;
+				float distance = clip[v][2] + clip[v][3], nextDistance = clip[next][2] + clip[next][3];
+				if (distance >= 0.0f) {
+					memcpy(polygon[count], clip[v], sizeof(polygon[count]));
+					memcpy(polygonAttributes[count++], attributes[v], sizeof(polygonAttributes[0]));
+				}
+				if ((distance >= 0.0f) != (nextDistance >= 0.0f)) {
+					float s = distance / (distance - nextDistance);
+					for (int i = 0; i < 4; ++i) {
+						polygon[count][i] = clip[v][i] + s * (clip[next][i] - clip[v][i]);
+					}
+					for (int i = 0; i < 5; ++i) {
+						polygonAttributes[count][i] = attributes[v][i] + s * (attributes[next][i] - attributes[v][i]);
+					}
+					++count;
+				}
+			}
+
+			for (int fan = 1; fan + 1 < count; ++fan) {
+				URasterVertex screen[3];
+				int corners[3] = { 0, fan, fan + 1 };
+				for (int v = 0; v < 3; ++v) {
+					const float* p = polygon[corners[v]];
+					float inverseW = 1.0f / p[3];
+					screen[v].x = (p[0] * inverseW * 0.5f + 0.5f) * width;
+					screen[v].y = (0.5f - p[1] * inverseW * 0.5f) * height;
+					screen[v].z = p[2] * inverseW * 0.5f + 0.5f;
+					screen[v].inverseW = inverseW;
+					for (int i = 0; i < 5; ++i) {
+						screen[v].attributes[i] = polygonAttributes[corners[v]][i] * inverseW;
+					}
+				}
+				UAddTriangle(chunk, screen, draw);
+			}
+		}
+	}
+
+	/*
+	 * @desc Edge setup and binning of one screen space triangle
+	 * @returns void
+	 */
+	void UAddTriangle(UChunk& chunk, const URasterVertex* v, const UDraw& draw) {
+		float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+		if (std::fabs(area) < 1e-8f) {
+			return;
+		}
+
+		UTriangle triangle;
+		int minX = (int)std::floor(std::min(v[0].x, std::min(v[1].x, v[2].x)));
+		int minY = (int)std::floor(std::min(v[0].y, std::min(v[1].y, v[2].y)));
+		int maxX = (int)std::ceil(std::max(v[0].x, std::max(v[1].x, v[2].x)));
+		int maxY = (int)std::ceil(std::max(v[0].y, std::max(v[1].y, v[2].y)));
+		triangle.minX = std::max(minX, 0);
+		triangle.minY = std::max(minY, 0);
+		triangle.maxX = std::min(maxX, width - 1);
+		triangle.maxY = std::min(maxY, height - 1);
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+			return;
+		}
+
+		// Weight of vertex i comes from the edge opposite to it
+		float inverseArea = 1.0f / area;
+		for (int i = 0; i < 3; ++i) {
+			const URasterVertex& p = v[(i + 1) % 3];
+			const URasterVertex& q = v[(i + 2) % 3];
+			triangle.a[i] = (p.y - q.y) * inverseArea;
+			triangle.b[i] = (q.x - p.x) * inverseArea;
+			triangle.c[i] = (p.x * q.y - q.x * p.y) * inverseArea;
+			// Weights grow into the triangle and y points down, so the
+			// triangle is right of a left edge and below a top edge
+			triangle.topLeft[i] = triangle.a[i] > 0.0f || (triangle.a[i] == 0.0f && triangle.b[i] > 0.0f);
+			triangle.z[i] = v[i].z;
+			triangle.inverseW[i] = v[i].inverseW;
+			memcpy(triangle.attributes[i], v[i].attributes, sizeof(triangle.attributes[i]));
+		}
+		triangle.minZ = std::min(v[0].z, std::min(v[1].z, v[2].z));
+		triangle.colored = draw.layout.color >= 0;
+		triangle.texture = draw.layout.texcoord >= 0 ? draw.texture : NULL;
+
+		uint32_t index = (uint32_t)chunk.triangles.size();
+		chunk.triangles.push_back(triangle);
+		for (int ty = triangle.minY / RasterTileSize; ty <= triangle.maxY / RasterTileSize; ++ty) {
+			for (int tx = triangle.minX / RasterTileSize; tx <= triangle.maxX / RasterTileSize; ++tx) {
+				chunk.bins[(size_t)ty * tilesX + tx].push_back(index);
+			}
+		}
+	}
+
+	/*
+	 * @desc Draws every binned triangle of one tile in submission order
+	 * @returns pixels written
+	 */
+	size_t URasterizeTile(size_t tile, size_t chunkCount) {
+		int tileX = (int)(tile % tilesX) * RasterTileSize, tileY = (int)(tile / tilesX) * RasterTileSize;
+		int tileMaxX = std::min(tileX + RasterTileSize, width) - 1, tileMaxY = std::min(tileY + RasterTileSize, height) - 1;
+		size_t written = 0;
+
+		for (size_t c = 0; c < chunkCount; ++c) {
+			const std::vector<uint32_t>& bin = chunks[c].bins[tile];
+			for (size_t i = 0; i < bin.size(); ++i) {
+				const UTriangle& triangle = chunks[c].triangles[bin[i]];
+				int minX = std::max(triangle.minX, tileX), maxX = std::min(triangle.maxX, tileMaxX);
+				int minY = std::max(triangle.minY, tileY), maxY = std::min(triangle.maxY, tileMaxY);
+
+				for (int by = minY / RasterBlockSize; by <= maxY / RasterBlockSize; ++by) {
+					for (int bx = minX / RasterBlockSize; bx <= maxX / RasterBlockSize; ++bx) {
+						written += URasterizeBlock(triangle, bx, by, minX, minY, maxX, maxY);
+					}
+				}
+			}
+		}
+		return written;
+	}
+
+	/*
+	 * @desc One 8x8 block of one triangle, limited to the given pixel rectangle
+	 * @returns pixels written
+	 */
+	size_t URasterizeBlock(const UTriangle& triangle, int bx, int by, int minX, int minY, int maxX, int maxY) {
+		size_t block = (size_t)by * blocksX + bx;
+
+		// Hierarchical depth: nothing of this triangle can be in front here
+		if (triangle.minZ >= blockMaxDepth[block]) {
+			return 0;
+		}
+
+		int x0 = std::max(bx * RasterBlockSize, minX), x1 = std::min(bx * RasterBlockSize + RasterBlockSize - 1, maxX);
+		int y0 = std::max(by * RasterBlockSize, minY), y1 = std::min(by * RasterBlockSize + RasterBlockSize - 1, maxY);
+
+		// Block entirely outside one edge, weights are linear so the corners decide
+		for (int e = 0; e < 3; ++e) {
+			float cx0 = x0 + 0.5f, cx1 = x1 + 0.5f, cy0 = y0 + 0.5f, cy1 = y1 + 0.5f;
+			float w00 = triangle.a[e] * cx0 + triangle.b[e] * cy0 + triangle.c[e];
+			float w10 = triangle.a[e] * cx1 + triangle.b[e] * cy0 + triangle.c[e];
+			float w01 = triangle.a[e] * cx0 + triangle.b[e] * cy1 + triangle.c[e];
+			float w11 = triangle.a[e] * cx1 + triangle.b[e] * cy1 + triangle.c[e];
+			if (w00 < 0.0f && w10 < 0.0f && w01 < 0.0f && w11 < 0.0f) {
+				return 0;
+			}
+		}
+
+		size_t written = 0;
+		for (int y = y0; y <= y1; ++y) {
+			float* depthRow = &depth[(size_t)y * width];
+			float py = y + 0.5f;
+			for (int x = x0; x <= x1; x += 4) {
+				int mask = UCoverage(triangle, x, py, x1, depthRow);
+				for (int lane = 0; lane < 4; ++lane) {
+					if (mask & (1 << lane)) {
+						UShade(triangle, x + lane, y);
+						++written;
+					}
+				}
+			}
+		}
+
+		if (written > 0) {
+			float maximum = 0.0f;
+			int blockX1 = std::min(bx * RasterBlockSize + RasterBlockSize, width);
+			int blockY1 = std::min(by * RasterBlockSize + RasterBlockSize, height);
+			for (int y = by * RasterBlockSize; y < blockY1; ++y) {
+				for (int x = bx * RasterBlockSize; x < blockX1; ++x) {
+					maximum = std::max(maximum, depth[(size_t)y * width + x]);
+				}
+			}
+			blockMaxDepth[block] = maximum;
+		}
+		return written;
+	}
+
+	/*
+	 * @desc Inside and depth tests for pixels x .. x + 3 of a row, passing
+	 *       pixels get their new depth
+	 * @returns bit mask of passing pixels
+	 */
+	int UCoverage(const UTriangle& t, int x, float py, int maxX, float* depthRow) {
+		int valid = maxX - x >= 3 ? 15 : (1 << (maxX - x + 1)) - 1;
+#ifdef __SSE2__
+		__m128 px = _mm_add_ps(_mm_set1_ps(x + 0.5f), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+		__m128 zero = _mm_setzero_ps();
+		__m128 weights[3];
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int e = 0; e < 3; ++e) {
+			weights[e] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.a[e]), px), _mm_set1_ps(t.b[e] * py + t.c[e]));
+			inside = _mm_and_ps(inside, t.topLeft[e] ? _mm_cmpge_ps(weights[e], zero) : _mm_cmpgt_ps(weights[e], zero));
+		}
+		int mask = _mm_movemask_ps(inside) & valid;
+		if (mask == 0) {
+			return 0;
+		}
+		__m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(weights[0], _mm_set1_ps(t.z[0])), _mm_mul_ps(weights[1], _mm_set1_ps(t.z[1]))),
+			_mm_mul_ps(weights[2], _mm_set1_ps(t.z[2])));
+		float zs[4];
+		_mm_storeu_ps(zs, z);
+#else
+		int mask = 0;
+		float zs[4];
+		for (int lane = 0; lane < 4; ++lane) {
+			float px = x + lane + 0.5f, w[3];
+			bool inside = true;
+			for (int e = 0; e < 3; ++e) {
+				w[e] = t.a[e] * px + t.b[e] * py + t.c[e];
+				inside = inside && (w[e] > 0.0f || (w[e] == 0.0f && t.topLeft[e]));
+			}
+			zs[lane] = w[0] * t.z[0] + w[1] * t.z[1] + w[2] * t.z[2];
+			if (inside) {
+				mask |= 1 << lane;
+			}
+		}
+		mask &= valid;
+#endif
+		for (int lane = 0; lane < 4; ++lane) {
+			if ((mask & (1 << lane)) && zs[lane] >= 0.0f && zs[lane] < depthRow[x + lane]) {
+				depthRow[x + lane] = zs[lane];
+			}
+			else {
+				mask &= ~(1 << lane);
+			}
+		}
+		return mask;
+	}
+
+	/*
+	 * @desc Perspective correct attributes, vertex color times texture
+	 * @returns void
+	 */
+	void UShade(const UTriangle& t, int x, int y) {
+		float px = x + 0.5f, py = y + 0.5f, w[3];
+		for (int e = 0; e < 3; ++e) {
+			w[e] = t.a[e] * px + t.b[e] * py + t.c[e];
+		}
+		float correction = 1.0f / (w[0] * t.inverseW[0] + w[1] * t.inverseW[1] + w[2] * t.inverseW[2]);
+		float attributes[5];
+		for (int i = 0; i < 5; ++i) {
+			attributes[i] = (w[0] * t.attributes[0][i] + w[1] * t.attributes[1][i] + w[2] * t.attributes[2][i]) * correction;
+		}
+
+		float rgba[4] = { attributes[0], attributes[1], attributes[2], 1.0f };
+		if (t.texture != NULL) {
+			float texel[4];
+			USample(*t.texture, attributes[3], attributes[4], texel);
+			for (int i = 0; i < 4; ++i) {
+				rgba[i] = t.colored ? rgba[i] * texel[i] : texel[i];
+			}
+		}
+
+		unsigned char* pixel = &color.pixels[((size_t)y * width + x) * 4];
+		for (int i = 0; i < 4; ++i) {
+			pixel[i] = UToByte(rgba[i]);
+		}
+	}
+
+	/*
+	 * @desc Bilinear sample with repeat wrapping, t = 0 is the first image row
+	 *       as with glTexImage2D data
+	 * @returns void
+	 */
+	static void USample(const UImage& image, float s, float t, float* out) {
+		float fx = s * image.width - 0.5f, fy = t * image.height - 0.5f;
+		float floorX = std::floor(fx), floorY = std::floor(fy);
+		float ax = fx - floorX, ay = fy - floorY;
+		int x0 = (((int)floorX % image.width) + image.width) % image.width, x1 = (x0 + 1) % image.width;
+		int y0 = (((int)floorY % image.height) + image.height) % image.height, y1 = (y0 + 1) % image.height;
+		const unsigned char* p00 = &image.pixels[((size_t)y0 * image.width + x0) * 4];
+		const unsigned char* p10 = &image.pixels[((size_t)y0 * image.width + x1) * 4];
+		const unsigned char* p01 = &image.pixels[((size_t)y1 * image.width + x0) * 4];
+		const unsigned char* p11 = &image.pixels[((size_t)y1 * image.width + x1) * 4];
+		for (int i = 0; i < 4; ++i) {
+			float top = p00[i] + (p10[i] - p00[i]) * ax, bottom = p01[i] + (p11[i] - p01[i]) * ax;
+			out[i] = (top + (bottom - top) * ay) / 255.0f;
+		}
+	}
+};
+
+#endif // SOFTWARE_RASTERIZER_H
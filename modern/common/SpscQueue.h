@@ -0,0 +1,64 @@
+/*
+ * @author Jacob William
+ * @desc Bounded lock-free queue for exactly one producer thread and one
+ *       consumer thread. Each side owns one counter and only reads the
+ *       other's, so neither ever waits on a lock; the counters sit on their
+ *       own cache lines so the two threads do not fight over one line.
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+template <typename T, size_t Capacity>
+class USpscQueue {
+public:
+
+	USpscQueue() : head(0), tail(0) {
+	}
+
+	/*
+	 * @desc Producer side, copies value in
+	 * @returns false when the queue is full
+	 */
+	bool Push(const T& value) {
+		size_t position = head.load(std::memory_order_relaxed);
+		if (position - tail.load(std::memory_order_acquire) == Capacity) {
+			return false;
+		}
+		items[position % Capacity] = value;
+		head.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	 * @desc Consumer side, copies the oldest value out
+	 * @returns false when the queue is empty
+	 */
+	bool Pop(T& value) {
+		size_t position = tail.load(std::memory_order_relaxed);
+		if (position == head.load(std::memory_order_acquire)) {
+			return false;
+		}
+		value = items[position % Capacity];
+		tail.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	 * @desc Entries queued, exact only on a quiet queue
+	 */
+	size_t Size(void) const {
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+	}
+
+private:
+
+	alignas(64) std::atomic<size_t> head;	// written by the producer only
+	alignas(64) std::atomic<size_t> tail;	// written by the consumer only
+	T items[Capacity];
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,608 @@
+/*
+ * @author Jacob William
+ * @desc Offline block compression and a cache file for textures. Images are
+ *       encoded to BC1 (opaque), BC3 (with alpha) or ETC2 RGB8 with their
+ *       whole mip chain and written to a small container: a header, one
+ *       entry per level, then the blocks. The loader maps the file and hands
+ *       the blocks straight to glCompressedTexImage2D.
+ *
+ *       The ETC2 encoder only emits ETC1 individual mode blocks, which every
+ *       ETC2 decoder reads the same way.
+ */
+
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Image.h"
+
+// Block formats the encoder can produce
+enum UTextureCodec {
+	UCodecBC1,
+	UCodecBC3,
+	UCodecETC2
+};
+
+// File layout, all fields little endian
+struct UTextureFileHeader {
+	char magic[4];
+	uint32_t internalFormat;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+	uint32_t reserved;
+};
+
+struct UTextureFileLevel {
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset;
+	uint64_t size;
+};
+
+// What the loader reports
+struct UTextureLoadStats {
+	size_t gpuBytes;
+	int width;
+	int height;
+	int levels;
+};
+
+/*
+ * @desc GL internal format of a codec
+ */
+inline GLenum UCodecFormat(UTextureCodec codec) {
+	switch (codec) {
+	case UCodecBC1:
+		return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case UCodecBC3:
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	default:
+		return GL_COMPRESSED_RGB8_ETC2;
+	}
+}
+
+/*
+ * @desc Bytes per 4x4 block
+ */
+inline size_t UCodecBlockBytes(UTextureCodec codec) {
+	return codec == UCodecBC3 ? 16 : 8;
+}
+
+/*
+ * @desc Whether the context takes blocks of this internal format: BC needs
+ *       S3TC, ETC2 GL 4.3 or ARB_ES3_compatibility
+ */
+inline bool UCompressedFormatSupported(GLenum format) {
+	switch (format) {
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		return GLEW_EXT_texture_compression_s3tc;
+	case GL_COMPRESSED_RGB8_ETC2:
+		return GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility;
+	default:
+		return false;
+	}
+}
+
+/*
+ * @desc BC formats when the driver has S3TC, ETC2 when it has that
+ * @returns false when the context takes neither, textures stay uncompressed
+ */
+inline bool UPreferredCodec(bool hasAlpha, UTextureCodec& codec) {
+	if (GLEW_EXT_texture_compression_s3tc) {
+		codec = hasAlpha ? UCodecBC3 : UCodecBC1;
+		return true;
+	}
+	if (!hasAlpha && UCompressedFormatSupported(GL_COMPRESSED_RGB8_ETC2)) {
+		codec = UCodecETC2;
+		return true;
+	}
+	return false;
+}
+
+/*
+ * @desc Copies a 4x4 block out of an image, clamping at the edges
+ * @returns void
+ */
+inline void UFetchBlock(const UImage& image, int blockX, int blockY, unsigned char block[16][4]) {
+	for (int y = 0; y < 4; ++y) {
+		int sy = std::min(blockY * 4 + y, image.height - 1);
+		for (int x = 0; x < 4; ++x) {
+			int sx = std::min(blockX * 4 + x, image.width - 1);
+			memcpy(block[y * 4 + x], &image.pixels[(sy * image.width + sx) * 4], 4);
+		}
+	}
+}
+
+inline uint16_t UPack565(const float color[3]) {
+	int r = (int)(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+	int g = (int)(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+	int b = (int)(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+inline void UUnpack565(uint16_t packed, int color[3]) {
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+/*
+ * @desc Encodes the color part of a BC1/BC3 block in four color mode.
+ *       Endpoints are the extremes along the block's principal axis.
+ * @returns void
+ */
+inline void UEncodeBC1Color(const unsigned char block[16][4], unsigned char out[8]) {
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; ++i) {
+		for (int c = 0; c < 3; ++c) {
+			mean[c] += block[i][c] / 16.0f;
+		}
+	}
+
+	// Covariance and a few power iterations for the principal axis
+	float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; ++i) {
+		float r = block[i][0] - mean[0], g = block[i][1] - mean[1], b = block[i][2] - mean[2];
+		cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+		cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+	}
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 4; ++iteration) {
+		float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+		float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+		if (length < 1e-6f) {
+			break;
+		}
+		axis[0] = x / length;
+		axis[1] = y / length;
+		axis[2] = z / length;
+	}
+
+	float lowest = 1e30f, highest = -1e30f;
+	for (int i = 0; i < 16; ++i) {
+		float t = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+		lowest = std::min(lowest, t);
+		highest = std::max(highest, t);
+	}
+	float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	if (axisLength > 0.0f) {
+		lowest /= axisLength;
+		highest /= axisLength;
+	}
+
+	float start[3], end[3];
+	for (int c = 0; c < 3; ++c) {
+		start[c] = mean[c] + axis[c] * highest;
+		end[c] = mean[c] + axis[c] * lowest;
+	}
+
+	uint16_t color0 = UPack565(start), color1 = UPack565(end);
+	if (color0 < color1) {
+		std::swap(color0, color1);
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		int palette[4][3];
+		UUnpack565(color0, palette[0]);
+		UUnpack565(color1, palette[1]);
+		for (int c = 0; c < 3; ++c) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; ++i) {
+			int best = 0, bestError = 1 << 30;
+			for (int p = 0; p < 4; ++p) {
+				int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+				int error = dr * dr + dg * dg + db * db;
+				if (error < bestError) {
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= (uint32_t)best << (2 * i);
+		}
+	}
+
+	out[0] = (unsigned char)(color0 & 0xFF);
+	out[1] = (unsigned char)(color0 >> 8);
+	out[2] = (unsigned char)(color1 & 0xFF);
+	out[3] = (unsigned char)(color1 >> 8);
+	for (int b = 0; b < 4; ++b) {
+		out[4 + b] = (unsigned char)(indices >> (8 * b));
+	}
+}
+
+/*
+ * @desc Encodes the BC3 alpha block with the eight value ramp between the
+ *       block's alpha extremes
+ * @returns void
+ */
+inline void UEncodeBC3Alpha(const unsigned char block[16][4], unsigned char out[8]) {
+	int alpha0 = 0, alpha1 = 255;
+	for (int i = 0; i < 16; ++i) {
+		alpha0 = std::max(alpha0, (int)block[i][3]);
+		alpha1 = std::min(alpha1, (int)block[i][3]);
+	}
+
+	uint64_t indices = 0;
+	if (alpha0 > alpha1) {
+		int ramp[8] = { alpha0, alpha1 };
+		for (int r = 2; r < 8; ++r) {
+			ramp[r] = ((8 - r) * alpha0 + (r - 1) * alpha1) / 7;
+		}
+		for (int i = 0; i < 16; ++i) {
+			int best = 0, bestError = 1 << 30;
+			for (int r = 0; r < 8; ++r) {
+				int error = std::abs(block[i][3] - ramp[r]);
+				if (error < bestError) {
+					bestError = error;
+					best = r;
+				}
+			}
+			indices |= (uint64_t)best << (3 * i);
+		}
+	}
+
+	out[0] = (unsigned char)alpha0;
+	out[1] = (unsigned char)alpha1;
+	for (int b = 0; b < 6; ++b) {
+		out[2 + b] = (unsigned char)(indices >> (8 * b));
+	}
+}
+
+/*
+ * @desc Encodes an ETC1 individual mode block (valid ETC2 RGB8), both
+ *       subblock orientations and all eight modifier tables are tried
+ * @returns void
+ */
+inline void UEncodeETC2Block(const unsigned char block[16][4], unsigned char out[8]) {
+	static const int Modifiers[8][2] = {
+		{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+	};
+
+	int bestTotal = 1 << 30;
+	for (int flip = 0; flip < 2; ++flip) {
+		int base[2][3], table[2];
+		int pixelIndex[16];
+		int total = 0;
+
+		for (int sub = 0; sub < 2; ++sub) {
+			// Pixels belonging to this half, left/right without flip, top/bottom with it
+			int members[8], count = 0;
+			for (int i = 0; i < 16; ++i) {
+				int x = i % 4, y = i / 4;
+				if ((flip ? y : x) / 2 == sub) {
+					members[count++] = i;
+				}
+			}
+
+			int average[3] = { 0, 0, 0 };
+			for (int m = 0; m < 8; ++m) {
+				for (int c = 0; c < 3; ++c) {
+					average[c] += block[members[m]][c];
+				}
+			}
+			for (int c = 0; c < 3; ++c) {
+				base[sub][c] = std::min(15, (average[c] / 8 * 15 + 127) / 255);
+			}
+
+			int bestTableError = 1 << 30;
+			for (int t = 0; t < 8; ++t) {
+				int error = 0, chosen[8];
+				for (int m = 0; m < 8; ++m) {
+					int bestPixelError = 1 << 30;
+					for (int selector = 0; selector < 4; ++selector) {
+						int modifier = (selector & 2) ? -Modifiers[t][selector & 1] : Modifiers[t][selector & 1];
+						int pixelError = 0;
+						for (int c = 0; c < 3; ++c) {
+							int value = std::min(255, std::max(0, base[sub][c] * 17 + modifier));
+							int difference = value - block[members[m]][c];
+							pixelError += difference * difference;
+						}
+						if (pixelError < bestPixelError) {
+							bestPixelError = pixelError;
+							chosen[m] = selector;
+						}
+					}
+					error += bestPixelError;
+				}
+				if (error < bestTableError) {
+					bestTableError = error;
+					table[sub] = t;
+					for (int m = 0; m < 8; ++m) {
+						pixelIndex[members[m]] = chosen[m];
+					}
+				}
+			}
+			total += bestTableError;
+		}
+
+		if (total >= bestTotal) {
+			continue;
+		}
+		bestTotal = total;
+
+		out[0] = (unsigned char)((base[0][0] << 4) | base[1][0]);
+		out[1] = (unsigned char)((base[0][1] << 4) | base[1][1]);
+		out[2] = (unsigned char)((base[0][2] << 4) | base[1][2]);
+		out[3] = (unsigned char)((table[0] << 5) | (table[1] << 2) | flip);
+
+		// Pixel bits are numbered column first, most significant bits then least
+		uint16_t msb = 0, lsb = 0;
+		for (int i = 0; i < 16; ++i) {
+			int bit = (i % 4) * 4 + i / 4;
+			msb |= (uint16_t)(((pixelIndex[i] >> 1) & 1) << bit);
+			lsb |= (uint16_t)((pixelIndex[i] & 1) << bit);
+		}
+		out[4] = (unsigned char)(msb >> 8);
+		out[5] = (unsigned char)(msb & 0xFF);
+		out[6] = (unsigned char)(lsb >> 8);
+		out[7] = (unsigned char)(lsb & 0xFF);
+	}
+}
+
+/*
+ * @desc Compresses one image level
+ * @returns the blocks, row by row
+ */
+inline std::vector<unsigned char> UCompressImage(const UImage& image, UTextureCodec codec) {
+	int blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+	size_t blockBytes = UCodecBlockBytes(codec);
+	std::vector<unsigned char> blocks(blocksX * blocksY * blockBytes);
+
+	unsigned char block[16][4];
+	for (int by = 0; by < blocksY; ++by) {
+		for (int bx = 0; bx < blocksX; ++bx) {
+			unsigned char* out = &blocks[(by * blocksX + bx) * blockBytes];
+			UFetchBlock(image, bx, by, block);
+
+			if (codec == UCodecBC1) {
+				UEncodeBC1Color(block, out);
+			}
+			else if (codec == UCodecBC3) {
+				UEncodeBC3Alpha(block, out);
+				UEncodeBC1Color(block, out + 8);
+			}
+			else {
+				UEncodeETC2Block(block, out);
+			}
+		}
+	}
+	return blocks;
+}
+
+/*
+ * @desc Encodes levels (level 0 first, usually a full mip chain) and writes
+ *       them to path
+ * @returns false if the file could not be written
+ */
+inline bool UWriteCompressedTexture(const char* path, const std::vector<UImage>& levels, UTextureCodec codec) {
+	if (levels.empty()) {
+		return false;
+	}
+	UTextureFileHeader header;
+	memcpy(header.magic, "UTX1", 4);
+	header.internalFormat = UCodecFormat(codec);
+	header.width = levels[0].width;
+	header.height = levels[0].height;
+	header.levelCount = (uint32_t)levels.size();
+	header.reserved = 0;
+
+	std::vector<UTextureFileLevel> entries(levels.size());
+	std::vector<std::vector<unsigned char> > data(levels.size());
+	uint64_t offset = sizeof(header) + entries.size() * sizeof(UTextureFileLevel);
+
+	for (size_t l = 0; l < levels.size(); ++l) {
+		data[l] = UCompressImage(levels[l], codec);
+		offset = (offset + 15) & ~(uint64_t)15;
+		entries[l].width = levels[l].width;
+		entries[l].height = levels[l].height;
+		entries[l].offset = offset;
+		entries[l].size = data[l].size();
+		offset += data[l].size();
+	}
+
+	// Written beside the old file and renamed over it, so a loader mapping
+	// the old one keeps reading it whole and never sees a partial file
+	std::string temporary = std::string(path) + ".XXXXXX";
+#ifdef _WIN32
+	temporary = std::string(path) + ".tmp";
+	FILE* file = fopen(temporary.c_str(), "wb");
+#else
+	int descriptor = mkstemp(&temporary[0]);
+	if (descriptor >= 0) {
+		fchmod(descriptor, 0644);
+	}
+	FILE* file = descriptor >= 0 ? fdopen(descriptor, "wb") : NULL;
+	if (file == NULL && descriptor >= 0) {
+		close(descriptor);
+		unlink(temporary.c_str());
+	}
+#endif
+	if (file == NULL) {
+		return false;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1
+			&& fwrite(entries.data(), sizeof(UTextureFileLevel), entries.size(), file) == entries.size();
+	for (size_t l = 0; l < levels.size() && written; ++l) {
+		written = fseek(file, (long)entries[l].offset, SEEK_SET) == 0
+				&& fwrite(data[l].data(), 1, data[l].size(), file) == data[l].size();
+	}
+	written = fclose(file) == 0 && written;
+#ifdef _WIN32
+	written = written && MoveFileExA(temporary.c_str(), path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	written = written && rename(temporary.c_str(), path) == 0;
+#endif
+	if (!written) {
+		remove(temporary.c_str());
+	}
+	return written;
+}
+
+/*
+ * Read-only memory mapping of a whole file
+ */
+class UMappedFile {
+public:
+
+	UMappedFile() : data(NULL), size(0) {
+#ifdef _WIN32
+		file = INVALID_HANDLE_VALUE;
+		mapping = NULL;
+#endif
+	}
+
+	~UMappedFile() {
+		Close();
+	}
+
+	/*
+	 * @desc Maps path into memory
+	 * @returns false if the file does not exist or cannot be mapped
+	 */
+	bool Open(const char* path) {
+		Close();
+#ifdef _WIN32
+		file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER length;
+		GetFileSizeEx(file, &length);
+		size = (size_t)length.QuadPart;
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		data = mapping != NULL ? (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+#else
+		int descriptor = open(path, O_RDONLY);
+		if (descriptor < 0) {
+			return false;
+		}
+		struct stat info;
+		if (fstat(descriptor, &info) == 0 && info.st_size > 0) {
+			size = (size_t)info.st_size;
+			void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+			data = mapped != MAP_FAILED ? (const unsigned char*)mapped : NULL;
+		}
+		close(descriptor);
+#endif
+		if (data == NULL) {
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void Close(void) {
+#ifdef _WIN32
+		if (data != NULL) {
+			UnmapViewOfFile(data);
+		}
+		if (mapping != NULL) {
+			CloseHandle(mapping);
+		}
+		if (file != INVALID_HANDLE_VALUE) {
+			CloseHandle(file);
+		}
+		file = INVALID_HANDLE_VALUE;
+		mapping = NULL;
+#else
+		if (data != NULL) {
+			munmap((void*)data, size);
+		}
+#endif
+		data = NULL;
+		size = 0;
+	}
+
+	const unsigned char* Data(void) const {
+		return data;
+	}
+
+	size_t Size(void) const {
+		return size;
+	}
+
+private:
+
+	const unsigned char* data;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+};
+
+/*
+ * @desc Maps a compressed texture file and uploads every level into the
+ *       texture currently bound to GL_TEXTURE_2D
+ * @parameters file path, optional stats output
+ * @returns false if the file is missing, malformed or its format unsupported
+ */
+inline bool ULoadCompressedTexture(const char* path, UTextureLoadStats* stats) {
+	UMappedFile file;
+	if (!file.Open(path) || file.Size() < sizeof(UTextureFileHeader)) {
+		return false;
+	}
+
+	const UTextureFileHeader* header = (const UTextureFileHeader*)file.Data();
+	if (memcmp(header->magic, "UTX1", 4) != 0
+			|| file.Size() < sizeof(UTextureFileHeader) + header->levelCount * sizeof(UTextureFileLevel)) {
+		return false;
+	}
+
+	GLenum format = header->internalFormat;
+	if (!UCompressedFormatSupported(format)) {
+		return false;
+	}
+
+	const UTextureFileLevel* levels = (const UTextureFileLevel*)(header + 1);
+	size_t gpuBytes = 0;
+	for (uint32_t l = 0; l < header->levelCount; ++l) {
+		if (levels[l].offset + levels[l].size > file.Size()) {
+			return false;
+		}
+		glCompressedTexImage2D(GL_TEXTURE_2D, l, format, levels[l].width, levels[l].height, 0,
+				(GLsizei)levels[l].size, file.Data() + levels[l].offset);
+		gpuBytes += levels[l].size;
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header->levelCount - 1);
+
+	if (stats != NULL) {
+		stats->gpuBytes = gpuBytes;
+		stats->width = header->width;
+		stats->height = header->height;
+		stats->levels = header->levelCount;
+	}
+	return true;
+}
+
+#endif // TEXTURE_COMPRESSION_H
@@ -0,0 +1,258 @@
+/*
+ * @author Jacob William
+ * @desc Packs many RGBA images into the layers of one GL_TEXTURE_2D_ARRAY.
+ *       Images are placed with a skyline packer, each layer takes as many as
+ *       fit before a new layer is started. Every image gets a region that
+ *       remaps its 0..1 texture coordinates into its rectangle, so objects
+ *       with different images can share one bind and one draw.
+ */
+
+#ifndef TEXTURE_PACKER_H
+#define TEXTURE_PACKER_H
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <GL/glew.h>
+
+#include "Image.h"
+
+// Where an image ended up, texture coordinates map to offset + uv * scale
+struct UPackedRegion {
+	float uvOffset[2];
+	float uvScale[2];
+	float layer;
+};
+
+// Result of packing, upload with UUploadTexturePack
+struct UTexturePack {
+	int layerSize;
+	int layerCount;
+	std::vector<unsigned char> pixels;
+	std::vector<UPackedRegion> regions;
+};
+
+/*
+ * Skyline bin packer for one square layer, keeps the top edge of the placed
+ * rectangles as a list of segments and puts each new rectangle where it
+ * ends up lowest
+ */
+class USkylinePacker {
+public:
+
+	explicit USkylinePacker(int size) : size(size) {
+		USegment segment = { 0, 0, size };
+		skyline.push_back(segment);
+	}
+
+	/*
+	 * @desc Finds a spot for a width x height rectangle
+	 * @returns false when the layer is full
+	 */
+	bool Insert(int width, int height, int* x, int* y) {
+		int bestIndex = -1, bestY = size, bestWidth = size;
+
+		for (size_t i = 0; i < skyline.size(); ++i) {
+			int top;
+			if (!UFits(i, width, height, &top)) {
+				continue;
+			}
+			if (top < bestY || (top == bestY && skyline[i].width < bestWidth)) {
+				bestIndex = (int)i;
+				bestY = top;
+				bestWidth = skyline[i].width;
+			}
+		}
+
+		if (bestIndex < 0) {
+			return false;
+		}
+
+		*x = skyline[bestIndex].x;
+		*y = bestY;
+		UAddLevel(bestIndex, *x, bestY + height, width);
+		return true;
+	}
+
+private:
+
+	struct USegment {
+		int x, y, width;
+	};
+
+	int size;
+	std::vector<USegment> skyline;
+
+	/*
+	 * @desc Checks whether the rectangle fits starting at segment index
+	 * @returns true and the y it would rest at
+	 */
+	bool UFits(size_t index, int width, int height, int* top) const {
+		int x = skyline[index].x;
+		if (x + width > size) {
+			return false;
+		}
+
+		int remaining = width, y = skyline[index].y;
+		for (size_t i = index; remaining > 0; ++i) {
+			if (i == skyline.size()) {
+				return false;
+			}
+			y = std::max(y, skyline[i].y);
+			if (y + height > size) {
+				return false;
+			}
+			remaining -= skyline[i].width;
+		}
+		*top = y;
+		return true;
+	}
+
+	/*
+	 * @desc Raises the skyline under the new rectangle and merges equal segments
+	 * @returns void
+	 */
+	void UAddLevel(int index, int x, int y, int width) {
+		USegment segment = { x, y, width };
+		skyline.insert(skyline.begin() + index, segment);
+
+		// Shrink or drop the segments now covered by the new one
+		for (size_t i = index + 1; i < skyline.size(); ++i) {
+			int shadowEnd = skyline[i - 1].x + skyline[i - 1].width;
+			if (skyline[i].x >= shadowEnd) {
+				break;
+			}
+			int shrink = shadowEnd - skyline[i].x;
+			skyline[i].x += shrink;
+			skyline[i].width -= shrink;
+			if (skyline[i].width <= 0) {
+				skyline.erase(skyline.begin() + i);
+				--i;
+			}
+			else {
+				break;
+			}
+		}
+
+		for (size_t i = 0; i + 1 < skyline.size(); ++i) {
+			if (skyline[i].y == skyline[i + 1].y) {
+				skyline[i].width += skyline[i + 1].width;
+				skyline.erase(skyline.begin() + i + 1);
+				--i;
+			}
+		}
+	}
+};
+
+/*
+ * @desc Packs images into square layers; images bigger than a layer are
+ *       halved until they fit, padding pixels are filled by clamping the
+ *       image edges so filtering does not pick up neighbours. Throws
+ *       std::invalid_argument unless a one pixel image and its padding fit
+ *       in a layer, halving could never make it fit otherwise
+ * @parameters images, layer size in pixels, padding in pixels
+ * @returns the packed layers and one region per image, same order as images
+ */
+inline UTexturePack UPackTextures(const std::vector<UImage>& images, int layerSize, int padding) {
+	if (padding < 0 || 2 * padding >= layerSize) {
+		throw std::invalid_argument("texture pack padding leaves no room in a layer");
+	}
+
+	UTexturePack pack;
+	pack.layerSize = layerSize;
+	pack.layerCount = 0;
+	pack.regions.resize(images.size());
+
+	// Tallest first packs tighter
+	std::vector<size_t> order(images.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return images[a].height > images[b].height;
+	});
+
+	std::vector<USkylinePacker> layers;
+	size_t layerBytes = (size_t)layerSize * layerSize * 4;
+
+	for (size_t o = 0; o < order.size(); ++o) {
+		UImage image = images[order[o]];
+		while (image.width + 2 * padding > layerSize || image.height + 2 * padding > layerSize) {
+			image = UHalveImage(image);
+		}
+
+		int paddedWidth = image.width + 2 * padding, paddedHeight = image.height + 2 * padding;
+		int x = 0, y = 0;
+		size_t layer = 0;
+		while (layer < layers.size() && !layers[layer].Insert(paddedWidth, paddedHeight, &x, &y)) {
+			++layer;
+		}
+		if (layer == layers.size()) {
+			layers.push_back(USkylinePacker(layerSize));
+			pack.pixels.resize(layers.size() * layerBytes, 0);
+			layers.back().Insert(paddedWidth, paddedHeight, &x, &y);
+		}
+
+		// Copy with clamped edges into the padding
+		unsigned char* target = &pack.pixels[layer * layerBytes];
+		for (int py = 0; py < paddedHeight; ++py) {
+			int sy = std::min(std::max(py - padding, 0), image.height - 1);
+			for (int px = 0; px < paddedWidth; ++px) {
+				int sx = std::min(std::max(px - padding, 0), image.width - 1);
+				memcpy(&target[((y + py) * layerSize + x + px) * 4], &image.pixels[(sy * image.width + sx) * 4], 4);
+			}
+		}
+
+		UPackedRegion& region = pack.regions[order[o]];
+		region.uvOffset[0] = (float)(x + padding) / layerSize;
+		region.uvOffset[1] = (float)(y + padding) / layerSize;
+		region.uvScale[0] = (float)image.width / layerSize;
+		region.uvScale[1] = (float)image.height / layerSize;
+		region.layer = (float)layer;
+	}
+
+	pack.layerCount = (int)layers.size();
+	return pack;
+}
+
+/*
+ * @desc Creates the array texture for a pack, mip levels stop at the padding
+ *       so neighbouring images do not bleed into each other
+ * @returns GL texture name
+ */
+inline GLuint UUploadTexturePack(const UTexturePack& pack, int padding) {
+	int levels = 1;
+	while ((1 << levels) <= padding && (pack.layerSize >> levels) > 0) {
+		++levels;
+	}
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage) {
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA8, pack.layerSize, pack.layerSize, pack.layerCount);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, pack.layerSize, pack.layerSize, pack.layerCount,
+				GL_RGBA, GL_UNSIGNED_BYTE, pack.pixels.data());
+	} else {
+		// Immutable storage needs 4.2, so allocate level by level and fill the smaller ones below
+		for (int l = 0; l < levels; ++l) {
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, l, GL_RGBA8, std::max(pack.layerSize >> l, 1), std::max(pack.layerSize >> l, 1),
+					pack.layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, l == 0 ? pack.pixels.data() : NULL);
+		}
+	}
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	if (levels > 1) {
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	}
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	return texture;
+}
+
+#endif // TEXTURE_PACKER_H
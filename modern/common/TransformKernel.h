@@ -0,0 +1,236 @@
+/*
+ * @author Jacob William
+ * @desc Batched model-matrix builder. Takes structure-of-arrays translation,
+ *       quaternion rotation and scale and writes column-major 4x4 matrices
+ *       (translate * rotate * scale, same layout as glm::mat4) ready to be
+ *       copied into an instance buffer.
+ *
+ *       The SSE and AVX2 paths are compiled with target attributes and picked
+ *       at runtime, so the demos still build without any -m flags.
+ */
+
+#ifndef TRANSFORM_KERNEL_H
+#define TRANSFORM_KERNEL_H
+
+#include <cstddef>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSFORM_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+ * Structure of arrays holding one transform per instance
+ * Quaternions are expected to be normalized (x, y, z, w)
+ */
+struct UTransformSoA {
+	const float *tx, *ty, *tz;
+	const float *qx, *qy, *qz, *qw;
+	const float *sx, *sy, *sz;
+};
+
+// Kernel signature, writes 16 floats per instance into out
+typedef void (*UTransformKernelFn)(const UTransformSoA&, size_t first, size_t count, float* out);
+
+/*
+ * @desc Builds the matrices one instance at a time
+ * @parameters transforms, first instance, instance count, output matrices
+ * @returns void
+ */
+inline void UBuildMatricesScalar(const UTransformSoA& t, size_t first, size_t count, float* out) {
+	for (size_t i = first; i < first + count; ++i) {
+		float x = t.qx[i], y = t.qy[i], z = t.qz[i], w = t.qw[i];
+		float xx = x * x, yy = y * y, zz = z * z;
+		float xy = x * y, xz = x * z, yz = y * z;
+		float wx = w * x, wy = w * y, wz = w * z;
+
+		float* m = out + i * 16;
+
+		// Column 0
+		m[0] = (1.0f - 2.0f * (yy + zz)) * t.sx[i];
+		m[1] = (2.0f * (xy + wz)) * t.sx[i];
+		m[2] = (2.0f * (xz - wy)) * t.sx[i];
+		m[3] = 0.0f;
+
+		// Column 1
+		m[4] = (2.0f * (xy - wz)) * t.sy[i];
+		m[5] = (1.0f - 2.0f * (xx + zz)) * t.sy[i];
+		m[6] = (2.0f * (yz + wx)) * t.sy[i];
+		m[7] = 0.0f;
+
+		// Column 2
+		m[8] = (2.0f * (xz + wy)) * t.sz[i];
+		m[9] = (2.0f * (yz - wx)) * t.sz[i];
+		m[10] = (1.0f - 2.0f * (xx + yy)) * t.sz[i];
+		m[11] = 0.0f;
+
+		// Column 3
+		m[12] = t.tx[i];
+		m[13] = t.ty[i];
+		m[14] = t.tz[i];
+		m[15] = 1.0f;
+	}
+}
+
+#ifdef TRANSFORM_KERNEL_X86
+
+/*
+ * @desc Writes 4 instances worth of one column, e holds the column's
+ *       4 components each spread across the 4 instances
+ * @returns void
+ */
+__attribute__((target("sse2")))
+inline void UStoreColumns4(__m128 e0, __m128 e1, __m128 e2, __m128 e3, float* m, int column) {
+	_MM_TRANSPOSE4_PS(e0, e1, e2, e3);
+	_mm_storeu_ps(m + column * 4, e0);
+	_mm_storeu_ps(m + 16 + column * 4, e1);
+	_mm_storeu_ps(m + 32 + column * 4, e2);
+	_mm_storeu_ps(m + 48 + column * 4, e3);
+}
+
+/*
+ * @desc Builds 4 matrices per iteration with SSE, the operation order matches
+ *       the scalar path so results are bit-identical
+ * @returns void
+ */
+__attribute__((target("sse2")))
+inline void UBuildMatricesSSE(const UTransformSoA& t, size_t first, size_t count, float* out) {
+	const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+	size_t i = first, end = first + count;
+
+	for (; i + 4 <= end; i += 4) {
+		__m128 x = _mm_loadu_ps(t.qx + i), y = _mm_loadu_ps(t.qy + i);
+		__m128 z = _mm_loadu_ps(t.qz + i), w = _mm_loadu_ps(t.qw + i);
+		__m128 sx = _mm_loadu_ps(t.sx + i), sy = _mm_loadu_ps(t.sy + i), sz = _mm_loadu_ps(t.sz + i);
+
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+		float* m = out + i * 16;
+
+		UStoreColumns4(
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+			zero, m, 0);
+		UStoreColumns4(
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+			zero, m, 1);
+		UStoreColumns4(
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+			zero, m, 2);
+		UStoreColumns4(
+			_mm_loadu_ps(t.tx + i), _mm_loadu_ps(t.ty + i), _mm_loadu_ps(t.tz + i),
+			one, m, 3);
+	}
+
+	// Leftover instances
+	UBuildMatricesScalar(t, i, end - i, out);
+}
+
+/*
+ * @desc Splits 8 lanes into two 4 instance column stores
+ * @returns void
+ */
+__attribute__((target("avx2")))
+inline void UStoreColumns8(__m256 e0, __m256 e1, __m256 e2, __m256 e3, float* m, int column) {
+	UStoreColumns4(_mm256_castps256_ps128(e0), _mm256_castps256_ps128(e1),
+			_mm256_castps256_ps128(e2), _mm256_castps256_ps128(e3), m, column);
+	UStoreColumns4(_mm256_extractf128_ps(e0, 1), _mm256_extractf128_ps(e1, 1),
+			_mm256_extractf128_ps(e2, 1), _mm256_extractf128_ps(e3, 1), m + 64, column);
+}
+
+/*
+ * @desc Builds 8 matrices per iteration with AVX2, no FMA so the results stay
+ *       bit-identical to the scalar and SSE paths
+ * @returns void
+ */
+__attribute__((target("avx2")))
+inline void UBuildMatricesAVX2(const UTransformSoA& t, size_t first, size_t count, float* out) {
+	const __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f), zero = _mm256_setzero_ps();
+	size_t i = first, end = first + count;
+
+	for (; i + 8 <= end; i += 8) {
+		__m256 x = _mm256_loadu_ps(t.qx + i), y = _mm256_loadu_ps(t.qy + i);
+		__m256 z = _mm256_loadu_ps(t.qz + i), w = _mm256_loadu_ps(t.qw + i);
+		__m256 sx = _mm256_loadu_ps(t.sx + i), sy = _mm256_loadu_ps(t.sy + i), sz = _mm256_loadu_ps(t.sz + i);
+
+		__m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+		__m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+		__m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+		float* m = out + i * 16;
+
+		UStoreColumns8(
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx),
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx),
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx),
+			zero, m, 0);
+		UStoreColumns8(
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy),
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy),
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy),
+			zero, m, 1);
+		UStoreColumns8(
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz),
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz),
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz),
+			zero, m, 2);
+		UStoreColumns8(
+			_mm256_loadu_ps(t.tx + i), _mm256_loadu_ps(t.ty + i), _mm256_loadu_ps(t.tz + i),
+			one, m, 3);
+	}
+
+	// Leftover instances
+	UBuildMatricesSSE(t, i, end - i, out);
+}
+
+#endif // TRANSFORM_KERNEL_X86
+
+/*
+ * @desc Picks the widest kernel the running CPU supports
+ * @returns kernel function pointer
+ */
+inline UTransformKernelFn USelectTransformKernel(void) {
+#ifdef TRANSFORM_KERNEL_X86
+	if (__builtin_cpu_supports("avx2")) {
+		return UBuildMatricesAVX2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return UBuildMatricesSSE;
+	}
+#endif
+	return UBuildMatricesScalar;
+}
+
+/*
+ * @desc Name of the selected kernel for logs and benchmark output
+ * @returns kernel name
+ */
+inline const char* UTransformKernelName(UTransformKernelFn kernel) {
+#ifdef TRANSFORM_KERNEL_X86
+	if (kernel == UBuildMatricesAVX2) {
+		return "avx2";
+	}
+	if (kernel == UBuildMatricesSSE) {
+		return "sse";
+	}
+#endif
+	return "scalar";
+}
+
+/*
+ * @desc Builds count matrices with the kernel selected on first use
+ * @returns void
+ */
+inline void UBuildMatrices(const UTransformSoA& t, size_t first, size_t count, float* out) {
+	static const UTransformKernelFn kernel = USelectTransformKernel();
+	kernel(t, first, count, out);
+}
+
+#endif // TRANSFORM_KERNEL_H
@@ -0,0 +1,670 @@
+/*
+ * @author Jacob William
+ * @desc Sparse virtual texturing. A texture is cut offline into fixed size
+ *       pages per mip level and stored in a page file. At run time a small
+ *       feedback pass writes which page and level every pixel wants, read
+ *       back through a pixel pack buffer a frame later; a streaming thread
+ *       reads the missing pages from the mapped file, and they are copied
+ *       into slots of one physical atlas texture kept as an LRU cache. An indirection texture with one texel per page and one
+ *       mip per level tells the fragment shader which atlas slot to sample;
+ *       pages not resident yet fall back to their nearest resident parent.
+ *
+ *       The coarsest level is a single page and is always resident.
+ */
+
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <GL/glew.h>
+
+#include "MipGenerator.h"
+#include "Readback.h"
+#include "TextureCompression.h"
+
+// Content texels per page side
+const int VirtualPageSize = 128;
+
+// Texels copied from the neighbours around each page so bilinear filtering does not seam
+const int VirtualPageBorder = 4;
+
+// Atlas slots per side
+const int VirtualAtlasPages = 16;
+
+// Upload budget so streaming never stalls a frame for long
+const int VirtualUploadsPerFrame = 16;
+
+// Feedback buffer is this many times smaller than the window
+const int VirtualFeedbackScale = 8;
+
+// Page file header, pages follow level by level in row order
+struct UVirtualTextureHeader {
+	char magic[4];
+	uint32_t width;
+	uint32_t height;
+	uint32_t virtualSize;
+	uint32_t pageSize;
+	uint32_t border;
+	uint32_t levelCount;
+	uint32_t reserved;
+};
+
+// Counters printed by the demos
+struct UVirtualTextureStats {
+	size_t residentPages;
+	size_t residentBytes;
+	size_t atlasBytes;
+	size_t totalBytes;
+	size_t pageIns;
+	size_t evictions;
+	double averageLatency;
+	double maxLatency;
+};
+
+/*
+ * @desc Packs a page key
+ */
+inline uint32_t UPageKey(int level, int x, int y) {
+	return (uint32_t)level << 24 | (uint32_t)y << 12 | (uint32_t)x;
+}
+
+/*
+ * @desc Cuts an sRGB image into the page file at path. The image is placed in
+ *       the corner of a power of two square, the rest is filled by clamping
+ *       its edges, so the shader scales texture coordinates by width/size
+ * @returns false if the file could not be written
+ */
+inline bool UWriteVirtualTexture(const char* path, UJobSystem& jobs, const UImage& image) {
+	int virtualSize = VirtualPageSize;
+	while (virtualSize < image.width || virtualSize < image.height) {
+		virtualSize *= 2;
+	}
+
+	UImage padded;
+	padded.width = virtualSize;
+	padded.height = virtualSize;
+	padded.pixels.resize((size_t)virtualSize * virtualSize * 4);
+	for (int y = 0; y < virtualSize; ++y) {
+		int sy = std::min(y, image.height - 1);
+		for (int x = 0; x < virtualSize; ++x) {
+			int sx = std::min(x, image.width - 1);
+			memcpy(&padded.pixels[((size_t)y * virtualSize + x) * 4], &image.pixels[((size_t)sy * image.width + sx) * 4], 4);
+		}
+	}
+
+	std::vector<UImage> levels = UGenerateMipChain(jobs, padded);
+	while (levels.back().width < VirtualPageSize) {
+		levels.pop_back();
+	}
+
+	UVirtualTextureHeader header;
+	memcpy(header.magic, "UVT1", 4);
+	header.width = image.width;
+	header.height = image.height;
+	header.virtualSize = virtualSize;
+	header.pageSize = VirtualPageSize;
+	header.border = VirtualPageBorder;
+	header.levelCount = (uint32_t)levels.size();
+	header.reserved = 0;
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL) {
+		return false;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	int side = VirtualPageSize + 2 * VirtualPageBorder;
+	std::vector<unsigned char> page((size_t)side * side * 4);
+	for (size_t l = 0; l < levels.size() && written; ++l) {
+		const UImage& level = levels[l];
+		int pages = level.width / VirtualPageSize;
+		for (int py = 0; py < pages && written; ++py) {
+			for (int px = 0; px < pages && written; ++px) {
+				for (int y = 0; y < side; ++y) {
+					int sy = std::min(std::max(py * VirtualPageSize + y - VirtualPageBorder, 0), level.height - 1);
+					for (int x = 0; x < side; ++x) {
+						int sx = std::min(std::max(px * VirtualPageSize + x - VirtualPageBorder, 0), level.width - 1);
+						memcpy(&page[((size_t)y * side + x) * 4], &level.pixels[((size_t)sy * level.width + sx) * 4], 4);
+					}
+				}
+				written = fwrite(page.data(), 1, page.size(), file) == page.size();
+			}
+		}
+	}
+	return fclose(file) == 0 && written;
+}
+
+/*
+ * Reads pages from the mapped page file on its own thread. Buffers of
+ * finished pages are handed back with Recycle so steady streaming does not
+ * allocate
+ */
+class UPageStreamer {
+public:
+
+	typedef std::chrono::steady_clock UClock;
+
+	struct UPage {
+		uint32_t key;
+		UClock::time_point requested;
+		std::vector<unsigned char> pixels;
+	};
+
+	UPageStreamer() : stop(false) {
+	}
+
+	~UPageStreamer() {
+		Stop();
+	}
+
+	/*
+	 * @desc Starts the thread, pages are pageBytes each starting at the offsets
+	 *       returned by offsetOf(key)
+	 * @returns void
+	 */
+	template <typename OffsetFn>
+	void Start(const UMappedFile* file, size_t pageBytes, OffsetFn offsetOf) {
+		thread = std::thread([this, file, pageBytes, offsetOf]() {
+			for (;;) {
+				UPage page;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					wake.wait(lock, [this]() { return stop || !requests.empty(); });
+					if (stop) {
+						return;
+					}
+					page.key = requests.front().first;
+					page.requested = requests.front().second;
+					requests.pop_front();
+					if (!spare.empty()) {
+						page.pixels.swap(spare.back());
+						spare.pop_back();
+					}
+				}
+
+				// Touching the mapping is where the disk read happens
+				page.pixels.resize(pageBytes);
+				memcpy(page.pixels.data(), file->Data() + offsetOf(page.key), pageBytes);
+
+				std::lock_guard<std::mutex> lock(mutex);
+				finished.push_back(UPage());
+				finished.back().key = page.key;
+				finished.back().requested = page.requested;
+				finished.back().pixels.swap(page.pixels);
+			}
+		});
+	}
+
+	void Stop(void) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		wake.notify_one();
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+
+	/*
+	 * @desc Queues page reads in the given order
+	 * @returns void
+	 */
+	void Request(const std::vector<uint32_t>& keys) {
+		if (keys.empty()) {
+			return;
+		}
+		UClock::time_point now = UClock::now();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (size_t i = 0; i < keys.size(); ++i) {
+				requests.push_back(std::make_pair(keys[i], now));
+			}
+		}
+		wake.notify_one();
+	}
+
+	/*
+	 * @desc Moves up to limit finished pages into out
+	 * @returns void
+	 */
+	void Collect(std::vector<UPage>& out, size_t limit) {
+		std::lock_guard<std::mutex> lock(mutex);
+		while (!finished.empty() && out.size() < limit) {
+			out.push_back(UPage());
+			out.back().key = finished.front().key;
+			out.back().requested = finished.front().requested;
+			out.back().pixels.swap(finished.front().pixels);
+			finished.pop_front();
+		}
+	}
+
+	/*
+	 * @desc Returns a page buffer for reuse
+	 * @returns void
+	 */
+	void Recycle(std::vector<unsigned char>& pixels) {
+		std::lock_guard<std::mutex> lock(mutex);
+		spare.push_back(std::vector<unsigned char>());
+		spare.back().swap(pixels);
+	}
+
+private:
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stop;
+	std::deque<std::pair<uint32_t, UClock::time_point> > requests;
+	std::deque<UPage> finished;
+	std::vector<std::vector<unsigned char> > spare;
+};
+
+/*
+ * Physical atlas, indirection texture and page cache for one page file
+ */
+class UVirtualTexture {
+public:
+
+	UVirtualTexture() : atlas(0), indirection(0), feedbackFramebuffer(0), feedbackColor(0), feedbackDepth(0),
+		feedbackWidth(0), feedbackHeight(0), frame(0), dirty(false), pageIns(0), evictions(0), totalLatency(0.0), maxLatency(0.0) {
+	}
+
+	~UVirtualTexture() {
+		streamer.Stop();
+		feedbackReadbacks[0].Destroy();
+		feedbackReadbacks[1].Destroy();
+		glDeleteTextures(1, &atlas);
+		glDeleteTextures(1, &indirection);
+		glDeleteTextures(1, &feedbackColor);
+		glDeleteRenderbuffers(1, &feedbackDepth);
+		glDeleteFramebuffers(1, &feedbackFramebuffer);
+	}
+
+	/*
+	 * @desc Maps the page file, creates the textures, loads the coarsest page
+	 *       and starts streaming
+	 * @returns false if the file is missing or not a page file
+	 */
+	bool Open(const char* path) {
+		if (!file.Open(path) || file.Size() < sizeof(UVirtualTextureHeader)) {
+			return false;
+		}
+		memcpy(&header, file.Data(), sizeof(header));
+		if (memcmp(header.magic, "UVT1", 4) != 0 || header.levelCount == 0) {
+			return false;
+		}
+
+		int side = header.pageSize + 2 * header.border;
+		pageBytes = (size_t)side * side * 4;
+		levelFirstPage.clear();
+		size_t pages = 0;
+		for (uint32_t l = 0; l < header.levelCount; ++l) {
+			levelFirstPage.push_back(pages);
+			pages += (size_t)UPagesAt(l) * UPagesAt(l);
+		}
+		if (file.Size() < sizeof(header) + pages * pageBytes) {
+			return false;
+		}
+
+		// Physical atlas, no mips, every level lives in its own pages
+		glGenTextures(1, &atlas);
+		glBindTexture(GL_TEXTURE_2D, atlas);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, UAtlasSize(), UAtlasSize(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		// One texel per page, one mip per level
+		glGenTextures(1, &indirection);
+		glBindTexture(GL_TEXTURE_2D, indirection);
+		for (uint32_t l = 0; l < header.levelCount; ++l) {
+			glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, UPagesAt(l), UPagesAt(l), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.levelCount - 1);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		table.resize(header.levelCount);
+		for (uint32_t l = 0; l < header.levelCount; ++l) {
+			table[l].resize((size_t)UPagesAt(l) * UPagesAt(l) * 4);
+		}
+
+		for (int s = VirtualAtlasPages * VirtualAtlasPages - 1; s >= 0; --s) {
+			freeSlots.push_back(s);
+		}
+
+		// The single page of the coarsest level is the fallback for everything
+		uint32_t root = UPageKey(header.levelCount - 1, 0, 0);
+		UUpload(root, file.Data() + UPageOffset(root));
+		resident[root].pinned = true;
+		URebuildIndirection();
+
+		const UVirtualTexture* self = this;
+		streamer.Start(&file, pageBytes, [self](uint32_t key) { return self->UPageOffset(key); });
+		return true;
+	}
+
+	/*
+	 * @desc Binds the small feedback target, the caller then draws with the
+	 *       feedback shader
+	 * @parameters window size
+	 * @returns void
+	 */
+	void BeginFeedback(int windowWidth, int windowHeight) {
+		int width = std::max(1, windowWidth / VirtualFeedbackScale), height = std::max(1, windowHeight / VirtualFeedbackScale);
+		if (width != feedbackWidth || height != feedbackHeight) {
+			UCreateFeedbackTarget(width, height);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+		glViewport(0, 0, feedbackWidth, feedbackHeight);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+
+	/*
+	 * @desc Queues the readback of this frame's feedback, restores the
+	 *       window framebuffer and queues the missing pages of the previous
+	 *       frame's feedback coarse first. Its copy finished while this
+	 *       frame drew, so the map does not stall the pipeline
+	 * @returns void
+	 */
+	void EndFeedback(int windowWidth, int windowHeight) {
+		UPixelReadback& current = feedbackReadbacks[frame % 2];
+		UPixelReadback& previous = feedbackReadbacks[(frame + 1) % 2];
+		current.Start(0, 0, feedbackWidth, feedbackHeight);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, windowWidth, windowHeight);
+
+		++frame;
+		const unsigned char* feedback = previous.Map();
+		if (feedback == NULL) {
+			return;
+		}
+		size_t feedbackBytes = (size_t)previous.Width() * previous.Height() * 4;
+		wanted.clear();
+		for (size_t i = 0; i < feedbackBytes; i += 4) {
+			if (feedback[i + 3] == 0) {
+				continue;
+			}
+			int level = std::min<int>(feedback[i + 2], header.levelCount - 1);
+			int x = std::min<int>(feedback[i + 0], UPagesAt(level) - 1), y = std::min<int>(feedback[i + 1], UPagesAt(level) - 1);
+
+			// Parents too, so there is always something close to show
+			for (; level < (int)header.levelCount; ++level, x /= 2, y /= 2) {
+				wanted.push_back(UPageKey(level, x, y));
+			}
+		}
+		previous.Unmap();
+		std::sort(wanted.begin(), wanted.end());
+		wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+
+		missing.clear();
+		for (size_t i = 0; i < wanted.size(); ++i) {
+			std::unordered_map<uint32_t, UResidentPage>::iterator page = resident.find(wanted[i]);
+			if (page != resident.end()) {
+				page->second.lastUsed = frame;
+				lru.splice(lru.begin(), lru, page->second.position);
+			}
+			else if (pending.insert(wanted[i]).second) {
+				missing.push_back(wanted[i]);
+			}
+		}
+
+		// Higher level in the top bits, so reverse order is coarse first
+		std::reverse(missing.begin(), missing.end());
+		streamer.Request(missing);
+	}
+
+	/*
+	 * @desc Uploads finished pages within the per frame budget and refreshes
+	 *       the indirection texture
+	 * @returns void
+	 */
+	void Update(void) {
+		arrived.clear();
+		streamer.Collect(arrived, VirtualUploadsPerFrame);
+		UPageStreamer::UClock::time_point now = UPageStreamer::UClock::now();
+
+		for (size_t i = 0; i < arrived.size(); ++i) {
+			UPageStreamer::UPage& page = arrived[i];
+			pending.erase(page.key);
+			if (UUpload(page.key, page.pixels.data())) {
+				double latency = std::chrono::duration<double, std::milli>(now - page.requested).count();
+				totalLatency += latency;
+				maxLatency = std::max(maxLatency, latency);
+				++pageIns;
+			}
+			streamer.Recycle(page.pixels);
+		}
+
+		if (dirty) {
+			URebuildIndirection();
+		}
+	}
+
+	/*
+	 * @desc Binds atlas and indirection and sets the sampling uniforms of program
+	 * @parameters program, texture units for the atlas and the indirection
+	 * @returns void
+	 */
+	void Bind(GLuint program, int atlasUnit, int indirectionUnit) const {
+		glActiveTexture(GL_TEXTURE0 + atlasUnit);
+		glBindTexture(GL_TEXTURE_2D, atlas);
+		glActiveTexture(GL_TEXTURE0 + indirectionUnit);
+		glBindTexture(GL_TEXTURE_2D, indirection);
+		glActiveTexture(GL_TEXTURE0);
+
+		glUniform1i(glGetUniformLocation(program, "uAtlas"), atlasUnit);
+		glUniform1i(glGetUniformLocation(program, "uIndirection"), indirectionUnit);
+		SetUniforms(program);
+	}
+
+	/*
+	 * @desc Uniforms shared by the sampling and the feedback shader
+	 * @returns void
+	 */
+	void SetUniforms(GLuint program) const {
+		glUniform1f(glGetUniformLocation(program, "uVirtualSize"), (float)header.virtualSize);
+		glUniform1f(glGetUniformLocation(program, "uPageSize"), (float)header.pageSize);
+		glUniform1f(glGetUniformLocation(program, "uBorder"), (float)header.border);
+		glUniform1f(glGetUniformLocation(program, "uAtlasSize"), (float)UAtlasSize());
+		glUniform1f(glGetUniformLocation(program, "uMaxLevel"), (float)(header.levelCount - 1));
+		glUniform2f(glGetUniformLocation(program, "uUvScale"), (float)header.width / header.virtualSize, (float)header.height / header.virtualSize);
+	}
+
+	UVirtualTextureStats Stats(void) const {
+		UVirtualTextureStats stats;
+		stats.residentPages = resident.size();
+		stats.residentBytes = resident.size() * pageBytes;
+		stats.atlasBytes = (size_t)UAtlasSize() * UAtlasSize() * 4;
+		stats.totalBytes = 0;
+		for (uint32_t l = 0; l < header.levelCount; ++l) {
+			stats.totalBytes += (size_t)(header.virtualSize >> l) * (header.virtualSize >> l) * 4;
+		}
+		stats.pageIns = pageIns;
+		stats.evictions = evictions;
+		stats.averageLatency = pageIns > 0 ? totalLatency / pageIns : 0.0;
+		stats.maxLatency = maxLatency;
+		return stats;
+	}
+
+private:
+
+	struct UResidentPage {
+		int slot;
+		unsigned lastUsed;
+		bool pinned;
+		std::list<uint32_t>::iterator position;
+	};
+
+	UMappedFile file;
+	UVirtualTextureHeader header;
+	size_t pageBytes;
+	std::vector<size_t> levelFirstPage;
+
+	GLuint atlas, indirection;
+	GLuint feedbackFramebuffer, feedbackColor, feedbackDepth;
+	int feedbackWidth, feedbackHeight;
+
+	// Feedback of this frame and the one before, read a frame late
+	UPixelReadback feedbackReadbacks[2];
+
+	// Most recently used at the front
+	std::unordered_map<uint32_t, UResidentPage> resident;
+	std::list<uint32_t> lru;
+	std::vector<int> freeSlots;
+	std::unordered_set<uint32_t> pending;
+	std::vector<std::vector<unsigned char> > table;
+
+	UPageStreamer streamer;
+	std::vector<uint32_t> wanted, missing;
+	std::vector<UPageStreamer::UPage> arrived;
+
+	unsigned frame;
+	bool dirty;
+	size_t pageIns, evictions;
+	double totalLatency, maxLatency;
+
+	int UPagesAt(uint32_t level) const {
+		return std::max(1, (int)(header.virtualSize / header.pageSize) >> level);
+	}
+
+	int UAtlasSize(void) const {
+		return VirtualAtlasPages * (header.pageSize + 2 * header.border);
+	}
+
+	size_t UPageOffset(uint32_t key) const {
+		uint32_t level = key >> 24, y = (key >> 12) & 0xFFF, x = key & 0xFFF;
+		return sizeof(UVirtualTextureHeader) + (levelFirstPage[level] + (size_t)y * UPagesAt(level) + x) * pageBytes;
+	}
+
+	/*
+	 * @desc Puts a page into a free slot or the least recently used one; pages
+	 *       used this frame are never evicted, the page is dropped instead
+	 * @returns false if no slot could be freed
+	 */
+	bool UUpload(uint32_t key, const unsigned char* pixels) {
+		int slot;
+		if (!freeSlots.empty()) {
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else {
+			std::list<uint32_t>::iterator victim = lru.end();
+			while (victim != lru.begin()) {
+				--victim;
+				const UResidentPage& page = resident[*victim];
+				if (!page.pinned && page.lastUsed != frame) {
+					break;
+				}
+			}
+			UResidentPage& page = resident[*victim];
+			if (page.pinned || page.lastUsed == frame) {
+				return false;
+			}
+			slot = page.slot;
+			resident.erase(*victim);
+			lru.erase(victim);
+			++evictions;
+		}
+
+		int side = header.pageSize + 2 * header.border;
+		glBindTexture(GL_TEXTURE_2D, atlas);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % VirtualAtlasPages) * side, (slot / VirtualAtlasPages) * side,
+				side, side, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		lru.push_front(key);
+		UResidentPage& page = resident[key];
+		page.slot = slot;
+		page.lastUsed = frame;
+		page.pinned = false;
+		page.position = lru.begin();
+		dirty = true;
+		return true;
+	}
+
+	/*
+	 * @desc Rewrites every indirection texel, coarse levels first so a missing
+	 *       page can copy its parent's entry
+	 * @returns void
+	 */
+	void URebuildIndirection(void) {
+		glBindTexture(GL_TEXTURE_2D, indirection);
+		for (int l = header.levelCount - 1; l >= 0; --l) {
+			int pages = UPagesAt(l);
+			for (int y = 0; y < pages; ++y) {
+				for (int x = 0; x < pages; ++x) {
+					unsigned char* entry = &table[l][((size_t)y * pages + x) * 4];
+					std::unordered_map<uint32_t, UResidentPage>::const_iterator page = resident.find(UPageKey(l, x, y));
+					if (page != resident.end()) {
+						entry[0] = (unsigned char)(page->second.slot % VirtualAtlasPages);
+						entry[1] = (unsigned char)(page->second.slot / VirtualAtlasPages);
+						entry[2] = (unsigned char)l;
+						entry[3] = 255;
+					}
+					else {
+						memcpy(entry, &table[l + 1][((size_t)(y / 2) * UPagesAt(l + 1) + x / 2) * 4], 4);
+					}
+				}
+			}
+			glTexSubImage2D(GL_TEXTURE_2D, l, 0, 0, pages, pages, GL_RGBA, GL_UNSIGNED_BYTE, table[l].data());
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		dirty = false;
+	}
+
+	void UCreateFeedbackTarget(int width, int height) {
+		glDeleteTextures(1, &feedbackColor);
+		glDeleteRenderbuffers(1, &feedbackDepth);
+		glDeleteFramebuffers(1, &feedbackFramebuffer);
+
+		glGenTextures(1, &feedbackColor);
+		glBindTexture(GL_TEXTURE_2D, feedbackColor);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenRenderbuffers(1, &feedbackDepth);
+		glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glGenFramebuffers(1, &feedbackFramebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackColor, 0);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		feedbackWidth = width;
+		feedbackHeight = height;
+	}
+};
+
+/*
+ * @desc Prints resident versus total size and page-in latency
+ * @returns void
+ */
+inline void UPrintVirtualTextureStats(std::ostream& out, const UVirtualTextureStats& stats) {
+	out << "virtual texture: " << stats.residentPages << " pages resident, " << stats.residentBytes / 1024
+		<< " KiB of " << stats.totalBytes / 1024 << " KiB (atlas " << stats.atlasBytes / 1024 << " KiB), "
+		<< stats.pageIns << " page-ins, " << stats.evictions << " evictions, latency avg "
+		<< stats.averageLatency << " ms max " << stats.maxLatency << " ms" << std::endl;
+}
+
+#endif // VIRTUAL_TEXTURE_H
@@ -0,0 +1,71 @@
+/*
+ * @author Jacob William
+ * @desc Offline mesh compiler, welds a mesh and cuts it into meshlets for
+ *       the file read by UMeshletMesh::Load. The input is an OBJ file, which
+ *       should be closed and consistently wound, or "chair" for the chair of
+ *       FlatChair made double sided. The optional level tessellates every
+ *       triangle into level * level, 300 turns the chair into 2M triangles.
+ *
+ *       MeshletCompiler input.obj|chair output.umesh [level]
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+#include "../common/AssetDatabase.h"
+#include "../common/DemoMeshes.h"
+#include "../common/Meshlets.h"
+
+// Use the standard name spaces
+using namespace std;
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	if (argc < 3) {
+		cout << "usage: MeshletCompiler input.obj|chair output.umesh [level]" << endl;
+		return 1;
+	}
+	int level = argc > 3 ? max(1, atoi(argv[3])) : 1;
+
+	vector<GLfloat> vertices;
+	bool sheet = string(argv[1]) == "chair";
+	if (sheet) {
+		vertices = UAddFlatNormals(ChairVertices, DemoMeshVertexCount, 6);
+	}
+	else if (!ULoadObj(argv[1], vertices)) {
+		cout << "Failed to load " << argv[1] << endl;
+		return 1;
+	}
+
+	auto start = chrono::steady_clock::now();
+	if (level > 1) {
+		vertices = UTessellate(vertices.data(), vertices.size() / 9, 9, level);
+	}
+	if (sheet) {
+		UAddBackFaces(vertices);
+	}
+
+	vector<GLfloat> unique;
+	vector<uint32_t> indices;
+	UWeldVertices(vertices, 9, unique, indices);
+	UMeshletData data;
+	UBuildMeshlets(unique, indices, data);
+	if (!UWriteMeshletFile(argv[2], data)) {
+		cout << "Failed to write " << argv[2] << endl;
+		return 1;
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	// Against the same mesh as float vertices and 32 bit indices
+	size_t triangles = indices.size() / 3;
+	size_t packed = data.vertices.size() * sizeof(UPackedVertex) + data.indices.size();
+	size_t plain = unique.size() * sizeof(GLfloat) + indices.size() * sizeof(uint32_t);
+	cout << argv[2] << ": " << triangles << " triangles, " << unique.size() / 9 << " vertices, "
+		<< data.meshlets.size() << " meshlets averaging " << (double)triangles / data.meshlets.size() << " triangles and "
+		<< (double)data.vertices.size() / data.meshlets.size() << " vertices, " << packed / 1024 << " KiB (indexed floats "
+		<< plain / 1024 << " KiB), built in " << seconds * 1000.0 << " ms" << endl;
+	return 0;
+}
@@ -0,0 +1,663 @@
+/*
+ * @author Jacob William
+ * @desc Rendering regression check. Draws the triangles, colored cube,
+ *       textured cube and chair demo scenes from fixed cameras into an
+ *       offscreen framebuffer, the chair both flat as FlatChair starts and
+ *       lit over its floor with the cascaded shadows of -shadows. Each frame
+ *       is read back through a pixel pack buffer while the next one renders
+ *       and compared to its reference PNG in golden/ with the perceptual
+ *       tolerance of common/ImageCompare.h. A frame that fails leaves
+ *       <name>_actual.png and <name>_diff.png next to the program, one with
+ *       no reference just <name>_actual.png, and the exit code is 1.
+ *
+ *       The window is hidden and never drawn into, so no GPU is needed; on
+ *       a machine without one run it on Mesa llvmpipe:
+ *
+ *       LIBGL_ALWAYS_SOFTWARE=1 xvfb-run -a ./RenderCheck [-update] [-dir golden]
+ *                                          [-tolerance 2.3] [-fraction 0.001]
+ *
+ *       -update writes the references instead of checking them. The ones in
+ *       golden/ were made on llvmpipe.
+ *
+ *       g++ -O2 -std=c++11 RenderCheck.cpp -o RenderCheck -lGLEW -lGL -lglut -lSOIL2
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+// Importing glm headers
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// SOIL2 library import
+#include "SOIL2/SOIL2.h"
+
+#include "../common/DemoMeshes.h"
+#include "../common/ImageCompare.h"
+#include "../common/Readback.h"
+#include "../common/ShadowCascades.h"
+
+// Use the standard name spaces
+using namespace std;
+
+// Vertex and  Fragment Shader
+#ifndef GLSL
+#define GLSL(Version, Source) "#version " #Version "\n" #Source
+#endif
+
+// Same size as the demo windows
+const int Width = 800, Height = 600;
+
+// Depth range, light and shadow map size of FlatChair -shadows
+const GLfloat NearPlane = 0.1f, FarPlane = 100.0f;
+const glm::vec3 TowardsLight = glm::normalize(glm::vec3(0.4f, 1.0f, 0.3f));
+const int ShadowMapSize = 2048;
+
+/*
+ * Colored meshes, the triangles use it too with identity matrices since a
+ * two component position reads back as (x, y, 0, 1)
+ */
+const GLchar* ColorVertexShader = GLSL(330,
+		layout (location = 0) in vec3 position;
+		layout (location = 1) in vec3 color;
+
+		out vec3 mobileColor;
+
+		uniform mat4 model;
+		uniform mat4 view;
+		uniform mat4 projection;
+		void main() {
+			gl_Position = projection * view * model * vec4(position, 1.0f);
+			mobileColor = color;
+		}
+);
+
+const GLchar* ColorFragmentShader = GLSL(330,
+		in vec3 mobileColor;
+
+		out vec4 gpuColor;
+
+		void main() {
+			gpuColor = vec4(mobileColor, 1.0);
+		}
+);
+
+const GLchar* TexturedVertexShader = GLSL(330,
+		layout (location = 0) in vec3 position;
+		layout (location = 2) in vec2 textureCoordinates;
+
+		out vec2 mobileTextureCoordinate;
+
+		uniform mat4 model;
+		uniform mat4 view;
+		uniform mat4 projection;
+		void main() {
+			gl_Position = projection * view * model * vec4(position, 1.0f);
+			mobileTextureCoordinate = vec2(textureCoordinates.x, 1.0f - textureCoordinates.y);
+		}
+);
+
+const GLchar* TexturedFragmentShader = GLSL(330,
+
+	in vec2 mobileTextureCoordinate;
+
+	out vec4 gpuTexture;
+
+	uniform sampler2D uTexture;
+	void main() {
+		gpuTexture = texture(uTexture, mobileTextureCoordinate);
+	}
+);
+
+/*
+ * FlatChair's -shadows shaders, the chair has no thickness so both sides
+ * of a face are lit
+ */
+const GLchar* LitVertexShader = GLSL(330,
+		layout (location = 0) in vec3 position;
+		layout (location = 1) in vec3 color;
+		layout (location = 2) in vec3 normal;
+
+		out vec3 mobileColor;
+		out vec3 worldPosition;
+		out vec3 worldNormal;
+		out float viewDepth;
+
+		uniform mat4 model;
+		uniform mat4 view;
+		uniform mat4 projection;
+		void main() {
+			vec4 world = model * vec4(position, 1.0f);
+			vec4 eye = view * world;
+			gl_Position = projection * eye;
+			mobileColor = color;
+			worldPosition = world.xyz;
+			worldNormal = mat3(model) * normal;
+			viewDepth = -eye.z;
+		}
+);
+
+const GLchar* LitFragmentShader = GLSL_PART(
+	in vec3 mobileColor;
+	in vec3 worldPosition;
+	in vec3 worldNormal;
+	in float viewDepth;
+	out vec4 gpuColor;
+	uniform vec3 uTowardsLight;
+	void main() {
+		vec3 normal = normalize(gl_FrontFacing ? worldNormal : -worldNormal);
+		float diffuse = max(dot(normal, uTowardsLight), 0.0);
+		float lit = diffuse * UShadowFactor(worldPosition, viewDepth);
+		gpuColor = vec4(mobileColor * (0.3 + 0.7 * lit), 1.0);
+	}
+);
+
+const GLchar* ShadowVertexShader = GLSL(330,
+		layout (location = 0) in vec3 position;
+		uniform mat4 model;
+		uniform mat4 lightViewProjection;
+		void main() {
+			gl_Position = lightViewProjection * model * vec4(position, 1.0f);
+		}
+);
+
+const GLchar* ShadowFragmentShader = GLSL(330,
+	void main() {
+	}
+);
+
+// One demo mesh and how its vertices are laid out
+struct URenderScene {
+	const char* name;
+	const GLfloat* vertices;
+	GLsizeiptr size;
+	const GLushort* indices;
+	GLsizei count;
+	bool flat;
+	bool textured;
+	bool shadowed;	// gets flat normals, a floor and the shadow maps
+};
+
+const URenderScene Scenes[] = {
+	{ "triangles", InvertedTrianglesVertices, sizeof(InvertedTrianglesVertices), InvertedTrianglesIndices, 6, true, false, false },
+	{ "cube", ColorCubeVertices, sizeof(ColorCubeVertices), NULL, DemoMeshVertexCount, false, false, false },
+	{ "textured_cube", TexturedCubeVertices, sizeof(TexturedCubeVertices), NULL, DemoMeshVertexCount, false, true, false },
+	{ "chair", ChairVertices, sizeof(ChairVertices), NULL, DemoMeshVertexCount, false, false, false },
+	{ "chair_shadowed", ChairVertices, sizeof(ChairVertices), NULL, DemoMeshVertexCount, false, false, true }
+};
+
+// Floor of a shadowed scene and the bounding radius of what casts onto it
+struct URenderFloor {
+	GLuint vertexArray, buffer;
+	GLfloat casterRadius;
+};
+
+// Fixed cameras, the first is the one the demos start with
+struct URenderCamera {
+	const char* name;
+	glm::vec3 eye;
+};
+
+const URenderCamera Cameras[] = {
+	{ "front", glm::vec3(0.0f, 0.0f, 5.0f) },
+	{ "above", glm::vec3(2.5f, 3.5f, 3.0f) },
+	{ "below", glm::vec3(-3.0f, -2.5f, 3.5f) }
+};
+
+// One frame in flight: its name and the readback carrying it
+struct URenderFrame {
+	string name;
+	UPixelReadback readback;
+};
+
+/*
+ * @desc Compiles and links one vertex and fragment shader, the fragment
+ *       shader may come in parts
+ * @returns program name
+ */
+GLuint UCreateProgram(const GLchar* vertexSource, GLsizei fragmentCount, const GLchar** fragmentSources) {
+	GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShaderId, 1, &vertexSource, NULL);
+	glCompileShader(vertexShaderId);
+
+	GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShaderId, fragmentCount, fragmentSources, NULL);
+	glCompileShader(fragmentShaderId);
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShaderId);
+	glAttachShader(program, fragmentShaderId);
+	glLinkProgram(program);
+
+	glDeleteShader(vertexShaderId);
+	glDeleteShader(fragmentShaderId);
+	return program;
+}
+
+GLuint UCreateProgram(const GLchar* vertexSource, const GLchar* fragmentSource) {
+	return UCreateProgram(vertexSource, 1, &fragmentSource);
+}
+
+/*
+ * @desc Checkerboard with a colored corner so orientation mistakes show.
+ *       Generated rather than loaded so the references do not depend on
+ *       the JPEG decoder, and sampled without mips since mip selection is
+ *       up to the driver
+ * @returns texture name
+ */
+GLuint UCreateCheckerTexture(void) {
+	const int Size = 64;
+	vector<unsigned char> pixels(Size * Size * 4);
+	for (int y = 0; y < Size; ++y) {
+		for (int x = 0; x < Size; ++x) {
+			unsigned char* pixel = &pixels[(y * Size + x) * 4];
+			unsigned char value = ((x / 8) + (y / 8)) % 2 ? 230 : 40;
+			pixel[0] = x < 16 && y < 16 ? 230 : value;
+			pixel[1] = value;
+			pixel[2] = x < 16 && y < 16 ? 40 : value;
+			pixel[3] = 255;
+		}
+	}
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, Size, Size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	return texture;
+}
+
+/*
+ * @desc Position 0, color 1 and normal 2 of the bound buffer, the layout
+ *       of FlatChair
+ * @returns void
+ */
+void ULitVertexLayout(void) {
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+}
+
+/*
+ * @desc Vertex array for a scene with the attribute layout of its demo
+ * @returns vertex array name
+ */
+GLuint UCreateSceneArray(const URenderScene& scene, GLuint buffers[2]) {
+	GLuint vertexArray;
+	glGenVertexArrays(1, &vertexArray);
+	glGenBuffers(2, buffers);
+	glBindVertexArray(vertexArray);
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+	if (scene.shadowed) {
+		vector<GLfloat> vertices = UAddFlatNormals(scene.vertices, scene.count, 6);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+	}
+	else {
+		glBufferData(GL_ARRAY_BUFFER, scene.size, scene.vertices, GL_STATIC_DRAW);
+	}
+
+	if (scene.shadowed) {
+		ULitVertexLayout();
+	}
+	else if (scene.flat) {
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)(2 * sizeof(GLfloat)));
+		glEnableVertexAttribArray(1);
+	}
+	else if (scene.textured) {
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+		glEnableVertexAttribArray(2);
+	}
+	else {
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+		glEnableVertexAttribArray(1);
+	}
+	glEnableVertexAttribArray(0);
+
+	if (scene.indices != NULL) {
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, scene.count * sizeof(GLushort), scene.indices, GL_STATIC_DRAW);
+	}
+
+	glBindVertexArray(0);
+	return vertexArray;
+}
+
+/*
+ * @desc FlatChair's floor: just under the lowest vertex of the scaled
+ *       model, which turns about y only, in world space
+ * @returns the floor and the model's bounding radius
+ */
+URenderFloor UCreateFloor(const URenderScene& scene) {
+	URenderFloor floor;
+	floor.casterRadius = 0.0f;
+	GLfloat lowest = 0.0f;
+	for (GLsizei i = 0; i < scene.count; ++i) {
+		const GLfloat* vertex = scene.vertices + i * 6;
+		floor.casterRadius = max(floor.casterRadius, 2.0f * sqrt(vertex[0] * vertex[0] + vertex[1] * vertex[1] + vertex[2] * vertex[2]));
+		lowest = min(lowest, vertex[1]);
+	}
+
+	const GLfloat h = 2.0f * lowest - 0.01f, grey = 0.6f;
+	const GLfloat ground[] = {
+		-12.0f, h, -12.0f,  0.0f, 1.0f, 0.0f,  grey, grey, grey,
+		12.0f, h, 12.0f,  0.0f, 1.0f, 0.0f,  grey, grey, grey,
+		12.0f, h, -12.0f,  0.0f, 1.0f, 0.0f,  grey, grey, grey,
+		12.0f, h, 12.0f,  0.0f, 1.0f, 0.0f,  grey, grey, grey,
+		-12.0f, h, -12.0f,  0.0f, 1.0f, 0.0f,  grey, grey, grey,
+		-12.0f, h, 12.0f,  0.0f, 1.0f, 0.0f,  grey, grey, grey
+	};
+	glGenVertexArrays(1, &floor.vertexArray);
+	glGenBuffers(1, &floor.buffer);
+	glBindVertexArray(floor.vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, floor.buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(ground), ground, GL_STATIC_DRAW);
+	ULitVertexLayout();
+	glEnableVertexAttribArray(0);
+	glBindVertexArray(0);
+	return floor;
+}
+
+/*
+ * @desc Model, view and projection of a scene seen from camera, the model
+ *       transform is the one the demos start with
+ * @returns void
+ */
+void USceneMatrices(const URenderScene& scene, const URenderCamera& camera, glm::mat4& model, glm::mat4& view, glm::mat4& projection) {
+	model = view = projection = glm::mat4();
+	if (!scene.flat) {
+		model = glm::rotate(model, glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		model = glm::scale(model, glm::vec3(2.0f, 2.0f, 2.0f));
+		view = glm::lookAt(camera.eye, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		projection = glm::perspective(glm::radians(45.0f), (GLfloat)Width / (GLfloat)Height, NearPlane, FarPlane);
+	}
+}
+
+/*
+ * @desc Draws one scene from one camera into the bound framebuffer
+ * @returns void
+ */
+void UDrawScene(const URenderScene& scene, const URenderCamera& camera, GLuint program, GLuint vertexArray) {
+	glm::mat4 model, view, projection;
+	USceneMatrices(scene, camera, model, view, projection);
+
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glUseProgram(program);
+	glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(model));
+	glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+	glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+	if (scene.textured) {
+		glUniform1i(glGetUniformLocation(program, "uTexture"), 0);
+	}
+
+	glBindVertexArray(vertexArray);
+	if (scene.indices != NULL) {
+		glDrawElements(GL_TRIANGLES, scene.count, GL_UNSIGNED_SHORT, NULL);
+	}
+	else {
+		glDrawArrays(GL_TRIANGLES, 0, scene.count);
+	}
+	glBindVertexArray(0);
+}
+
+/*
+ * @desc Draws a shadowed scene the way FlatChair -shadows does: the
+ *       cascades for this camera, then the lit model and its floor into
+ *       framebuffer. The cascades are made fresh so a frame does not depend
+ *       on the camera before it
+ * @returns void
+ */
+void UDrawShadowedScene(const URenderScene& scene, const URenderCamera& camera, GLuint litProgram, GLuint shadowProgram,
+		GLuint vertexArray, const URenderFloor& floor, GLuint framebuffer) {
+	glm::mat4 model, view, projection;
+	USceneMatrices(scene, camera, model, view, projection);
+
+	UShadowCascades cascades;
+	cascades.Create(ShadowMapSize);
+	const GLfloat casters[4] = { 0.0f, 0.0f, 0.0f, floor.casterRadius };
+	cascades.Update(glm::value_ptr(view), glm::value_ptr(projection), NearPlane, FarPlane, glm::value_ptr(TowardsLight), casters, 1);
+
+	glUseProgram(shadowProgram);
+	glBindVertexArray(vertexArray);
+	GLint lightLocation = glGetUniformLocation(shadowProgram, "lightViewProjection");
+	glUniformMatrix4fv(glGetUniformLocation(shadowProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+	GLsizei count = scene.count;
+	cascades.Render([lightLocation, count](const float* lightViewProjection) {
+		glUniformMatrix4fv(lightLocation, 1, GL_FALSE, lightViewProjection);
+		glDrawArrays(GL_TRIANGLES, 0, count);
+	});
+
+	// The cascades leave the default framebuffer bound
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, Width, Height);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glUseProgram(litProgram);
+	GLint modelLocation = glGetUniformLocation(litProgram, "model");
+	glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+	glUniformMatrix4fv(glGetUniformLocation(litProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+	glUniformMatrix4fv(glGetUniformLocation(litProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+	glUniform3fv(glGetUniformLocation(litProgram, "uTowardsLight"), 1, glm::value_ptr(TowardsLight));
+	cascades.Bind(litProgram, 1);
+	glDrawArrays(GL_TRIANGLES, 0, scene.count);
+
+	glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4()));
+	glBindVertexArray(floor.vertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+	glBindVertexArray(0);
+
+	cascades.Destroy();
+}
+
+/*
+ * @desc Collects a frame and writes or checks its reference
+ * @returns false when the frame does not match
+ */
+bool UCheckFrame(URenderFrame& frame, const string& directory, bool update, float tolerance, float fraction) {
+	UImage actual;
+	if (!frame.readback.Finish(actual)) {
+		cout << frame.name << ": readback failed" << endl;
+		return false;
+	}
+
+	string referencePath = directory + "/" + frame.name + ".png";
+	if (update) {
+		if (!SOIL_save_image(referencePath.c_str(), SOIL_SAVE_TYPE_PNG, actual.width, actual.height, 4, actual.pixels.data())) {
+			cout << "Failed to write " << referencePath << endl;
+			return false;
+		}
+		cout << frame.name << ": updated" << endl;
+		return true;
+	}
+
+	UImage reference;
+	unsigned char* pixels = SOIL_load_image(referencePath.c_str(), &reference.width, &reference.height, 0, SOIL_LOAD_RGBA);
+	if (pixels == NULL) {
+		cout << frame.name << ": FAIL, no reference at " << referencePath << ", run with -update" << endl;
+		string actualPath = frame.name + "_actual.png";
+		SOIL_save_image(actualPath.c_str(), SOIL_SAVE_TYPE_PNG, actual.width, actual.height, 4, actual.pixels.data());
+		return false;
+	}
+	reference.pixels.assign(pixels, pixels + (size_t)reference.width * reference.height * 4);
+	SOIL_free_image_data(pixels);
+
+	UImage diff;
+	UImageDifference difference = UCompareImages(reference, actual, tolerance, &diff);
+	bool passed = !difference.sizeMismatch && difference.differentPixels <= fraction * difference.totalPixels;
+
+	if (difference.sizeMismatch) {
+		cout << frame.name << ": FAIL, reference is " << reference.width << "x" << reference.height
+			<< ", frame is " << actual.width << "x" << actual.height << endl;
+	}
+	else {
+		cout << frame.name << ": " << (passed ? "ok" : "FAIL") << ", " << difference.differentPixels << " of "
+			<< difference.totalPixels << " pixels differ, max delta " << difference.maxDelta << endl;
+	}
+
+	if (!passed) {
+		string actualPath = frame.name + "_actual.png", diffPath = frame.name + "_diff.png";
+		SOIL_save_image(actualPath.c_str(), SOIL_SAVE_TYPE_PNG, actual.width, actual.height, 4, actual.pixels.data());
+		if (!difference.sizeMismatch) {
+			SOIL_save_image(diffPath.c_str(), SOIL_SAVE_TYPE_PNG, diff.width, diff.height, 4, diff.pixels.data());
+		}
+	}
+	return passed;
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	glutInit(&argc, argv);
+
+	bool update = false;
+	string directory = "golden";
+	float tolerance = CompareJustNoticeable;
+	float fraction = 0.001f;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-update") == 0) {
+			update = true;
+		}
+		else if (strcmp(argv[i], "-dir") == 0 && i + 1 < argc) {
+			directory = argv[++i];
+		}
+		else if (strcmp(argv[i], "-tolerance") == 0 && i + 1 < argc) {
+			char* end;
+			double value = strtod(argv[++i], &end);
+			if (end == argv[i] || *end != '\0' || !(value >= 0.0 && value <= 100.0)) {
+				cout << "-tolerance needs a delta E between 0 and 100, not " << argv[i] << endl;
+				return 1;
+			}
+			tolerance = (float)value;
+		}
+		else if (strcmp(argv[i], "-fraction") == 0 && i + 1 < argc) {
+			char* end;
+			double value = strtod(argv[++i], &end);
+			if (end == argv[i] || *end != '\0' || !(value >= 0.0 && value <= 1.0)) {
+				cout << "-fraction needs a value between 0 and 1, not " << argv[i] << endl;
+				return 1;
+			}
+			fraction = (float)value;
+		}
+		else {
+			cout << "Unknown argument " << argv[i] << endl;
+			return 1;
+		}
+	}
+
+	glutInitDisplayMode(GLUT_RGBA);
+	glutInitWindowSize(64, 64);
+	glutCreateWindow("RenderCheck");
+	glutHideWindow();
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK) {
+		cout << "Failed to initialize GLEW" << endl;
+		return 1;
+	}
+	cout << "INFO: OpenGL Renderer: " << glGetString(GL_RENDERER) << endl;
+
+	// Offscreen target, independent of whatever the window system gives us
+	GLuint framebuffer, renderbuffers[2];
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(2, renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, Width, Height);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, Width, Height);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		cout << "Offscreen framebuffer is incomplete" << endl;
+		return 1;
+	}
+	glViewport(0, 0, Width, Height);
+	glEnable(GL_DEPTH_TEST);
+
+	GLuint colorProgram = UCreateProgram(ColorVertexShader, ColorFragmentShader);
+	GLuint texturedProgram = UCreateProgram(TexturedVertexShader, TexturedFragmentShader);
+	const GLchar* litSources[] = { "#version 330\n", ShadowCascadesShader, LitFragmentShader };
+	GLuint litProgram = UCreateProgram(LitVertexShader, 3, litSources);
+	GLuint shadowProgram = UCreateProgram(ShadowVertexShader, ShadowFragmentShader);
+	GLuint texture = UCreateCheckerTexture();
+
+	// Two frames in flight: frame n is read back while frame n + 1 renders
+	URenderFrame frames[2];
+	int frameCount = 0, failures = 0;
+
+	for (size_t s = 0; s < sizeof(Scenes) / sizeof(Scenes[0]); ++s) {
+		const URenderScene& scene = Scenes[s];
+		GLuint buffers[2];
+		GLuint vertexArray = UCreateSceneArray(scene, buffers);
+		GLuint program = scene.textured ? texturedProgram : colorProgram;
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, scene.textured ? texture : 0);
+		URenderFloor floor = { 0, 0, 0.0f };
+		if (scene.shadowed) {
+			floor = UCreateFloor(scene);
+		}
+
+		// Clip space scenes have nothing for a camera to change
+		size_t cameraCount = scene.flat ? 1 : sizeof(Cameras) / sizeof(Cameras[0]);
+		for (size_t c = 0; c < cameraCount; ++c) {
+			// The floor hides a shadowed scene from below
+			if (scene.shadowed && Cameras[c].eye.y < 0.0f) {
+				continue;
+			}
+			if (scene.shadowed) {
+				UDrawShadowedScene(scene, Cameras[c], litProgram, shadowProgram, vertexArray, floor, framebuffer);
+			}
+			else {
+				UDrawScene(scene, Cameras[c], program, vertexArray);
+			}
+
+			URenderFrame& frame = frames[frameCount % 2];
+			frame.name = string(scene.name) + "_" + Cameras[c].name;
+			frame.readback.Start(0, 0, Width, Height);
+
+			if (frameCount > 0 && !UCheckFrame(frames[(frameCount - 1) % 2], directory, update, tolerance, fraction)) {
+				++failures;
+			}
+			++frameCount;
+		}
+
+		glDeleteVertexArrays(1, &vertexArray);
+		glDeleteBuffers(2, buffers);
+		if (scene.shadowed) {
+			glDeleteVertexArrays(1, &floor.vertexArray);
+			glDeleteBuffers(1, &floor.buffer);
+		}
+	}
+	if (frameCount > 0 && !UCheckFrame(frames[(frameCount - 1) % 2], directory, update, tolerance, fraction)) {
+		++failures;
+	}
+
+	frames[0].readback.Destroy();
+	frames[1].readback.Destroy();
+	glDeleteTextures(1, &texture);
+	glDeleteProgram(colorProgram);
+	glDeleteProgram(texturedProgram);
+	glDeleteProgram(litProgram);
+	glDeleteProgram(shadowProgram);
+	glDeleteRenderbuffers(2, renderbuffers);
+	glDeleteFramebuffers(1, &framebuffer);
+
+	cout << frameCount - failures << " of " << frameCount << " frames match" << endl;
+	return failures == 0 ? 0 : 1;
+}
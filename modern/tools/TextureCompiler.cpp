@@ -0,0 +1,68 @@
+/*
+ * @author Jacob William
+ * @desc Offline texture compiler, encodes an image and its mip chain into
+ *       the compressed texture file read by ULoadCompressedTexture
+ *
+ *       TextureCompiler snhu.JPG snhu.utex [bc1|bc3|etc2]
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+
+// SOIL2 library import
+#include "SOIL2/SOIL2.h"
+
+#include "../common/MipGenerator.h"
+#include "../common/TextureCompression.h"
+
+// Use the standard name spaces
+using namespace std;
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	if (argc < 3) {
+		cout << "usage: TextureCompiler input output.utex [bc1|bc3|etc2]" << endl;
+		return 1;
+	}
+
+	UTextureCodec codec = UCodecBC1;
+	if (argc > 3) {
+		if (strcmp(argv[3], "bc3") == 0) {
+			codec = UCodecBC3;
+		}
+		else if (strcmp(argv[3], "etc2") == 0) {
+			codec = UCodecETC2;
+		}
+	}
+
+	UImage image;
+	unsigned char* pixels = SOIL_load_image(argv[1], &image.width, &image.height, 0, SOIL_LOAD_RGBA);
+	if (pixels == NULL) {
+		cout << "Failed to load " << argv[1] << endl;
+		return 1;
+	}
+	image.pixels.assign(pixels, pixels + (size_t)image.width * image.height * 4);
+	SOIL_free_image_data(pixels);
+
+	auto start = chrono::steady_clock::now();
+	UJobSystem jobs;
+	vector<UImage> levels = UGenerateMipChain(jobs, image);
+	if (!UWriteCompressedTexture(argv[2], levels, codec)) {
+		cout << "Failed to write " << argv[2] << endl;
+		return 1;
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	size_t raw = 0, compressed = 0;
+	for (size_t l = 0; l < levels.size(); ++l) {
+		raw += (size_t)levels[l].width * levels[l].height * 3;
+		compressed += (size_t)((levels[l].width + 3) / 4) * ((levels[l].height + 3) / 4) * UCodecBlockBytes(codec);
+	}
+
+	cout << argv[2] << ": " << image.width << "x" << image.height << ", " << levels.size() << " levels, "
+		<< compressed / 1024 << " KiB (RGB8 with mips " << raw / 1024 << " KiB), encoded in "
+		<< seconds * 1000.0 << " ms" << endl;
+	return 0;
+}